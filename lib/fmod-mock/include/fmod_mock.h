@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * In-process stand-in for the subset of the FMOD Core API the engine uses,
+ * so the engine builds and runs natively without the FMOD libraries.
+ *
+ * Differences from FMOD:
+ * - Time only advances in `System::update`, which mixes exactly one block
+ *   of the DSP buffer length whatever the output type. Runs are therefore
+ *   deterministic, and `FMOD_OUTPUTTYPE_NOSOUND(_NRT)` never plays.
+ * - Sounds decode fully on creation; non-blocking loads are ready (or
+ *   failed) when `createSound` returns.
+ * - Supported formats are PCM WAV (8/16/24/32-bit, float), raw PCM via
+ *   `FMOD_OPENRAW`, and mock banks (see `bank`) in place of FSB files,
+ *   whose compressed codecs are not decoded. Cue points of WAV files,
+ *   named by their `labl` chunks, become sync points.
+ * - Reverb properties are stored but not mixed; CPU usage reads zero.
+ * - Functions outside the subset are not defined, so code that starts
+ *   using one fails to link instead of misbehaving.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// RIFF form type of mock banks
+#define FMOD_MOCK_BANK_FORM "FSBM"
+
+namespace FMOD::Mock
+{
+    /**
+     * A named WAV cue point
+     */
+    struct Marker
+    {
+        std::string name;
+        // Offset in sample frames
+        uint32_t offset;
+    };
+
+    namespace detail
+    {
+        inline void put(std::string &out, uint32_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i)
+                out.push_back((char)((value >> (i * 8)) & 0xFF));
+        }
+
+        inline void chunk(std::string &out, std::string_view id,
+            std::string_view body)
+        {
+            out.append(id);
+            put(out, (uint32_t)body.size(), 4);
+            out.append(body);
+            if (body.size() & 1)
+                out.push_back(0);
+        }
+    }
+
+    /**
+     * Encode a 32-bit float WAV file in memory, for tests and tools
+     *
+     * @param samples - interleaved samples, `frames * channels` long
+     * @param frames - number of sample frames
+     * @param channels - number of channels
+     * @param rate - sample rate in Hz
+     * @param markers - cue points to embed
+     */
+    inline std::string wav(const float *samples, uint32_t frames,
+        int channels, int rate, const std::vector<Marker> &markers = {})
+    {
+        using detail::put;
+
+        std::string fmt;
+        put(fmt, 3, 2); // WAVE_FORMAT_IEEE_FLOAT
+        put(fmt, channels, 2);
+        put(fmt, rate, 4);
+        put(fmt, rate * channels * 4, 4);
+        put(fmt, channels * 4, 2);
+        put(fmt, 32, 2);
+
+        std::string body("WAVE");
+        detail::chunk(body, "fmt ", fmt);
+        detail::chunk(body, "data", std::string_view(
+            reinterpret_cast<const char *>(samples),
+            (size_t)frames * channels * sizeof(float)));
+
+        if (!markers.empty())
+        {
+            std::string cue, labels("adtl");
+            put(cue, (uint32_t)markers.size(), 4);
+            for (uint32_t i = 0; i < markers.size(); ++i)
+            {
+                put(cue, i + 1, 4);                 // id
+                put(cue, markers[i].offset, 4);     // position
+                cue.append("data");
+                put(cue, 0, 4);                     // chunk start
+                put(cue, 0, 4);                     // block start
+                put(cue, markers[i].offset, 4);     // sample offset
+
+                std::string label;
+                put(label, i + 1, 4);
+                label.append(markers[i].name);
+                label.push_back(0);
+                detail::chunk(labels, "labl", label);
+            }
+
+            detail::chunk(body, "cue ", cue);
+            detail::chunk(body, "LIST", labels);
+        }
+
+        std::string out;
+        detail::chunk(out, "RIFF", body);
+        return out;
+    }
+
+    /**
+     * Pack WAV files into a mock bank, each becoming a subsound in order
+     *
+     * @param wavs - whole WAV files, e.g. from `wav`
+     */
+    inline std::string bank(const std::vector<std::string> &wavs)
+    {
+        std::string body(FMOD_MOCK_BANK_FORM);
+        for (const auto &file : wavs)
+        {
+            body.append(file);
+            if (file.size() & 1)
+                body.push_back(0);
+        }
+
+        std::string out;
+        detail::chunk(out, "RIFF", body);
+        return out;
+    }
+}
@@ -0,0 +1,1021 @@
+#include "Mock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+namespace FMOD::Mock
+{
+    // Channel handle table, grown in chunks that are never moved or freed,
+    // so handles resolve without locking
+    static constexpr unsigned int CHUNK_SIZE = 256;
+    static constexpr unsigned int MAX_CHUNKS = 1024;
+
+    // Handle bits: slot index above INDEX_SHIFT, generation below it, and
+    // the lowest bit set
+    static constexpr int INDEX_SHIFT = sizeof(uintptr_t) * 4;
+    static constexpr uintptr_t GENERATION_MASK =
+        ((uintptr_t)1 << (INDEX_SHIFT - 1)) - 1;
+
+    static std::atomic<ChannelImpl *> s_chunks[MAX_CHUNKS];
+    static unsigned int s_slots;
+    static std::vector<unsigned int> s_free;
+    static std::mutex s_tableMutex;
+
+    static ChannelImpl *slot(unsigned int index)
+    {
+        auto chunk = s_chunks[index / CHUNK_SIZE].load(
+            std::memory_order_acquire);
+        return chunk ? chunk + index % CHUNK_SIZE : nullptr;
+    }
+
+
+    Channel *channelHandle(const ChannelImpl *channel)
+    {
+        const auto value = ((uintptr_t)channel->index << INDEX_SHIFT) |
+            ((uintptr_t)(channel->generation & GENERATION_MASK) << 1) | 1;
+        return reinterpret_cast<Channel *>(value);
+    }
+
+
+    ChannelImpl *channel(Channel *handle)
+    {
+        const auto value = reinterpret_cast<uintptr_t>(handle);
+        if (!(value & 1))
+            return nullptr;
+
+        const auto index = (unsigned int)(value >> INDEX_SHIFT);
+        if (index / CHUNK_SIZE >= MAX_CHUNKS)
+            return nullptr;
+
+        auto chan = slot(index);
+        if (!chan || !chan->system ||
+            (chan->generation & GENERATION_MASK) !=
+                ((value >> 1) & GENERATION_MASK))
+        {
+            return nullptr;
+        }
+
+        return chan;
+    }
+
+
+    ControlImpl *control(ChannelControl *handle)
+    {
+        const auto value = reinterpret_cast<uintptr_t>(handle);
+        if (value & 1)
+            return channel(reinterpret_cast<Channel *>(handle));
+
+        return reinterpret_cast<GroupImpl *>(handle);
+    }
+
+
+    ChannelImpl *acquireChannel()
+    {
+        std::lock_guard lock(s_tableMutex);
+
+        unsigned int index;
+        if (!s_free.empty())
+        {
+            index = s_free.back();
+            s_free.pop_back();
+        }
+        else
+        {
+            if (s_slots / CHUNK_SIZE >= MAX_CHUNKS)
+                throw std::bad_alloc();
+
+            index = s_slots;
+            if (index % CHUNK_SIZE == 0)
+            {
+                // The table outlives every system, it's never freed
+                auto chunk = new ChannelImpl[CHUNK_SIZE];
+                for (unsigned int i = 0; i < CHUNK_SIZE; ++i)
+                {
+                    chunk[i].system = nullptr;
+                    chunk[i].index = index + i;
+                    chunk[i].generation = 0;
+                }
+                s_chunks[index / CHUNK_SIZE].store(chunk,
+                    std::memory_order_release);
+            }
+
+            // reserve up front, so releasing never allocates
+            s_free.reserve(index + 1);
+            ++s_slots;
+        }
+
+        return slot(index);
+    }
+
+
+    void releaseChannel(ChannelImpl *channel)
+    {
+        channel->system = nullptr;
+        channel->sound = nullptr;
+        channel->fades.clear();
+        channel->matrix.clear();
+        channel->dsps.clear();
+        ++channel->generation;
+
+        std::lock_guard lock(s_tableMutex);
+        s_free.emplace_back(channel->index);
+    }
+
+
+    void initControl(ControlImpl &control, SystemImpl *system, bool isGroup)
+    {
+        control.system = system;
+        control.parent = nullptr;
+        control.isGroup = isGroup;
+        control.volume = 1.f;
+        control.paused = false;
+        control.mute = false;
+        control.delayStart = 0;
+        control.delayEnd = 0;
+        control.stopAtEnd = false;
+        control.fades.clear();
+        control.matrix.clear();
+        control.matrixOut = 0;
+        control.matrixIn = 0;
+        std::fill(std::begin(control.reverb), std::end(control.reverb), 0.f);
+        control.dsps.assign(1, nullptr); // the fader
+        control.userData = nullptr;
+    }
+
+
+    template <typename T>
+    static void erase(std::vector<T *> &list, T *item)
+    {
+        auto it = std::find(list.begin(), list.end(), item);
+        if (it != list.end())
+            list.erase(it);
+    }
+
+
+    void attach(ChannelImpl &channel, GroupImpl *group)
+    {
+        if (!group)
+            group = channel.system->master;
+
+        group->channels.reserve(group->channels.size() + 1);
+        if (channel.parent)
+            erase(channel.parent->channels, &channel);
+
+        group->channels.emplace_back(&channel);
+        channel.parent = group;
+    }
+
+
+    void attach(GroupImpl &group, GroupImpl *parent)
+    {
+        if (!parent)
+            parent = group.system->master;
+
+        parent->groups.reserve(parent->groups.size() + 1);
+        if (group.parent)
+            erase(group.parent->groups, &group);
+
+        parent->groups.emplace_back(&group);
+        group.parent = parent;
+    }
+
+
+    void stopChannel(ChannelImpl &channel)
+    {
+        auto sys = channel.system;
+
+        for (auto dsp : channel.dsps)
+        {
+            if (dsp)
+                dsp->owner = nullptr;
+        }
+
+        if (channel.parent)
+            erase(channel.parent->channels, &channel);
+        erase(sys->channels, &channel);
+        releaseChannel(&channel);
+    }
+
+
+    void stopGroup(GroupImpl &group)
+    {
+        while (!group.channels.empty())
+            stopChannel(*group.channels.back());
+
+        for (auto child : group.groups)
+            stopGroup(*child);
+    }
+
+
+    void releaseGroup(GroupImpl &group)
+    {
+        auto sys = group.system;
+        auto parent = group.parent ? group.parent : sys->master;
+
+        // Children return to the parent, as in FMOD
+        while (!group.channels.empty())
+            attach(*group.channels.back(), parent);
+        while (!group.groups.empty())
+            attach(*group.groups.back(), parent);
+
+        for (auto dsp : group.dsps)
+        {
+            if (dsp)
+                dsp->owner = nullptr;
+        }
+
+        erase(parent->groups, &group);
+        erase(sys->groups, &group);
+        delete &group;
+    }
+
+
+    float fadeVolume(const ControlImpl &control, unsigned long long clock)
+    {
+        const auto &fades = control.fades;
+        if (fades.empty())
+            return 1.f;
+        if (clock <= fades.front().clock)
+            return fades.front().volume;
+        if (clock >= fades.back().clock)
+            return fades.back().volume;
+
+        auto next = std::upper_bound(fades.begin(), fades.end(), clock,
+            [](unsigned long long clock, const FadePoint &point) {
+                return clock < point.clock;
+            });
+        auto prev = next - 1;
+
+        const auto t = (double)(clock - prev->clock) /
+            (double)(next->clock - prev->clock);
+        return (float)(prev->volume + (next->volume - prev->volume) * t);
+    }
+
+
+    bool toPCM(unsigned int value, FMOD_TIMEUNIT unit, float frequency,
+        int channels, int bits, unsigned int *result)
+    {
+        switch(unit)
+        {
+        case FMOD_TIMEUNIT_PCM:
+            *result = value;
+            return true;
+        case FMOD_TIMEUNIT_MS:
+            *result = (unsigned int)((double)value * frequency / 1000.0);
+            return true;
+        case FMOD_TIMEUNIT_PCMBYTES:
+            *result = (channels && bits) ? value / (channels * bits / 8) : 0;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+
+    bool fromPCM(unsigned int pcm, FMOD_TIMEUNIT unit, float frequency,
+        int channels, int bits, unsigned int *result)
+    {
+        switch(unit)
+        {
+        case FMOD_TIMEUNIT_PCM:
+            *result = pcm;
+            return true;
+        case FMOD_TIMEUNIT_MS:
+            *result = frequency > 0 ?
+                (unsigned int)((double)pcm * 1000.0 / frequency) : 0;
+            return true;
+        case FMOD_TIMEUNIT_PCMBYTES:
+            *result = pcm * (unsigned int)(channels * bits / 8);
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+
+using namespace FMOD::Mock;
+
+// Resolve `this`, returning FMOD_ERR_INVALID_HANDLE for ended channels
+#define MOCK_CONTROL(name) \
+    auto name = control(this); \
+    if (!name) return FMOD_ERR_INVALID_HANDLE
+
+#define MOCK_CHANNEL(name) \
+    auto name = Mock::channel(this); \
+    if (!name) return FMOD_ERR_INVALID_HANDLE
+
+
+namespace FMOD
+{
+    // ----- ChannelControl ---------------------------------------------------
+
+    FMOD_RESULT F_API ChannelControl::getSystemObject(System **system)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!system)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *system = handle(ctrl->system);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::stop()
+    {
+        MOCK_CONTROL(ctrl);
+
+        if (ctrl->isGroup)
+            stopGroup(*static_cast<GroupImpl *>(ctrl));
+        else
+            stopChannel(*static_cast<ChannelImpl *>(ctrl));
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setPaused(bool paused)
+    {
+        MOCK_CONTROL(ctrl);
+        ctrl->paused = paused;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getPaused(bool *paused)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!paused)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *paused = ctrl->paused;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setVolume(float volume)
+    {
+        MOCK_CONTROL(ctrl);
+        ctrl->volume = volume;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getVolume(float *volume)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!volume)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *volume = ctrl->volume;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getAudibility(float *audibility)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!audibility)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *audibility = Mock::audibility(*ctrl);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setMute(bool mute)
+    {
+        MOCK_CONTROL(ctrl);
+        ctrl->mute = mute;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getMute(bool *mute)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!mute)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *mute = ctrl->mute;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setReverbProperties(int instance,
+        float wet)
+    {
+        MOCK_CONTROL(ctrl);
+        if (instance < 0 || instance >= FMOD_REVERB_MAXINSTANCES)
+            return FMOD_ERR_INVALID_PARAM;
+
+        // Stored only, reverb is not mixed
+        ctrl->reverb[instance] = wet;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getReverbProperties(int instance,
+        float *wet)
+    {
+        MOCK_CONTROL(ctrl);
+        if (instance < 0 || instance >= FMOD_REVERB_MAXINSTANCES || !wet)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *wet = ctrl->reverb[instance];
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::isPlaying(bool *isplaying)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!isplaying)
+            return FMOD_ERR_INVALID_PARAM;
+
+        if (!ctrl->isGroup)
+        {
+            *isplaying = !static_cast<ChannelImpl *>(ctrl)->ended;
+            return FMOD_OK;
+        }
+
+        // A group plays while any channel below it does
+        std::vector<GroupImpl *> stack{static_cast<GroupImpl *>(ctrl)};
+        *isplaying = false;
+        while (!stack.empty() && !*isplaying)
+        {
+            auto group = stack.back();
+            stack.pop_back();
+
+            for (auto chan : group->channels)
+            {
+                if (!chan->ended)
+                    *isplaying = true;
+            }
+            stack.insert(stack.end(), group->groups.begin(),
+                group->groups.end());
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setMixMatrix(float *matrix,
+        int outchannels, int inchannels, int inchannel_hop)
+    {
+        MOCK_CONTROL(ctrl);
+
+        if (!matrix)
+        {
+            ctrl->matrix.clear();
+            ctrl->matrixOut = ctrl->matrixIn = 0;
+            return FMOD_OK;
+        }
+
+        if (outchannels <= 0 || inchannels <= 0 ||
+            outchannels > FMOD_MAX_CHANNEL_WIDTH ||
+            inchannels > FMOD_MAX_CHANNEL_WIDTH)
+        {
+            return FMOD_ERR_INVALID_PARAM;
+        }
+
+        if (inchannel_hop == 0)
+            inchannel_hop = inchannels;
+        if (inchannel_hop < inchannels)
+            return FMOD_ERR_INVALID_PARAM;
+
+        ctrl->matrix.resize((size_t)outchannels * inchannels);
+        for (int o = 0; o < outchannels; ++o)
+        {
+            for (int i = 0; i < inchannels; ++i)
+                ctrl->matrix[o * inchannels + i] = matrix[o * inchannel_hop + i];
+        }
+
+        ctrl->matrixOut = outchannels;
+        ctrl->matrixIn = inchannels;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getMixMatrix(float *matrix,
+        int *outchannels, int *inchannels, int inchannel_hop)
+    {
+        MOCK_CONTROL(ctrl);
+
+        if (outchannels)
+            *outchannels = ctrl->matrixOut;
+        if (inchannels)
+            *inchannels = ctrl->matrixIn;
+
+        if (matrix)
+        {
+            if (inchannel_hop == 0)
+                inchannel_hop = ctrl->matrixIn;
+
+            for (int o = 0; o < ctrl->matrixOut; ++o)
+            {
+                for (int i = 0; i < ctrl->matrixIn; ++i)
+                    matrix[o * inchannel_hop + i] =
+                        ctrl->matrix[o * ctrl->matrixIn + i];
+            }
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getDSPClock(
+        unsigned long long *dspclock, unsigned long long *parentclock)
+    {
+        MOCK_CONTROL(ctrl);
+
+        // Everything runs at the mixer rate, so all clocks are the system's
+        if (dspclock)
+            *dspclock = ctrl->system->clock;
+        if (parentclock)
+            *parentclock = ctrl->system->clock;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setDelay(
+        unsigned long long dspclock_start, unsigned long long dspclock_end,
+        bool stopchannels)
+    {
+        MOCK_CONTROL(ctrl);
+        if (dspclock_end && dspclock_end < dspclock_start)
+            return FMOD_ERR_INVALID_PARAM;
+
+        ctrl->delayStart = dspclock_start;
+        ctrl->delayEnd = dspclock_end;
+        ctrl->stopAtEnd = stopchannels;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getDelay(
+        unsigned long long *dspclock_start, unsigned long long *dspclock_end,
+        bool *stopchannels)
+    {
+        MOCK_CONTROL(ctrl);
+
+        if (dspclock_start)
+            *dspclock_start = ctrl->delayStart;
+        if (dspclock_end)
+            *dspclock_end = ctrl->delayEnd;
+        if (stopchannels)
+            *stopchannels = ctrl->stopAtEnd;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::addFadePoint(
+        unsigned long long dspclock, float volume)
+    {
+        MOCK_CONTROL(ctrl);
+
+        auto &fades = ctrl->fades;
+        auto it = std::upper_bound(fades.begin(), fades.end(), dspclock,
+            [](unsigned long long clock, const FadePoint &point) {
+                return clock < point.clock;
+            });
+        fades.insert(it, FadePoint{.clock=dspclock, .volume=volume});
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::removeFadePoints(
+        unsigned long long dspclock_start, unsigned long long dspclock_end)
+    {
+        MOCK_CONTROL(ctrl);
+
+        auto &fades = ctrl->fades;
+        fades.erase(std::remove_if(fades.begin(), fades.end(),
+            [=](const FadePoint &point) {
+                return point.clock >= dspclock_start &&
+                    point.clock <= dspclock_end;
+            }), fades.end());
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getFadePoints(unsigned int *numpoints,
+        unsigned long long *point_dspclock, float *point_volume)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!numpoints)
+            return FMOD_ERR_INVALID_PARAM;
+
+        // When filling arrays, a nonzero count is taken as their capacity
+        const auto &fades = ctrl->fades;
+        auto count = (unsigned int)fades.size();
+        if ((point_dspclock || point_volume) && *numpoints)
+            count = std::min(count, *numpoints);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            if (point_dspclock)
+                point_dspclock[i] = fades[i].clock;
+            if (point_volume)
+                point_volume[i] = fades[i].volume;
+        }
+
+        *numpoints = count;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getDSP(int index, DSP **dsp)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!dsp || index < 0 || index >= (int)ctrl->dsps.size())
+            return FMOD_ERR_INVALID_PARAM;
+        if (!ctrl->dsps[index])
+            return FMOD_ERR_UNSUPPORTED; // the built-in fader
+
+        *dsp = handle(ctrl->dsps[index]);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::addDSP(int index, DSP *dsp)
+    {
+        MOCK_CONTROL(ctrl);
+        auto impl = Mock::dsp(dsp);
+        if (!impl)
+            return FMOD_ERR_INVALID_PARAM;
+
+        auto &chain = ctrl->dsps;
+        switch(index)
+        {
+        case FMOD_CHANNELCONTROL_DSP_HEAD:
+            index = 0;
+            break;
+        case FMOD_CHANNELCONTROL_DSP_FADER:
+            index = (int)(std::find(chain.begin(), chain.end(), nullptr) -
+                chain.begin());
+            break;
+        case FMOD_CHANNELCONTROL_DSP_TAIL:
+            index = (int)chain.size();
+            break;
+        default:
+            if (index < 0 || index > (int)chain.size())
+                return FMOD_ERR_INVALID_PARAM;
+        }
+
+        chain.reserve(chain.size() + 1);
+        if (impl->owner == ctrl)
+        {
+            // moving within the chain
+            auto it = std::find(chain.begin(), chain.end(), impl);
+            if (it - chain.begin() < index)
+                --index;
+            chain.erase(it);
+        }
+        else
+        {
+            detach(*impl);
+        }
+
+        chain.insert(chain.begin() + index, impl);
+        impl->owner = ctrl;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::removeDSP(DSP *dsp)
+    {
+        MOCK_CONTROL(ctrl);
+        auto impl = Mock::dsp(dsp);
+        if (!impl || impl->owner != ctrl)
+            return FMOD_ERR_INVALID_PARAM;
+
+        detach(*impl);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getNumDSPs(int *numdsps)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!numdsps)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *numdsps = (int)ctrl->dsps.size();
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getDSPIndex(DSP *dsp, int *index)
+    {
+        MOCK_CONTROL(ctrl);
+        auto impl = Mock::dsp(dsp);
+        if (!impl || !index)
+            return FMOD_ERR_INVALID_PARAM;
+
+        auto it = std::find(ctrl->dsps.begin(), ctrl->dsps.end(), impl);
+        if (it == ctrl->dsps.end())
+            return FMOD_ERR_DSP_NOTFOUND;
+
+        *index = (int)(it - ctrl->dsps.begin());
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::setUserData(void *userdata)
+    {
+        MOCK_CONTROL(ctrl);
+        ctrl->userData = userdata;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelControl::getUserData(void **userdata)
+    {
+        MOCK_CONTROL(ctrl);
+        if (!userdata)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *userdata = ctrl->userData;
+        return FMOD_OK;
+    }
+
+
+    // ----- Channel ----------------------------------------------------------
+
+    FMOD_RESULT F_API Channel::setFrequency(float frequency)
+    {
+        MOCK_CHANNEL(chan);
+        if (frequency < 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        chan->frequency = frequency;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::getFrequency(float *frequency)
+    {
+        MOCK_CHANNEL(chan);
+        if (!frequency)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *frequency = chan->frequency;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::setPriority(int priority)
+    {
+        MOCK_CHANNEL(chan);
+        if (priority < 0 || priority > 256)
+            return FMOD_ERR_INVALID_PARAM;
+
+        chan->priority = priority;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::getPriority(int *priority)
+    {
+        MOCK_CHANNEL(chan);
+        if (!priority)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *priority = chan->priority;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::setPosition(unsigned int position,
+        FMOD_TIMEUNIT postype)
+    {
+        MOCK_CHANNEL(chan);
+        auto snd = chan->sound;
+
+        unsigned int pcm;
+        if (!toPCM(position, postype, snd->frequency, snd->channels,
+            snd->bits, &pcm))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        if (pcm >= snd->length)
+            return FMOD_ERR_INVALID_POSITION;
+
+        chan->position = pcm;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::getPosition(unsigned int *position,
+        FMOD_TIMEUNIT postype)
+    {
+        MOCK_CHANNEL(chan);
+        if (!position)
+            return FMOD_ERR_INVALID_PARAM;
+
+        auto snd = chan->sound;
+        return fromPCM((unsigned int)chan->position, postype,
+            snd->frequency, snd->channels, snd->bits, position) ?
+            FMOD_OK : FMOD_ERR_FORMAT;
+    }
+
+
+    FMOD_RESULT F_API Channel::setChannelGroup(ChannelGroup *channelgroup)
+    {
+        MOCK_CHANNEL(chan);
+
+        try {
+            attach(*chan, Mock::group(channelgroup));
+        }
+        catch(const std::bad_alloc &)
+        {
+            return FMOD_ERR_MEMORY;
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::getChannelGroup(ChannelGroup **channelgroup)
+    {
+        MOCK_CHANNEL(chan);
+        if (!channelgroup)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *channelgroup = handle(chan->parent);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::setLoopPoints(unsigned int loopstart,
+        FMOD_TIMEUNIT loopstarttype, unsigned int loopend,
+        FMOD_TIMEUNIT loopendtype)
+    {
+        MOCK_CHANNEL(chan);
+        auto snd = chan->sound;
+
+        unsigned int start, end;
+        if (!toPCM(loopstart, loopstarttype, snd->frequency, snd->channels,
+                snd->bits, &start) ||
+            !toPCM(loopend, loopendtype, snd->frequency, snd->channels,
+                snd->bits, &end))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        if (start >= end)
+            return FMOD_ERR_INVALID_PARAM;
+
+        chan->loopStart = start;
+        chan->loopEnd = end;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::getLoopPoints(unsigned int *loopstart,
+        FMOD_TIMEUNIT loopstarttype, unsigned int *loopend,
+        FMOD_TIMEUNIT loopendtype)
+    {
+        MOCK_CHANNEL(chan);
+        auto snd = chan->sound;
+
+        if (loopstart && !fromPCM(chan->loopStart, loopstarttype,
+            snd->frequency, snd->channels, snd->bits, loopstart))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        if (loopend && !fromPCM(chan->loopEnd, loopendtype,
+            snd->frequency, snd->channels, snd->bits, loopend))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::isVirtual(bool *isvirtual)
+    {
+        MOCK_CHANNEL(chan);
+        if (!isvirtual)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *isvirtual = chan->isVirtual;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Channel::getCurrentSound(Sound **sound)
+    {
+        MOCK_CHANNEL(chan);
+        if (!sound)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *sound = handle(chan->sound);
+        return FMOD_OK;
+    }
+
+
+    // ----- ChannelGroup -----------------------------------------------------
+
+    FMOD_RESULT F_API ChannelGroup::release()
+    {
+        auto group = Mock::group(this);
+        if (group == group->system->master)
+            return FMOD_ERR_INVALID_HANDLE; // owned by the system
+
+        try {
+            releaseGroup(*group);
+        }
+        catch(const std::bad_alloc &)
+        {
+            return FMOD_ERR_MEMORY;
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::getParentGroup(ChannelGroup **group)
+    {
+        if (!group)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *group = handle(Mock::group(this)->parent);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::getNumGroups(int *numgroups)
+    {
+        if (!numgroups)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *numgroups = (int)Mock::group(this)->groups.size();
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::getGroup(int index, ChannelGroup **group)
+    {
+        const auto &groups = Mock::group(this)->groups;
+        if (!group || index < 0 || index >= (int)groups.size())
+            return FMOD_ERR_INVALID_PARAM;
+
+        *group = handle(groups[index]);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::addGroup(ChannelGroup *group,
+        bool propagatedspclock, DSPConnection **connection)
+    {
+        if (!group || group == this)
+            return FMOD_ERR_INVALID_PARAM;
+        if (connection)
+            *connection = nullptr;
+
+        try {
+            attach(*Mock::group(group), Mock::group(this));
+        }
+        catch(const std::bad_alloc &)
+        {
+            return FMOD_ERR_MEMORY;
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::getName(char *name, int namelen)
+    {
+        if (!name || namelen <= 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        std::strncpy(name, Mock::group(this)->name.c_str(), namelen - 1);
+        name[namelen - 1] = 0;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::getNumChannels(int *numchannels)
+    {
+        if (!numchannels)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *numchannels = (int)Mock::group(this)->channels.size();
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API ChannelGroup::getChannel(int index, Channel **channel)
+    {
+        const auto &channels = Mock::group(this)->channels;
+        if (!channel || index < 0 || index >= (int)channels.size())
+            return FMOD_ERR_INVALID_PARAM;
+
+        *channel = channelHandle(channels[index]);
+        return FMOD_OK;
+    }
+}
@@ -0,0 +1,212 @@
+#include "Mock.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+namespace FMOD::Mock
+{
+    static DSPImpl *owner(FMOD_DSP_STATE *state)
+    {
+        return static_cast<DSPImpl *>(state->instance);
+    }
+
+
+    static void *F_CALL stateAlloc(unsigned int size, FMOD_MEMORY_TYPE type,
+        const char *sourcestr)
+    {
+        return allocate(size);
+    }
+
+
+    static void *F_CALL stateRealloc(void *ptr, unsigned int size,
+        FMOD_MEMORY_TYPE type, const char *sourcestr)
+    {
+        return reallocate(ptr, size);
+    }
+
+
+    static void F_CALL stateFree(void *ptr, FMOD_MEMORY_TYPE type,
+        const char *sourcestr)
+    {
+        deallocate(ptr);
+    }
+
+
+    static FMOD_RESULT F_CALL stateGetSampleRate(FMOD_DSP_STATE *state,
+        int *rate)
+    {
+        *rate = owner(state)->system->samplerate;
+        return FMOD_OK;
+    }
+
+
+    static FMOD_RESULT F_CALL stateGetBlockSize(FMOD_DSP_STATE *state,
+        unsigned int *blocksize)
+    {
+        *blocksize = owner(state)->system->bufferLength;
+        return FMOD_OK;
+    }
+
+
+    static FMOD_RESULT F_CALL stateGetSpeakerMode(FMOD_DSP_STATE *state,
+        FMOD_SPEAKERMODE *speakermode_mixer,
+        FMOD_SPEAKERMODE *speakermode_output)
+    {
+        const auto mode = owner(state)->system->speakerMode;
+        if (speakermode_mixer)
+            *speakermode_mixer = mode;
+        if (speakermode_output)
+            *speakermode_output = mode;
+        return FMOD_OK;
+    }
+
+
+    static FMOD_RESULT F_CALL stateGetClock(FMOD_DSP_STATE *state,
+        unsigned long long *clock, unsigned int *offset,
+        unsigned int *length)
+    {
+        auto sys = owner(state)->system;
+        if (clock)
+            *clock = sys->clock;
+        if (offset)
+            *offset = 0;
+        if (length)
+            *length = sys->bufferLength;
+        return FMOD_OK;
+    }
+
+
+    static FMOD_RESULT F_CALL stateGetListenerAttributes(
+        FMOD_DSP_STATE *state, int *numlisteners,
+        FMOD_3D_ATTRIBUTES *attributes)
+    {
+        return FMOD_ERR_UNSUPPORTED;
+    }
+
+
+    static void F_CALL stateLog(FMOD_DEBUG_FLAGS level, const char *file,
+        int line, const char *function, const char *str, ...)
+    {
+        if (!(level & FMOD_DEBUG_LEVEL_ERROR))
+            return;
+
+        va_list args;
+        va_start(args, str);
+        std::fprintf(stderr, "[FMOD mock] %s: ", function);
+        std::vfprintf(stderr, str, args);
+        std::fputc('\n', stderr);
+        va_end(args);
+    }
+
+
+    static FMOD_RESULT F_CALL stateGetUserData(FMOD_DSP_STATE *state,
+        void **userdata)
+    {
+        *userdata = owner(state)->userData;
+        return FMOD_OK;
+    }
+
+
+    FMOD_DSP_STATE_FUNCTIONS stateFunctions = {
+        .alloc=stateAlloc,
+        .realloc=stateRealloc,
+        .free=stateFree,
+        .getsamplerate=stateGetSampleRate,
+        .getblocksize=stateGetBlockSize,
+        .dft=nullptr,
+        .pan=nullptr,
+        .getspeakermode=stateGetSpeakerMode,
+        .getclock=stateGetClock,
+        .getlistenerattributes=stateGetListenerAttributes,
+        .log=stateLog,
+        .getuserdata=stateGetUserData,
+    };
+
+
+    void detach(DSPImpl &dsp)
+    {
+        if (!dsp.owner)
+            return;
+
+        auto &chain = dsp.owner->dsps;
+        auto it = std::find(chain.begin(), chain.end(), &dsp);
+        if (it != chain.end())
+            chain.erase(it);
+        dsp.owner = nullptr;
+    }
+}
+
+
+using namespace FMOD::Mock;
+
+namespace FMOD
+{
+    FMOD_RESULT F_API DSP::release()
+    {
+        auto impl = Mock::dsp(this);
+        auto sys = impl->system;
+
+        detach(*impl);
+        if (impl->desc.release)
+            impl->desc.release(&impl->state);
+
+        auto it = std::find(sys->dsps.begin(), sys->dsps.end(), impl);
+        if (it != sys->dsps.end())
+            sys->dsps.erase(it);
+
+        delete impl;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API DSP::getSystemObject(System **system)
+    {
+        if (!system)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *system = handle(Mock::dsp(this)->system);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API DSP::setBypass(bool bypass)
+    {
+        Mock::dsp(this)->bypass = bypass;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API DSP::getBypass(bool *bypass)
+    {
+        if (!bypass)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *bypass = Mock::dsp(this)->bypass;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API DSP::reset()
+    {
+        auto impl = Mock::dsp(this);
+        return impl->desc.reset ? impl->desc.reset(&impl->state) : FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API DSP::setUserData(void *userdata)
+    {
+        Mock::dsp(this)->userData = userdata;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API DSP::getUserData(void **userdata)
+    {
+        if (!userdata)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *userdata = Mock::dsp(this)->userData;
+        return FMOD_OK;
+    }
+}
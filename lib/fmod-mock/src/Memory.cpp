@@ -0,0 +1,142 @@
+#include "Mock.h"
+
+#include <fmod.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace FMOD::Mock
+{
+    // Size header in front of each allocation, for the stats
+    static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    static FMOD_MEMORY_ALLOC_CALLBACK s_alloc;
+    static FMOD_MEMORY_FREE_CALLBACK s_free;
+
+    static std::atomic<int> s_systems;
+    static std::atomic<long long> s_current;
+    static std::atomic<long long> s_max;
+
+    void *allocate(size_t bytes)
+    {
+        const auto total = bytes + HEADER_SIZE;
+        if (total > 0xFFFFFFFFu)
+            return nullptr;
+
+        auto block = static_cast<char *>(s_alloc ?
+            s_alloc((unsigned int)total, FMOD_MEMORY_NORMAL, __FILE__) :
+            std::malloc(total));
+        if (!block)
+            return nullptr;
+
+        *reinterpret_cast<size_t *>(block) = bytes;
+
+        const auto current = s_current.fetch_add((long long)bytes,
+            std::memory_order_relaxed) + (long long)bytes;
+        auto max = s_max.load(std::memory_order_relaxed);
+        while (current > max &&
+            !s_max.compare_exchange_weak(max, current,
+                std::memory_order_relaxed))
+        { }
+
+        return block + HEADER_SIZE;
+    }
+
+
+    void *reallocate(void *ptr, size_t bytes)
+    {
+        if (!ptr)
+            return allocate(bytes);
+
+        auto resized = allocate(bytes);
+        if (!resized)
+            return nullptr;
+
+        const auto oldBytes = *reinterpret_cast<size_t *>(
+            static_cast<char *>(ptr) - HEADER_SIZE);
+        std::memcpy(resized, ptr, std::min(bytes, oldBytes));
+        deallocate(ptr);
+        return resized;
+    }
+
+
+    void deallocate(void *ptr)
+    {
+        if (!ptr)
+            return;
+
+        auto block = static_cast<char *>(ptr) - HEADER_SIZE;
+        s_current.fetch_sub((long long)*reinterpret_cast<size_t *>(block),
+            std::memory_order_relaxed);
+
+        if (s_free)
+            s_free(block, FMOD_MEMORY_NORMAL, __FILE__);
+        else
+            std::free(block);
+    }
+
+
+    void systemCreated()
+    {
+        s_systems.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    void systemReleased()
+    {
+        s_systems.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+
+    void *MockObject::operator new(size_t size)
+    {
+        auto ptr = allocate(size);
+        if (!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+
+    void MockObject::operator delete(void *ptr)
+    {
+        deallocate(ptr);
+    }
+}
+
+
+FMOD_RESULT F_API FMOD_Memory_Initialize(void *poolmem, int poollen,
+    FMOD_MEMORY_ALLOC_CALLBACK useralloc,
+    FMOD_MEMORY_REALLOC_CALLBACK userrealloc,
+    FMOD_MEMORY_FREE_CALLBACK userfree, FMOD_MEMORY_TYPE memtypeflags)
+{
+    using namespace FMOD::Mock;
+
+    if (s_systems.load(std::memory_order_relaxed) > 0)
+        return FMOD_ERR_INITIALIZED;
+
+    // Fixed pools are not supported, the mock only routes allocations
+    if (poolmem || poollen)
+        return FMOD_ERR_UNSUPPORTED;
+
+    if ((useralloc == nullptr) != (userfree == nullptr))
+        return FMOD_ERR_INVALID_PARAM;
+
+    s_alloc = useralloc;
+    s_free = userfree;
+    return FMOD_OK;
+}
+
+
+FMOD_RESULT F_API FMOD_Memory_GetStats(int *currentalloced, int *maxalloced,
+    FMOD_BOOL blocking)
+{
+    using namespace FMOD::Mock;
+
+    if (currentalloced)
+        *currentalloced = (int)s_current.load(std::memory_order_relaxed);
+    if (maxalloced)
+        *maxalloced = (int)s_max.load(std::memory_order_relaxed);
+    return FMOD_OK;
+}
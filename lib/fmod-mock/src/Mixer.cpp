@@ -0,0 +1,458 @@
+#include "Mock.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace FMOD::Mock
+{
+    // Widest signal a chain may carry
+    static constexpr int MAX_WIDTH = FMOD_MAX_CHANNEL_WIDTH;
+
+    /**
+     * Mix buffer `which` (0: sum, 1-2: chain work) of a graph depth
+     */
+    static float *buffer(SystemImpl &sys, size_t depth, int which)
+    {
+        const auto index = depth * 3 + which;
+        if (sys.scratch.size() <= index)
+            sys.scratch.resize(index + 1);
+
+        auto &buf = sys.scratch[index];
+        buf.resize((size_t)sys.bufferLength * MAX_WIDTH);
+        return buf.data();
+    }
+
+    /**
+     * Activity mask of a graph depth, one entry per frame
+     */
+    static char *activeMask(SystemImpl &sys, size_t depth)
+    {
+        if (sys.active.size() <= depth)
+            sys.active.resize(depth + 1);
+
+        auto &mask = sys.active[depth];
+        mask.resize(sys.bufferLength);
+        return mask.data();
+    }
+
+    /**
+     * Frames of this block where a control plays, given its parent's
+     *
+     * @return whether any frame is active
+     */
+    static bool computeActive(const ControlImpl &ctrl, const char *parent,
+        char *out, unsigned long long clock, unsigned int frames)
+    {
+        bool any = false;
+        for (unsigned int i = 0; i < frames; ++i)
+        {
+            const auto t = clock + i;
+            out[i] = parent[i] && !ctrl.paused && t >= ctrl.delayStart &&
+                (ctrl.delayEnd == 0 || t < ctrl.delayEnd);
+            any = any || out[i];
+        }
+        return any;
+    }
+
+    /**
+     * Apply the volume, fade and mix matrix of a control
+     */
+    static void fader(SystemImpl &sys, const ControlImpl &ctrl,
+        const float *in, int inChannels, float *out, int &outChannels,
+        const char *active)
+    {
+        const auto frames = sys.bufferLength;
+        const auto outWidth = ctrl.matrix.empty() ? sys.outChannels :
+            ctrl.matrixOut;
+
+        std::fill(out, out + (size_t)frames * outWidth, 0.f);
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            if (!active[f] || ctrl.mute)
+                continue;
+
+            const auto gain = ctrl.volume * fadeVolume(ctrl, sys.clock + f);
+            const auto src = in + (size_t)f * inChannels;
+            const auto dst = out + (size_t)f * outWidth;
+
+            if (!ctrl.matrix.empty())
+            {
+                const auto width = std::min(inChannels, ctrl.matrixIn);
+                for (int o = 0; o < outWidth; ++o)
+                {
+                    float sum = 0;
+                    for (int i = 0; i < width; ++i)
+                        sum += ctrl.matrix[o * ctrl.matrixIn + i] * src[i];
+                    dst[o] = sum * gain;
+                }
+            }
+            else if (inChannels == 1 && outWidth > 1)
+            {
+                // Centered, constant power
+                for (int o = 0; o < outWidth; ++o)
+                    dst[o] = src[0] * gain * 0.70710678f;
+            }
+            else
+            {
+                for (int i = 0; i < inChannels; ++i)
+                    dst[i % outWidth] += src[i] * gain;
+            }
+        }
+
+        outChannels = outWidth;
+    }
+
+    /**
+     * Run a control's DSP chain from its tail to its head
+     *
+     * @param buf - signal in, the chain's output out
+     * @param other - spare buffer of the same size
+     * @param channels - width of the signal in, and out
+     * @param runEffects - whether to run the DSPs other than the fader
+     */
+    static void runChain(SystemImpl &sys, ControlImpl &ctrl, float *&buf,
+        float *&other, int &channels, const char *active, bool runEffects)
+    {
+        for (size_t i = ctrl.dsps.size(); i-- > 0;)
+        {
+            auto dsp = ctrl.dsps[i];
+            if (!dsp)
+            {
+                int outChannels;
+                fader(sys, ctrl, buf, channels, other, outChannels, active);
+                std::swap(buf, other);
+                channels = outChannels;
+                continue;
+            }
+
+            if (!runEffects || dsp->bypass || !dsp->desc.read)
+                continue;
+
+            int outChannels = channels;
+            const auto result = dsp->desc.read(&dsp->state, buf, other,
+                sys.bufferLength, channels, &outChannels);
+            if (result != FMOD_OK || outChannels <= 0 ||
+                outChannels > MAX_WIDTH)
+            {
+                continue; // leave the signal as is, like a bypass
+            }
+
+            std::swap(buf, other);
+            channels = outChannels;
+        }
+    }
+
+    /**
+     * Decode one block of a channel's sound, advancing its playhead
+     * through active frames only
+     */
+    static void render(SystemImpl &sys, ChannelImpl &chan, float *out,
+        const char *active)
+    {
+        const auto &snd = *chan.sound;
+        const auto frames = sys.bufferLength;
+        const auto width = snd.channels;
+        const auto length = snd.length;
+        const auto data = snd.samples.data();
+
+        const bool loop = (chan.mode & FMOD_LOOP_NORMAL) && length > 0;
+        const auto loopEnd = std::min(chan.loopEnd, length - 1);
+        const auto loopStart = std::min(chan.loopStart, loopEnd);
+        const auto step = (double)chan.frequency / sys.samplerate;
+
+        std::fill(out, out + (size_t)frames * width, 0.f);
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            if (!active[f])
+                continue;
+            if (chan.ended)
+                break;
+
+            const auto index = (unsigned int)chan.position;
+            if (!chan.isVirtual)
+            {
+                const auto frac = (float)(chan.position - index);
+                auto next = index + 1;
+                if (loop && next > loopEnd)
+                    next = loopStart;
+                else if (next >= length)
+                    next = index;
+
+                const auto a = data + (size_t)index * width;
+                const auto b = data + (size_t)next * width;
+                const auto dst = out + (size_t)f * width;
+                for (int c = 0; c < width; ++c)
+                    dst[c] = a[c] + (b[c] - a[c]) * frac;
+            }
+
+            chan.position += step;
+            if (loop)
+            {
+                const auto span = (double)loopEnd + 1 - loopStart;
+                while (chan.position >= (double)loopEnd + 1)
+                    chan.position -= span;
+            }
+            else if (chan.position >= length)
+            {
+                chan.position = length;
+                chan.ended = true;
+            }
+        }
+    }
+
+    static void addInto(float *sum, int sumChannels, const float *in,
+        int inChannels, unsigned int frames)
+    {
+        const auto width = std::min(sumChannels, inChannels);
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            for (int c = 0; c < width; ++c)
+                sum[(size_t)f * sumChannels + c] +=
+                    in[(size_t)f * inChannels + c];
+        }
+    }
+
+    /**
+     * Mix a group and everything under it into the depth's sum buffer
+     *
+     * @return the group's output, `sys.outChannels` wide
+     */
+    static const float *mixGroup(SystemImpl &sys, GroupImpl &group,
+        size_t depth, const char *parentActive)
+    {
+        const auto frames = sys.bufferLength;
+        const auto width = sys.outChannels;
+
+        auto active = activeMask(sys, depth);
+        computeActive(group, parentActive, active, sys.clock, frames);
+
+        auto sum = buffer(sys, depth, 0);
+        std::fill(sum, sum + (size_t)frames * width, 0.f);
+
+        for (size_t i = 0; i < group.groups.size(); ++i)
+        {
+            auto out = mixGroup(sys, *group.groups[i], depth + 1, active);
+            addInto(sum, width, out, width, frames);
+        }
+
+        for (size_t i = 0; i < group.channels.size(); ++i)
+        {
+            auto &chan = *group.channels[i];
+            auto chanActive = activeMask(sys, depth + 1);
+            const bool any = computeActive(chan, active, chanActive,
+                sys.clock, frames);
+
+            auto buf = buffer(sys, depth + 1, 1);
+            auto other = buffer(sys, depth + 1, 2);
+            render(sys, chan, buf, chanActive);
+
+            int channels = chan.sound->channels;
+            runChain(sys, chan, buf, other, channels, chanActive,
+                any && !chan.isVirtual);
+            addInto(sum, width, buf, channels, frames);
+        }
+
+        // Groups keep processing while silent, effect tails ring out
+        float *buf = sum;
+        float *other = buffer(sys, depth, 1);
+        int channels = width;
+        runChain(sys, group, buf, other, channels, active, true);
+
+        if (buf != sum)
+            std::copy(buf, buf + (size_t)frames * width, sum);
+        if (channels < width)
+        {
+            for (unsigned int f = frames; f-- > 0;)
+            {
+                for (int c = width; c-- > 0;)
+                {
+                    sum[(size_t)f * width + c] = (c < channels) ?
+                        sum[(size_t)f * channels + c] : 0.f;
+                }
+            }
+        }
+        return sum;
+    }
+
+    /**
+     * Apply the end of delays, pause or stop, and drop passed fade points
+     */
+    static void advanceControl(ControlImpl &ctrl, unsigned long long clock)
+    {
+        auto &fades = ctrl.fades;
+        size_t passed = 0;
+        while (fades.size() - passed >= 2 && fades[passed + 1].clock <= clock)
+            ++passed;
+        fades.erase(fades.begin(), fades.begin() + passed);
+
+        if (ctrl.delayEnd == 0 || ctrl.delayEnd > clock)
+            return;
+
+        if (ctrl.stopAtEnd)
+        {
+            if (ctrl.isGroup)
+                stopGroup(static_cast<GroupImpl &>(ctrl));
+            else
+                static_cast<ChannelImpl &>(ctrl).ended = true;
+        }
+        else
+        {
+            ctrl.paused = true;
+        }
+        ctrl.delayEnd = 0;
+    }
+
+    static void advanceGroup(GroupImpl &group, unsigned long long clock)
+    {
+        for (auto chan : group.channels)
+            advanceControl(*chan, clock);
+        for (auto child : group.groups)
+            advanceGroup(*child, clock);
+        advanceControl(group, clock);
+    }
+
+    static void writeU32(std::ofstream &file, uint32_t value)
+    {
+        const char bytes[4] = {
+            (char)(value & 0xFF), (char)((value >> 8) & 0xFF),
+            (char)((value >> 16) & 0xFF), (char)((value >> 24) & 0xFF),
+        };
+        file.write(bytes, 4);
+    }
+
+    static void writeU16(std::ofstream &file, uint16_t value)
+    {
+        const char bytes[2] = {
+            (char)(value & 0xFF), (char)((value >> 8) & 0xFF),
+        };
+        file.write(bytes, 2);
+    }
+
+
+    void mix(SystemImpl &sys)
+    {
+        auto callback = [&sys](FMOD_SYSTEM_CALLBACK_TYPE type) {
+            if (sys.callback && (sys.callbackMask & type))
+            {
+                sys.callback(reinterpret_cast<FMOD_SYSTEM *>(handle(&sys)),
+                    type, nullptr, nullptr, sys.userData);
+            }
+        };
+
+        callback(FMOD_SYSTEM_CALLBACK_PREMIX);
+
+        updateVirtual(sys);
+
+        const auto frames = sys.bufferLength;
+        auto all = activeMask(sys, 0);
+        std::fill(all, all + frames, 1);
+        // The master is mixed a level down, so depth 0 keeps the root mask
+        auto out = mixGroup(sys, *sys.master, 1, all);
+
+        if (sys.wav.is_open())
+        {
+            for (size_t i = 0, count = (size_t)frames * sys.outChannels;
+                i < count; ++i)
+            {
+                writeU32(sys.wav, std::bit_cast<uint32_t>(out[i]));
+            }
+            sys.wavFrames += frames;
+        }
+
+        sys.clock += frames;
+        advanceGroup(*sys.master, sys.clock);
+
+        for (size_t i = sys.channels.size(); i-- > 0;)
+        {
+            if (sys.channels[i]->ended)
+                stopChannel(*sys.channels[i]);
+        }
+
+        callback(FMOD_SYSTEM_CALLBACK_POSTMIX);
+    }
+
+
+    float audibility(const ControlImpl &control)
+    {
+        const auto clock = control.system->clock;
+
+        float result = 1.f;
+        for (auto ctrl = &control; ctrl; ctrl = ctrl->parent)
+        {
+            if (ctrl->paused || ctrl->mute || clock < ctrl->delayStart)
+                return 0;
+            result *= ctrl->volume * fadeVolume(*ctrl, clock);
+        }
+        return result;
+    }
+
+
+    void updateVirtual(SystemImpl &sys)
+    {
+        auto &ranking = sys.ranking;
+        ranking.clear();
+
+        const bool vol0 = sys.flags & FMOD_INIT_VOL0_BECOMES_VIRTUAL;
+        for (auto chan : sys.channels)
+        {
+            const auto level = audibility(*chan);
+            if (vol0 && level <= sys.advanced.vol0virtualvol)
+                chan->isVirtual = true;
+            else
+                ranking.emplace_back(chan, level);
+        }
+
+        std::stable_sort(ranking.begin(), ranking.end(),
+            [](const auto &a, const auto &b) {
+                if (a.first->priority != b.first->priority)
+                    return a.first->priority < b.first->priority;
+                return a.second > b.second;
+            });
+
+        for (size_t i = 0; i < ranking.size(); ++i)
+            ranking[i].first->isVirtual = (int)i >= sys.softwareChannels;
+    }
+
+
+    FMOD_RESULT openWavOutput(SystemImpl &sys, const char *path)
+    {
+        sys.wav.open(path ? path : "fmodoutput.wav",
+            std::ios::binary | std::ios::trunc);
+        if (!sys.wav.is_open())
+            return FMOD_ERR_FILE_NOTFOUND;
+
+        // 32-bit float, sizes filled in on close
+        const auto channels = (uint16_t)sys.outChannels;
+        sys.wav.write("RIFF", 4);
+        writeU32(sys.wav, 0);
+        sys.wav.write("WAVEfmt ", 8);
+        writeU32(sys.wav, 16);
+        writeU16(sys.wav, 3);
+        writeU16(sys.wav, channels);
+        writeU32(sys.wav, sys.samplerate);
+        writeU32(sys.wav, sys.samplerate * channels * 4);
+        writeU16(sys.wav, channels * 4);
+        writeU16(sys.wav, 32);
+        sys.wav.write("data", 4);
+        writeU32(sys.wav, 0);
+
+        sys.wavFrames = 0;
+        return FMOD_OK;
+    }
+
+
+    void closeWavOutput(SystemImpl &sys)
+    {
+        if (!sys.wav.is_open())
+            return;
+
+        const auto bytes = (uint32_t)(sys.wavFrames * sys.outChannels * 4);
+        sys.wav.seekp(4);
+        writeU32(sys.wav, 36 + bytes);
+        sys.wav.seekp(40);
+        writeU32(sys.wav, bytes);
+        sys.wav.close();
+    }
+}
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <fmod.hpp>
+#include <fmod_dsp.h>
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Internals of the mock FMOD backend.
+ *
+ * The FMOD classes are opaque: their members are never accessed by the
+ * caller, so each handle is really a pointer to one of the structs below,
+ * reinterpreted. Channels are the exception, see `channelHandle`.
+ */
+namespace FMOD::Mock
+{
+    struct SystemImpl;
+    struct GroupImpl;
+    struct ChannelImpl;
+    struct SoundImpl;
+    struct DSPImpl;
+
+    // ----- Memory -----------------------------------------------------------
+
+    /**
+     * Allocate through the callbacks of `FMOD_Memory_Initialize`, or the
+     * heap if none were installed. Counted by `FMOD_Memory_GetStats`.
+     *
+     * @return the memory, or nullptr if the allocation was refused
+     */
+    void *allocate(size_t bytes);
+
+    /**
+     * Resize memory from `allocate`, behaving like `std::realloc`
+     */
+    void *reallocate(void *ptr, size_t bytes);
+
+    /**
+     * Free memory from `allocate`. Passing nullptr does nothing.
+     */
+    void deallocate(void *ptr);
+
+    /**
+     * Mark a system created or released, so the allocator can't be swapped
+     * while memory from it may be in use
+     */
+    void systemCreated();
+    void systemReleased();
+
+    /**
+     * Base of the mock's objects, allocating them like FMOD would
+     */
+    struct MockObject
+    {
+        static void *operator new(size_t size);
+        static void operator delete(void *ptr);
+    };
+
+    /**
+     * Standard allocator over `allocate`, for sample data
+     */
+    template <typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        Allocator() = default;
+        template <typename U>
+        Allocator(const Allocator<U> &) { }
+
+        T *allocate(size_t count)
+        {
+            auto ptr = Mock::allocate(count * sizeof(T));
+            if (!ptr)
+                throw std::bad_alloc();
+            return static_cast<T *>(ptr);
+        }
+
+        void deallocate(T *ptr, size_t count)
+        {
+            Mock::deallocate(ptr);
+        }
+
+        template <typename U>
+        bool operator==(const Allocator<U> &) const { return true; }
+    };
+
+    using SampleBuffer = std::vector<float, Allocator<float>>;
+
+    // ----- Objects ----------------------------------------------------------
+
+    struct SyncPointImpl : MockObject
+    {
+        std::string name;
+        unsigned int offset; // in PCM samples
+    };
+
+    struct SoundImpl : MockObject
+    {
+        SystemImpl *system;
+        SoundImpl *parent;
+        std::vector<SoundImpl *> subsounds;
+
+        FMOD_MODE mode;
+        FMOD_SOUND_TYPE type;
+        FMOD_SOUND_FORMAT format;
+        int channels;
+        int bits;
+        float frequency;
+        int priority;
+
+        // Decoded interleaved sample data
+        SampleBuffer samples;
+        // Length in PCM samples
+        unsigned int length;
+        unsigned int loopStart;
+        unsigned int loopEnd;
+
+        // Sorted by offset, points at the same offset in insertion order
+        std::vector<std::unique_ptr<SyncPointImpl>> syncPoints;
+
+        // Result of the open, reported by getOpenState
+        FMOD_RESULT openResult;
+        std::string name;
+        void *userData;
+    };
+
+    struct FadePoint
+    {
+        unsigned long long clock;
+        float volume;
+    };
+
+    /**
+     * State shared by channels and channel groups
+     */
+    struct ControlImpl : MockObject
+    {
+        SystemImpl *system;
+        GroupImpl *parent;
+        bool isGroup;
+
+        float volume;
+        bool paused;
+        bool mute;
+        unsigned long long delayStart;
+        unsigned long long delayEnd;
+        bool stopAtEnd;
+
+        // Sorted by clock
+        std::vector<FadePoint> fades;
+
+        // Mix matrix of the fader, [out * matrixIn + in]. Empty if default.
+        std::vector<float> matrix;
+        int matrixOut;
+        int matrixIn;
+
+        float reverb[FMOD_REVERB_MAXINSTANCES];
+
+        // DSP chain, index 0 at the head (output side). The fader is a
+        // nullptr entry.
+        std::vector<DSPImpl *> dsps;
+
+        void *userData;
+    };
+
+    struct GroupImpl : ControlImpl
+    {
+        std::string name;
+        std::vector<GroupImpl *> groups;
+        std::vector<ChannelImpl *> channels;
+    };
+
+    struct ChannelImpl : ControlImpl
+    {
+        SoundImpl *sound;
+        // Playhead in PCM samples of the sound, fractional when resampling
+        double position;
+        float frequency;
+        FMOD_MODE mode;
+        unsigned int loopStart;
+        unsigned int loopEnd;
+        int priority;
+        bool isVirtual;
+        // Reached the end of the sound, or stopped by a delay; released
+        // after the current mix
+        bool ended;
+
+        // Slot in the channel handle table
+        unsigned int index;
+        unsigned int generation;
+    };
+
+    struct DSPImpl : MockObject
+    {
+        SystemImpl *system;
+        ControlImpl *owner;
+        FMOD_DSP_DESCRIPTION desc;
+        FMOD_DSP_STATE state;
+        void *userData;
+        bool bypass;
+    };
+
+    struct SystemImpl : MockObject
+    {
+        FMOD_OUTPUTTYPE output;
+        int samplerate;
+        FMOD_SPEAKERMODE speakerMode;
+        int outChannels;
+        unsigned int bufferLength;
+        int bufferCount;
+        int softwareChannels;
+        int maxChannels;
+        FMOD_ADVANCEDSETTINGS advanced;
+        FMOD_INITFLAGS flags;
+        FMOD_REVERB_PROPERTIES reverb[FMOD_REVERB_MAXINSTANCES];
+
+        bool initialized;
+        bool suspended;
+        // Samples mixed since init
+        unsigned long long clock;
+
+        GroupImpl *master;
+        std::vector<GroupImpl *> groups;
+        std::vector<ChannelImpl *> channels;
+        std::vector<SoundImpl *> sounds;
+        std::vector<DSPImpl *> dsps;
+
+        FMOD_SYSTEM_CALLBACK callback;
+        FMOD_SYSTEM_CALLBACK_TYPE callbackMask;
+        void *userData;
+
+        // FMOD_OUTPUTTYPE_WAVWRITER(_NRT) target
+        std::ofstream wav;
+        size_t wavFrames;
+
+        // Mix buffers (three per graph depth) and activity masks (one per
+        // depth), reused between mixes
+        std::vector<std::vector<float>> scratch;
+        std::vector<std::vector<char>> active;
+        // Channels competing for a real voice, reused between mixes
+        std::vector<std::pair<ChannelImpl *, float>> ranking;
+    };
+
+    // ----- Handles ----------------------------------------------------------
+
+    inline SystemImpl *system(System *handle)
+    {
+        return reinterpret_cast<SystemImpl *>(handle);
+    }
+
+    inline System *handle(SystemImpl *system)
+    {
+        return reinterpret_cast<System *>(system);
+    }
+
+    inline SoundImpl *sound(Sound *handle)
+    {
+        return reinterpret_cast<SoundImpl *>(handle);
+    }
+
+    inline Sound *handle(SoundImpl *sound)
+    {
+        return reinterpret_cast<Sound *>(sound);
+    }
+
+    inline DSPImpl *dsp(DSP *handle)
+    {
+        return reinterpret_cast<DSPImpl *>(handle);
+    }
+
+    inline DSP *handle(DSPImpl *dsp)
+    {
+        return reinterpret_cast<DSP *>(dsp);
+    }
+
+    inline GroupImpl *group(ChannelGroup *handle)
+    {
+        return reinterpret_cast<GroupImpl *>(handle);
+    }
+
+    inline ChannelGroup *handle(GroupImpl *group)
+    {
+        return reinterpret_cast<ChannelGroup *>(group);
+    }
+
+    /**
+     * Channels end on their own, after which FMOD invalidates their
+     * handles instead of leaving them dangling. Channel handles therefore
+     * encode a slot of a process-wide table and the slot's generation,
+     * with the lowest bit set to tell them apart from group pointers.
+     */
+    Channel *channelHandle(const ChannelImpl *channel);
+
+    /**
+     * Resolve a channel handle
+     *
+     * @return the channel, or nullptr if it ended or was stopped
+     */
+    ChannelImpl *channel(Channel *handle);
+
+    /**
+     * Resolve a channel or channel group handle
+     *
+     * @return the object, or nullptr if it's a stale channel handle
+     */
+    ControlImpl *control(ChannelControl *handle);
+
+    /**
+     * Get a channel from the handle table, with its base fields reset
+     */
+    ChannelImpl *acquireChannel();
+
+    /**
+     * Invalidate the handles of a channel and return it to the table
+     */
+    void releaseChannel(ChannelImpl *channel);
+
+    // ----- Graph ------------------------------------------------------------
+
+    /**
+     * Set up the base fields of a channel or group
+     */
+    void initControl(ControlImpl &control, SystemImpl *system, bool isGroup);
+
+    /**
+     * Move a channel into a group, the master group if nullptr
+     */
+    void attach(ChannelImpl &channel, GroupImpl *group);
+
+    /**
+     * Move a group under another one
+     */
+    void attach(GroupImpl &group, GroupImpl *parent);
+
+    /**
+     * Stop a channel, invalidating its handle
+     */
+    void stopChannel(ChannelImpl &channel);
+
+    /**
+     * Stop all channels in a group and its subgroups
+     */
+    void stopGroup(GroupImpl &group);
+
+    /**
+     * Free a group, moving its channels and subgroups to its parent
+     */
+    void releaseGroup(GroupImpl &group);
+
+    /**
+     * Detach a DSP from the chain it is in, if any
+     */
+    void detach(DSPImpl &dsp);
+
+    /**
+     * Free a sound and its subsounds, stopping channels that play them
+     */
+    void releaseSound(SoundImpl &sound);
+
+    /**
+     * Volume of the fade points at a DSP clock, 1 if there are none
+     */
+    float fadeVolume(const ControlImpl &control, unsigned long long clock);
+
+    /**
+     * Convert an offset between time units of a sound
+     *
+     * @return whether the units are supported
+     */
+    bool toPCM(unsigned int value, FMOD_TIMEUNIT unit, float frequency,
+        int channels, int bits, unsigned int *result);
+    bool fromPCM(unsigned int pcm, FMOD_TIMEUNIT unit, float frequency,
+        int channels, int bits, unsigned int *result);
+
+    // ----- Mixer ------------------------------------------------------------
+
+    /**
+     * Mix one block of `bufferLength` samples and advance the DSP clock
+     */
+    void mix(SystemImpl &system);
+
+    /**
+     * Decide which channels are real, and which only advance their
+     * playhead, by priority and audibility
+     */
+    void updateVirtual(SystemImpl &system);
+
+    /**
+     * Product of volume and fade of a control and its parents at the
+     * current clock, 0 if any is paused or muted
+     */
+    float audibility(const ControlImpl &control);
+
+    /**
+     * Open the file of FMOD_OUTPUTTYPE_WAVWRITER(_NRT) outputs
+     */
+    FMOD_RESULT openWavOutput(SystemImpl &system, const char *path);
+
+    /**
+     * Finish the WAV file of the output, if any
+     */
+    void closeWavOutput(SystemImpl &system);
+
+    /**
+     * Functions passed to DSP callbacks in their FMOD_DSP_STATE
+     */
+    extern FMOD_DSP_STATE_FUNCTIONS stateFunctions;
+
+    // ----- Decoding ---------------------------------------------------------
+
+    /**
+     * Open a WAV file, mock bank or raw PCM data into a sound, see
+     * fmod_mock.h for the supported formats
+     */
+    FMOD_RESULT openSound(SystemImpl &system, const char *data,
+        size_t length, FMOD_MODE mode, const FMOD_CREATESOUNDEXINFO *exinfo,
+        SoundImpl *sound);
+
+    /**
+     * Channels of an output speaker mode, 0 if unsupported
+     */
+    int speakerModeChannels(FMOD_SPEAKERMODE mode);
+}
@@ -0,0 +1,691 @@
+#include "Mock.h"
+
+#include <fmod_mock.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace FMOD::Mock
+{
+    /**
+     * Undecoded sample data in a sound's native format
+     */
+    struct PCMView
+    {
+        const char *data;
+        size_t bytes;
+        FMOD_SOUND_FORMAT format;
+        int channels;
+        int bits;
+        float frequency;
+    };
+
+    /**
+     * A RIFF chunk
+     */
+    struct Chunk
+    {
+        std::string_view id;
+        const char *data;
+        size_t size;
+    };
+
+    static uint32_t readU32(const char *data)
+    {
+        auto bytes = reinterpret_cast<const unsigned char *>(data);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+            ((uint32_t)bytes[3] << 24);
+    }
+
+    static uint16_t readU16(const char *data)
+    {
+        auto bytes = reinterpret_cast<const unsigned char *>(data);
+        return (uint16_t)(bytes[0] | (bytes[1] << 8));
+    }
+
+    /**
+     * Split the body of a RIFF form into its chunks
+     *
+     * @return whether the chunks were well-formed
+     */
+    static bool readChunks(const char *data, size_t length,
+        std::vector<Chunk> &chunks)
+    {
+        size_t offset = 0;
+        while (offset + 8 <= length)
+        {
+            const auto size = (size_t)readU32(data + offset + 4);
+            if (size > length - offset - 8)
+                return false;
+
+            chunks.emplace_back(Chunk{
+                .id=std::string_view(data + offset, 4),
+                .data=data + offset + 8,
+                .size=size,
+            });
+
+            offset += 8 + size + (size & 1); // chunks are word-aligned
+        }
+
+        return true;
+    }
+
+    static int bitsOf(FMOD_SOUND_FORMAT format)
+    {
+        switch(format)
+        {
+        case FMOD_SOUND_FORMAT_PCM8:     return 8;
+        case FMOD_SOUND_FORMAT_PCM16:    return 16;
+        case FMOD_SOUND_FORMAT_PCM24:    return 24;
+        case FMOD_SOUND_FORMAT_PCM32:
+        case FMOD_SOUND_FORMAT_PCMFLOAT: return 32;
+        default:                         return 0;
+        }
+    }
+
+    /**
+     * Convert native sample data into the sound's float samples
+     */
+    static FMOD_RESULT decode(SoundImpl &sound, const PCMView &pcm)
+    {
+        if (pcm.bits == 0 || pcm.channels <= 0 ||
+            pcm.channels > FMOD_MAX_CHANNEL_WIDTH || pcm.frequency <= 0)
+        {
+            return FMOD_ERR_FORMAT;
+        }
+
+        const auto width = (size_t)pcm.bits / 8;
+        const auto count = pcm.bytes / width / pcm.channels * pcm.channels;
+
+        sound.format = pcm.format;
+        sound.channels = pcm.channels;
+        sound.bits = pcm.bits;
+        sound.frequency = pcm.frequency;
+        sound.length = (unsigned int)(count / pcm.channels);
+        sound.loopStart = 0;
+        sound.loopEnd = sound.length ? sound.length - 1 : 0;
+        sound.samples.resize(count);
+
+        auto out = sound.samples.data();
+        auto in = reinterpret_cast<const unsigned char *>(pcm.data);
+        for (size_t i = 0; i < count; ++i, in += width)
+        {
+            switch(pcm.format)
+            {
+            case FMOD_SOUND_FORMAT_PCM8:
+                out[i] = ((int)in[0] - 128) / 128.f;
+                break;
+            case FMOD_SOUND_FORMAT_PCM16:
+                out[i] = (int16_t)(in[0] | (in[1] << 8)) / 32768.f;
+                break;
+            case FMOD_SOUND_FORMAT_PCM24:
+                out[i] = (float)((int32_t)(((uint32_t)in[0] << 8) |
+                    ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 24)) >> 8) /
+                    8388608.f;
+                break;
+            case FMOD_SOUND_FORMAT_PCM32:
+                out[i] = (float)((double)(int32_t)readU32(
+                    reinterpret_cast<const char *>(in)) / 2147483648.0);
+                break;
+            default:
+                std::memcpy(out + i, in, sizeof(float));
+                break;
+            }
+        }
+
+        return FMOD_OK;
+    }
+
+    /**
+     * Insert a sync point, after those at the same offset
+     */
+    static SyncPointImpl *insertSyncPoint(SoundImpl &sound,
+        std::string_view name, unsigned int offset)
+    {
+        auto point = std::make_unique<SyncPointImpl>();
+        point->name = name;
+        point->offset = offset;
+
+        auto &points = sound.syncPoints;
+        auto it = std::upper_bound(points.begin(), points.end(), offset,
+            [](unsigned int offset, const std::unique_ptr<SyncPointImpl> &p) {
+                return offset < p->offset;
+            });
+        return points.insert(it, std::move(point))->get();
+    }
+
+    /**
+     * Read a WAV file into a sound, with its cue points as sync points
+     */
+    static FMOD_RESULT openWav(SoundImpl &sound, const char *data,
+        size_t length, PCMView &pcm)
+    {
+        std::vector<Chunk> chunks;
+        if (!readChunks(data + 12, std::min<size_t>(length,
+            readU32(data + 4) + 8) - 12, chunks))
+        {
+            return FMOD_ERR_FILE_BAD;
+        }
+
+        const Chunk *fmt = nullptr, *body = nullptr, *cue = nullptr;
+        std::vector<Chunk> labels;
+        for (const auto &chunk : chunks)
+        {
+            if (chunk.id == "fmt ")
+                fmt = &chunk;
+            else if (chunk.id == "data")
+                body = &chunk;
+            else if (chunk.id == "cue ")
+                cue = &chunk;
+            else if (chunk.id == "LIST" && chunk.size >= 4 &&
+                std::string_view(chunk.data, 4) == "adtl")
+            {
+                readChunks(chunk.data + 4, chunk.size - 4, labels);
+            }
+        }
+
+        if (!fmt || !body || fmt->size < 16)
+            return FMOD_ERR_FORMAT;
+
+        auto tag = readU16(fmt->data);
+        const auto bits = readU16(fmt->data + 14);
+        if (tag == 0xFFFE && fmt->size >= 26) // WAVE_FORMAT_EXTENSIBLE
+            tag = readU16(fmt->data + 24);
+
+        pcm.data = body->data;
+        pcm.bytes = body->size;
+        pcm.channels = readU16(fmt->data + 2);
+        pcm.frequency = (float)readU32(fmt->data + 4);
+        pcm.bits = bits;
+
+        if (tag == 1 && bits == 8)
+            pcm.format = FMOD_SOUND_FORMAT_PCM8;
+        else if (tag == 1 && bits == 16)
+            pcm.format = FMOD_SOUND_FORMAT_PCM16;
+        else if (tag == 1 && bits == 24)
+            pcm.format = FMOD_SOUND_FORMAT_PCM24;
+        else if (tag == 1 && bits == 32)
+            pcm.format = FMOD_SOUND_FORMAT_PCM32;
+        else if (tag == 3 && bits == 32)
+            pcm.format = FMOD_SOUND_FORMAT_PCMFLOAT;
+        else
+            return FMOD_ERR_FORMAT;
+
+        auto result = decode(sound, pcm);
+        if (result != FMOD_OK)
+            return result;
+
+        sound.type = FMOD_SOUND_TYPE_WAV;
+
+        if (cue && cue->size >= 4)
+        {
+            const auto count = std::min<size_t>(readU32(cue->data),
+                (cue->size - 4) / 24);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto entry = cue->data + 4 + i * 24;
+                const auto id = readU32(entry);
+                const auto offset = readU32(entry + 20);
+
+                std::string_view name;
+                for (const auto &label : labels)
+                {
+                    if (label.id == "labl" && label.size >= 4 &&
+                        readU32(label.data) == id)
+                    {
+                        name = std::string_view(label.data + 4,
+                            strnlen(label.data + 4, label.size - 4));
+                        break;
+                    }
+                }
+
+                insertSyncPoint(sound, name, offset);
+            }
+        }
+
+        return FMOD_OK;
+    }
+
+    /**
+     * Call the decode callback of a load, if any
+     */
+    static FMOD_RESULT notifyDecoded(SoundImpl &sound, const PCMView &pcm,
+        const FMOD_CREATESOUNDEXINFO *exinfo)
+    {
+        if (!exinfo || !exinfo->pcmreadcallback)
+            return FMOD_OK;
+
+        return exinfo->pcmreadcallback(
+            reinterpret_cast<FMOD_SOUND *>(handle(&sound)),
+            const_cast<char *>(pcm.data), (unsigned int)pcm.bytes);
+    }
+
+
+    FMOD_RESULT openSound(SystemImpl &system, const char *data,
+        size_t length, FMOD_MODE mode, const FMOD_CREATESOUNDEXINFO *exinfo,
+        SoundImpl *sound)
+    {
+        sound->mode = mode;
+        sound->type = FMOD_SOUND_TYPE_UNKNOWN;
+        sound->format = FMOD_SOUND_FORMAT_NONE;
+        sound->channels = 0;
+        sound->bits = 0;
+        sound->frequency = 0;
+        sound->priority = 128;
+        sound->length = 0;
+        sound->loopStart = 0;
+        sound->loopEnd = 0;
+        sound->openResult = FMOD_OK;
+
+        if (mode & FMOD_OPENRAW)
+        {
+            if (!exinfo || exinfo->numchannels <= 0 ||
+                exinfo->defaultfrequency <= 0)
+            {
+                return FMOD_ERR_INVALID_PARAM;
+            }
+
+            PCMView pcm{
+                .data=data,
+                .bytes=length,
+                .format=exinfo->format,
+                .channels=exinfo->numchannels,
+                .bits=bitsOf(exinfo->format),
+                .frequency=(float)exinfo->defaultfrequency,
+            };
+
+            auto result = decode(*sound, pcm);
+            if (result != FMOD_OK)
+                return result;
+
+            sound->type = FMOD_SOUND_TYPE_RAW;
+            return notifyDecoded(*sound, pcm, exinfo);
+        }
+
+        if (length < 12)
+            return FMOD_ERR_FORMAT;
+
+        const std::string_view magic(data, 4), form(data + 8, 4);
+        if (magic == "RIFF" && form == "WAVE")
+        {
+            PCMView pcm{};
+            auto result = openWav(*sound, data, length, pcm);
+            if (result != FMOD_OK)
+                return result;
+
+            return notifyDecoded(*sound, pcm, exinfo);
+        }
+
+        if (magic == "RIFF" && form == FMOD_MOCK_BANK_FORM)
+        {
+            std::vector<Chunk> chunks;
+            if (!readChunks(data + 12, std::min<size_t>(length,
+                readU32(data + 4) + 8) - 12, chunks))
+            {
+                return FMOD_ERR_FILE_BAD;
+            }
+
+            sound->type = FMOD_SOUND_TYPE_FSB;
+            for (const auto &chunk : chunks)
+            {
+                if (chunk.id != "RIFF")
+                    continue;
+
+                auto subsound = new SoundImpl();
+                subsound->system = &system;
+                subsound->parent = sound;
+                subsound->userData = nullptr;
+                try {
+                    sound->subsounds.emplace_back(subsound);
+                }
+                catch(...)
+                {
+                    delete subsound;
+                    throw;
+                }
+
+                // the chunk is a whole WAV file, header included
+                const auto wav = chunk.data - 8;
+                const auto wavLength = chunk.size + 8;
+                if (wavLength < 12 || std::string_view(wav + 8, 4) != "WAVE")
+                    return FMOD_ERR_FORMAT;
+
+                auto result = openSound(system, wav, wavLength,
+                    mode & ~FMOD_NONBLOCKING, exinfo, subsound);
+                if (result != FMOD_OK)
+                    return result;
+
+                subsound->type = FMOD_SOUND_TYPE_FSB;
+            }
+
+            return FMOD_OK;
+        }
+
+        // Real banks are compressed, which the mock doesn't decode
+        return FMOD_ERR_FORMAT;
+    }
+
+
+    void releaseSound(SoundImpl &sound)
+    {
+        auto sys = sound.system;
+
+        for (size_t i = sys->channels.size(); i-- > 0;)
+        {
+            auto chan = sys->channels[i];
+            if (chan->sound == &sound || chan->sound->parent == &sound)
+                stopChannel(*chan);
+        }
+
+        while (!sound.subsounds.empty())
+            releaseSound(*sound.subsounds.back());
+
+        auto &owner = sound.parent ? sound.parent->subsounds : sys->sounds;
+        auto it = std::find(owner.begin(), owner.end(), &sound);
+        if (it != owner.end())
+            owner.erase(it);
+
+        delete &sound;
+    }
+}
+
+
+using namespace FMOD::Mock;
+
+namespace FMOD
+{
+    FMOD_RESULT F_API Sound::release()
+    {
+        releaseSound(*Mock::sound(this));
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getSystemObject(System **system)
+    {
+        if (!system)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *system = handle(Mock::sound(this)->system);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::setDefaults(float frequency, int priority)
+    {
+        if (frequency <= 0 || priority < 0 || priority > 256)
+            return FMOD_ERR_INVALID_PARAM;
+
+        auto snd = Mock::sound(this);
+        snd->frequency = frequency;
+        snd->priority = priority;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getDefaults(float *frequency, int *priority)
+    {
+        auto snd = Mock::sound(this);
+        if (frequency)
+            *frequency = snd->frequency;
+        if (priority)
+            *priority = snd->priority;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getSubSound(int index, Sound **subsound)
+    {
+        auto snd = Mock::sound(this);
+        if (!subsound || index < 0 || index >= (int)snd->subsounds.size())
+            return FMOD_ERR_INVALID_PARAM;
+
+        *subsound = handle(snd->subsounds[index]);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getSubSoundParent(Sound **parentsound)
+    {
+        if (!parentsound)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *parentsound = handle(Mock::sound(this)->parent);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getName(char *name, int namelen)
+    {
+        if (!name || namelen <= 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        std::strncpy(name, Mock::sound(this)->name.c_str(), namelen - 1);
+        name[namelen - 1] = 0;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getLength(unsigned int *length,
+        FMOD_TIMEUNIT lengthtype)
+    {
+        auto snd = Mock::sound(this);
+        if (!length)
+            return FMOD_ERR_INVALID_PARAM;
+
+        return fromPCM(snd->length, lengthtype, snd->frequency,
+            snd->channels, snd->bits, length) ? FMOD_OK : FMOD_ERR_FORMAT;
+    }
+
+
+    FMOD_RESULT F_API Sound::getFormat(FMOD_SOUND_TYPE *type,
+        FMOD_SOUND_FORMAT *format, int *channels, int *bits)
+    {
+        auto snd = Mock::sound(this);
+        if (type)
+            *type = snd->type;
+        if (format)
+            *format = snd->format;
+        if (channels)
+            *channels = snd->channels;
+        if (bits)
+            *bits = snd->bits;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getNumSubSounds(int *numsubsounds)
+    {
+        if (!numsubsounds)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *numsubsounds = (int)Mock::sound(this)->subsounds.size();
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getOpenState(FMOD_OPENSTATE *openstate,
+        unsigned int *percentbuffered, bool *starving, bool *diskbusy)
+    {
+        // Loads complete within createSound
+        const auto result = Mock::sound(this)->openResult;
+        if (openstate)
+        {
+            *openstate = (result == FMOD_OK) ? FMOD_OPENSTATE_READY :
+                FMOD_OPENSTATE_ERROR;
+        }
+        if (percentbuffered)
+            *percentbuffered = 100;
+        if (starving)
+            *starving = false;
+        if (diskbusy)
+            *diskbusy = false;
+        return result;
+    }
+
+
+    FMOD_RESULT F_API Sound::getNumSyncPoints(int *numsyncpoints)
+    {
+        if (!numsyncpoints)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *numsyncpoints = (int)Mock::sound(this)->syncPoints.size();
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getSyncPoint(int index, FMOD_SYNCPOINT **point)
+    {
+        const auto &points = Mock::sound(this)->syncPoints;
+        if (!point || index < 0 || index >= (int)points.size())
+            return FMOD_ERR_INVALID_PARAM;
+
+        *point = reinterpret_cast<FMOD_SYNCPOINT *>(points[index].get());
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getSyncPointInfo(FMOD_SYNCPOINT *point,
+        char *name, int namelen, unsigned int *offset,
+        FMOD_TIMEUNIT offsettype)
+    {
+        auto snd = Mock::sound(this);
+        auto impl = reinterpret_cast<SyncPointImpl *>(point);
+        if (!impl)
+            return FMOD_ERR_INVALID_PARAM;
+
+        if (name && namelen > 0)
+        {
+            std::strncpy(name, impl->name.c_str(), namelen - 1);
+            name[namelen - 1] = 0;
+        }
+
+        if (offset && !fromPCM(impl->offset, offsettype, snd->frequency,
+            snd->channels, snd->bits, offset))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::addSyncPoint(unsigned int offset,
+        FMOD_TIMEUNIT offsettype, const char *name, FMOD_SYNCPOINT **point)
+    {
+        auto snd = Mock::sound(this);
+
+        unsigned int pcm;
+        if (!toPCM(offset, offsettype, snd->frequency, snd->channels,
+            snd->bits, &pcm))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+
+        try {
+            auto impl = insertSyncPoint(*snd, name ? name : "", pcm);
+            if (point)
+                *point = reinterpret_cast<FMOD_SYNCPOINT *>(impl);
+        }
+        catch(const std::bad_alloc &)
+        {
+            return FMOD_ERR_MEMORY;
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::deleteSyncPoint(FMOD_SYNCPOINT *point)
+    {
+        auto &points = Mock::sound(this)->syncPoints;
+        auto it = std::find_if(points.begin(), points.end(),
+            [point](const std::unique_ptr<SyncPointImpl> &p) {
+                return reinterpret_cast<FMOD_SYNCPOINT *>(p.get()) == point;
+            });
+        if (it == points.end())
+            return FMOD_ERR_INVALID_PARAM;
+
+        points.erase(it);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::setMode(FMOD_MODE mode)
+    {
+        Mock::sound(this)->mode = mode;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getMode(FMOD_MODE *mode)
+    {
+        if (!mode)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *mode = Mock::sound(this)->mode;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::setLoopPoints(unsigned int loopstart,
+        FMOD_TIMEUNIT loopstarttype, unsigned int loopend,
+        FMOD_TIMEUNIT loopendtype)
+    {
+        auto snd = Mock::sound(this);
+
+        unsigned int start, end;
+        if (!toPCM(loopstart, loopstarttype, snd->frequency, snd->channels,
+                snd->bits, &start) ||
+            !toPCM(loopend, loopendtype, snd->frequency, snd->channels,
+                snd->bits, &end))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        if (start >= end)
+            return FMOD_ERR_INVALID_PARAM;
+
+        snd->loopStart = start;
+        snd->loopEnd = end;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getLoopPoints(unsigned int *loopstart,
+        FMOD_TIMEUNIT loopstarttype, unsigned int *loopend,
+        FMOD_TIMEUNIT loopendtype)
+    {
+        auto snd = Mock::sound(this);
+
+        if (loopstart && !fromPCM(snd->loopStart, loopstarttype,
+            snd->frequency, snd->channels, snd->bits, loopstart))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        if (loopend && !fromPCM(snd->loopEnd, loopendtype, snd->frequency,
+            snd->channels, snd->bits, loopend))
+        {
+            return FMOD_ERR_FORMAT;
+        }
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::setUserData(void *userdata)
+    {
+        Mock::sound(this)->userData = userdata;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API Sound::getUserData(void **userdata)
+    {
+        if (!userdata)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *userdata = Mock::sound(this)->userData;
+        return FMOD_OK;
+    }
+}
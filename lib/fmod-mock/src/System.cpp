@@ -0,0 +1,677 @@
+#include "Mock.h"
+
+#include <fmod.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <new>
+
+namespace FMOD::Mock
+{
+    int speakerModeChannels(FMOD_SPEAKERMODE mode)
+    {
+        switch(mode)
+        {
+        case FMOD_SPEAKERMODE_MONO:          return 1;
+        case FMOD_SPEAKERMODE_DEFAULT:       // stereo, as on the web
+        case FMOD_SPEAKERMODE_STEREO:        return 2;
+        case FMOD_SPEAKERMODE_QUAD:          return 4;
+        case FMOD_SPEAKERMODE_SURROUND:      return 5;
+        case FMOD_SPEAKERMODE_5POINT1:       return 6;
+        case FMOD_SPEAKERMODE_7POINT1:       return 8;
+        case FMOD_SPEAKERMODE_7POINT1POINT4: return 12;
+        default:                             return 0;
+        }
+    }
+}
+
+using namespace FMOD::Mock;
+
+
+FMOD_RESULT F_API FMOD_System_Create(FMOD_SYSTEM **system,
+    unsigned int headerversion)
+{
+    if (!system)
+        return FMOD_ERR_INVALID_PARAM;
+    if (headerversion != FMOD_VERSION)
+        return FMOD_ERR_HEADER_MISMATCH;
+
+    SystemImpl *sys;
+    try {
+        sys = new SystemImpl();
+    }
+    catch(const std::bad_alloc &)
+    {
+        return FMOD_ERR_MEMORY;
+    }
+
+    sys->output = FMOD_OUTPUTTYPE_AUTODETECT;
+    sys->samplerate = 48000;
+    sys->speakerMode = FMOD_SPEAKERMODE_DEFAULT;
+    sys->outChannels = speakerModeChannels(sys->speakerMode);
+    sys->bufferLength = 1024;
+    sys->bufferCount = 4;
+    sys->softwareChannels = 64;
+    sys->maxChannels = 0;
+
+    std::memset(&sys->advanced, 0, sizeof(FMOD_ADVANCEDSETTINGS));
+    sys->advanced.cbSize = sizeof(FMOD_ADVANCEDSETTINGS);
+    sys->advanced.vol0virtualvol = 0;
+    sys->flags = FMOD_INIT_NORMAL;
+
+    const FMOD_REVERB_PROPERTIES off = FMOD_PRESET_OFF;
+    std::fill(std::begin(sys->reverb), std::end(sys->reverb), off);
+
+    sys->initialized = false;
+    sys->suspended = false;
+    sys->clock = 0;
+    sys->master = nullptr;
+    sys->callback = nullptr;
+    sys->callbackMask = 0;
+    sys->userData = nullptr;
+    sys->wavFrames = 0;
+
+    systemCreated();
+    *system = reinterpret_cast<FMOD_SYSTEM *>(sys);
+    return FMOD_OK;
+}
+
+
+namespace FMOD
+{
+    FMOD_RESULT F_API System::release()
+    {
+        auto sys = Mock::system(this);
+
+        while (!sys->channels.empty())
+            stopChannel(*sys->channels.back());
+        while (!sys->sounds.empty())
+            releaseSound(*sys->sounds.back());
+        while (!sys->dsps.empty())
+            handle(sys->dsps.back())->release();
+
+        for (auto group : sys->groups)
+            delete group;
+        sys->groups.clear();
+        delete sys->master;
+
+        closeWavOutput(*sys);
+        delete sys;
+        systemReleased();
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setOutput(FMOD_OUTPUTTYPE output)
+    {
+        auto sys = Mock::system(this);
+        if (sys->initialized)
+            return FMOD_ERR_INITIALIZED;
+
+        switch(output)
+        {
+        case FMOD_OUTPUTTYPE_AUTODETECT:
+        case FMOD_OUTPUTTYPE_NOSOUND:
+        case FMOD_OUTPUTTYPE_WAVWRITER:
+        case FMOD_OUTPUTTYPE_NOSOUND_NRT:
+        case FMOD_OUTPUTTYPE_WAVWRITER_NRT:
+            sys->output = output;
+            return FMOD_OK;
+        default:
+            return FMOD_ERR_OUTPUT_INIT;
+        }
+    }
+
+
+    FMOD_RESULT F_API System::getDriverInfo(int id, char *name, int namelen,
+        FMOD_GUID *guid, int *systemrate, FMOD_SPEAKERMODE *speakermode,
+        int *speakermodechannels)
+    {
+        if (id != 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        if (name && namelen > 0)
+        {
+            std::strncpy(name, "Mock output", namelen - 1);
+            name[namelen - 1] = 0;
+        }
+        if (guid)
+            std::memset(guid, 0, sizeof(FMOD_GUID));
+        if (systemrate)
+            *systemrate = 48000;
+        if (speakermode)
+            *speakermode = FMOD_SPEAKERMODE_STEREO;
+        if (speakermodechannels)
+            *speakermodechannels = 2;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setSoftwareChannels(int numsoftwarechannels)
+    {
+        auto sys = Mock::system(this);
+        if (sys->initialized)
+            return FMOD_ERR_INITIALIZED;
+        if (numsoftwarechannels < 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        sys->softwareChannels = numsoftwarechannels;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getSoftwareChannels(int *numsoftwarechannels)
+    {
+        if (!numsoftwarechannels)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *numsoftwarechannels = Mock::system(this)->softwareChannels;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setSoftwareFormat(int samplerate,
+        FMOD_SPEAKERMODE speakermode, int numrawspeakers)
+    {
+        auto sys = Mock::system(this);
+        if (sys->initialized)
+            return FMOD_ERR_INITIALIZED;
+
+        const auto channels = speakerModeChannels(speakermode);
+        if (samplerate < 8000 || samplerate > 192000 || channels == 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        sys->samplerate = samplerate;
+        sys->speakerMode = speakermode;
+        sys->outChannels = channels;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getSoftwareFormat(int *samplerate,
+        FMOD_SPEAKERMODE *speakermode, int *numrawspeakers)
+    {
+        auto sys = Mock::system(this);
+        if (samplerate)
+            *samplerate = sys->samplerate;
+        if (speakermode)
+            *speakermode = sys->speakerMode;
+        if (numrawspeakers)
+            *numrawspeakers = 0;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setDSPBufferSize(unsigned int bufferlength,
+        int numbuffers)
+    {
+        auto sys = Mock::system(this);
+        if (sys->initialized)
+            return FMOD_ERR_INITIALIZED;
+        if (bufferlength == 0 || numbuffers < 2)
+            return FMOD_ERR_INVALID_PARAM;
+
+        sys->bufferLength = bufferlength;
+        sys->bufferCount = numbuffers;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getDSPBufferSize(unsigned int *bufferlength,
+        int *numbuffers)
+    {
+        auto sys = Mock::system(this);
+        if (bufferlength)
+            *bufferlength = sys->bufferLength;
+        if (numbuffers)
+            *numbuffers = sys->bufferCount;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setAdvancedSettings(
+        FMOD_ADVANCEDSETTINGS *settings)
+    {
+        if (!settings || settings->cbSize != sizeof(FMOD_ADVANCEDSETTINGS))
+            return FMOD_ERR_INVALID_PARAM;
+
+        Mock::system(this)->advanced = *settings;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getAdvancedSettings(
+        FMOD_ADVANCEDSETTINGS *settings)
+    {
+        if (!settings || settings->cbSize != sizeof(FMOD_ADVANCEDSETTINGS))
+            return FMOD_ERR_INVALID_PARAM;
+
+        *settings = Mock::system(this)->advanced;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setCallback(FMOD_SYSTEM_CALLBACK callback,
+        FMOD_SYSTEM_CALLBACK_TYPE callbackmask)
+    {
+        auto sys = Mock::system(this);
+        sys->callback = callback;
+        sys->callbackMask = callback ? callbackmask : 0;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::init(int maxchannels, FMOD_INITFLAGS flags,
+        void *extradriverdata)
+    {
+        auto sys = Mock::system(this);
+        if (sys->initialized)
+            return FMOD_ERR_INITIALIZED;
+        if (maxchannels < 0 || maxchannels > 4095)
+            return FMOD_ERR_INVALID_PARAM;
+
+        try {
+            if (sys->output == FMOD_OUTPUTTYPE_WAVWRITER ||
+                sys->output == FMOD_OUTPUTTYPE_WAVWRITER_NRT)
+            {
+                auto result = openWavOutput(*sys,
+                    static_cast<const char *>(extradriverdata));
+                if (result != FMOD_OK)
+                    return result;
+            }
+
+            auto master = new GroupImpl();
+            initControl(*master, sys, true);
+            master->name = "Master";
+            sys->master = master;
+        }
+        catch(const std::bad_alloc &)
+        {
+            closeWavOutput(*sys);
+            return FMOD_ERR_MEMORY;
+        }
+
+        sys->maxChannels = maxchannels;
+        sys->flags = flags;
+        sys->initialized = true;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::update()
+    {
+        auto sys = Mock::system(this);
+        if (!sys->initialized)
+            return FMOD_ERR_UNINITIALIZED;
+
+        // One block per update regardless of the output type, so time
+        // only advances when the caller says so
+        if (!sys->suspended)
+        {
+            try {
+                mix(*sys);
+            }
+            catch(const std::bad_alloc &)
+            {
+                return FMOD_ERR_MEMORY;
+            }
+        }
+
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::mixerSuspend()
+    {
+        Mock::system(this)->suspended = true;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::mixerResume()
+    {
+        Mock::system(this)->suspended = false;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::lockDSP()
+    {
+        // Mixing happens within update, on the caller's thread
+        return Mock::system(this)->initialized ? FMOD_OK :
+            FMOD_ERR_UNINITIALIZED;
+    }
+
+
+    FMOD_RESULT F_API System::unlockDSP()
+    {
+        return Mock::system(this)->initialized ? FMOD_OK :
+            FMOD_ERR_UNINITIALIZED;
+    }
+
+
+    FMOD_RESULT F_API System::getSpeakerModeChannels(FMOD_SPEAKERMODE mode,
+        int *channels)
+    {
+        if (!channels)
+            return FMOD_ERR_INVALID_PARAM;
+
+        if (mode == FMOD_SPEAKERMODE_DEFAULT)
+            mode = Mock::system(this)->speakerMode;
+
+        const auto count = speakerModeChannels(mode);
+        if (count == 0)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *channels = count;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getChannelsPlaying(int *channels,
+        int *realchannels)
+    {
+        auto sys = Mock::system(this);
+
+        int playing = 0, real = 0;
+        for (auto chan : sys->channels)
+        {
+            if (chan->ended)
+                continue;
+
+            ++playing;
+            if (!chan->isVirtual)
+                ++real;
+        }
+
+        if (channels)
+            *channels = playing;
+        if (realchannels)
+            *realchannels = real;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getCPUUsage(FMOD_CPU_USAGE *usage)
+    {
+        if (!usage)
+            return FMOD_ERR_INVALID_PARAM;
+
+        // Not measured, mixing cost depends on the host, not the mixer
+        std::memset(usage, 0, sizeof(FMOD_CPU_USAGE));
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::createSound(const char *name_or_data,
+        FMOD_MODE mode, FMOD_CREATESOUNDEXINFO *exinfo, Sound **sound)
+    {
+        auto sys = Mock::system(this);
+        if (!sound || !name_or_data)
+            return FMOD_ERR_INVALID_PARAM;
+        if (!sys->initialized)
+            return FMOD_ERR_UNINITIALIZED;
+        *sound = nullptr;
+
+        const bool inMemory = mode & (FMOD_OPENMEMORY | FMOD_OPENMEMORY_POINT);
+        if (inMemory && (!exinfo || exinfo->length == 0))
+            return FMOD_ERR_INVALID_PARAM;
+
+        try {
+            std::vector<char> file;
+            const char *data = name_or_data;
+            size_t length = inMemory ? exinfo->length : 0;
+
+            if (!inMemory)
+            {
+                std::ifstream in(name_or_data, std::ios::binary);
+                if (!in)
+                    return FMOD_ERR_FILE_NOTFOUND;
+
+                file.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+                data = file.data();
+                length = file.size();
+            }
+
+            auto snd = new SoundImpl();
+            snd->system = sys;
+            snd->parent = nullptr;
+            snd->userData = nullptr;
+            sys->sounds.emplace_back(snd);
+
+            auto result = openSound(*sys, data, length, mode, exinfo, snd);
+            if (result != FMOD_OK && !(mode & FMOD_NONBLOCKING))
+            {
+                releaseSound(*snd);
+                return result;
+            }
+
+            // Non-blocking loads complete right away, failures are
+            // reported by getOpenState
+            snd->openResult = result;
+            if (!inMemory)
+                snd->name = name_or_data;
+
+            *sound = handle(snd);
+            return FMOD_OK;
+        }
+        catch(const std::bad_alloc &)
+        {
+            return FMOD_ERR_MEMORY;
+        }
+    }
+
+
+    FMOD_RESULT F_API System::createDSP(
+        const FMOD_DSP_DESCRIPTION *description, DSP **dsp)
+    {
+        auto sys = Mock::system(this);
+        if (!description || !dsp)
+            return FMOD_ERR_INVALID_PARAM;
+        if (description->process && !description->read)
+            return FMOD_ERR_UNSUPPORTED; // only read callbacks are mixed
+
+        DSPImpl *impl = nullptr;
+        try {
+            impl = new DSPImpl();
+            sys->dsps.emplace_back(impl);
+        }
+        catch(const std::bad_alloc &)
+        {
+            delete impl;
+            return FMOD_ERR_MEMORY;
+        }
+
+        impl->system = sys;
+        impl->owner = nullptr;
+        impl->desc = *description;
+        impl->userData = description->userdata;
+        impl->bypass = false;
+
+        std::memset(&impl->state, 0, sizeof(FMOD_DSP_STATE));
+        impl->state.instance = impl;
+        impl->state.source_speakermode = sys->speakerMode;
+        impl->state.functions = &stateFunctions;
+
+        if (description->create)
+        {
+            auto result = description->create(&impl->state);
+            if (result != FMOD_OK)
+            {
+                sys->dsps.pop_back();
+                delete impl;
+                return result;
+            }
+        }
+
+        *dsp = handle(impl);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::createChannelGroup(const char *name,
+        ChannelGroup **channelgroup)
+    {
+        auto sys = Mock::system(this);
+        if (!channelgroup)
+            return FMOD_ERR_INVALID_PARAM;
+        if (!sys->initialized)
+            return FMOD_ERR_UNINITIALIZED;
+
+        GroupImpl *group = nullptr;
+        try {
+            group = new GroupImpl();
+            initControl(*group, sys, true);
+            if (name)
+                group->name = name;
+
+            sys->groups.emplace_back(group);
+            attach(*group, sys->master);
+        }
+        catch(const std::bad_alloc &)
+        {
+            if (group)
+            {
+                auto it = std::find(sys->groups.begin(), sys->groups.end(),
+                    group);
+                if (it != sys->groups.end())
+                    sys->groups.erase(it);
+                delete group;
+            }
+            return FMOD_ERR_MEMORY;
+        }
+
+        *channelgroup = handle(group);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::playSound(Sound *sound,
+        ChannelGroup *channelgroup, bool paused, Channel **channel)
+    {
+        auto sys = Mock::system(this);
+        auto snd = Mock::sound(sound);
+        if (!snd)
+            return FMOD_ERR_INVALID_PARAM;
+        if (!sys->initialized)
+            return FMOD_ERR_UNINITIALIZED;
+        if (snd->openResult != FMOD_OK)
+            return FMOD_ERR_NOTREADY;
+        if (!snd->subsounds.empty() || snd->length == 0)
+            return FMOD_ERR_SUBSOUNDS; // banks are played by subsound
+
+        if (sys->maxChannels &&
+            (int)sys->channels.size() >= sys->maxChannels)
+        {
+            // Steal the least important channel, as FMOD does
+            ChannelImpl *victim = nullptr;
+            for (auto chan : sys->channels)
+            {
+                if (!victim || chan->priority > victim->priority ||
+                    (chan->priority == victim->priority &&
+                        audibility(*chan) < audibility(*victim)))
+                {
+                    victim = chan;
+                }
+            }
+
+            if (!victim || victim->priority < snd->priority)
+                return FMOD_ERR_CHANNEL_ALLOC;
+            stopChannel(*victim);
+        }
+
+        ChannelImpl *chan;
+        try {
+            chan = acquireChannel();
+        }
+        catch(const std::bad_alloc &)
+        {
+            return FMOD_ERR_MEMORY;
+        }
+
+        initControl(*chan, sys, false);
+        chan->paused = paused;
+        chan->sound = snd;
+        chan->position = 0;
+        chan->frequency = snd->frequency;
+        chan->mode = snd->mode;
+        chan->loopStart = snd->loopStart;
+        chan->loopEnd = snd->loopEnd;
+        chan->priority = snd->priority;
+        chan->isVirtual = false;
+        chan->ended = false;
+
+        try {
+            sys->channels.emplace_back(chan);
+            attach(*chan, channelgroup ? Mock::group(channelgroup) :
+                sys->master);
+        }
+        catch(const std::bad_alloc &)
+        {
+            stopChannel(*chan);
+            return FMOD_ERR_MEMORY;
+        }
+
+        if (channel)
+            *channel = channelHandle(chan);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getMasterChannelGroup(
+        ChannelGroup **channelgroup)
+    {
+        auto sys = Mock::system(this);
+        if (!channelgroup)
+            return FMOD_ERR_INVALID_PARAM;
+        if (!sys->master)
+            return FMOD_ERR_UNINITIALIZED;
+
+        *channelgroup = handle(sys->master);
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setReverbProperties(int instance,
+        const FMOD_REVERB_PROPERTIES *prop)
+    {
+        if (instance < 0 || instance >= FMOD_REVERB_MAXINSTANCES)
+            return FMOD_ERR_INVALID_PARAM;
+
+        // Stored only, reverb is not mixed
+        const FMOD_REVERB_PROPERTIES off = FMOD_PRESET_OFF;
+        Mock::system(this)->reverb[instance] = prop ? *prop : off;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getReverbProperties(int instance,
+        FMOD_REVERB_PROPERTIES *prop)
+    {
+        if (instance < 0 || instance >= FMOD_REVERB_MAXINSTANCES || !prop)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *prop = Mock::system(this)->reverb[instance];
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::setUserData(void *userdata)
+    {
+        Mock::system(this)->userData = userdata;
+        return FMOD_OK;
+    }
+
+
+    FMOD_RESULT F_API System::getUserData(void **userdata)
+    {
+        if (!userdata)
+            return FMOD_ERR_INVALID_PARAM;
+
+        *userdata = Mock::system(this)->userData;
+        return FMOD_OK;
+    }
+}
@@ -52,12 +52,94 @@ EMSCRIPTEN_BINDINGS(AudioEngine) {
         .field("start", &LoopInfo<double>::start)
         .field("end", &LoopInfo<double>::end)
         ;
+    value_object<SyncStats>("SyncStats")
+        .field("checks", &SyncStats::checks)
+        .field("resyncs", &SyncStats::resyncs)
+        .field("lastSkew", &SyncStats::lastSkew)
+        .field("maxSkew", &SyncStats::maxSkew)
+        .field("totalSkew", &SyncStats::totalSkew)
+        ;
+
+    value_object<LatencyStats>("LatencyStats")
+        .field("profile", &LatencyStats::profile)
+        .field("active", &LatencyStats::active)
+        .field("bufferLength", &LatencyStats::bufferLength)
+        .field("bufferCount", &LatencyStats::bufferCount)
+        .field("latency", &LatencyStats::latency)
+        .field("underruns", &LatencyStats::underruns)
+        .field("reinits", &LatencyStats::reinits)
+        .field("failedReinits", &LatencyStats::failedReinits)
+        .field("pending", &LatencyStats::pending)
+        ;
+
+    value_object<TimingStats>("TimingStats")
+        .field("name", &TimingStats::name)
+        .field("count", &TimingStats::count)
+        .field("min", &TimingStats::min)
+        .field("avg", &TimingStats::avg)
+        .field("p99", &TimingStats::p99)
+        .field("max", &TimingStats::max)
+        ;
+    value_object<TrackProfile>("TrackProfile")
+        .field("handle", &TrackProfile::handle)
+        .field("voices", &TrackProfile::voices)
+        .field("dsps", &TrackProfile::dsps)
+        ;
+    register_vector<TimingStats>("TimingStatsVector");
+    register_vector<TrackProfile>("TrackProfileVector");
+    value_object<ProfileSnapshot>("ProfileSnapshot")
+        .field("window", &ProfileSnapshot::window)
+        .field("cpuDsp", &ProfileSnapshot::cpuDsp)
+        .field("cpuStream", &ProfileSnapshot::cpuStream)
+        .field("cpuGeometry", &ProfileSnapshot::cpuGeometry)
+        .field("cpuUpdate", &ProfileSnapshot::cpuUpdate)
+        .field("cpuConvolution1", &ProfileSnapshot::cpuConvolution1)
+        .field("cpuConvolution2", &ProfileSnapshot::cpuConvolution2)
+        .field("timings", &ProfileSnapshot::timings)
+        .field("tracks", &ProfileSnapshot::tracks)
+        .field("currentAlloc", &ProfileSnapshot::currentAlloc)
+        .field("maxAlloc", &ProfileSnapshot::maxAlloc)
+        ;
+
+    value_object<GlitchStats>("GlitchStats")
+        .field("underruns", &GlitchStats::underruns)
+        .field("overloads", &GlitchStats::overloads)
+        .field("lateMixes", &GlitchStats::lateMixes)
+        .field("lateUpdates", &GlitchStats::lateUpdates)
+        .field("lastGlitch", &GlitchStats::lastGlitch)
+        .field("maxMix", &GlitchStats::maxMix)
+        .field("maxMixInterval", &GlitchStats::maxMixInterval)
+        .field("maxUpdateInterval", &GlitchStats::maxUpdateInterval)
+        ;
+
+    value_object<MemoryStats>("MemoryStats")
+        .field("budget", &MemoryStats::budget)
+        .field("live", &MemoryStats::live)
+        .field("peak", &MemoryStats::peak)
+        .field("fmodLive", &MemoryStats::fmodLive)
+        .field("fmodPeak", &MemoryStats::fmodPeak)
+        .field("pcmLive", &MemoryStats::pcmLive)
+        .field("pcmPeak", &MemoryStats::pcmPeak)
+        .field("luaLive", &MemoryStats::luaLive)
+        .field("luaPeak", &MemoryStats::luaPeak)
+        .field("engineLive", &MemoryStats::engineLive)
+        .field("enginePeak", &MemoryStats::enginePeak)
+        .field("failures", &MemoryStats::failures)
+        .field("lastFailure", &MemoryStats::lastFailure)
+        ;
+
+    value_object<VoiceStats>("VoiceStats")
+        .field("budget", &VoiceStats::budget)
+        .field("playing", &VoiceStats::playing)
+        .field("real", &VoiceStats::real)
+        .field("pending", &VoiceStats::pending)
+        ;
 
     using T = AudioEngine;
 
     class_<AudioEngine>("AudioEngine")
         .constructor<>()
-        .function("init", &T::init)
+        .function("init", select_overload<bool()>(&T::init))
         .function("resume", &T::resume)
         .function("suspend", &T::suspend)
         .function("update", &T::update)
@@ -68,10 +150,92 @@ EMSCRIPTEN_BINDINGS(AudioEngine) {
         .function("getAudibility", &T::getAudibility)
         .function("getCPUUsageTotal", &T::getCPUUsageTotal)
         .function("getCPUUsageDSP", &T::getCPUUsageDSP)
+        .function("attachTrack", &T::attachTrack)
+        .function("detachTrack", &T::detachTrack)
+        .function("transportStart", &T::transportStart)
+        .function("transportStop", &T::transportStop)
+        .function("transportSeek", &T::transportSeek)
+        .function("transportTransitionTo", &T::transportTransitionTo)
+        .function("setTransportTempo", &T::setTransportTempo)
+        .function("getTransportPlaying", &T::getTransportPlaying)
+        .function("setLatencyProfile", &T::setLatencyProfile)
+        .function("getLatencyProfile", &T::getLatencyProfile)
+        .function("getLatencyStats", &T::getLatencyStats)
+        .function("setVoiceBudget", &T::setVoiceBudget)
+        .function("getVoiceStats", &T::getVoiceStats)
+        .function("getProfile", &T::getProfile)
+        .function("resetProfile", &T::resetProfile)
+        .function("setProfiling", &T::setProfiling)
+        .function("setProfileWindow", &T::setProfileWindow)
+        .function("getGlitchStats", &T::getGlitchStats)
+        .function("resetGlitchStats", &T::resetGlitchStats)
+        .function("setMemoryBudget", &T::setMemoryBudget)
+        .function("getMemoryStats", &T::getMemoryStats)
+        .function("resetMemoryPeaks", &T::resetMemoryPeaks)
+        .function("setGlitchCallback", optional_override(
+            [](T &engine, emscripten::val callback) {
+                if (callback.isNull() || callback.isUndefined())
+                {
+                    engine.onGlitch({});
+                    return;
+                }
+
+                engine.onGlitch([callback](const Glitch &glitch) {
+                    callback((int)glitch.type, glitch.time, glitch.duration,
+                        (double)glitch.clock);
+                });
+            }))
+        .function("playlistEnqueue", optional_override(
+            [](T &engine, size_t data, size_t bytelength, float crossfade,
+                std::string exitMarker) {
+                engine.playlist().enqueue((const char *)data, bytelength,
+                    crossfade, exitMarker);
+            }))
+        .function("playlistPlay", optional_override(
+            [](T &engine, float seconds) {
+                engine.playlist().play(seconds);
+            }))
+        .function("playlistStop", optional_override(
+            [](T &engine, float seconds) {
+                engine.playlist().stop(seconds);
+            }))
+        .function("playlistSkip", optional_override(
+            [](T &engine, float crossfade) {
+                return engine.playlist().skip(crossfade);
+            }))
+        .function("playlistClear", optional_override(
+            [](T &engine) {
+                engine.playlist().clear();
+            }))
+        .function("getPlaylistSize", optional_override(
+            [](const T &engine) {
+                return (int)engine.playlist().size();
+            }))
+        .function("getPlaylistPlayed", optional_override(
+            [](const T &engine) {
+                return (int)engine.playlist().played();
+            }))
+        .function("getPlaylistPreloaded", optional_override(
+            [](const T &engine) {
+                return engine.playlist().preloaded();
+            }))
+        .function("setPlaylistCallback", optional_override(
+            [](T &engine, emscripten::val callback) {
+                if (callback.isNull() || callback.isUndefined())
+                {
+                    engine.playlist().onSwitch({});
+                    return;
+                }
+
+                engine.playlist().onSwitch([callback](size_t played) {
+                    callback((int)played);
+                });
+            }))
         ;
 
     class_<MultiTrackControl>("MultiTrackControl")
-        .constructor<uintptr_t, emscripten::val>()
+        .constructor<AudioEngine &, AudioEngine::TrackHandle,
+            emscripten::val>()
         .function("loadSound", &MultiTrackControl::loadSound)
         .function("loadBank", &MultiTrackControl::loadBank)
         .function("loadScript", &MultiTrackControl::loadScript)
@@ -85,6 +249,8 @@ EMSCRIPTEN_BINDINGS(AudioEngine) {
         .function("getVolume", &MultiTrackControl::getVolume)
         .function("setReverbLevel", &MultiTrackControl::setReverbLevel)
         .function("getReverbLevel", &MultiTrackControl::getReverbLevel)
+        .function("setPriority", &MultiTrackControl::setPriority)
+        .function("getPriority", &MultiTrackControl::getPriority)
         .function("setPanLeft", &MultiTrackControl::setPanLeft)
         .function("getPanLeft", &MultiTrackControl::getPanLeft)
         .function("setPanRight", &MultiTrackControl::setPanRight)
@@ -92,6 +258,21 @@ EMSCRIPTEN_BINDINGS(AudioEngine) {
         .function("setPosition", &MultiTrackControl::setPosition)
         .function("getPosition", &MultiTrackControl::getPosition)
         .function("transitionTo", &MultiTrackControl::transitionTo)
+        .function("transitionToQuantized",
+            &MultiTrackControl::transitionToQuantized)
+        .function("addTempoPoint", &MultiTrackControl::addTempoPoint)
+        .function("clearTempoMap", &MultiTrackControl::clearTempoMap)
+        .function("loadStinger", &MultiTrackControl::loadStinger)
+        .function("playStinger", &MultiTrackControl::playStinger)
+        .function("stopStingers", &MultiTrackControl::stopStingers)
+        .function("setMaxStingerVoices",
+            &MultiTrackControl::setMaxStingerVoices)
+        .function("clearStingers", &MultiTrackControl::clearStingers)
+        .function("getSyncStats", &MultiTrackControl::getSyncStats)
+        .function("resetSyncStats", &MultiTrackControl::resetSyncStats)
+        .function("setSyncThreshold", &MultiTrackControl::setSyncThreshold)
+        .function("setUseStemMixer", &MultiTrackControl::setUseStemMixer)
+        .function("getUseStemMixer", &MultiTrackControl::getUseStemMixer)
         .function("getLength", &MultiTrackControl::getLength)
         .function("getChannelCount", &MultiTrackControl::getChannelCount)
         .function("getAudibility", &MultiTrackControl::getAudibility)
@@ -102,11 +283,21 @@ EMSCRIPTEN_BINDINGS(AudioEngine) {
         .function("editSyncPoint", &MultiTrackControl::editSyncPoint)
         .function("getSyncPointCount", &MultiTrackControl::getSyncPointCount)
         .function("getSyncPoint", &MultiTrackControl::getSyncPoint)
+        .function("setSyncPoints", &MultiTrackControl::setSyncPoints)
+        .function("getSyncPoints", &MultiTrackControl::getSyncPoints)
         .function("getSampleData", &MultiTrackControl::getSampleData)
-        .function("onSyncPoint", &MultiTrackControl::onSyncPoint)
+        .function("onEvents", &MultiTrackControl::onEvents)
+        .function("setMarkerLookahead", &MultiTrackControl::setMarkerLookahead)
         .function("doMarker", &MultiTrackControl::doMarker)
         .function("samplerate", &MultiTrackControl::samplerate)
         .function("dspClock", &MultiTrackControl::dspClock)
         .function("setParameter", &MultiTrackControl::setParameter)
+        .function("addSection", &MultiTrackControl::addSection)
+        .function("addSectionExit", &MultiTrackControl::addSectionExit)
+        .function("clearSections", &MultiTrackControl::clearSections)
+        .function("startSection", &MultiTrackControl::startSection)
+        .function("getCurrentSection", &MultiTrackControl::getCurrentSection)
+        .function("setSequencerLookahead",
+            &MultiTrackControl::setSequencerLookahead)
         ;
 }
@@ -0,0 +1,48 @@
+#include "AdaptiveLatency.h"
+
+namespace Insound
+{
+    AdaptiveLatency::AdaptiveLatency(LatencyProfile start) :
+        m_profile(), m_underruns(), m_elapsed(), m_hot()
+    {
+        reset(start);
+    }
+
+
+    bool AdaptiveLatency::observe(unsigned underruns, float cpu,
+        double seconds)
+    {
+        m_elapsed += seconds;
+        if (m_elapsed > Window)
+        {
+            m_elapsed = 0;
+            m_underruns = 0;
+        }
+        m_underruns += underruns;
+
+        m_hot = (cpu >= MaxCPU) ? m_hot + seconds : 0;
+
+        if (m_underruns < MaxUnderruns && m_hot < HotTime)
+            return false;
+
+        // already at the safest profile
+        if (m_profile == LatencyProfile::PowerSaver)
+        {
+            reset(m_profile);
+            return false;
+        }
+
+        reset(static_cast<LatencyProfile>(static_cast<int>(m_profile) + 1));
+        return true;
+    }
+
+
+    void AdaptiveLatency::reset(LatencyProfile profile)
+    {
+        m_profile = (profile == LatencyProfile::Adaptive) ?
+            LatencyProfile::Low : profile;
+        m_underruns = 0;
+        m_elapsed = 0;
+        m_hot = 0;
+    }
+}
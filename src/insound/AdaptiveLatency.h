@@ -0,0 +1,56 @@
+#pragma once
+
+#include <insound/LatencyProfile.h>
+
+namespace Insound
+{
+    /**
+     * Decides when the output should back off to a safer latency profile,
+     * from underruns and CPU usage measured each engine update.
+     */
+    class AdaptiveLatency
+    {
+    public:
+        /** Underruns within `Window` seconds that call for a back-off */
+        static constexpr unsigned MaxUnderruns = 3;
+        static constexpr double Window = 10.0;
+        /** CPU usage in percent that calls for a back-off if sustained for
+         *  `HotTime` seconds */
+        static constexpr float MaxCPU = 85.f;
+        static constexpr double HotTime = 2.0;
+
+        explicit AdaptiveLatency(LatencyProfile start = LatencyProfile::Low);
+
+        /**
+         * Record the measurements of one engine update.
+         *
+         * @param underruns - underruns since the last call
+         * @param cpu       - total mixer CPU usage in percent
+         * @param seconds   - time since the last call
+         *
+         * @return whether to back off, `profile()` is then the profile to
+         *         switch to
+         */
+        bool observe(unsigned underruns, float cpu, double seconds);
+
+        /**
+         * Start over at a profile, forgetting measurements
+         */
+        void reset(LatencyProfile profile);
+
+        /**
+         * Profile the output should currently be using, never `Adaptive`
+         */
+        [[nodiscard]]
+        LatencyProfile profile() const { return m_profile; }
+
+    private:
+        LatencyProfile m_profile;
+        // Underruns in the current window
+        unsigned m_underruns;
+        // Seconds into the current window
+        double m_elapsed;
+        // Seconds CPU usage has been above the limit
+        double m_hot;
+    };
+}
@@ -5,41 +5,85 @@
 #include "scripting/Marker.h"
 
 #include <insound/MultiTrackAudio.h>
+#include <insound/TrackEvent.h>
 
 #include <fmod.hpp>
 #include <fmod_errors.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <optional>
 #include <stdexcept>
 #include <variant>
 
+// Consecutive failures to create the new output before a re-init is dropped
+static const unsigned MAX_REINIT_ATTEMPTS = 3;
+
 namespace Insound
 {
-    AudioEngine::AudioEngine(): sys(), master(), tracks()
+    /**
+     * Times each mix for the engine's glitch monitor
+     */
+    static FMOD_RESULT F_CALL mixCallback(FMOD_SYSTEM *system,
+        FMOD_SYSTEM_CALLBACK_TYPE type, void *commanddata1,
+        void *commanddata2, void *userdata)
+    {
+        auto engine = static_cast<AudioEngine *>(userdata);
+        if (!engine)
+            return FMOD_OK;
+
+        auto &monitor = engine->glitchMonitor();
+        if (type == FMOD_SYSTEM_CALLBACK_PREMIX)
+            monitor.mixBegin(monitor.now());
+        else if (type == FMOD_SYSTEM_CALLBACK_POSTMIX)
+            monitor.mixEnd(monitor.now());
+
+        return FMOD_OK;
+    }
+
+    AudioEngine::AudioEngine(): sys(), master(), m_transport(), tracks(),
+        m_playlist(*this), m_settings(), m_profile(LatencyProfile::Balanced),
+        m_active(LatencyProfile::Balanced), m_adaptive(m_active),
+        m_pending(), m_reinits(), m_failedReinits(), m_attempts(),
+        m_voiceBudget(m_settings.realChannels),
+        m_profiler(), m_glitches(), m_lastTime()
     {}
 
-    uintptr_t AudioEngine::createTrack()
+    AudioEngine::TrackHandle AudioEngine::createTrack()
     {
-        return (uintptr_t)tracks.emplace_back(new MultiTrackAudio(sys));
+        auto track = new MultiTrackAudio(sys);
+        const auto handle = tracks.insert(track);
+        if (!handle)
+        {
+            delete track;
+            throw std::runtime_error("AudioEngine::createTrack: maximum "
+                "number of tracks reached");
+        }
+
+        return handle;
     }
 
-    void AudioEngine::deleteTrack(uintptr_t track)
+    void AudioEngine::deleteTrack(TrackHandle track)
     {
-        auto size = tracks.size();
-        for (int i = 0; i < size; ++i)
-        {
-            auto curTrack = tracks[i];
-            if ((uintptr_t)curTrack == track)
-            {
-                curTrack->clear();
-                delete curTrack;
+        auto curTrack = getTrack(track);
+        if (!curTrack)
+            return;
 
-                tracks.erase(tracks.begin() + i);
-                break;
-            }
-        }
+        if (m_transport)
+            m_transport->detach(curTrack);
+
+        curTrack->clear();
+        delete curTrack;
+
+        tracks.erase(track);
+    }
+
+    MultiTrackAudio *AudioEngine::getTrack(TrackHandle track) const
+    {
+        auto result = tracks.find(track);
+        return result ? *result : nullptr;
     }
 
     AudioEngine::~AudioEngine()
@@ -50,79 +94,403 @@ namespace Insound
     void AudioEngine::resume()
     {
         checkResult(sys->mixerResume());
+        m_glitches.suspend(false);
+        m_lastTime = std::chrono::steady_clock::now();
     }
 
     void AudioEngine::suspend()
     {
         checkResult(sys->mixerSuspend());
+        m_glitches.suspend(true);
     }
 
     void AudioEngine::update()
     {
+        m_profiler.tick();
+        ProfileScope scope(&m_profiler, ProfileSection::EngineUpdate);
+
+        for (auto track : tracks)
+        {
+            track->update();
+        }
+
+        m_playlist.update();
+
         checkResult(sys->update());
+
+        if (m_settings.output != OutputMode::Realtime)
+            return;
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto seconds = std::chrono::duration<double>(
+            now - m_lastTime).count();
+        m_lastTime = now;
+
+        const auto underruns = detectGlitches(seconds);
+
+        if (m_profile == LatencyProfile::Adaptive && !m_pending &&
+            m_adaptive.observe(underruns, getCPUUsageTotal(), seconds))
+        {
+            m_active = m_adaptive.profile();
+            m_pending = true;
+        }
+
+        if (m_pending)
+            reinit();
+    }
+
+    unsigned AudioEngine::detectGlitches(double seconds)
+    {
+        const auto clock = transport().clock();
+        const auto before = m_glitches.stats().underruns;
+        m_glitches.update(clock, seconds, m_glitches.now());
+
+        // Overloads and late mixes may not be audible, only underruns are
+        const auto underruns = m_glitches.stats().underruns - before;
+        if (!underruns)
+            return 0;
+
+        for (auto track : tracks)
+        {
+            if (!track->isLoaded())
+                continue;
+
+            track->pushEvent(TrackEvent{
+                .type=TrackEvent::Type::Underrun,
+                .index=0,
+                .offset=track->channel(0).ch_positionSamples(),
+                .clock=clock,
+            });
+        }
+
+        return underruns;
+    }
+
+    bool AudioEngine::reinit()
+    {
+        // Wait for a point where nothing scheduled on the old clock is left
+        // to carry over
+        if (m_playlist.switching())
+            return false;
+
+        for (auto track : tracks)
+        {
+            if (!track->canRebind())
+                return false;
+        }
+
+        auto settings = m_settings;
+        const auto config = bufferConfig(m_active);
+        settings.bufferLength = config.bufferLength;
+        settings.bufferCount = config.bufferCount;
+        settings.realChannels = m_voiceBudget;
+
+        auto next = createSystem(settings);
+        if (!next)
+            return reinitFailed();
+
+        FMOD::ChannelGroup *group;
+        auto result = next->getMasterChannelGroup(&group);
+        if (result != FMOD_OK)
+        {
+            next->release();
+            std::cerr << FMOD_ErrorString(result) << '\n';
+            return reinitFailed();
+        }
+
+        // Tracks release their objects on the old system, still alive here,
+        // and resume where they were on the new one
+        for (auto track : tracks)
+        {
+            track->rebind(next);
+        }
+
+        const auto volume = master->volume();
+        master.reset();
+        sys->release();
+
+        sys = next;
+        master.emplace(group);
+        master->volume(volume);
+        m_transport->rebind(next);
+
+        m_settings = settings;
+        m_pending = false;
+        m_attempts = 0;
+        ++m_reinits;
+        m_glitches.configure(samplerate(), settings.bufferLength,
+            settings.bufferCount);
+        m_glitches.restart(m_transport->clock());
+        m_lastTime = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    bool AudioEngine::reinitFailed()
+    {
+        ++m_failedReinits;
+        if (++m_attempts < MAX_REINIT_ATTEMPTS)
+            return false;
+
+        // Drop the change, staying on the output in use
+        m_pending = false;
+        m_attempts = 0;
+        m_voiceBudget = m_settings.realChannels;
+        m_active = closestProfile(m_settings.bufferLength,
+            m_settings.bufferCount);
+        if (m_profile == LatencyProfile::Adaptive)
+            m_adaptive.reset(m_active);
+        return false;
+    }
+
+    void AudioEngine::setLatencyProfile(int profile)
+    {
+        if (profile < 0 || profile > (int)LatencyProfile::Adaptive)
+            throw std::invalid_argument("AudioEngine::setLatencyProfile: "
+                "invalid profile");
+
+        m_profile = static_cast<LatencyProfile>(profile);
+        m_adaptive.reset(m_profile);
+        m_active = m_adaptive.profile();
+
+        if (sys && m_settings.output == OutputMode::Realtime)
+        {
+            m_attempts = 0;
+            const auto config = bufferConfig(m_active);
+            m_pending = config.bufferLength != m_settings.bufferLength ||
+                config.bufferCount != m_settings.bufferCount ||
+                m_voiceBudget != m_settings.realChannels;
+        }
+    }
+
+    void AudioEngine::setVoiceBudget(int voices)
+    {
+        if (voices <= 0)
+            throw std::invalid_argument("AudioEngine::setVoiceBudget: must "
+                "be greater than 0");
+
+        m_voiceBudget = voices;
+        if (sys && m_settings.output == OutputMode::Realtime)
+        {
+            m_attempts = 0;
+            m_pending = m_pending || voices != m_settings.realChannels;
+        }
+    }
+
+    VoiceStats AudioEngine::getVoiceStats() const
+    {
+        int playing, real;
+        checkResult( sys->getChannelsPlaying(&playing, &real) );
+
+        int budget;
+        checkResult( sys->getSoftwareChannels(&budget) );
+
+        return VoiceStats{
+            .budget=budget,
+            .playing=playing,
+            .real=real,
+            .pending=m_pending && m_voiceBudget != budget,
+        };
+    }
+
+    int AudioEngine::getLatencyProfile() const
+    {
+        return static_cast<int>(m_profile);
+    }
+
+    LatencyStats AudioEngine::getLatencyStats() const
+    {
+        unsigned bufferLength = m_settings.bufferLength;
+        int bufferCount = m_settings.bufferCount;
+        if (sys)
+            checkResult( sys->getDSPBufferSize(&bufferLength, &bufferCount) );
+
+        // the configuration in use is the active one, unless a switch is
+        // still waiting to be applied
+        const auto active = m_pending ?
+            closestProfile(bufferLength, bufferCount) : m_active;
+
+        return LatencyStats{
+            .profile=static_cast<int>(m_profile),
+            .active=static_cast<int>(active),
+            .bufferLength=bufferLength,
+            .bufferCount=bufferCount,
+            .latency=sys ? (double)bufferLength * bufferCount / samplerate() :
+                0,
+            .underruns=m_glitches.stats().underruns,
+            .reinits=m_reinits,
+            .failedReinits=m_failedReinits,
+            .pending=m_pending,
+        };
     }
 
     bool AudioEngine::init()
     {
+        AudioEngineSettings settings;
+        const auto config = bufferConfig(m_active);
+        settings.bufferLength = config.bufferLength;
+        settings.bufferCount = config.bufferCount;
+        settings.realChannels = m_voiceBudget;
+
+        return init(settings);
+    }
+
+    bool AudioEngine::init(const AudioEngineSettings &settings)
+    {
+        auto sys = createSystem(settings);
+        if (!sys)
+            return false;
+
+        FMOD::ChannelGroup *master;
+        auto result = sys->getMasterChannelGroup(&master);
+        if (result != FMOD_OK)
+        {
+            sys->release();
+            std::cerr << FMOD_ErrorString(result) << '\n';
+            return false;
+        }
+
+        if (this->sys)
+        {
+            this->sys->release();
+        }
+
+        this->sys = sys;
+        this->master.emplace(master);
+        this->m_transport.emplace(sys);
+
+        m_settings = settings;
+        m_voiceBudget = settings.realChannels;
+        m_pending = false;
+        m_attempts = 0;
+
+        // Custom buffers count as the profile closest to them
+        m_active = closestProfile(settings.bufferLength,
+            settings.bufferCount);
+        if (m_profile == LatencyProfile::Adaptive)
+            m_adaptive.reset(m_active);
+        else
+            m_profile = m_active;
+        m_glitches.configure(samplerate(), settings.bufferLength,
+            settings.bufferCount);
+        m_glitches.suspend(false);
+        m_glitches.restart(m_transport->clock());
+        m_glitches.resetStats();
+        m_lastTime = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    FMOD::System *AudioEngine::createSystem(
+        const AudioEngineSettings &settings)
+    {
+        // FMOD allocations are counted against the memory budget
+        MemoryBudget::install();
+
         FMOD::System *sys;
         auto result = FMOD::System_Create(&sys);
         if (result != FMOD_OK)
         {
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
+        }
+
+        void *extraDriverData = nullptr;
+        switch(settings.output)
+        {
+        case OutputMode::NoSoundNRT:
+            result = sys->setOutput(FMOD_OUTPUTTYPE_NOSOUND_NRT);
+            break;
+        case OutputMode::WavWriterNRT:
+            result = sys->setOutput(FMOD_OUTPUTTYPE_WAVWRITER_NRT);
+            extraDriverData = (void *)settings.outputFile.c_str();
+            break;
+        default:
+            break;
         }
 
-        int system_rate;
-        result = sys->getDriverInfo(0, nullptr, 0, nullptr, &system_rate,
-            nullptr, nullptr);
         if (result != FMOD_OK)
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
+        }
+
+        int system_rate = settings.samplerate;
+        if (system_rate <= 0)
+        {
+            result = sys->getDriverInfo(0, nullptr, 0, nullptr, &system_rate,
+                nullptr, nullptr);
+            if (result != FMOD_OK)
+            {
+                sys->release();
+                std::cerr << FMOD_ErrorString(result) << '\n';
+                return nullptr;
+            }
         }
 
-        result = sys->setSoftwareFormat(system_rate, FMOD_SPEAKERMODE_DEFAULT,
-            0);
+        result = sys->setSoftwareFormat(system_rate, settings.stereo ?
+            FMOD_SPEAKERMODE_STEREO : FMOD_SPEAKERMODE_DEFAULT, 0);
         if (result != FMOD_OK)
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
         }
 
-        result = sys->setDSPBufferSize(2048, 2);
+        result = sys->setDSPBufferSize(settings.bufferLength,
+            settings.bufferCount);
         if (result != FMOD_OK)
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
         }
 
-        result = sys->init(1024, FMOD_INIT_NORMAL, nullptr);
+        result = sys->setSoftwareChannels(settings.realChannels);
         if (result != FMOD_OK)
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
         }
 
-        FMOD_REVERB_PROPERTIES reverbPreset = FMOD_PRESET_CONCERTHALL;
-        result = sys->setReverbProperties(0, &reverbPreset);
+        FMOD_INITFLAGS flags = FMOD_INIT_NORMAL;
+        if (settings.virtualVolume > 0)
+        {
+            FMOD_ADVANCEDSETTINGS advanced;
+            std::memset(&advanced, 0, sizeof(FMOD_ADVANCEDSETTINGS));
+            advanced.cbSize = sizeof(FMOD_ADVANCEDSETTINGS);
+            result = sys->getAdvancedSettings(&advanced);
+            if (result == FMOD_OK)
+            {
+                advanced.vol0virtualvol = settings.virtualVolume;
+                result = sys->setAdvancedSettings(&advanced);
+            }
+
+            if (result != FMOD_OK)
+            {
+                sys->release();
+                std::cerr << FMOD_ErrorString(result) << '\n';
+                return nullptr;
+            }
+
+            flags |= FMOD_INIT_VOL0_BECOMES_VIRTUAL;
+        }
+
+        result = sys->init(settings.maxChannels, flags, extraDriverData);
         if (result != FMOD_OK)
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
         }
 
-        FMOD::ChannelGroup *master;
-        result = sys->getMasterChannelGroup(&master);
+        FMOD_REVERB_PROPERTIES reverbPreset = FMOD_PRESET_CONCERTHALL;
+        result = sys->setReverbProperties(0, &reverbPreset);
         if (result != FMOD_OK)
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
         }
 
         result = sys->setUserData(this);
@@ -130,21 +498,29 @@ namespace Insound
         {
             sys->release();
             std::cerr << FMOD_ErrorString(result) << '\n';
-            return false;
+            return nullptr;
         }
 
-        if (this->sys)
+        if (settings.output == OutputMode::Realtime)
         {
-            this->sys->release();
+            result = sys->setCallback(mixCallback,
+                FMOD_SYSTEM_CALLBACK_PREMIX | FMOD_SYSTEM_CALLBACK_POSTMIX);
+            if (result != FMOD_OK)
+            {
+                sys->release();
+                std::cerr << FMOD_ErrorString(result) << '\n';
+                return nullptr;
+            }
         }
 
-        this->sys = sys;
-        this->master.emplace(master);
-        return true;
+        return sys;
     }
 
     void AudioEngine::close()
     {
+        m_playlist.clear();
+        m_transport.reset();
+
         for (auto track : tracks)
         {
             track->clear();
@@ -164,6 +540,13 @@ namespace Insound
         }
     }
 
+    int AudioEngine::samplerate() const
+    {
+        int rate;
+        checkResult( sys->getSoftwareFormat(&rate, nullptr, nullptr) );
+        return rate;
+    }
+
     float AudioEngine::getMasterVolume() const
     {
         return master->volume();
@@ -189,8 +572,148 @@ namespace Insound
         return usage.dsp;
     }
 
+    ProfileSnapshot AudioEngine::getProfile() const
+    {
+        FMOD_CPU_USAGE usage;
+        checkResult(sys->getCPUUsage(&usage));
+
+        ProfileSnapshot result{
+            .window=m_profiler.reportedWindow(),
+            .cpuDsp=usage.dsp,
+            .cpuStream=usage.stream,
+            .cpuGeometry=usage.geometry,
+            .cpuUpdate=usage.update,
+            .cpuConvolution1=usage.convolution1,
+            .cpuConvolution2=usage.convolution2,
+            .timings=m_profiler.stats(),
+            .tracks={},
+            .currentAlloc=0,
+            .maxAlloc=0,
+        };
+
+        checkResult( FMOD::Memory_GetStats(&result.currentAlloc,
+            &result.maxAlloc, false) );
+
+        result.tracks.reserve(tracks.size());
+        for (auto handle : tracks.handles())
+        {
+            auto &track = result.tracks.emplace_back(
+                (*tracks.find(handle))->profile());
+            track.handle = handle;
+        }
+
+        return result;
+    }
+
+    GlitchStats AudioEngine::getGlitchStats() const
+    {
+        return m_glitches.stats();
+    }
+
+    void AudioEngine::resetGlitchStats()
+    {
+        m_glitches.resetStats();
+    }
+
+    void AudioEngine::setMemoryBudget(size_t bytes)
+    {
+        MemoryBudget::budget(bytes);
+    }
+
+    MemoryStats AudioEngine::getMemoryStats() const
+    {
+        return MemoryBudget::stats();
+    }
+
+    void AudioEngine::resetMemoryPeaks()
+    {
+        MemoryBudget::resetPeaks();
+    }
+
+    void AudioEngine::onGlitch(std::function<void(const Glitch &)> callback)
+    {
+        m_glitches.onGlitch(std::move(callback));
+    }
+
+    void AudioEngine::resetProfile()
+    {
+        m_profiler.reset();
+    }
+
+    void AudioEngine::setProfiling(bool enabled)
+    {
+        m_profiler.enabled(enabled);
+    }
+
+    void AudioEngine::setProfileWindow(double seconds)
+    {
+        m_profiler.window(seconds);
+    }
+
     float AudioEngine::getAudibility() const
     {
         return master->audibility();
     }
+
+    void AudioEngine::attachTrack(TrackHandle track)
+    {
+        auto curTrack = getTrack(track);
+        if (!curTrack)
+            throw std::runtime_error("AudioEngine::attachTrack: track does "
+                "not belong to this engine");
+
+        transport().attach(curTrack);
+    }
+
+    void AudioEngine::detachTrack(TrackHandle track)
+    {
+        if (auto curTrack = getTrack(track))
+            transport().detach(curTrack);
+    }
+
+    void AudioEngine::transportStart(float delay)
+    {
+        transport().start(delay);
+    }
+
+    void AudioEngine::transportStop(float seconds)
+    {
+        transport().stop(seconds);
+    }
+
+    void AudioEngine::transportSeek(double seconds)
+    {
+        transport().seek(seconds);
+    }
+
+    void AudioEngine::transportTransitionTo(float position, float inTime,
+        bool fadeIn, float outTime, bool fadeOut, int quantize)
+    {
+        transport().transitionTo(position, inTime, fadeIn, outTime, fadeOut,
+            static_cast<Quantize>(quantize));
+    }
+
+    void AudioEngine::setTransportTempo(double bpm, int beatsPerBar)
+    {
+        transport().tempo(bpm, beatsPerBar);
+    }
+
+    bool AudioEngine::getTransportPlaying() const
+    {
+        return transport().playing();
+    }
+
+    Transport &AudioEngine::transport()
+    {
+        if (!m_transport)
+            throw std::runtime_error("AudioEngine was not initialized");
+        return m_transport.value();
+    }
+
+    const Transport &AudioEngine::transport() const
+    {
+        if (!m_transport)
+            throw std::runtime_error("AudioEngine was not initialized");
+        return m_transport.value();
+    }
 }
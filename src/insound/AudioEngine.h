@@ -1,13 +1,21 @@
 #pragma once
 
+#include <insound/AdaptiveLatency.h>
+#include <insound/AudioEngineSettings.h>
 #include <insound/Channel.h>
+#include <insound/GlitchMonitor.h>
+#include <insound/LatencyProfile.h>
+#include <insound/MemoryBudget.h>
 #include <insound/scripting/LuaDriver.h>
 #include <insound/params/ParamDescMgr.h>
+#include <insound/Playlist.h>
+#include <insound/profiling/Profiler.h>
 #include <insound/SampleDataInfo.h>
-
-#include <emscripten/val.h>
+#include <insound/SlotMap.h>
+#include <insound/Transport.h>
 
 #include <chrono>
+#include <optional>
 
 // Forward declaration
 namespace FMOD
@@ -20,28 +28,137 @@ namespace Insound
     class Channel;
     class MultiTrackAudio;
 
+    /**
+     * Output latency report of a realtime engine
+     */
+    struct LatencyStats
+    {
+        /** Requested `LatencyProfile` */
+        int profile;
+        /** Profile of the current buffer configuration, differs from
+         *  `profile` in adaptive mode */
+        int active;
+        /** Size of one mix block in samples */
+        unsigned bufferLength;
+        /** Number of mix blocks buffered ahead */
+        int bufferCount;
+        /** Output buffer latency in seconds */
+        double latency;
+        /** Underruns detected since the last glitch stats reset */
+        unsigned underruns;
+        /** Number of times the output was re-initialized */
+        unsigned reinits;
+        /** Number of re-inits that failed to create the new output. After 3
+         *  failures in a row, the change is dropped and the output in use
+         *  kept. */
+        unsigned failedReinits;
+        /** Whether a re-init is waiting for tracks to finish loading or
+         *  transitioning, or is retried after a failure */
+        bool pending;
+    };
+
+    /**
+     * Voice usage of the engine
+     */
+    struct VoiceStats
+    {
+        /** Budget of channels actually mixed */
+        int budget;
+        /** Channels playing, real and virtual */
+        int playing;
+        /** Channels playing that are actually mixed */
+        int real;
+        /** Whether a new budget is waiting for the output to re-init.
+         *  Always false on non-realtime outputs, which keep their budget. */
+        bool pending;
+    };
+
     class AudioEngine
     {
     public:
+        /**
+         * Generation-checked track handle. Handles of deleted tracks stay
+         * invalid, even after their slot is reused.
+         */
+        using TrackHandle = SlotMap<MultiTrackAudio *>::Handle;
+
         AudioEngine();
         ~AudioEngine();
 
     public:
         /**
-         * Initialize audio engine
+         * Initialize audio engine with the buffer configuration of the
+         * current latency profile
          * @return whether initialization was successful
          * @throws runtime error if there was an error, propagating to the
          *         frontend as a wasm error (if proper link flag is set)
          */
         bool init();
 
+        /**
+         * Initialize audio engine with custom output settings, e.g. for
+         * rendering offline faster than realtime. The latency profile
+         * becomes the one closest to the settings' buffers, unless it is
+         * adaptive, which then backs off from there.
+         * @return whether initialization was successful
+         */
+        bool init(const AudioEngineSettings &settings);
+
         /**
          * Update the audio engine to process all sound/params/levels/etc.
          * Should be called at least once every 20ms, if not faster for
          * priority of performance in-browser.
+         *
+         * Realtime outputs are checked for glitches, see `onGlitch`. Audible
+         * ones are queued to each loaded track as
+         * `TrackEvent::Type::Underrun`.
          */
         void update();
 
+        /**
+         * Set the latency profile. Before `init`, it picks the buffer
+         * configuration to initialize with. Afterward, the output is
+         * re-initialized on an update where no track is loading or in the
+         * middle of a transition, and no playlist switch is scheduled,
+         * since FMOD cannot resize buffers of a running mixer. Loaded
+         * tracks are moved over, resuming where they were after a short
+         * gap, see `MultiTrackAudio::rebind`. If the new output can't be
+         * created, the switch is retried on the next updates, and dropped
+         * after 3 failures, see `LatencyStats::failedReinits`.
+         *
+         * @param profile - `LatencyProfile` value
+         */
+        void setLatencyProfile(int profile);
+
+        /**
+         * Set how many channels are actually mixed. Beyond the budget, FMOD
+         * virtualizes the least important and least audible channels, see
+         * `MultiTrackAudio::priority`. Like latency profiles, changes after
+         * `init` apply when the output can be re-initialized. Non-realtime
+         * outputs keep the budget they were initialized with.
+         *
+         * @param voices - number of real voices, 64 by default
+         */
+        void setVoiceBudget(int voices);
+
+        /**
+         * Get the voice budget and how many voices are playing
+         */
+        [[nodiscard]]
+        VoiceStats getVoiceStats() const;
+
+        /**
+         * Get the requested `LatencyProfile` value
+         */
+        [[nodiscard]]
+        int getLatencyProfile() const;
+
+        /**
+         * Get the current buffer configuration and glitch counts
+         */
+        [[nodiscard]]
+        LatencyStats getLatencyStats() const;
+
         /**
          * Resume the audio context
          */
@@ -55,20 +172,31 @@ namespace Insound
         /**
          * Create a MultitTrackAudio object that should be wrapped inside of
          * a MultiTrackChannel object.
-         * @return ptr to the object for which JS code takes responsibility of.
-         *             JS should free this manually when done with by calling
-         *             `deleteTrack` on this pointer. It gets cleaned up during
-         *             AudioEngine disposal, however.
+         * @return handle to the track for which JS code takes responsibility.
+         *         JS should free this manually when done with by calling
+         *         `deleteTrack` on this handle. It gets cleaned up during
+         *         AudioEngine disposal, however.
+         * @throws runtime error if the maximum number of tracks is reached
          */
-        uintptr_t createTrack();
+        TrackHandle createTrack();
 
         /**
          * Release memory and resources of track. Please call this with all
-         * pointers retrieved via `createTrack` when done with.
+         * handles retrieved via `createTrack` when done with. Deleting a
+         * stale handle does nothing.
          *
-         * @param track - pointer to an MultiTrackAudio object
+         * @param track - handle retrieved from `createTrack`
          */
-        void deleteTrack(uintptr_t track);
+        void deleteTrack(TrackHandle track);
+
+        /**
+         * Get the track of a handle
+         *
+         * @param track - handle retrieved from `createTrack`
+         * @return the track, or nullptr if the handle is stale or invalid
+         */
+        [[nodiscard]]
+        MultiTrackAudio *getTrack(TrackHandle track) const;
 
         /**
          * Get the volume level of the master bus
@@ -100,14 +228,222 @@ namespace Insound
          */
         [[nodiscard]]
         float getCPUUsageDSP() const;
+
+        // ----- Profiling ----------------------------------------------------
+
+        /**
+         * Get a structured profile of the last sampling window: the FMOD CPU
+         * usage breakdown, timings of engine, track and Lua updates, per-track
+         * voices and DSPs, and FMOD allocation counters.
+         */
+        [[nodiscard]]
+        ProfileSnapshot getProfile() const;
+
+        /**
+         * Discard recorded timings and start a new sampling window
+         */
+        void resetProfile();
+
+        /**
+         * Set whether timings are recorded, on by default
+         */
+        void setProfiling(bool enabled);
+
+        /**
+         * Set the length of a profiling sampling window in seconds
+         */
+        void setProfileWindow(double seconds);
+
+        /**
+         * Get the profiler that engine components record timings into
+         */
+        [[nodiscard]]
+        Profiler &profiler() { return m_profiler; }
+
+        // ----- Glitch detection ---------------------------------------------
+
+        /**
+         * Get glitch counters and worst-case mixer and update timings since
+         * init or the last `resetGlitchStats`
+         */
+        [[nodiscard]]
+        GlitchStats getGlitchStats() const;
+
+        void resetGlitchStats();
+
+        /**
+         * Set a callback fired from `update` for each glitch detected, e.g.
+         * to correlate glitches with script, decode or GC pauses
+         */
+        void onGlitch(std::function<void(const Glitch &)> callback);
+
+        /**
+         * Get the monitor fed by the mixer callbacks
+         */
+        [[nodiscard]]
+        GlitchMonitor &glitchMonitor() { return m_glitches; }
+
+        // ----- Memory -------------------------------------------------------
+
+        /**
+         * Set the maximum bytes of FMOD, decoded PCM and Lua memory. Loading
+         * a bank that would exceed it throws `MemoryBudgetExceeded`. The
+         * budget is shared by all engines of the process.
+         *
+         * @param bytes - budget in bytes, 0 for unlimited (default)
+         */
+        void setMemoryBudget(size_t bytes);
+
+        /**
+         * Get live and peak bytes of each subsystem
+         */
+        [[nodiscard]]
+        MemoryStats getMemoryStats() const;
+
+        /**
+         * Reset peaks to the current usage, and the refusal counter
+         */
+        void resetMemoryPeaks();
+
+        // ----- Playlist -----------------------------------------------------
+
+        /**
+         * Get the queue of banks played back to back on engine-owned tracks
+         */
+        [[nodiscard]]
+        Playlist &playlist() { return m_playlist; }
+        [[nodiscard]]
+        const Playlist &playlist() const { return m_playlist; }
+
+        // ----- Transport ----------------------------------------------------
+
+        /**
+         * Attach a track created via `createTrack` to the engine transport,
+         * so that it starts, stops and seeks in sync with other attached
+         * tracks.
+         *
+         * @param track - handle retrieved from `createTrack`
+         */
+        void attachTrack(TrackHandle track);
+
+        /**
+         * Detach a track from the engine transport
+         *
+         * @param track - handle retrieved from `createTrack`
+         */
+        void detachTrack(TrackHandle track);
+
+        /**
+         * Start all attached tracks at one common DSP clock
+         *
+         * @param delay - seconds to wait before starting
+         */
+        void transportStart(float delay);
+
+        /**
+         * Stop all attached tracks at one common DSP clock
+         *
+         * @param seconds - seconds to fade out
+         */
+        void transportStop(float seconds);
+
+        /**
+         * Seek all attached tracks to a position in seconds
+         */
+        void transportSeek(double seconds);
+
+        /**
+         * Transition all attached tracks at one common DSP clock
+         *
+         * @param quantize - `Quantize` value to snap the transition to, based
+         *                   on the transport tempo
+         */
+        void transportTransitionTo(float position, float inTime, bool fadeIn,
+            float outTime, bool fadeOut, int quantize);
+
+        /**
+         * Set the tempo of the transport used for quantized transitions
+         */
+        void setTransportTempo(double bpm, int beatsPerBar);
+
+        [[nodiscard]]
+        bool getTransportPlaying() const;
+
+        [[nodiscard]]
+        Transport &transport();
+        [[nodiscard]]
+        const Transport &transport() const;
+
+        /**
+         * Get the underlying FMOD system, or nullptr if not initialized
+         */
+        [[nodiscard]]
+        FMOD::System *system() const { return sys; }
+
+        /**
+         * Get the mixer sample rate
+         */
+        [[nodiscard]]
+        int samplerate() const;
     private:
         /**
          * Called during destructor, invalidating all internals. Can be
          * called before object is destroyed to free resources in advance.
          */
         void close();
+
+        /**
+         * Create and initialize an FMOD system
+         * @return the system, or nullptr on failure
+         */
+        [[nodiscard]]
+        FMOD::System *createSystem(const AudioEngineSettings &settings);
+
+        /**
+         * Report glitches found since the last update. If the output
+         * underran, one `TrackEvent::Underrun` is queued to each loaded track.
+         * @return number of underruns found
+         */
+        unsigned detectGlitches(double seconds);
+
+        /**
+         * Move the engine and its tracks onto a new system with the buffer
+         * configuration of `m_active` and the current voice budget. Waits
+         * while a track cannot be moved, see `MultiTrackAudio::canRebind`,
+         * or a playlist switch is scheduled on the old clock.
+         * @return whether the output was re-initialized
+         */
+        bool reinit();
+
+        /**
+         * Count a failed re-init, dropping the pending change after
+         * `MAX_REINIT_ATTEMPTS` failures in a row
+         * @return false
+         */
+        bool reinitFailed();
+
         FMOD::System *sys;
         std::optional<Channel> master;
-        std::vector<MultiTrackAudio *> tracks;
+        std::optional<Transport> m_transport;
+        SlotMap<MultiTrackAudio *> tracks;
+        Playlist m_playlist;
+
+        // Settings of the last successful `init`
+        AudioEngineSettings m_settings;
+        LatencyProfile m_profile;
+        // Profile of the buffer configuration in use or pending
+        LatencyProfile m_active;
+        AdaptiveLatency m_adaptive;
+        bool m_pending;
+        unsigned m_reinits;
+        unsigned m_failedReinits;
+        // Consecutive failed attempts at the pending re-init
+        unsigned m_attempts;
+        int m_voiceBudget;
+
+        Profiler m_profiler;
+
+        GlitchMonitor m_glitches;
+        std::chrono::steady_clock::time_point m_lastTime;
     };
 }
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+namespace Insound
+{
+    /**
+     * Where the mixer sends its output, and who drives it
+     */
+    enum class OutputMode
+    {
+        /** Default audio device, mixed in realtime */
+        Realtime,
+        /** No output, mixes one block per `AudioEngine::update` as fast as
+         *  the CPU allows */
+        NoSoundNRT,
+        /** Writes to `AudioEngineSettings::outputFile`, mixes one block per
+         *  `AudioEngine::update` as fast as the CPU allows */
+        WavWriterNRT,
+    };
+
+    /**
+     * Options for `AudioEngine::init`
+     */
+    struct AudioEngineSettings
+    {
+        AudioEngineSettings() : output(OutputMode::Realtime), samplerate(0),
+            stereo(false), bufferLength(2048), bufferCount(2),
+            maxChannels(1024), realChannels(64), virtualVolume(.001f),
+            outputFile()
+        { }
+
+        OutputMode output;
+
+        /** Mixer sample rate, 0 uses the rate of the output device */
+        int samplerate;
+
+        /** Whether to force a stereo mix instead of the device default */
+        bool stereo;
+
+        /** Size of one mix block in samples */
+        unsigned bufferLength;
+        /** Number of mix blocks buffered ahead, ignored by NRT outputs */
+        int bufferCount;
+
+        /** Maximum number of virtual channels */
+        int maxChannels;
+
+        /** Budget of channels actually mixed. Beyond it, the least important
+         *  and least audible channels play virtually, costing no DSP time. */
+        int realChannels;
+
+        /** Audibility below which a channel goes virtual regardless of the
+         *  budget, 0 disables audibility-based virtualization */
+        float virtualVolume;
+
+        /** Path of the file to write for `OutputMode::WavWriterNRT` */
+        std::string outputFile;
+    };
+}
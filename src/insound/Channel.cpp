@@ -161,7 +161,7 @@ namespace Insound
             {
                 float percentage =
                     ((float)targetClock - clocks[0]) / (clocks[1] - clocks[0]);
-                return std::abs(volumes[1] - volumes[0] * percentage);
+                return volumes[0] + (volumes[1] - volumes[0]) * percentage;
             }
             else if (targetClock > clocks[1])
             {
@@ -375,6 +375,42 @@ namespace Insound
         return {.start=start, .end=end};
     }
 
+    Channel &Channel::ch_priority(int priority)
+    {
+        if (m_isGroup)
+            throw std::runtime_error("Cannot call Channel::ch_priority "
+                "when underlying type is an FMOD::ChannelGroup");
+
+        checkResult( static_cast<FMOD::Channel *>(chan)->setPriority(
+            priority) );
+
+        return *this;
+    }
+
+    int Channel::ch_priority() const
+    {
+        if (m_isGroup)
+            throw std::runtime_error("Cannot call Channel::ch_priority "
+                "when underlying type is an FMOD::ChannelGroup");
+
+        int priority;
+        checkResult( static_cast<FMOD::Channel *>(chan)->getPriority(
+            &priority) );
+        return priority;
+    }
+
+    bool Channel::ch_isVirtual() const
+    {
+        if (m_isGroup)
+            throw std::runtime_error("Cannot call Channel::ch_isVirtual "
+                "when underlying type is an FMOD::ChannelGroup");
+
+        bool result;
+        checkResult( static_cast<FMOD::Channel *>(chan)->isVirtual(
+            &result) );
+        return result;
+    }
+
     Channel *Channel::group() const
     {
         FMOD::ChannelGroup *group;
@@ -147,6 +147,27 @@ namespace Insound
         [[nodiscard]]
         LoopInfo<unsigned> ch_loopPCM() const;
 
+        /**
+         * Set the voice priority, used by FMOD to choose which channels are
+         * virtualized when the real voice budget is exceeded.
+         * Only available if this is an FMOD::Channel.
+         *
+         * @param priority - 0: most important, 256: least important
+         * @return reference to this object for chaining.
+         */
+        Channel &ch_priority(int priority);
+
+        [[nodiscard]]
+        int ch_priority() const;
+
+        /**
+         * Whether FMOD currently plays this channel virtually, i.e. it is
+         * inaudible or lost its real voice to higher priority channels.
+         * Only available if this is an FMOD::Channel.
+         */
+        [[nodiscard]]
+        bool ch_isVirtual() const;
+
         /**
          * Set the reverb send level.
          *
@@ -0,0 +1,83 @@
+#include "DriftMonitor.h"
+
+#include <algorithm>
+
+namespace Insound
+{
+    DriftMonitor::DriftMonitor(unsigned threshold) :
+        m_stats(), m_threshold(threshold), m_reference(), m_sorted()
+    {
+
+    }
+
+
+    bool DriftMonitor::measure(const std::vector<unsigned> &positions,
+        LoopInfo<unsigned> loop)
+    {
+        if (positions.empty()) return false;
+
+        m_sorted.assign(positions.begin(), positions.end());
+        std::sort(m_sorted.begin(), m_sorted.end());
+
+        size_t first;
+        const auto skew = span(m_sorted, loop, first);
+        m_reference = m_sorted[(first + m_sorted.size() / 2) %
+            m_sorted.size()];
+
+        ++m_stats.checks;
+        m_stats.lastSkew = skew;
+        m_stats.totalSkew += skew;
+        if (skew > m_stats.maxSkew)
+            m_stats.maxSkew = skew;
+
+        return skew > m_threshold;
+    }
+
+
+    unsigned DriftMonitor::skew(const std::vector<unsigned> &positions,
+        LoopInfo<unsigned> loop)
+    {
+        if (positions.empty()) return 0;
+
+        auto sorted = positions;
+        std::sort(sorted.begin(), sorted.end());
+
+        size_t first;
+        return span(sorted, loop, first);
+    }
+
+
+    void DriftMonitor::resetStats()
+    {
+        m_stats = SyncStats();
+    }
+
+
+    unsigned DriftMonitor::span(const std::vector<unsigned> &sorted,
+        LoopInfo<unsigned> loop, size_t &first)
+    {
+        first = 0;
+        const auto front = sorted.front();
+        const auto back = sorted.back();
+
+        // Positions can only wrap around when all of them are in the loop
+        if (loop.end <= loop.start || front < loop.start || back >= loop.end)
+            return back - front;
+
+        // The smallest span around the loop leaves out the largest gap
+        // between neighboring positions
+        const auto length = loop.end - loop.start;
+        auto largestGap = front + length - back;
+        for (size_t i = 1, size = sorted.size(); i < size; ++i)
+        {
+            const auto gap = sorted[i] - sorted[i - 1];
+            if (gap > largestGap)
+            {
+                largestGap = gap;
+                first = i;
+            }
+        }
+
+        return length - largestGap;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <insound/LoopInfo.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * Skew statistics of a track's stems, for observing drift in production.
+     * All skew values are in PCM samples of the track.
+     */
+    struct SyncStats
+    {
+        /** Number of channel set measurements taken */
+        unsigned checks;
+        /** Number of times stems were realigned */
+        unsigned resyncs;
+        /** Skew of the last measurement */
+        unsigned lastSkew;
+        /** Largest skew measured */
+        unsigned maxSkew;
+        /** Sum of all measured skews, divide by `checks` for the mean */
+        double totalSkew;
+    };
+
+    /**
+     * Measures how far apart the playheads of a set of stems are, and
+     * decides when they have drifted far enough to be realigned.
+     */
+    class DriftMonitor
+    {
+    public:
+        /**
+         * @param threshold - skew in PCM samples above which a measurement
+         *                    calls for a resync
+         */
+        explicit DriftMonitor(unsigned threshold = 64);
+
+        /**
+         * Measure the skew of a set of stem positions, recording it in the
+         * statistics.
+         *
+         * @param positions - PCM position of each stem
+         * @param loop      - current loop points, positions that straddle the
+         *                    loop end are measured around the wrap
+         *
+         * @return whether skew exceeds the threshold
+         */
+        bool measure(const std::vector<unsigned> &positions,
+            LoopInfo<unsigned> loop);
+
+        /**
+         * Position that the stems should be realigned to from the last
+         * measurement; the median of its positions.
+         */
+        [[nodiscard]]
+        unsigned reference() const { return m_reference; }
+
+        /**
+         * Record that the stems were realigned
+         */
+        void resynced() { ++m_stats.resyncs; }
+
+        /**
+         * Get the smallest distance spanning all positions, in PCM samples.
+         * When looping, positions near the loop end and loop start count as
+         * being close to each other.
+         */
+        [[nodiscard]]
+        static unsigned skew(const std::vector<unsigned> &positions,
+            LoopInfo<unsigned> loop);
+
+        [[nodiscard]]
+        const SyncStats &stats() const { return m_stats; }
+        void resetStats();
+
+        [[nodiscard]]
+        unsigned threshold() const { return m_threshold; }
+        void threshold(unsigned samples) { m_threshold = samples; }
+
+    private:
+        /**
+         * Find the smallest span of sorted positions.
+         *
+         * @param sorted - positions in ascending order
+         * @param loop   - current loop points
+         * @param first  - receives the index that the span starts at
+         */
+        static unsigned span(const std::vector<unsigned> &sorted,
+            LoopInfo<unsigned> loop, size_t &first);
+
+        SyncStats m_stats;
+        unsigned m_threshold;
+        unsigned m_reference;
+
+        // Reused for sorting positions, to avoid allocating on each update
+        std::vector<unsigned> m_sorted;
+    };
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace Insound
+{
+    /**
+     * Fixed-size, lock-free queue with a single producer and a single
+     * consumer, which may be on different threads. Pushing never allocates
+     * or blocks, so it is safe from audio callbacks.
+     *
+     * @tparam T        - trivially copyable element type
+     * @tparam Capacity - maximum number of queued elements, a power of two
+     */
+    template <typename T, size_t Capacity>
+        requires std::is_trivially_copyable_v<T>
+    class EventRing
+    {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+            "EventRing capacity must be a power of two");
+    public:
+        EventRing() : m_data(), m_head(0), m_tail(0), m_dropped(0) { }
+
+        EventRing(const EventRing &) = delete;
+        EventRing &operator=(const EventRing &) = delete;
+
+        /**
+         * Enqueue an element, producer only
+         *
+         * @return whether it was queued, false if the ring is full and the
+         *         element was dropped
+         */
+        bool push(const T &value)
+        {
+            const auto head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            m_data[head & (Capacity - 1)] = value;
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Dequeue the oldest element, consumer only
+         *
+         * @return whether an element was available
+         */
+        bool pop(T &value)
+        {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire))
+                return false;
+
+            value = m_data[tail & (Capacity - 1)];
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Dequeue all available elements, consumer only
+         *
+         * @param container - container to append to with `push_back`
+         *
+         * @return number of elements dequeued
+         */
+        template <typename Container>
+        size_t drain(Container &container)
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            const auto head = m_head.load(std::memory_order_acquire);
+
+            for (auto i = tail; i != head; ++i)
+                container.push_back(m_data[i & (Capacity - 1)]);
+
+            m_tail.store(head, std::memory_order_release);
+            return head - tail;
+        }
+
+        /**
+         * Discard all queued elements, consumer only
+         */
+        void clear()
+        {
+            m_tail.store(m_head.load(std::memory_order_acquire),
+                std::memory_order_release);
+        }
+
+        /**
+         * Approximate number of queued elements
+         */
+        [[nodiscard]]
+        size_t size() const
+        {
+            return m_head.load(std::memory_order_acquire) -
+                m_tail.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]]
+        bool empty() const { return size() == 0; }
+
+        [[nodiscard]]
+        static constexpr size_t capacity() { return Capacity; }
+
+        /**
+         * Number of elements dropped because the ring was full
+         */
+        [[nodiscard]]
+        size_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        T m_data[Capacity];
+
+        // Separate cache lines, so producer and consumer don't contend
+        alignas(64) std::atomic<size_t> m_head;
+        alignas(64) std::atomic<size_t> m_tail;
+        std::atomic<size_t> m_dropped;
+    };
+}
@@ -0,0 +1,260 @@
+#include "GlitchMonitor.h"
+
+#include <algorithm>
+
+namespace Insound
+{
+    // Fraction of the output rate by which the device clock may drift from
+    // the system timer without counting as an underrun
+    static const double CLOCK_TOLERANCE = .001;
+
+    // Seconds without any mixer progress after which the output is treated
+    // as suspended, e.g. a browser audio context awaiting a user gesture
+    static const double MAX_STALL = .5;
+
+    // Update intervals above this many seconds are treated as a throttled or
+    // hidden page rather than a stall of the update loop
+    static const double MAX_UPDATE_GAP = 1.0;
+
+    // Minimum update interval in seconds that counts as late, so events
+    // scheduled a marker lookahead ahead still arrive in time
+    static const double LATE_UPDATE = .1;
+
+    GlitchMonitor::GlitchMonitor() : m_epoch(std::chrono::steady_clock::now()),
+        m_rate(), m_blockTime(), m_bufferTime(), m_mixLimit(0),
+        m_overloadLimit(0), m_mixStart(-1), m_suspended(false),
+        m_mixerGlitches(), m_lastClock(), m_deficit(), m_stall(), m_stats(),
+        m_maxMix(0), m_maxMixInterval(0), m_callback()
+    {
+        resetStats();
+    }
+
+
+    void GlitchMonitor::configure(int samplerate, unsigned bufferLength,
+        int bufferCount)
+    {
+        m_rate = samplerate;
+        m_blockTime = (double)bufferLength / samplerate;
+        m_bufferTime = m_blockTime * bufferCount;
+
+        // a gap past the buffered audio plus the next block drains the device
+        m_mixLimit.store(m_bufferTime + m_blockTime, std::memory_order_relaxed);
+        m_overloadLimit.store(m_blockTime, std::memory_order_relaxed);
+    }
+
+
+    double GlitchMonitor::now() const
+    {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - m_epoch).count();
+    }
+
+
+    void GlitchMonitor::mixBegin(double time)
+    {
+        const auto last = m_mixStart.exchange(time, std::memory_order_relaxed);
+        if (last < 0 || m_suspended.load(std::memory_order_relaxed))
+            return;
+
+        const auto interval = time - last;
+        if (interval >= MAX_STALL)
+            return; // resumed from a suspended output
+
+        raise(m_maxMixInterval, interval);
+        if (interval > m_mixLimit.load(std::memory_order_relaxed))
+        {
+            m_mixerGlitches.push(Glitch{
+                .type=Glitch::Type::LateMix,
+                .time=time,
+                .duration=interval,
+                .clock=0,
+            });
+        }
+    }
+
+
+    void GlitchMonitor::mixEnd(double time)
+    {
+        const auto start = m_mixStart.load(std::memory_order_relaxed);
+        if (start < 0)
+            return;
+
+        const auto mix = time - start;
+        raise(m_maxMix, mix);
+        if (mix > m_overloadLimit.load(std::memory_order_relaxed))
+        {
+            m_mixerGlitches.push(Glitch{
+                .type=Glitch::Type::Overload,
+                .time=time,
+                .duration=mix,
+                .clock=0,
+            });
+        }
+    }
+
+
+    unsigned GlitchMonitor::update(unsigned long long clock, double seconds,
+        double time)
+    {
+        unsigned found = 0;
+
+        // Mixer thread measurements
+        Glitch glitch;
+        while (m_mixerGlitches.pop(glitch))
+        {
+            glitch.clock = clock;
+            report(glitch);
+            ++found;
+        }
+
+        // Update interval
+        if (seconds < MAX_UPDATE_GAP)
+        {
+            m_stats.maxUpdateInterval = std::max(m_stats.maxUpdateInterval,
+                seconds);
+
+            if (seconds > std::max(LATE_UPDATE, m_bufferTime))
+            {
+                report(Glitch{
+                    .type=Glitch::Type::LateUpdate,
+                    .time=time,
+                    .duration=seconds,
+                    .clock=clock,
+                });
+            }
+        }
+
+        // Mixer clock progress against wall-clock time
+        const auto advanced = clock - m_lastClock;
+        m_lastClock = clock;
+
+        if (m_suspended.load(std::memory_order_relaxed) || m_rate <= 0)
+            return found;
+
+        // Hold the time back until the mixer moves again, then count it only
+        // if the stall was short enough to be a glitch
+        m_stall += seconds;
+        if (advanced == 0)
+            return found;
+
+        if (m_stall > MAX_STALL)
+        {
+            m_deficit = 0;
+        }
+        else
+        {
+            m_deficit += m_stall * m_rate - (double)advanced;
+            m_deficit = std::max(m_deficit - m_stall * m_rate * CLOCK_TOLERANCE,
+                0.0);
+        }
+        m_stall = 0;
+
+        // Up to the whole output buffer may be consumed before it runs dry
+        if (m_deficit > m_bufferTime * m_rate)
+        {
+            report(Glitch{
+                .type=Glitch::Type::Underrun,
+                .time=time,
+                .duration=m_deficit / m_rate,
+                .clock=clock,
+            });
+
+            m_deficit = 0;
+            ++found;
+        }
+
+        return found;
+    }
+
+
+    void GlitchMonitor::suspend(bool suspended)
+    {
+        m_suspended.store(suspended, std::memory_order_relaxed);
+        if (!suspended)
+        {
+            m_mixStart.store(-1, std::memory_order_relaxed);
+            m_deficit = 0;
+            m_stall = 0;
+        }
+    }
+
+
+    void GlitchMonitor::restart(unsigned long long clock)
+    {
+        m_mixStart.store(-1, std::memory_order_relaxed);
+        Glitch glitch;
+        while (m_mixerGlitches.pop(glitch)) { }
+
+        m_lastClock = clock;
+        m_deficit = 0;
+        m_stall = 0;
+    }
+
+
+    void GlitchMonitor::resetStats()
+    {
+        m_stats = GlitchStats{
+            .underruns=0,
+            .overloads=0,
+            .lateMixes=0,
+            .lateUpdates=0,
+            .lastGlitch=-1,
+            .maxMix=0,
+            .maxMixInterval=0,
+            .maxUpdateInterval=0,
+        };
+        m_maxMix.store(0, std::memory_order_relaxed);
+        m_maxMixInterval.store(0, std::memory_order_relaxed);
+    }
+
+
+    GlitchStats GlitchMonitor::stats() const
+    {
+        auto result = m_stats;
+        result.maxMix = m_maxMix.load(std::memory_order_relaxed);
+        result.maxMixInterval = m_maxMixInterval.load(
+            std::memory_order_relaxed);
+        return result;
+    }
+
+
+    void GlitchMonitor::onGlitch(std::function<void(const Glitch &)> callback)
+    {
+        m_callback = std::move(callback);
+    }
+
+
+    void GlitchMonitor::report(const Glitch &glitch)
+    {
+        switch(glitch.type)
+        {
+        case Glitch::Type::Underrun:
+            ++m_stats.underruns;
+            break;
+        case Glitch::Type::Overload:
+            ++m_stats.overloads;
+            break;
+        case Glitch::Type::LateMix:
+            ++m_stats.lateMixes;
+            break;
+        case Glitch::Type::LateUpdate:
+            ++m_stats.lateUpdates;
+            break;
+        }
+
+        m_stats.lastGlitch = glitch.time;
+
+        if (m_callback)
+            m_callback(glitch);
+    }
+
+
+    void GlitchMonitor::raise(std::atomic<double> &max, double value)
+    {
+        auto current = max.load(std::memory_order_relaxed);
+        while (value > current &&
+            !max.compare_exchange_weak(current, value,
+                std::memory_order_relaxed))
+        { }
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <insound/EventRing.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+namespace Insound
+{
+    /**
+     * An audible or likely audible disturbance of the output
+     */
+    struct Glitch
+    {
+        enum class Type
+        {
+            /** The mixer clock fell behind wall-clock time by more than the
+             *  output buffer, so the device ran dry */
+            Underrun,
+            /** Mixing one block took longer than the block's duration */
+            Overload,
+            /** The gap between two mixes exceeded the buffered audio, the
+             *  mixer was starved of CPU time */
+            LateMix,
+            /** `AudioEngine::update` was called too late, e.g. during a long
+             *  script, decode or GC pause */
+            LateUpdate,
+        };
+
+        Type type;
+        /** Seconds since the monitor was created, when it was detected */
+        double time;
+        /** Seconds of the measured deficit, mix, gap or update interval */
+        double duration;
+        /** Mixer DSP clock when it was reported */
+        unsigned long long clock;
+    };
+
+    /**
+     * Glitch counters and worst-case timings since the last reset
+     */
+    struct GlitchStats
+    {
+        unsigned underruns;
+        unsigned overloads;
+        unsigned lateMixes;
+        unsigned lateUpdates;
+        /** `Glitch::time` of the last glitch, or -1 if none */
+        double lastGlitch;
+        /** Longest mix of one block in seconds */
+        double maxMix;
+        /** Longest gap between the start of two mixes in seconds */
+        double maxMixInterval;
+        /** Longest interval between two updates in seconds */
+        double maxUpdateInterval;
+    };
+
+    /**
+     * Detects mixer starvation and late updates. Mix timing is measured on
+     * the mixer thread around each mix, from `FMOD_SYSTEM_CALLBACK_PREMIX`
+     * and `POSTMIX`. Clock gaps and update intervals are measured each
+     * engine update, which also reports every glitch found to the callback.
+     */
+    class GlitchMonitor
+    {
+    public:
+        GlitchMonitor();
+
+        GlitchMonitor(const GlitchMonitor &) = delete;
+        GlitchMonitor &operator=(const GlitchMonitor &) = delete;
+
+        /**
+         * Set thresholds from the output format
+         *
+         * @param samplerate   - mixer sample rate
+         * @param bufferLength - size of one mix block in samples
+         * @param bufferCount  - number of mix blocks buffered ahead
+         */
+        void configure(int samplerate, unsigned bufferLength,
+            int bufferCount);
+
+        /**
+         * Seconds since the monitor was created
+         */
+        [[nodiscard]]
+        double now() const;
+
+        // ----- Mixer thread -------------------------------------------------
+
+        /**
+         * Mark the start of a mix
+         * @param time - result of `now()`
+         */
+        void mixBegin(double time);
+
+        /**
+         * Mark the end of a mix
+         * @param time - result of `now()`
+         */
+        void mixEnd(double time);
+
+        // ----- Update thread ------------------------------------------------
+
+        /**
+         * Measure one engine update and report glitches found since the last
+         * one.
+         *
+         * @param clock   - current mixer DSP clock
+         * @param seconds - wall-clock time since the last update
+         * @param time    - result of `now()`
+         *
+         * @return number of mixer glitches found, late updates excluded
+         */
+        unsigned update(unsigned long long clock, double seconds,
+            double time);
+
+        /**
+         * Set whether the mixer is suspended, pausing detection
+         */
+        void suspend(bool suspended);
+
+        /**
+         * Forget the measurement history, e.g. after the output changed
+         */
+        void restart(unsigned long long clock);
+
+        /**
+         * Reset counters and worst-case timings
+         */
+        void resetStats();
+
+        [[nodiscard]]
+        GlitchStats stats() const;
+
+        /**
+         * Set a callback fired from `update` for each glitch
+         */
+        void onGlitch(std::function<void(const Glitch &)> callback);
+
+    private:
+        void report(const Glitch &glitch);
+
+        /**
+         * Atomically raise a maximum shared with the mixer thread
+         */
+        static void raise(std::atomic<double> &max, double value);
+
+        std::chrono::steady_clock::time_point m_epoch;
+
+        // Thresholds
+        int m_rate;
+        double m_blockTime;
+        double m_bufferTime;
+        std::atomic<double> m_mixLimit;
+        std::atomic<double> m_overloadLimit;
+
+        // Mixer thread state, negative when there is no previous mix
+        std::atomic<double> m_mixStart;
+        std::atomic<bool> m_suspended;
+        EventRing<Glitch, 64> m_mixerGlitches;
+
+        // Update thread state
+        unsigned long long m_lastClock;
+        // Samples the mixer clock has fallen behind wall-clock time
+        double m_deficit;
+        // Seconds the mixer clock has not advanced at all
+        double m_stall;
+
+        GlitchStats m_stats;
+        std::atomic<double> m_maxMix;
+        std::atomic<double> m_maxMixInterval;
+
+        std::function<void(const Glitch &)> m_callback;
+    };
+}
@@ -0,0 +1,225 @@
+#include "HorizontalSequencer.h"
+
+#include <insound/MultiTrackAudio.h>
+
+#include <stdexcept>
+#include <utility>
+
+namespace Insound
+{
+    HorizontalSequencer::HorizontalSequencer(MultiTrackAudio &track) :
+        m_track(track), m_sections(), m_params(), m_current(-1),
+        m_pending(-1), m_pendingClock(), m_lookahead(.25f)
+    {
+
+    }
+
+    Section &HorizontalSequencer::addSection(const std::string &name,
+        double start, double end)
+    {
+        if (end <= start)
+            throw std::invalid_argument("HorizontalSequencer: section \"" +
+                name + "\" must end after it starts");
+
+        auto index = findIndex(name);
+        if (index != -1)
+        {
+            auto &section = m_sections[index];
+            section.start = start;
+            section.end = end;
+            section.exits.clear();
+            return section;
+        }
+
+        return m_sections.emplace_back(Section{
+            .name=name,
+            .start=start,
+            .end=end,
+            .exits={},
+        });
+    }
+
+    ExitRule &HorizontalSequencer::addExit(std::string_view section,
+        const ExitRule &rule)
+    {
+        auto index = findIndex(section);
+        if (index == -1)
+            throw std::runtime_error("HorizontalSequencer: section \"" +
+                std::string(section) + "\" does not exist");
+
+        return m_sections[index].exits.emplace_back(rule);
+    }
+
+    void HorizontalSequencer::clear()
+    {
+        m_sections.clear();
+        m_current = -1;
+        m_pending = -1;
+        m_pendingClock = 0;
+    }
+
+    void HorizontalSequencer::start(std::string_view name)
+    {
+        auto index = findIndex(name);
+        if (index == -1)
+            throw std::runtime_error("HorizontalSequencer: section \"" +
+                std::string(name) + "\" does not exist");
+
+        const auto &section = m_sections[index];
+        const auto clock = m_track.nextClock(Quantize::None);
+        m_track.transitionToRegion(section.start, section.end, 0, true, 0,
+            true, clock);
+
+        m_current = index;
+        m_pending = -1;
+        m_pendingClock = clock;
+    }
+
+    void HorizontalSequencer::stop()
+    {
+        m_current = -1;
+        m_pending = -1;
+    }
+
+    void HorizontalSequencer::cancelled()
+    {
+        if (m_pending != -1)
+            m_pending = -1;
+        else if (m_current != -1 && m_track.dspClock() < m_pendingClock)
+            m_current = -1;
+    }
+
+    void HorizontalSequencer::clockReset()
+    {
+        if (m_pending != -1)
+        {
+            m_current = m_pending;
+            m_pending = -1;
+        }
+
+        m_pendingClock = 0;
+    }
+
+    void HorizontalSequencer::swap(HorizontalSequencer &other)
+    {
+        std::swap(m_sections, other.m_sections);
+        std::swap(m_params, other.m_params);
+        std::swap(m_current, other.m_current);
+        std::swap(m_pending, other.m_pending);
+        std::swap(m_pendingClock, other.m_pendingClock);
+        std::swap(m_lookahead, other.m_lookahead);
+    }
+
+    void HorizontalSequencer::setParameter(const std::string &name,
+        float value)
+    {
+        m_params[name] = value;
+        schedule();
+    }
+
+    float HorizontalSequencer::getParameter(const std::string &name) const
+    {
+        auto it = m_params.find(name);
+        return (it == m_params.end()) ? 0 : it->second;
+    }
+
+    void HorizontalSequencer::update()
+    {
+        if (m_current == -1) return;
+
+        if (m_pending != -1 && m_track.dspClock() >= m_pendingClock)
+        {
+            m_current = m_pending;
+            m_pending = -1;
+        }
+
+        schedule();
+    }
+
+    const Section *HorizontalSequencer::current() const
+    {
+        return (m_current == -1) ? nullptr : &m_sections[m_current];
+    }
+
+    const Section *HorizontalSequencer::pending() const
+    {
+        return (m_pending == -1) ? nullptr : &m_sections[m_pending];
+    }
+
+    int HorizontalSequencer::findIndex(std::string_view name) const
+    {
+        for (int i = 0, size = (int)m_sections.size(); i < size; ++i)
+        {
+            if (m_sections[i].name == name)
+                return i;
+        }
+
+        return -1;
+    }
+
+    bool HorizontalSequencer::evaluate(const ExitRule &rule) const
+    {
+        for (const auto &condition : rule.conditions)
+        {
+            const auto value = getParameter(condition.param);
+
+            bool result;
+            switch(condition.op)
+            {
+            case CompareOp::Equal:
+                result = value == condition.value; break;
+            case CompareOp::NotEqual:
+                result = value != condition.value; break;
+            case CompareOp::GreaterThan:
+                result = value > condition.value; break;
+            case CompareOp::GreaterThanOrEqual:
+                result = value >= condition.value; break;
+            case CompareOp::LessThan:
+                result = value < condition.value; break;
+            case CompareOp::LessThanOrEqual:
+                result = value <= condition.value; break;
+            default:
+                result = false; break;
+            }
+
+            if (!result)
+                return false;
+        }
+
+        return true;
+    }
+
+    void HorizontalSequencer::schedule()
+    {
+        if (m_current == -1 || m_pending != -1) return;
+        if (!m_track.isLoaded() || m_track.paused()) return;
+
+        // Wait for the track's scheduled transition to start, e.g. into the
+        // current section or of a seek, so it is not overridden
+        if (m_track.transitionPending()) return;
+
+        for (const auto &rule : m_sections[m_current].exits)
+        {
+            if (!evaluate(rule)) continue;
+
+            auto target = findIndex(rule.target);
+            if (target == -1) continue;
+
+            // Wait until the boundary is within the lookahead window, so that
+            // the rule may still change its outcome until then
+            const auto clock = m_track.nextClock(rule.quantize);
+            const auto window = (unsigned long long)(m_lookahead *
+                m_track.outputRate());
+            if (clock > m_track.dspClock() + window)
+                return;
+
+            const auto &section = m_sections[target];
+            m_track.transitionToRegion(section.start, section.end,
+                rule.inTime, rule.fadeIn, rule.outTime, rule.fadeOut, clock);
+
+            m_pending = target;
+            m_pendingClock = clock;
+            return;
+        }
+    }
+}
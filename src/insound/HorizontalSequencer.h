@@ -0,0 +1,208 @@
+#pragma once
+
+#include <insound/Quantize.h>
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound
+{
+    class MultiTrackAudio;
+
+    /**
+     * Comparison operator of an exit condition.
+     * Mirrors `CompareOp` in the TypeScript frontend.
+     */
+    enum class CompareOp
+    {
+        Equal,
+        NotEqual,
+        GreaterThan,
+        GreaterThanOrEqual,
+        LessThan,
+        LessThanOrEqual,
+    };
+
+    /**
+     * Compares a parameter's value against a constant
+     */
+    struct ExitCondition
+    {
+        std::string param;
+        CompareOp op;
+        float value;
+    };
+
+    /**
+     * Rule to leave a section once all of its conditions are met
+     */
+    struct ExitRule
+    {
+        /** All must be true for the rule to pass, passes if empty */
+        std::vector<ExitCondition> conditions;
+        /** Name of the section to transition to */
+        std::string target;
+        /** Musical boundary to transition at */
+        Quantize quantize;
+
+        float inTime;
+        bool fadeIn;
+        float outTime;
+        bool fadeOut;
+    };
+
+    /**
+     * A named region of a track that loops until one of its exit rules pass
+     */
+    struct Section
+    {
+        std::string name;
+        /** Loop start in seconds */
+        double start;
+        /** Loop end in seconds */
+        double end;
+        /** Evaluated in order, the first passing rule is used */
+        std::vector<ExitRule> exits;
+    };
+
+    /**
+     * Adaptive horizontal re-sequencer. Loops the current section of a track
+     * and schedules a transition to the next section when an exit rule
+     * passes.
+     *
+     * Transitions are committed to the mixer once their boundary falls
+     * within the lookahead window, so playback stays seamless even if
+     * `update` is not called for a while.
+     */
+    class HorizontalSequencer
+    {
+    public:
+        explicit HorizontalSequencer(MultiTrackAudio &track);
+
+        /**
+         * Add a section, replacing any with the same name.
+         *
+         * @param name  - unique name of the section
+         * @param start - loop start in seconds
+         * @param end   - loop end in seconds
+         *
+         * @return reference to the section to add exit rules to
+         */
+        Section &addSection(const std::string &name, double start,
+            double end);
+
+        /**
+         * Add an exit rule to a section. Throws if the section does not
+         * exist.
+         */
+        ExitRule &addExit(std::string_view section, const ExitRule &rule);
+
+        /**
+         * Remove all sections and stop sequencing
+         */
+        void clear();
+
+        /**
+         * Enter a section immediately, looping its region.
+         * Throws if the section does not exist.
+         */
+        void start(std::string_view section);
+
+        /**
+         * Stop sequencing, leaving the track playing as is
+         */
+        void stop();
+
+        /**
+         * Notify the sequencer that the track cancelled the last scheduled
+         * transition before it started, e.g. by seeking. A pending section
+         * is dropped, and its exit rules are evaluated again on the next
+         * update. If the transition was entering the first section,
+         * sequencing stops.
+         */
+        void cancelled();
+
+        /**
+         * Notify the sequencer that the track moved to a mixer whose DSP
+         * clock starts over, see `MultiTrackAudio::rebind`. Tracks only move
+         * once their last transition started, so a pending section is
+         * entered right away.
+         */
+        void clockReset();
+
+        /**
+         * Exchange sections, parameters and sequencing state with another
+         * sequencer of the same track
+         */
+        void swap(HorizontalSequencer &other);
+
+        /**
+         * Set a parameter value for exit conditions to check against. Exit
+         * rules are evaluated right away.
+         */
+        void setParameter(const std::string &name, float value);
+
+        /**
+         * Get a parameter's value, or 0 if it was never set
+         */
+        [[nodiscard]]
+        float getParameter(const std::string &name) const;
+
+        /**
+         * Number of seconds before a boundary to commit its transition.
+         * Should be greater than the longest expected gap between updates.
+         */
+        void lookahead(float seconds) { m_lookahead = seconds; }
+        [[nodiscard]]
+        float lookahead() const { return m_lookahead; }
+
+        /**
+         * Evaluate exit rules, commit transitions within the lookahead
+         * window, and advance to the next section once its transition was
+         * reached.
+         */
+        void update();
+
+        /**
+         * Get the section currently playing, or nullptr if not sequencing
+         */
+        [[nodiscard]]
+        const Section *current() const;
+
+        /**
+         * Get the section with a committed transition not yet reached, or
+         * nullptr if there is none
+         */
+        [[nodiscard]]
+        const Section *pending() const;
+
+        [[nodiscard]]
+        const std::vector<Section> &sections() const { return m_sections; }
+
+    private:
+        [[nodiscard]]
+        int findIndex(std::string_view name) const;
+
+        [[nodiscard]]
+        bool evaluate(const ExitRule &rule) const;
+
+        /**
+         * Commit the first passing exit rule if its boundary is inside the
+         * lookahead window
+         */
+        void schedule();
+
+        MultiTrackAudio &m_track;
+        std::vector<Section> m_sections;
+        std::map<std::string, float, std::less<>> m_params;
+
+        int m_current;
+        int m_pending;
+        // DSP clock of the last transition scheduled, pending or on start
+        unsigned long long m_pendingClock;
+
+        float m_lookahead;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <initializer_list>
+
+namespace Insound
+{
+    /**
+     * Trade-off between output latency and robustness against glitches
+     */
+    enum class LatencyProfile
+    {
+        /** ~21 ms at 48 kHz, for interactive use on capable machines */
+        Low,
+        /** ~43 ms at 48 kHz */
+        Balanced,
+        /** ~85 ms at 48 kHz, the fewest wakeups, for weak machines */
+        PowerSaver,
+        /** Starts at `Low`, backing off after glitches or high CPU usage */
+        Adaptive,
+    };
+
+    /**
+     * Mixer buffer configuration, total latency is length times count
+     */
+    struct BufferConfig
+    {
+        /** Size of one mix block in samples */
+        unsigned bufferLength;
+        /** Number of mix blocks buffered ahead */
+        int bufferCount;
+    };
+
+    /**
+     * Get the buffer configuration of a profile. `Adaptive` returns that of
+     * its starting profile.
+     */
+    [[nodiscard]]
+    constexpr BufferConfig bufferConfig(LatencyProfile profile)
+    {
+        switch(profile)
+        {
+        case LatencyProfile::Balanced:
+            return {512, 4};
+        case LatencyProfile::PowerSaver:
+            return {2048, 2};
+        default:
+            return {256, 4};
+        }
+    }
+
+    /**
+     * Get the profile whose buffer configuration is closest in latency to
+     * a given one, never `Adaptive`
+     */
+    [[nodiscard]]
+    constexpr LatencyProfile closestProfile(unsigned bufferLength,
+        int bufferCount)
+    {
+        const auto latency = (long long)bufferLength * bufferCount;
+
+        auto result = LatencyProfile::Low;
+        long long best = -1;
+        for (auto profile : {LatencyProfile::Low, LatencyProfile::Balanced,
+            LatencyProfile::PowerSaver})
+        {
+            const auto config = bufferConfig(profile);
+            const auto other = (long long)config.bufferLength *
+                config.bufferCount;
+            const auto distance = (latency > other) ? latency - other :
+                other - latency;
+            if (best == -1 || distance < best)
+            {
+                result = profile;
+                best = distance;
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,118 @@
+#include "MarkerScheduler.h"
+
+#include <algorithm>
+
+namespace Insound
+{
+    MarkerScheduler::MarkerScheduler(unsigned lookahead) :
+        m_lookahead(lookahead), m_last(), m_ahead(), m_valid()
+    {
+
+    }
+
+
+    void MarkerScheduler::update(const std::vector<unsigned> &offsets,
+        unsigned pcm, unsigned long long clock, double clocksPerSample,
+        LoopInfo<unsigned> loop, unsigned length,
+        std::vector<TrackEvent> &events)
+    {
+        const bool looping = loop.end > loop.start;
+        const long long end = m_lookahead;
+        long long start = 0;
+
+        if (m_valid)
+        {
+            auto elapsed = (long long)pcm - m_last;
+            if (elapsed < 0 && looping)
+                elapsed += loop.end - loop.start;
+
+            // a backward jump without reset, rescan from the playhead
+            start = (elapsed < 0) ? 0 :
+                std::max(m_ahead - elapsed, -end);
+        }
+
+        if (start < end)
+            scan(offsets, pcm, start, end, clock, clocksPerSample, loop,
+                length, events);
+
+        m_last = pcm;
+        m_ahead = std::max(start, end);
+        m_valid = true;
+    }
+
+
+    void MarkerScheduler::scan(const std::vector<unsigned> &offsets,
+        unsigned pcm, long long from, long long to, unsigned long long clock,
+        double clocksPerSample, LoopInfo<unsigned> loop, unsigned length,
+        std::vector<TrackEvent> &events) const
+    {
+        const bool looping = loop.end > loop.start && pcm < loop.end;
+        const long long loopLength = (long long)loop.end - loop.start;
+
+        auto emit = [&events, clock, clocksPerSample](TrackEvent::Type type,
+            unsigned index, unsigned offset, long long distance)
+        {
+            events.emplace_back(TrackEvent{
+                .type=type,
+                .index=index,
+                .offset=offset,
+                .clock=clock + (unsigned long long)(
+                    std::max(distance, 0LL) * clocksPerSample),
+            });
+        };
+
+        // Walk contiguous segments of track positions, split at the loop end
+        auto distance = from;
+        for (int segments = 0; distance < to && segments < 64; ++segments)
+        {
+            auto position = (long long)pcm + distance;
+            if (looping)
+            {
+                if (position >= loop.end)
+                    position = loop.start + (position - loop.start) %
+                        loopLength;
+                else if (position < loop.start && pcm >= loop.start)
+                    position += loopLength; // tail of the previous pass
+            }
+
+            if (position < 0)
+            {
+                distance -= position;
+                continue;
+            }
+
+            auto segmentEnd = position + (to - distance);
+            if (looping)
+                segmentEnd = std::min(segmentEnd, (long long)loop.end);
+
+            auto it = std::lower_bound(offsets.begin(), offsets.end(),
+                position);
+            for (; it != offsets.end() && *it < segmentEnd; ++it)
+            {
+                emit(TrackEvent::Type::SyncPoint,
+                    (unsigned)(it - offsets.begin()), *it,
+                    distance + (*it - position));
+            }
+
+            const auto segmentLength = segmentEnd - position;
+            if (looping)
+            {
+                // wraps within this span, or right at its end
+                if (segmentEnd == loop.end &&
+                    distance + segmentLength <= to)
+                {
+                    emit(TrackEvent::Type::LoopWrap, 0, loop.start,
+                        distance + segmentLength);
+                }
+            }
+            else if (position <= length && length < segmentEnd)
+            {
+                emit(TrackEvent::Type::End, 0, length,
+                    distance + (length - position));
+                break; // playback stops
+            }
+
+            distance += segmentLength;
+        }
+    }
+}
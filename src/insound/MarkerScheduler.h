@@ -0,0 +1,69 @@
+#pragma once
+
+#include <insound/LoopInfo.h>
+#include <insound/TrackEvent.h>
+
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * Walks sorted sync point offsets ahead of the playhead, emitting each
+     * point once, a lookahead before it is reached, with the exact DSP clock
+     * it will be reached at. Loop wraps and the end of the track are emitted
+     * the same way. Call `reset` whenever the playhead jumps.
+     */
+    class MarkerScheduler
+    {
+    public:
+        /**
+         * @param lookahead - PCM samples ahead of the playhead to schedule
+         */
+        explicit MarkerScheduler(unsigned lookahead = 0);
+
+        /**
+         * Schedule events between the last scanned position and the
+         * lookahead. Points the playhead already passed without being
+         * scheduled, e.g. after a stall, are emitted at `clock`.
+         *
+         * @param offsets         - sync point offsets in PCM samples, sorted
+         * @param pcm             - current playhead in PCM samples
+         * @param clock           - DSP clock that the playhead is at
+         * @param clocksPerSample - DSP clocks per PCM sample
+         * @param loop            - current loop points, no loop if empty
+         * @param length          - track length in PCM samples
+         * @param events          - container to append events to, in order of
+         *                          clock
+         */
+        void update(const std::vector<unsigned> &offsets, unsigned pcm,
+            unsigned long long clock, double clocksPerSample,
+            LoopInfo<unsigned> loop, unsigned length,
+            std::vector<TrackEvent> &events);
+
+        /**
+         * Forget the scanned region, the next update scans from the playhead,
+         * including a point exactly at it
+         */
+        void reset() { m_valid = false; }
+
+        [[nodiscard]]
+        unsigned lookahead() const { return m_lookahead; }
+        void lookahead(unsigned samples) { m_lookahead = samples; }
+
+    private:
+        /**
+         * Emit events within a span of playhead distances, in PCM samples
+         */
+        void scan(const std::vector<unsigned> &offsets, unsigned pcm,
+            long long from, long long to, unsigned long long clock,
+            double clocksPerSample, LoopInfo<unsigned> loop, unsigned length,
+            std::vector<TrackEvent> &events) const;
+
+        unsigned m_lookahead;
+        // Playhead at the last update
+        unsigned m_last;
+        // Samples past `m_last` that were already scanned
+        long long m_ahead;
+        bool m_valid;
+    };
+}
@@ -0,0 +1,300 @@
+#include "MemoryBudget.h"
+
+#include <fmod.hpp>
+#include <fmod_errors.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+namespace Insound
+{
+    // Size header in front of each allocation, keeping the memory after it
+    // aligned for any type
+    static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    static constexpr auto CATEGORY_COUNT = (size_t)MemoryCategory::Count;
+
+    static std::atomic<size_t> s_budget;
+    static std::atomic<size_t> s_live[CATEGORY_COUNT];
+    static std::atomic<size_t> s_peak[CATEGORY_COUNT];
+    static std::atomic<size_t> s_total;
+    // Bytes of the categories limited by the budget, all but Engine
+    static std::atomic<size_t> s_budgeted;
+    static std::atomic<size_t> s_totalPeak;
+    static std::atomic<unsigned> s_failures;
+    static std::atomic<size_t> s_lastFailure;
+    // Last refusal of each category not yet taken by `takeFailure`
+    static std::atomic<size_t> s_pendingFailure[CATEGORY_COUNT];
+
+    static void raise(std::atomic<size_t> &peak, size_t value)
+    {
+        auto current = peak.load(std::memory_order_relaxed);
+        while (value > current &&
+            !peak.compare_exchange_weak(current, value,
+                std::memory_order_relaxed))
+        { }
+    }
+
+    static void *F_CALL fmodAlloc(unsigned int size, FMOD_MEMORY_TYPE type,
+        const char *sourcestr)
+    {
+        return MemoryBudget::allocate(size, MemoryCategory::FMOD);
+    }
+
+    static void *F_CALL fmodRealloc(void *ptr, unsigned int size,
+        FMOD_MEMORY_TYPE type, const char *sourcestr)
+    {
+        return MemoryBudget::reallocate(ptr, size, MemoryCategory::FMOD);
+    }
+
+    static void F_CALL fmodFree(void *ptr, FMOD_MEMORY_TYPE type,
+        const char *sourcestr)
+    {
+        MemoryBudget::deallocate(ptr, MemoryCategory::FMOD);
+    }
+
+
+    void MemoryBudget::install()
+    {
+        static std::once_flag installed;
+        std::call_once(installed, []() {
+            auto result = FMOD::Memory_Initialize(nullptr, 0, fmodAlloc,
+                fmodRealloc, fmodFree);
+            if (result != FMOD_OK)
+            {
+                std::cerr << "MemoryBudget: failed to install the FMOD "
+                    "allocator: " << FMOD_ErrorString(result) << '\n';
+            }
+        });
+    }
+
+
+    void MemoryBudget::budget(size_t bytes)
+    {
+        s_budget.store(bytes, std::memory_order_relaxed);
+    }
+
+
+    size_t MemoryBudget::budget()
+    {
+        return s_budget.load(std::memory_order_relaxed);
+    }
+
+
+    bool MemoryBudget::reserve(MemoryCategory category, size_t bytes)
+    {
+        const auto index = (size_t)category;
+        if (category != MemoryCategory::Engine)
+        {
+            const auto budgeted = s_budgeted.fetch_add(bytes,
+                std::memory_order_relaxed) + bytes;
+
+            const auto limit = budget();
+            if (limit && budgeted > limit)
+            {
+                s_budgeted.fetch_sub(bytes, std::memory_order_relaxed);
+                s_failures.fetch_add(1, std::memory_order_relaxed);
+                s_lastFailure.store(bytes, std::memory_order_relaxed);
+                s_pendingFailure[index].store(bytes,
+                    std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        const auto total = s_total.fetch_add(bytes,
+            std::memory_order_relaxed) + bytes;
+        const auto live = s_live[index].fetch_add(bytes,
+            std::memory_order_relaxed) + bytes;
+        raise(s_peak[index], live);
+        raise(s_totalPeak, total);
+        return true;
+    }
+
+
+    void MemoryBudget::release(MemoryCategory category, size_t bytes)
+    {
+        s_live[(size_t)category].fetch_sub(bytes, std::memory_order_relaxed);
+        s_total.fetch_sub(bytes, std::memory_order_relaxed);
+        if (category != MemoryCategory::Engine)
+            s_budgeted.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+
+    void *MemoryBudget::allocate(size_t bytes, MemoryCategory category)
+    {
+        if (!reserve(category, bytes))
+            return nullptr;
+
+        auto block = static_cast<char *>(std::malloc(bytes + HEADER_SIZE));
+        if (!block)
+        {
+            release(category, bytes);
+            return nullptr;
+        }
+
+        *reinterpret_cast<size_t *>(block) = bytes;
+        return block + HEADER_SIZE;
+    }
+
+
+    void *MemoryBudget::allocate(size_t bytes, std::align_val_t alignment,
+        MemoryCategory category)
+    {
+        if (!reserve(category, bytes))
+            return nullptr;
+
+        // No size header, it would break the alignment. Callers pass the
+        // size back to `deallocate` instead.
+        auto ptr = ::operator new(bytes, alignment, std::nothrow);
+        if (!ptr)
+            release(category, bytes);
+        return ptr;
+    }
+
+
+    void *MemoryBudget::reallocate(void *ptr, size_t bytes,
+        MemoryCategory category)
+    {
+        if (!ptr)
+            return allocate(bytes, category);
+
+        auto block = static_cast<char *>(ptr) - HEADER_SIZE;
+        const auto oldBytes = *reinterpret_cast<size_t *>(block);
+
+        if (bytes > oldBytes && !reserve(category, bytes - oldBytes))
+            return nullptr;
+
+        auto resized = static_cast<char *>(std::realloc(block,
+            bytes + HEADER_SIZE));
+        if (!resized)
+        {
+            if (bytes > oldBytes)
+                release(category, bytes - oldBytes);
+            return nullptr;
+        }
+
+        if (bytes < oldBytes)
+            release(category, oldBytes - bytes);
+
+        *reinterpret_cast<size_t *>(resized) = bytes;
+        return resized + HEADER_SIZE;
+    }
+
+
+    void MemoryBudget::deallocate(void *ptr, MemoryCategory category)
+    {
+        if (!ptr)
+            return;
+
+        auto block = static_cast<char *>(ptr) - HEADER_SIZE;
+        release(category, *reinterpret_cast<size_t *>(block));
+        std::free(block);
+    }
+
+
+    void MemoryBudget::deallocate(void *ptr, size_t bytes,
+        std::align_val_t alignment, MemoryCategory category)
+    {
+        if (!ptr)
+            return;
+
+        release(category, bytes);
+        ::operator delete(ptr, alignment);
+    }
+
+
+    void *MemoryBudget::luaAlloc(void *userdata, void *ptr, size_t oldSize,
+        size_t newSize)
+    {
+        if (newSize == 0)
+        {
+            deallocate(ptr, MemoryCategory::Lua);
+            return nullptr;
+        }
+
+        return reallocate(ptr, newSize, MemoryCategory::Lua);
+    }
+
+
+    size_t MemoryBudget::takeFailure(MemoryCategory category)
+    {
+        return s_pendingFailure[(size_t)category].exchange(0,
+            std::memory_order_relaxed);
+    }
+
+
+    MemoryStats MemoryBudget::stats()
+    {
+        auto live = [](MemoryCategory category) {
+            return s_live[(size_t)category].load(std::memory_order_relaxed);
+        };
+        auto peak = [](MemoryCategory category) {
+            return s_peak[(size_t)category].load(std::memory_order_relaxed);
+        };
+
+        return MemoryStats{
+            .budget=budget(),
+            .live=s_total.load(std::memory_order_relaxed),
+            .peak=s_totalPeak.load(std::memory_order_relaxed),
+            .fmodLive=live(MemoryCategory::FMOD),
+            .fmodPeak=peak(MemoryCategory::FMOD),
+            .pcmLive=live(MemoryCategory::PCM),
+            .pcmPeak=peak(MemoryCategory::PCM),
+            .luaLive=live(MemoryCategory::Lua),
+            .luaPeak=peak(MemoryCategory::Lua),
+            .engineLive=live(MemoryCategory::Engine),
+            .enginePeak=peak(MemoryCategory::Engine),
+            .failures=s_failures.load(std::memory_order_relaxed),
+            .lastFailure=s_lastFailure.load(std::memory_order_relaxed),
+        };
+    }
+
+
+    void MemoryBudget::resetPeaks()
+    {
+        for (size_t i = 0; i < CATEGORY_COUNT; ++i)
+            s_peak[i].store(s_live[i].load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+
+        s_totalPeak.store(s_total.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        s_failures.store(0, std::memory_order_relaxed);
+        s_lastFailure.store(0, std::memory_order_relaxed);
+    }
+
+
+    void *EngineObject::operator new(size_t size)
+    {
+        auto ptr = MemoryBudget::allocate(size, MemoryCategory::Engine);
+        if (!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+
+    void EngineObject::operator delete(void *ptr, size_t size)
+    {
+        MemoryBudget::deallocate(ptr, MemoryCategory::Engine);
+    }
+
+
+    void *EngineObject::operator new(size_t size, std::align_val_t alignment)
+    {
+        auto ptr = MemoryBudget::allocate(size, alignment,
+            MemoryCategory::Engine);
+        if (!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+
+    void EngineObject::operator delete(void *ptr, size_t size,
+        std::align_val_t alignment)
+    {
+        MemoryBudget::deallocate(ptr, size, alignment,
+            MemoryCategory::Engine);
+    }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace Insound
+{
+    /**
+     * Subsystems that memory usage is reported for
+     */
+    enum class MemoryCategory
+    {
+        /** Allocations made by FMOD, e.g. sample data of loaded banks */
+        FMOD,
+        /** Decoded sample copies kept for waveform display and analysis,
+         *  and stinger sources kept to decode them again */
+        PCM,
+        /** Lua scripting contexts, and the bytecode of compiled scripts
+         *  cached for reloads */
+        Lua,
+        /** Tracks, controls and script drivers themselves */
+        Engine,
+
+        Count,
+    };
+
+    /**
+     * Memory usage report in bytes
+     */
+    struct MemoryStats
+    {
+        /** Maximum bytes of FMOD, PCM and Lua memory combined, 0 if
+         *  unlimited */
+        size_t budget;
+        /** Bytes in use by all categories */
+        size_t live;
+        /** Highest `live` since the last peak reset */
+        size_t peak;
+
+        size_t fmodLive;
+        size_t fmodPeak;
+        size_t pcmLive;
+        size_t pcmPeak;
+        size_t luaLive;
+        size_t luaPeak;
+        size_t engineLive;
+        size_t enginePeak;
+
+        /** Number of allocations refused by the budget */
+        unsigned failures;
+        /** Size of the last refused allocation */
+        size_t lastFailure;
+    };
+
+    /**
+     * Process-wide accounting of the engine's heap memory, enforcing an
+     * optional budget.
+     *
+     * FMOD allocates through it once `install` was called, and Lua states
+     * through `luaAlloc`. When an FMOD, PCM or Lua allocation would exceed
+     * the budget it fails, which surfaces as an error of the operation that
+     * needed it, e.g. `MemoryBudgetExceeded` when loading a bank. Engine
+     * objects are counted, but never refused.
+     *
+     * All functions are thread-safe, since FMOD allocates from its mixer
+     * and loader threads.
+     */
+    class MemoryBudget
+    {
+    public:
+        /**
+         * Route FMOD's allocations through the budget. Must be called before
+         * the first FMOD system is created, later calls do nothing.
+         */
+        static void install();
+
+        /**
+         * Set the maximum number of bytes of FMOD, PCM and Lua memory. Does
+         * not free anything if usage is already above it, but refuses new
+         * allocations until usage drops below.
+         *
+         * @param bytes - budget in bytes, 0 for unlimited (default)
+         */
+        static void budget(size_t bytes);
+
+        [[nodiscard]]
+        static size_t budget();
+
+        /**
+         * Account for an allocation about to be made
+         *
+         * @return whether it fits the budget; if not, nothing is accounted
+         */
+        [[nodiscard]]
+        static bool reserve(MemoryCategory category, size_t bytes);
+
+        /**
+         * Account for memory that was freed
+         */
+        static void release(MemoryCategory category, size_t bytes);
+
+        /**
+         * Allocate accounted memory, aligned for any type
+         *
+         * @return the memory, or nullptr if it exceeds the budget or the
+         *         heap is exhausted
+         */
+        [[nodiscard]]
+        static void *allocate(size_t bytes, MemoryCategory category);
+
+        /**
+         * Allocate accounted memory with an alignment stricter than that of
+         * any fundamental type
+         *
+         * @return the memory, or nullptr if it exceeds the budget or the
+         *         heap is exhausted. Free with the same overload of
+         *         `deallocate`.
+         */
+        [[nodiscard]]
+        static void *allocate(size_t bytes, std::align_val_t alignment,
+            MemoryCategory category);
+
+        /**
+         * Resize memory from `allocate`, behaving like `std::realloc`
+         */
+        [[nodiscard]]
+        static void *reallocate(void *ptr, size_t bytes,
+            MemoryCategory category);
+
+        /**
+         * Free memory from `allocate`. Passing nullptr does nothing.
+         */
+        static void deallocate(void *ptr, MemoryCategory category);
+
+        /**
+         * Free memory from the aligned `allocate`. Passing nullptr does
+         * nothing.
+         *
+         * @param bytes - size passed to `allocate`
+         */
+        static void deallocate(void *ptr, size_t bytes,
+            std::align_val_t alignment, MemoryCategory category);
+
+        /**
+         * Allocator of Lua states, see `lua_Alloc`
+         */
+        static void *luaAlloc(void *userdata, void *ptr, size_t oldSize,
+            size_t newSize);
+
+        /**
+         * Get the size of the last allocation of a category refused since
+         * the previous call, telling budget failures apart from an exhausted
+         * heap. Failures are kept per category, so a refused Lua allocation
+         * is not mistaken for the cause of a later FMOD error.
+         *
+         * @param category - category of the operation that failed
+         *
+         * @return size in bytes, or 0 if none was refused
+         */
+        [[nodiscard]]
+        static size_t takeFailure(MemoryCategory category);
+
+        [[nodiscard]]
+        static MemoryStats stats();
+
+        /**
+         * Reset peaks to current usage, and the failure counter
+         */
+        static void resetPeaks();
+    };
+
+    /**
+     * Base of engine objects counted in `MemoryCategory::Engine`, including
+     * over-aligned ones, e.g. those holding an `EventRing`
+     */
+    struct EngineObject
+    {
+        static void *operator new(size_t size);
+        static void *operator new(size_t size, std::align_val_t alignment);
+        static void operator delete(void *ptr, size_t size);
+        static void operator delete(void *ptr, size_t size,
+            std::align_val_t alignment);
+    };
+}
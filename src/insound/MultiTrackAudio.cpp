@@ -4,7 +4,15 @@
 #include <insound/Int24.h>
 #include <insound/AudioEngine.h>
 #include "SyncPointMgr.h"
+#include "HorizontalSequencer.h"
+#include "EventRing.h"
+#include "MarkerScheduler.h"
+#include "StemMixer.h"
+#include "StingerPool.h"
+#include "TempoMap.h"
+#include <insound/MemoryBudget.h>
 #include <insound/errors/SoundLengthMismatch.h>
+#include <insound/profiling/Profiler.h>
 
 #include <fmod.hpp>
 #include <fmod_common.h>
@@ -12,37 +20,70 @@
 #include <fmod_dsp_effects.h>
 #include <fmod_errors.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
 static const unsigned int CHANSET_COUNT = 2;
 
+// Crossfade length when realigning drifted stems, in seconds
+static const float RESYNC_FADE = .01f;
+
+// Crossfade length of a seek while playing, in seconds
+static const float SEEK_FADE = .005f;
+
+// FMOD's default channel priority, in the middle of 0-256
+static const int DEFAULT_PRIORITY = 128;
+
 namespace Insound
 {
+    // Decoded sample data of each sound, shared by all tracks. Guarded by
+    // `pcmMutex` since tracks of independent systems may load on separate
+    // threads (e.g. batch rendering).
     static std::map<FMOD::Sound *, std::vector<float>> pcmData;
+    static std::mutex pcmMutex;
 
-    struct MultiTrackAudio::Impl
+    struct MultiTrackAudio::Impl : EngineObject
     {
     public:
-        Impl(FMOD::System *sys) :
+        Impl(FMOD::System *sys, MultiTrackAudio &track) :
             sounds(), chans(CHANSET_COUNT), fsb(),
-            main(sys), points(), syncpointCallback(), endCallback(), current(0)
+            main(sys), points(), current(0),
+            info(), tempo(), sequencer(track),
+            stingers(sys, static_cast<FMOD::ChannelGroup *>(main.raw())),
+            mixer(), mixerBytes(), drift(), positions(), idleClock(), startClock(), pendingLoop(),
+            seekTarget(), seeking(),
+            markers(), outgoingMarkers(), scheduled(), events(), markerLookahead(.1), outputRate(),
+            bufferLength(), priority(DEFAULT_PRIORITY), stemPriorities(),
+            pending(), loadError(), readyCallback()
         {
-
+            checkResult( sys->getSoftwareFormat(&outputRate, nullptr,
+                nullptr) );
+            checkResult( sys->getDSPBufferSize(&bufferLength, nullptr) );
         }
 
         ~Impl()
         {
+            dropMixer();
             chans.clear();
+            stingers.clear();
             main.release();
 
             if (fsb)
                 fsb->release();
+            if (pending)
+                pending->release();
 
             // Any left-over sounds (covered in the MainTrackAudio destructor,
             // but left here for good measure)
@@ -60,13 +101,280 @@ namespace Insound
 
         Channel main;
         SyncPointMgr points;
-        std::function<void(const std::string &, double, int)> syncpointCallback;
-        std::function<void()> endCallback;
+
+        // Static track data, populated on load
+        TrackInfo info;
+
+        // Musical grid for quantized transitions
+        TempoMap tempo;
+
+        // Adaptive section sequencing
+        HorizontalSequencer sequencer;
+
+        // One-shots layered over the stems
+        StingerPool stingers;
+
+        // Mixes the stems in place of the channels, if opted in
+        std::unique_ptr<StemMixer> mixer;
+        // PCM budget reserved for the mixer's copy of the stems
+        size_t mixerBytes;
+
+        // Stem skew measurement
+        DriftMonitor drift;
+        // Stem positions of the last measurement, reused between updates
+        std::vector<unsigned> positions;
+        // DSP clock after which the last transition's outgoing set is silent
+        unsigned long long idleClock;
+        // DSP clock at which the last transition's incoming set starts
+        unsigned long long startClock;
+        // Loop region of the incoming set, committed to `info.loop` once it
+        // starts at `startClock`
+        std::optional<LoopInfo<unsigned>> pendingLoop;
+        // Seek waiting for the spare channel set to free up, in PCM samples
+        std::optional<unsigned> seekTarget;
+        // Whether the last transition is a seek, whose position is reported
+        // before it starts
+        bool seeking;
+
+        // Sync point dispatch ahead of the playhead
+        MarkerScheduler markers;
+        // Sync point dispatch of the outgoing set, until `startClock`
+        MarkerScheduler outgoingMarkers;
+        // Events scheduled by the last update, reused between updates
+        std::vector<TrackEvent> scheduled;
+        // Playback events waiting for the frontend to poll them
+        EventRing<TrackEvent, 256> events;
+        // Seconds ahead of the playhead that sync points are dispatched
+        double markerLookahead;
+
+        // Mixer sample rate, the rate at which DSP clocks advance
+        int outputRate;
+        // Size of one mix block in DSP clocks
+        unsigned int bufferLength;
+
+        // Voice priority of the track, and of each stem relative to it
+        int priority;
+        std::vector<int> stemPriorities;
+
+        // Bank being opened by `loadFsbAsync`, committed once ready
+        FMOD::Sound *pending;
+        // Error of the last asynchronous load, empty on success
+        std::string loadError;
+        std::function<void()> readyCallback;
+
+        /**
+         * Apply the effective priority of each stem to its channels,
+         * covering stems added since the last call
+         */
+        void applyPriorities()
+        {
+            const auto count = chans.at(0).size();
+            stemPriorities.resize(count, 0);
+
+            for (auto &chanSet : chans)
+            {
+                for (size_t i = 0; i < chanSet.size(); ++i)
+                {
+                    chanSet[i].ch_priority(std::clamp(
+                        priority + stemPriorities[i], 0, 256));
+                }
+            }
+        }
+
+        /**
+         * Loop region of a channel set. A region transition loops only its
+         * incoming set until that set starts.
+         */
+        LoopInfo<unsigned> loopOf(int set) const
+        {
+            return (pendingLoop && set == current) ? *pendingLoop : info.loop;
+        }
+
+        /**
+         * Index of the channel set the playhead is on at a DSP clock: the
+         * outgoing set until the incoming one starts
+         */
+        int playheadSet(unsigned long long clock) const
+        {
+            return (clock < startClock) ?
+                (current + (int)chans.size() - 1) % (int)chans.size() :
+                current;
+        }
+
+        /**
+         * PCM position of the playhead on a channel set, or of the mixer
+         * while it is in use
+         */
+        unsigned playhead(int set) const
+        {
+            return mixer ? (unsigned)mixer->position() :
+                chans.at(set).at(0).ch_positionSamples();
+        }
+
+        /**
+         * Apply a stem's channel volume, fade and pan to the mixer
+         */
+        void mixStem(int ch, float seconds)
+        {
+            const auto &chan = chans.at(current).at(ch);
+            mixer->gain(ch, chan.volume() * chan.fadeLevel(true), seconds);
+            mixer->pan(ch, chan.panLeft(), chan.panRight(), seconds);
+        }
+
+        /**
+         * Remove the mixer, if any, and release its budget
+         */
+        void dropMixer()
+        {
+            mixer.reset();
+            MemoryBudget::release(MemoryCategory::PCM, mixerBytes);
+            mixerBytes = 0;
+        }
+
+        /**
+         * Commit the loop region of a started region transition
+         */
+        void commitLoop(unsigned long long clock)
+        {
+            if (pendingLoop && clock >= startClock)
+            {
+                info.loop = *pendingLoop;
+                pendingLoop.reset();
+            }
+        }
+
+        /**
+         * Hand sync point dispatch over to a transition: the outgoing set
+         * keeps its scanned region until `startClock`, the incoming set is
+         * scanned from its start position
+         */
+        void handOverMarkers()
+        {
+            outgoingMarkers = markers;
+            markers.reset();
+        }
+
+        /**
+         * Forget the scanned regions of both channel sets
+         */
+        void resetMarkers()
+        {
+            markers.reset();
+            outgoingMarkers.reset();
+        }
+
+        /**
+         * Move playback to the spare channel set, at a PCM position
+         */
+        void transition(unsigned position, LoopInfo<unsigned> loop,
+            float inTime, bool fadeIn, float outTime, bool fadeOut,
+            unsigned long long clock)
+        {
+            seeking = false;
+
+            // pause current layer, delayed
+            for (auto &chan : chans.at(current))
+            {
+                chan.pause(true, outTime, fadeOut, clock);
+            }
+
+            // move cursor to next layer
+            current = (current + 1) % chans.size();
+
+            // prepare to move to new position and fade-in
+            for (auto &chan : chans.at(current))
+            {
+                chan.ch_loopPCM(loop.start, loop.end);
+                chan.ch_positionSamples(position);
+                chan.pause(false, inTime, fadeIn, clock);
+            }
+
+            unsigned long long now;
+            checkResult( main.raw()->getDSPClock(&now, nullptr) );
+            startClock = std::max(clock, now);
+            idleClock = startClock +
+                (unsigned long long)(outTime * outputRate);
+        }
+
+        /**
+         * Cancel a transition whose incoming set has not started yet, at a
+         * DSP clock before `startClock`. The outgoing set keeps playing its
+         * loop, and the sequencer is told its pending section was dropped.
+         */
+        void cancelTransition(unsigned long long clock)
+        {
+            const auto outgoing = playheadSet(clock);
+
+            for (auto &chan : chans.at(current))
+                chan.pause(true, 0, false, clock);
+
+            for (auto &chan : chans.at(outgoing))
+            {
+                chan.pause(false, 0, true, clock);
+                // still audible, so hold full level instead of fading in
+                chan.fade(1.f, 1.f, 0, clock);
+            }
+
+            current = outgoing;
+            startClock = clock;
+            idleClock = clock;
+            pendingLoop.reset();
+            seeking = false;
+            markers = outgoingMarkers;
+            sequencer.cancelled();
+        }
+
+        /**
+         * Jump all stems of a playing track to a PCM position at one DSP
+         * clock, crossfading over the spare channel set. Cancels a scheduled
+         * transition that has not started.
+         */
+        void seek(unsigned position)
+        {
+            seekTarget.reset();
+
+            unsigned long long now;
+            checkResult( main.raw()->getDSPClock(&now, nullptr) );
+
+            if (now < startClock)
+                cancelTransition(now);
+
+            if (now < idleClock)
+            {
+                // both sets are audible, wait for the outgoing one to finish
+                seekTarget = position;
+            }
+            else
+            {
+                transition(position, loopOf(current), SEEK_FADE, true,
+                    SEEK_FADE, true, now + bufferLength);
+                seeking = true;
+                handOverMarkers();
+            }
+        }
     };
 
 
+    /**
+     * Read the static format data of a sound
+     */
+    static StemInfo readStemInfo(FMOD::Sound *sound)
+    {
+        StemInfo stem;
+        checkResult( sound->getLength(&stem.length, FMOD_TIMEUNIT_PCM) );
+        checkResult( sound->getDefaults(&stem.samplerate, nullptr) );
+
+        FMOD_SOUND_FORMAT format;
+        checkResult( sound->getFormat(nullptr, &format, &stem.channels,
+            &stem.bits) );
+        stem.format = (int)format;
+
+        return stem;
+    }
+
+
     MultiTrackAudio::MultiTrackAudio(FMOD::System *sys)
-        : m(new Impl(sys))
+        : m(new Impl(sys, *this))
     {
 
     }
@@ -88,6 +396,8 @@ namespace Insound
     void MultiTrackAudio::fadeChannelTo(int ch, float to, float seconds)
     {
         m->chans.at(m->current).at(ch).fadeTo(to, seconds);
+        if (m->mixer)
+            m->mixStem(ch, seconds);
     }
 
 
@@ -103,12 +413,21 @@ namespace Insound
     }
 
 
-    void MultiTrackAudio::pause(bool value, float seconds)
+    void MultiTrackAudio::pause(bool value, float seconds,
+        unsigned long long clock)
     {
-        auto clock = this->dspClock();
+        if (m->mixer)
+        {
+            m->mixer->paused(value);
+            return;
+        }
+
+        if (clock == 0)
+            clock = this->dspClock();
+
         for (auto &chan : m->chans.at(m->current))
         {
-            chan.pause(value, seconds, clock);
+            chan.pause(value, seconds, true, clock);
         }
     }
 
@@ -116,6 +435,7 @@ namespace Insound
     bool MultiTrackAudio::paused() const
     {
         if (!isLoaded()) return false;
+        if (m->mixer) return m->mixer->paused();
         
         return m->chans.at(m->current).at(0).paused();
     }
@@ -128,10 +448,22 @@ namespace Insound
         if (seconds >= len)
             seconds = len-.00001;
 
-        const auto samplerate = this->samplerate();
+        const unsigned target = seconds * this->samplerate();
 
-        for (auto &chan : m->chans.at(m->current))
-            chan.ch_positionSamples(seconds * samplerate);
+        if (m->mixer)
+        {
+            m->mixer->position(target);
+        }
+        else if (paused())
+        {
+            m->seekTarget.reset();
+            for (auto &chan : m->chans.at(m->current))
+                chan.ch_positionSamples(target);
+        }
+        else
+        {
+            m->seek(target);
+        }
     }
 
 
@@ -142,30 +474,23 @@ namespace Insound
         auto &chanSet = m->chans.at(m->current);
         if (chanSet.empty()) return 0;
 
-        // get first channel, assuming each is synced
-        return (double)m->chans.at(m->current)[0].ch_positionSamples() / (double)samplerate();
+        if (m->seekTarget)
+            return (double)m->seekTarget.value() / (double)samplerate();
+
+        // get first channel, assuming each is synced. Until a scheduled
+        // transition starts, the outgoing set carries the playhead, while
+        // seeks report their target right away.
+        const auto set = m->seeking ? m->current :
+            m->playheadSet(dspClock());
+        return (double)m->playhead(set) / (double)samplerate();
     }
 
 
     double MultiTrackAudio::length() const
     {
-        auto numSounds = m->sounds.size();
-
-        if (numSounds == 0) return 0;
-
-        unsigned int maxLength = 0;
-        for (int i = 0; i < numSounds; ++i)
-        {
-            const auto sound = m->sounds[i];
-
-            unsigned int length;
-            checkResult( sound->getLength(&length, FMOD_TIMEUNIT_PCM) );
+        if (m->info.empty()) return 0;
 
-            if (length > maxLength)
-                maxLength = length;
-        }
-
-        return maxLength / samplerate();
+        return m->info.length / samplerate();
     }
 
 
@@ -182,6 +507,7 @@ namespace Insound
             pause(true, 0); // stop audio if it's playing
         }
 
+        m->dropMixer();
 
         for (auto &chanSet : m->chans)
         {
@@ -190,13 +516,40 @@ namespace Insound
         m->current = 0;
 
         m->points.clear();
-        m->syncpointCallback =
-            std::function<void(const std::string &, double, int)>{};
+        m->tempo.clear();
+        m->sequencer.clear();
+        m->stingers.stopAll();
+        m->drift.resetStats();
+        m->idleClock = 0;
+        m->startClock = 0;
+        m->pendingLoop.reset();
+        m->seekTarget.reset();
+        m->seeking = false;
+        m->resetMarkers();
+        m->scheduled.clear();
+        m->events.clear();
+        m->stemPriorities.clear();
+
+        // Cancel an asynchronous load in progress
+        if (m->pending)
+        {
+            m->pending->release();
+            m->pending = nullptr;
+        }
 
         // Free pcm data
-        for (auto *sound : m->sounds)
         {
-            pcmData.erase(sound);
+            std::lock_guard lock(pcmMutex);
+            for (auto *sound : m->sounds)
+            {
+                auto it = pcmData.find(sound);
+                if (it == pcmData.end())
+                    continue;
+
+                MemoryBudget::release(MemoryCategory::PCM,
+                    it->second.size() * sizeof(float));
+                pcmData.erase(it);
+            }
         }
 
         // Release bank
@@ -219,61 +572,201 @@ namespace Insound
         }
 
         m->sounds.clear();
+        m->info = TrackInfo();
     }
 
 
-    bool MultiTrackAudio::isLoaded() const
+    bool MultiTrackAudio::canRebind() const
     {
-        return static_cast<bool>(!m->sounds.empty());
+        if (loading())
+            return false;
+        if (!isLoaded())
+            return true;
+
+        // A transition or seek in flight would be cut short
+        if (m->seekTarget || dspClock() < m->idleClock)
+            return false;
+
+        // Stems are recreated from their decoded copies
+        std::lock_guard lock(pcmMutex);
+        return std::all_of(m->sounds.begin(), m->sounds.end(),
+            [](FMOD::Sound *sound) { return pcmData.count(sound) != 0; });
     }
 
-    static FMOD_RESULT F_CALLBACK channelCallback(
-        FMOD_CHANNELCONTROL *chanCtrl,
-        FMOD_CHANNELCONTROL_TYPE chanType,
-        FMOD_CHANNELCONTROL_CALLBACK_TYPE callbackType,
-        void *commanddata1,
-        void *commanddata2)
+
+    void MultiTrackAudio::rebind(FMOD::System *sys)
     {
-        // Get `MultiTrackAudio` object
-        auto chan = (FMOD::ChannelControl *)chanCtrl;
-        MultiTrackAudio *track;
+        if (!canRebind())
+            throw std::runtime_error("MultiTrackAudio::rebind: cannot move "
+                "the track while it loads or transitions");
+
+        auto next = new Impl(sys, *this);
+        next->stingers.maxVoices(m->stingers.maxVoices());
+        try {
+            next->stingers.loadFrom(m->stingers);
+        }
+        catch(const std::exception &e)
+        {
+            // not worth losing the stems over
+            next->stingers.clear();
+            next->loadError = e.what();
+        }
 
-        auto result = chan->getUserData((void **)&track);
-        if (result != FMOD_OK)
-            return result;
+        next->readyCallback = std::move(m->readyCallback);
+        next->markerLookahead = m->markerLookahead;
+        next->priority = m->priority;
+        next->main.volume(m->main.volume());
+        next->main.pan(m->main.panLeft(), m->main.panRight());
+        next->main.reverbLevel(m->main.reverbLevel());
 
-        // Determine action based on callback type
-        switch (callbackType)
+        if (!isLoaded())
         {
-        case FMOD_CHANNELCONTROL_CALLBACK_SYNCPOINT:
-            {
-                auto pointIndex = (int)(uintptr_t)commanddata1;
-                const auto &callback = track->getSyncPointCallback();
+            delete m;
+            m = next;
+            return;
+        }
 
-                // Invoke callback, if any was set
-                if (callback)
-                    callback(
-                        track->getSyncPointLabel(pointIndex).data(),
-                        track->getSyncPointOffsetSeconds(pointIndex),
-                        pointIndex
-                    );
+        // The mixer is rebuilt on the new system, from the channels
+        const auto mixing = usingStemMixer();
+        if (mixing)
+            useStemMixer(false);
 
-                break;
-            }
+        // Playback state, restored once the stems are recreated
+        m->commitLoop(dspClock());
+        const auto wasPaused = paused();
+        const auto position = channel(0).ch_positionSamples();
 
-        case FMOD_CHANNELCONTROL_CALLBACK_END:
-            {
-                const auto &callback = track->getEndCallback();
-                if (callback)
-                    callback();
+        auto info = m->info;
+        const auto offsets = m->points.offsets();
+        std::vector<std::string> labels;
+        labels.reserve(offsets.size());
+        for (size_t i = 0; i < offsets.size(); ++i)
+            labels.emplace_back(m->points.getLabel(i));
 
-                break;
+        struct StemMix
+        {
+            float volume, panLeft, panRight, reverbLevel;
+        };
+        std::vector<StemMix> mix;
+        for (int i = 0, count = channelCount(); i < count; ++i)
+        {
+            const auto &chan = channel(i);
+            mix.emplace_back(StemMix{
+                .volume=chan.volume(),
+                .panLeft=chan.panLeft(),
+                .panRight=chan.panRight(),
+                .reverbLevel=chan.reverbLevel(),
+            });
+        }
+
+        auto stemPriorities = m->stemPriorities;
+        TempoMap tempo;
+        std::swap(tempo, m->tempo);
+        HorizontalSequencer sequencer(*this);
+        sequencer.swap(m->sequencer);
+
+        std::vector<TrackEvent> events;
+        TrackEvent event;
+        while (m->events.pop(event))
+            events.emplace_back(event);
+
+        // Take the decoded stems out before clearing, the new sounds play
+        // straight from them
+        std::vector<decltype(pcmData)::node_type> stems;
+        {
+            std::lock_guard lock(pcmMutex);
+            for (auto *sound : m->sounds)
+                stems.emplace_back(pcmData.extract(sound));
+        }
+
+        clear();
+        delete m;
+        m = next;
+
+        try {
+            for (size_t i = 0; i < stems.size(); ++i)
+            {
+                auto &samples = stems[i].mapped();
+                const auto &stem = info.stems.at(i);
+                const auto sound = (FMOD::Sound *)loadPCM(samples.data(),
+                    (unsigned)(samples.size() / stem.channels),
+                    stem.channels, (int)stem.samplerate);
+
+                std::lock_guard lock(pcmMutex);
+                stems[i].key() = sound;
+                pcmData.insert(std::move(stems[i]));
+            }
+        }
+        catch(const std::exception &e)
+        {
+            // `loadPCM` cleared the track, release what was not reinserted
+            for (auto &node : stems)
+            {
+                if (!node.empty())
+                    MemoryBudget::release(MemoryCategory::PCM,
+                        node.mapped().size() * sizeof(float));
             }
 
-        default: break;
+            m->loadError = e.what();
+            return;
         }
 
-        return FMOD_OK;
+        // Formats of the stems as loaded, rather than their decoded copies
+        std::swap(m->info, info);
+        loopSamples(m->info.loop.start, m->info.loop.end);
+        m->points.assign(labels, offsets);
+
+        m->stemPriorities = std::move(stemPriorities);
+        m->applyPriorities();
+        for (int i = 0, count = (int)mix.size(); i < count; ++i)
+        {
+            channelVolume(i, mix[i].volume);
+            channelPanLeft(i, mix[i].panLeft);
+            channelPanRight(i, mix[i].panRight);
+            channelReverbLevel(i, mix[i].reverbLevel);
+        }
+
+        std::swap(m->tempo, tempo);
+        m->sequencer.swap(sequencer);
+        m->sequencer.clockReset();
+
+        for (const auto &event : events)
+            m->events.push(event);
+
+        for (auto &chan : m->chans.at(m->current))
+            chan.ch_positionSamples(position);
+        if (!wasPaused)
+            pause(false, 0);
+
+        if (mixing)
+        {
+            try {
+                useStemMixer(true);
+            }
+            catch(const std::exception &e)
+            {
+                // the channels play on instead
+                m->loadError = e.what();
+            }
+        }
+    }
+
+
+    bool MultiTrackAudio::isLoaded() const
+    {
+        return static_cast<bool>(!m->sounds.empty());
+    }
+
+
+    bool MultiTrackAudio::loading() const
+    {
+        return m->pending != nullptr;
+    }
+
+
+    const std::string &MultiTrackAudio::loadError() const
+    {
+        return m->loadError;
     }
 
     size_t MultiTrackAudio::getSyncPointCount() const
@@ -296,6 +789,12 @@ namespace Insound
         return m->points.getOffsetMS(i);
     }
 
+    const SyncPointMgr &MultiTrackAudio::syncPoints() const
+    {
+        return m->points;
+    }
+
+
     double MultiTrackAudio::getSyncPointOffsetSeconds(size_t i) const
     {
         return (double)m->points.getOffsetSeconds(i);
@@ -316,6 +815,14 @@ namespace Insound
         int bits;
         checkResult(sound->getFormat(&type, &format, nullptr, &bits));
 
+        // Account for the copy up front, so banks over budget fail to load
+        if (bits != 8 && bits != 16 && bits != 24 && bits != 32)
+            return FMOD_ERR_FORMAT;
+
+        const auto bytes = (size_t)datalen / (bits / 8) * sizeof(float);
+        if (!MemoryBudget::reserve(MemoryCategory::PCM, bytes))
+            return FMOD_ERR_MEMORY;
+
         std::vector<float> res;
 
         // parse sample data based on format data
@@ -384,12 +891,15 @@ namespace Insound
         }
 
         // push to track pcm data
-        pcmData.emplace(sound, res);
+        std::lock_guard lock(pcmMutex);
+        if (!pcmData.emplace(sound, std::move(res)).second)
+            MemoryBudget::release(MemoryCategory::PCM, bytes);
         return FMOD_OK;
     }
 
     uintptr_t MultiTrackAudio::loadSound(const char *data, size_t bytelength)
     {
+        FMOD::Sound *sound;
         try {
             FMOD::System *sys;
             checkResult( m->main.raw()->getSystemObject(&sys) );
@@ -401,14 +911,63 @@ namespace Insound
             exinfo.length = bytelength;
             exinfo.pcmreadcallback = pcmReadCallback;
 
-            // add sound to the existing sounds and set its position accordingly
-            FMOD::Sound *sound;
             checkResult( sys->createSound(data,
                 FMOD_OPENMEMORY | FMOD_LOOP_NORMAL | FMOD_ACCURATETIME | FMOD_CREATESAMPLE,
                 &exinfo,
                 &sound)
             );
+        }
+        catch(...)
+        {
+            // clear other sounds since it's considered a "failed bank"
+            this->clear();
+            throw;
+        }
+
+        return addSound(sound);
+    }
 
+    uintptr_t MultiTrackAudio::loadPCM(const float *samples, unsigned frames,
+        int channels, int samplerate)
+    {
+        FMOD::Sound *sound;
+        try {
+            FMOD::System *sys;
+            checkResult( m->main.raw()->getSystemObject(&sys) );
+
+            auto exinfo{FMOD_CREATESOUNDEXINFO()};
+            std::memset(&exinfo, 0, sizeof(FMOD_CREATESOUNDEXINFO));
+            exinfo.cbsize = sizeof(FMOD_CREATESOUNDEXINFO);
+            exinfo.length = frames * channels * sizeof(float);
+            exinfo.numchannels = channels;
+            exinfo.defaultfrequency = samplerate;
+            exinfo.format = FMOD_SOUND_FORMAT_PCMFLOAT;
+
+            // Plays directly from the caller's memory, nothing is decoded
+            checkResult( sys->createSound((const char *)samples,
+                FMOD_OPENMEMORY_POINT | FMOD_OPENRAW | FMOD_LOOP_NORMAL |
+                FMOD_ACCURATETIME | FMOD_CREATESAMPLE,
+                &exinfo,
+                &sound)
+            );
+        }
+        catch(...)
+        {
+            this->clear();
+            throw;
+        }
+
+        return addSound(sound);
+    }
+
+    uintptr_t MultiTrackAudio::addSound(FMOD::Sound *sound)
+    {
+        try {
+            FMOD::System *sys;
+            checkResult( m->main.raw()->getSystemObject(&sys) );
+
+            const auto stem = readStemInfo(sound);
+            LoopInfo<unsigned> loop;
 
             // Check if this is to be the first sound
             if (m->fsb || m->sounds.empty()) // fsb means it will be later unloaded, otherwise, checks for empty sounds
@@ -427,9 +986,7 @@ namespace Insound
 
                 if (!loopEnd)
                 {
-                    unsigned int length;
-                    checkResult(sound->getLength(&length, FMOD_TIMEUNIT_PCM));
-                    loopEnd.emplace(length);
+                    loopEnd.emplace(stem.length);
                     didAlterLoop = true;
                 }
 
@@ -441,26 +998,19 @@ namespace Insound
                     points.load(sound);
 
                 m->points.swap(points);
+                loop = {.start=loopStart.value(), .end=loopEnd.value()};
             }
             else
             {
                 // set loop position from other sounds
-                unsigned int loopstart, loopend;
-                checkResult( m->sounds[0]->getLoopPoints(
-                    &loopstart, FMOD_TIMEUNIT_PCM,
-                    &loopend, FMOD_TIMEUNIT_PCM) );
+                loop = m->info.loop;
 
                 checkResult( sound->setLoopPoints(
-                    loopstart, FMOD_TIMEUNIT_PCM,
-                    loopend, FMOD_TIMEUNIT_PCM) );
+                    loop.start, FMOD_TIMEUNIT_PCM,
+                    loop.end, FMOD_TIMEUNIT_PCM) );
 
                 // check if length is equal to the first track, if not, throw
-                unsigned soundLength;
-                checkResult(sound->getLength(&soundLength, FMOD_TIMEUNIT_PCM));
-                unsigned firstLength;
-                checkResult(m->sounds[0]->getLength(&firstLength, FMOD_TIMEUNIT_PCM));
-
-                if (soundLength != firstLength)
+                if (stem.length != m->info.stems[0].length)
                 {
                     throw SoundLengthMismatch();
                 }
@@ -474,32 +1024,48 @@ namespace Insound
 
             for (auto &chanSet : m->chans)
             {
+                // align new stem to others' exact sample position
+                const auto position = chanSet.empty() ? 0 :
+                    chanSet[0].ch_positionSamples();
+
                 auto &chan = chanSet.emplace_back(sound, (FMOD::ChannelGroup *)m->main.raw(),
                     sys);
-
-                if (!chanSet.empty())
-                {
-                    // set channel track position to others' position
-                    auto seconds = chanSet[0].ch_position();
-                    chan.ch_position(seconds);
-                }
+                chan.ch_positionSamples(position);
             }
 
             m->sounds.emplace_back(sound);
 
+            if (m->info.empty())
+            {
+                m->info.samplerate = stem.samplerate;
+                m->info.loop = loop;
+            }
+            m->info.stems.emplace_back(stem);
+            if (stem.length > m->info.length)
+                m->info.length = stem.length;
+
+            m->applyPriorities();
             pause(true, 0); // pause, wait for user to trigger start
 
             return (uintptr_t)sound;
         }
         catch(...)
         {
+            // not owned by the track yet
+            if (std::find(m->sounds.begin(), m->sounds.end(), sound) ==
+                m->sounds.end())
+            {
+                sound->release();
+            }
+
             // clear other sounds since it's considered a "failed bank"
             this->clear();
             throw;
         }
     }
 
-    void MultiTrackAudio::loadFsb(const char *data, size_t bytelength)
+    FMOD::Sound *MultiTrackAudio::openFsb(const char *data,
+        size_t bytelength)
     {
         // Set relevant info to load the fsb
         auto exinfo{FMOD_CREATESOUNDEXINFO()};
@@ -519,6 +1085,69 @@ namespace Insound
             &exinfo, &snd)
         );
 
+        return snd;
+    }
+
+    void MultiTrackAudio::loadFsb(const char *data, size_t bytelength)
+    {
+        auto snd = openFsb(data, bytelength);
+        try {
+            commitFsb(snd);
+        }
+        catch(...)
+        {
+            snd->release();
+            throw;
+        }
+    }
+
+    void MultiTrackAudio::loadFsbAsync(const char *data, size_t bytelength)
+    {
+        if (m->pending)
+        {
+            m->pending->release();
+            m->pending = nullptr;
+        }
+
+        m->loadError.clear();
+        m->pending = openFsb(data, bytelength);
+    }
+
+    void MultiTrackAudio::pollLoad()
+    {
+        FMOD_OPENSTATE state;
+        auto result = m->pending->getOpenState(&state, nullptr, nullptr,
+            nullptr);
+        if (result == FMOD_OK && state != FMOD_OPENSTATE_READY &&
+            state != FMOD_OPENSTATE_ERROR)
+        {
+            return; // still loading
+        }
+
+        auto snd = m->pending;
+        m->pending = nullptr;
+
+        try {
+            checkResult(result);
+            if (state == FMOD_OPENSTATE_ERROR)
+                throw std::runtime_error("Failed to open the fsbank file.");
+            commitFsb(snd);
+        }
+        catch(const std::exception &e)
+        {
+            snd->release();
+            m->loadError = e.what();
+        }
+
+        if (m->readyCallback)
+            m->readyCallback();
+    }
+
+    void MultiTrackAudio::commitFsb(FMOD::Sound *snd)
+    {
+        FMOD::System *sys;
+        checkResult( m->main.raw()->getSystemObject(&sys) );
+
         // Ensure there is at least one sound in the bank
         int numSubSounds;
         checkResult( snd->getNumSubSounds(&numSubSounds) );
@@ -531,8 +1160,10 @@ namespace Insound
 
         SyncPointMgr syncPoints(firstSound);
 
-        unsigned int length;
-        checkResult( firstSound->getLength(&length, FMOD_TIMEUNIT_PCM) );
+        TrackInfo info;
+        info.stems.emplace_back(readStemInfo(firstSound));
+
+        const auto length = info.stems[0].length;
         if (length == 0)
             throw std::runtime_error("Invalid subsound, 0 length.");
 
@@ -540,15 +1171,19 @@ namespace Insound
         for (int i = 1; i < numSubSounds; ++i)
         {
             FMOD::Sound *curSound;
-            unsigned curLength;
             checkResult( snd->getSubSound(i, &curSound) );
-            checkResult( curSound->getLength(&curLength, FMOD_TIMEUNIT_PCM) );
-            if (curLength != length)
+
+            const auto &stem = info.stems.emplace_back(
+                readStemInfo(curSound));
+            if (stem.length != length)
             {
                 throw SoundLengthMismatch();
             }
         }
 
+        info.length = length;
+        info.samplerate = info.stems[0].samplerate;
+
         // Find loop start / end points if they exist
         auto loopstart = syncPoints.getOffsetPCM("LoopStart");
         auto loopend = syncPoints.getOffsetPCM("LoopEnd");
@@ -575,6 +1210,8 @@ namespace Insound
         if (loopend.value() < loopstart.value())
             throw std::runtime_error("LoopStart comes after LoopEnd.");
 
+        info.loop = {.start=loopstart.value(), .end=loopend.value()};
+
         // Set loop points on each sound, emplacing them into a Channel vector
         std::vector<std::vector<Channel>> chans(CHANSET_COUNT);
         std::vector<FMOD::Sound *> sounds;
@@ -590,7 +1227,7 @@ namespace Insound
                     loopend.value(), FMOD_TIMEUNIT_PCM)
             );
 
-            for (auto &chanSet : m->chans) // create channel for each channel set
+            for (auto &chanSet : chans) // create channel for each channel set
             {
                 // create the channel wrapper object from the subsound
                 chanSet.emplace_back(subsound,
@@ -606,7 +1243,9 @@ namespace Insound
         m->fsb = snd;
         m->sounds.swap(sounds);
         std::swap(m->points, syncPoints);
+        std::swap(m->info, info);
 
+        m->applyPriorities();
         pause(true, 0); // pause, wait for user to trigger start
     }
 
@@ -629,6 +1268,9 @@ namespace Insound
         {
             chanSet.at(ch).volume(vol);
         }
+
+        if (m->mixer)
+            m->mixStem(ch, 0);
     }
 
     float MultiTrackAudio::channelVolume(int ch) const
@@ -649,6 +1291,32 @@ namespace Insound
         return m->chans.at(0).at(ch).reverbLevel();
     }
 
+    void MultiTrackAudio::priority(int priority)
+    {
+        if (priority < 0 || priority > 256)
+            throw std::invalid_argument("MultiTrackAudio::priority: must be "
+                "within 0-256");
+
+        m->priority = priority;
+        m->applyPriorities();
+    }
+
+    int MultiTrackAudio::priority() const
+    {
+        return m->priority;
+    }
+
+    void MultiTrackAudio::channelPriority(int ch, int offset)
+    {
+        m->stemPriorities.at(ch) = offset;
+        m->applyPriorities();
+    }
+
+    int MultiTrackAudio::channelPriority(int ch) const
+    {
+        return m->stemPriorities.at(ch);
+    }
+
     void MultiTrackAudio::mainReverbLevel(float level)
     {
         m->main.reverbLevel(level);
@@ -676,6 +1344,8 @@ namespace Insound
             chanSet.at(ch).panLeft(level);
         }
 
+        if (m->mixer)
+            m->mixStem(ch, 0);
     }
 
     float MultiTrackAudio::channelPanLeft(int ch) const
@@ -700,6 +1370,8 @@ namespace Insound
             chanSet.at(ch).panRight(level);
         }
 
+        if (m->mixer)
+            m->mixStem(ch, 0);
     }
 
     float MultiTrackAudio::channelPanRight(int ch) const
@@ -714,17 +1386,21 @@ namespace Insound
     }
 
 
-    void MultiTrackAudio::setSyncPointCallback(
-        std::function<void(const std::string &, double, int)> callback)
+    void MultiTrackAudio::setSyncPoints(const std::vector<std::string> &labels,
+        const std::vector<double> &seconds)
     {
-        m->syncpointCallback = std::move(callback);
-    }
-
-
-    const std::function<void(const std::string &, double, int)> &
-    MultiTrackAudio::getSyncPointCallback() const
-    {
-        return m->syncpointCallback;
+        if (!isLoaded())
+            throw std::runtime_error("MultiTrackAudio::setSyncPoints: no "
+                "track is loaded");
+
+        const auto rate = samplerate();
+        std::vector<unsigned> offsets;
+        offsets.reserve(seconds.size());
+        for (auto offset : seconds)
+            offsets.emplace_back((unsigned)(std::max(offset, 0.0) * rate));
+
+        m->points.assign(labels, offsets);
+        m->resetMarkers();
     }
 
 
@@ -771,17 +1447,9 @@ namespace Insound
     }
 
 
-    void MultiTrackAudio::setEndCallback(
-        std::function<void()> callback)
+    void MultiTrackAudio::setReadyCallback(std::function<void()> &&callback)
     {
-        m->endCallback = std::move(callback);
-    }
-
-
-    const std::function<void()> &
-    MultiTrackAudio::getEndCallback() const
-    {
-        return m->endCallback;
+        m->readyCallback = std::move(callback);
     }
 
 
@@ -794,8 +1462,7 @@ namespace Insound
     {
         if (m->sounds.empty()) return;
 
-        float samplerate;
-        checkResult(m->sounds[0]->getDefaults(&samplerate, nullptr));
+        const auto samplerate = m->info.samplerate;
 
         unsigned startpcm = samplerate * loopstart;
         unsigned endpcm = samplerate * loopend;
@@ -803,20 +1470,25 @@ namespace Insound
         loopSamples(startpcm, endpcm);
     }
 
-    void MultiTrackAudio::loopSamples(unsigned loopstart, unsigned loopend)
+    /**
+     * Clamp loop points to be within a sound's length
+     */
+    static void clampLoop(unsigned &loopstart, unsigned &loopend,
+        unsigned lengthpcm)
     {
-        if (m->sounds.empty()) return;
-
-        // Clamp loop points
-        unsigned lengthpcm;
-        checkResult(m->sounds[0]->getLength(&lengthpcm, FMOD_TIMEUNIT_PCM));
-
         if (loopend >= lengthpcm)
             loopend = lengthpcm - 1;
         if (loopend == 0)
             loopend = 1;
         if (loopstart > loopend)
             loopstart = loopend - 1;
+    }
+
+    void MultiTrackAudio::loopSamples(unsigned loopstart, unsigned loopend)
+    {
+        if (m->sounds.empty()) return;
+
+        clampLoop(loopstart, loopend, m->info.stems.at(0).length);
 
         // Set points
         for (auto &chanSet : m->chans)
@@ -827,6 +1499,11 @@ namespace Insound
             }
         }
 
+        m->info.loop = {.start=loopstart, .end=loopend};
+        m->pendingLoop.reset();
+
+        if (m->mixer && loopstart < loopend)
+            m->mixer->loop(loopstart, loopend);
     }
 
     LoopInfo<double> MultiTrackAudio::loopMilliseconds() const
@@ -853,9 +1530,7 @@ namespace Insound
 
     LoopInfo<unsigned> MultiTrackAudio::loopSamples() const
     {
-        return (m->chans.at(0).empty()) ?
-            LoopInfo<unsigned>{0, 0} :
-            m->chans.at(0).at(0).ch_loopPCM();
+        return m->info.loop;
     }
 
     Channel &MultiTrackAudio::channel(int ch)
@@ -882,6 +1557,7 @@ namespace Insound
     {
         auto sound = m->sounds.at(index);
 
+        std::lock_guard lock(pcmMutex);
         auto it = pcmData.find(sound);
         if (it == pcmData.end())
         {
@@ -894,29 +1570,453 @@ namespace Insound
 
     void MultiTrackAudio::transitionTo(float position, float inTime, bool fadeIn, float outTime, bool fadeOut, unsigned long long clock)
     {
-        // pause current layer, delayed
-        for (auto &chan : m->chans.at(m->current))
+        if (m->mixer)
+            throw std::runtime_error("MultiTrackAudio::transitionTo: not "
+                "supported while the stem mixer is in use");
+
+        m->transition(position * m->info.samplerate, m->loopOf(m->current),
+            inTime, fadeIn, outTime, fadeOut, clock);
+        m->handOverMarkers();
+    }
+
+    void MultiTrackAudio::transitionToRegion(double start, double end,
+        float inTime, bool fadeIn, float outTime, bool fadeOut,
+        unsigned long long clock)
+    {
+        if (!isLoaded())
+            throw std::runtime_error("MultiTrackAudio::transitionToRegion: "
+                "no track is loaded");
+        if (m->mixer)
+            throw std::runtime_error("MultiTrackAudio::transitionToRegion: "
+                "not supported while the stem mixer is in use");
+
+        const auto rate = m->info.samplerate;
+        unsigned loopstart = start * rate;
+        unsigned loopend = end * rate;
+        clampLoop(loopstart, loopend, m->info.stems[0].length);
+
+        // loop the region on the next layer only, the current one keeps its
+        // loop until the transition is reached
+        const LoopInfo<unsigned> loop{.start=loopstart, .end=loopend};
+        m->transition(loopstart, loop, inTime, fadeIn, outTime, fadeOut,
+            clock);
+        m->pendingLoop = loop;
+        m->handOverMarkers();
+    }
+
+    void MultiTrackAudio::update()
+    {
+        if (m->pending)
+            pollLoad();
+
+        if (!isLoaded()) return;
+
+        m->commitLoop(dspClock());
+
+        if (m->seekTarget && !paused())
+            m->seek(m->seekTarget.value());
+
+        m->sequencer.update();
+        checkSync();
+        scheduleMarkers();
+    }
+
+    void MultiTrackAudio::scheduleMarkers()
+    {
+        // Playhead is not moving, so no clock can be predicted
+        if (m->points.empty() || paused())
+        {
+            m->resetMarkers();
+            return;
+        }
+
+        const auto rate = m->info.samplerate;
+        const double clocksPerSample = m->outputRate / (double)rate;
+        const auto lookahead = (unsigned)(m->markerLookahead * rate);
+        const auto now = dspClock();
+        m->scheduled.clear();
+
+        // Before a scheduled transition starts, the outgoing set carries the
+        // playhead up to `startClock`, while the current set holds still at
+        // its start position
+        unsigned gap = 0;
+        const auto set = m->playheadSet(now);
+        if (set != m->current)
+        {
+            gap = (unsigned)std::min<double>(
+                (m->startClock - now) / clocksPerSample, lookahead);
+            m->outgoingMarkers.lookahead(gap);
+            m->outgoingMarkers.update(m->points.offsets(),
+                m->playhead(set), now,
+                clocksPerSample, m->loopOf(set), m->info.length,
+                m->scheduled);
+        }
+
+        // The incoming set is scanned once its start is within the lookahead
+        if (gap < lookahead)
+        {
+            m->markers.lookahead(lookahead - gap);
+            m->markers.update(m->points.offsets(),
+                m->playhead(m->current), std::max(now, m->startClock),
+                clocksPerSample, m->loopOf(m->current), m->info.length,
+                m->scheduled);
+        }
+
+        for (const auto &event : m->scheduled)
+            m->events.push(event);
+    }
+
+    size_t MultiTrackAudio::pollEvents(std::vector<TrackEvent> &events)
+    {
+        return m->events.drain(events);
+    }
+
+    bool MultiTrackAudio::pushEvent(const TrackEvent &event)
+    {
+        return m->events.push(event);
+    }
+
+    size_t MultiTrackAudio::droppedEvents() const
+    {
+        return m->events.dropped();
+    }
+
+    TrackProfile MultiTrackAudio::profile() const
+    {
+        TrackProfile result{.handle=0, .voices=m->stingers.activeVoices(),
+            .dsps=0};
+
+        int count;
+        checkResult( m->main.raw()->getNumDSPs(&count) );
+        result.dsps += count;
+
+        for (const auto &chanSet : m->chans)
+        {
+            for (const auto &chan : chanSet)
+            {
+                auto raw = static_cast<FMOD::Channel *>(chan.raw());
+
+                bool playing, isVirtual;
+                if (raw->isPlaying(&playing) == FMOD_OK && playing &&
+                    raw->isVirtual(&isVirtual) == FMOD_OK && !isVirtual &&
+                    !chan.paused())
+                {
+                    ++result.voices;
+                }
+
+                if (raw->getNumDSPs(&count) == FMOD_OK)
+                    result.dsps += count;
+            }
+        }
+
+        return result;
+    }
+
+    void MultiTrackAudio::markerLookahead(double seconds)
+    {
+        m->markerLookahead = std::max(seconds, 0.0);
+    }
+
+    double MultiTrackAudio::markerLookahead() const
+    {
+        return m->markerLookahead;
+    }
+
+    void MultiTrackAudio::checkSync()
+    {
+        // The mixer's stems share one playhead
+        if (m->sounds.size() < 2 || m->mixer) return;
+
+        for (int i = 0, size = (int)m->chans.size(); i < size; ++i)
+        {
+            const auto loop = m->loopOf(i);
+            auto &chanSet = m->chans[i];
+            if (chanSet.empty() || chanSet[0].paused())
+                continue;
+
+            m->positions.clear();
+            for (const auto &chan : chanSet)
+                m->positions.emplace_back(chan.ch_positionSamples());
+
+            if (!m->drift.measure(m->positions, loop))
+                continue;
+
+            // Only realign the audible set, and only once the spare set is
+            // free, without interrupting scheduled transitions
+            if (i != m->current || m->sequencer.pending())
+                continue;
+
+            const auto now = dspClock();
+            if (now < m->idleClock)
+                continue;
+
+            const auto clock = now + m->bufferLength * 2;
+            auto target = m->drift.reference() + (unsigned)((clock - now) *
+                (double)m->info.samplerate / m->outputRate);
+            if (loop.end > loop.start && target >= loop.end)
+                target = loop.start + (target - loop.start) %
+                    (loop.end - loop.start);
+
+            m->transition(target, loop, RESYNC_FADE, true, RESYNC_FADE, true,
+                clock);
+            m->drift.resynced();
+        }
+    }
+
+    const SyncStats &MultiTrackAudio::syncStats() const
+    {
+        return m->drift.stats();
+    }
+
+    void MultiTrackAudio::resetSyncStats()
+    {
+        m->drift.resetStats();
+    }
+
+    void MultiTrackAudio::syncThreshold(unsigned samples)
+    {
+        m->drift.threshold(samples);
+    }
+
+    unsigned MultiTrackAudio::syncThreshold() const
+    {
+        return m->drift.threshold();
+    }
+
+    void MultiTrackAudio::useStemMixer(bool use)
+    {
+        if (use == usingStemMixer()) return;
+
+        if (!use)
+        {
+            // Hand the playhead back to the channels
+            const auto position = m->playhead(m->current);
+            const auto wasPaused = paused();
+            m->dropMixer();
+
+            for (auto &chan : m->chans.at(m->current))
+                chan.ch_positionSamples(position);
+            if (!wasPaused)
+                pause(false, 0);
+            return;
+        }
+
+        if (!isLoaded())
+            throw std::runtime_error("MultiTrackAudio::useStemMixer: no "
+                "track is loaded");
+
+        m->commitLoop(dspClock());
+        if (m->seekTarget || dspClock() < m->idleClock ||
+            m->sequencer.current())
+        {
+            throw std::runtime_error("MultiTrackAudio::useStemMixer: cannot "
+                "switch while a transition or section is playing");
+        }
+
+        // The mixer keeps its own planar copy of up to two channels
+        size_t bytes = 0;
+        for (const auto &stem : m->info.stems)
+        {
+            bytes += (size_t)stem.length * std::min(stem.channels, 2) *
+                sizeof(float);
+        }
+
+        if (!MemoryBudget::reserve(MemoryCategory::PCM, bytes))
+            throw std::runtime_error("MultiTrackAudio::useStemMixer: stem "
+                "copies are over the memory budget");
+
+        const auto position = m->playhead(m->current);
+        const auto wasPaused = paused();
+        auto mixer = std::make_unique<StemMixer>();
+        try {
+            {
+                std::lock_guard lock(pcmMutex);
+                for (size_t i = 0; i < m->sounds.size(); ++i)
+                {
+                    auto it = pcmData.find(m->sounds[i]);
+                    if (it == pcmData.end())
+                        throw std::runtime_error("MultiTrackAudio::"
+                            "useStemMixer: a stem has no decoded copy");
+
+                    const auto &stem = m->info.stems.at(i);
+                    mixer->addStem(it->second.data(),
+                        (unsigned)(it->second.size() / stem.channels),
+                        stem.channels, stem.samplerate);
+                }
+            }
+
+            const auto loop = m->info.loop;
+            if (loop.start < loop.end)
+                mixer->loop(loop.start, loop.end);
+            mixer->position(position);
+            mixer->paused(true);
+            mixer->attach(static_cast<FMOD::ChannelGroup *>(m->main.raw()));
+        }
+        catch(...)
         {
-            chan.pause(true, outTime, fadeOut, clock);
+            MemoryBudget::release(MemoryCategory::PCM, bytes);
+            throw;
         }
 
-        // move cursor to next layer
-        m->current = (m->current + 1) % m->chans.size();
+        m->mixer = std::move(mixer);
+        m->mixerBytes = bytes;
+        for (int i = 0, count = channelCount(); i < count; ++i)
+            m->mixStem(i, 0);
 
-        // prepare to move to new position and fade-in
+        // The mixer takes over from the channels at the same mix block
+        const auto clock = dspClock();
         for (auto &chan : m->chans.at(m->current))
+            chan.pause(true, 0, false, clock);
+        m->mixer->paused(wasPaused);
+    }
+
+    bool MultiTrackAudio::usingStemMixer() const
+    {
+        return static_cast<bool>(m->mixer);
+    }
+
+    HorizontalSequencer &MultiTrackAudio::sequencer()
+    {
+        return m->sequencer;
+    }
+
+    const HorizontalSequencer &MultiTrackAudio::sequencer() const
+    {
+        return m->sequencer;
+    }
+
+    StingerPool &MultiTrackAudio::stingers()
+    {
+        return m->stingers;
+    }
+
+    const StingerPool &MultiTrackAudio::stingers() const
+    {
+        return m->stingers;
+    }
+
+    int MultiTrackAudio::playStinger(std::string_view name, Quantize quantize,
+        int priority, float volume)
+    {
+        const auto sample = m->stingers.find(name);
+        if (sample == -1)
+            throw std::runtime_error("Stinger \"" + std::string(name) +
+                "\" is not loaded");
+
+        const auto clock = (quantize == Quantize::None) ? 0 :
+            nextClock(quantize);
+
+        return m->stingers.play(sample, clock, priority, volume);
+    }
+
+    int MultiTrackAudio::outputRate() const
+    {
+        return m->outputRate;
+    }
+
+    unsigned long long MultiTrackAudio::transitionTo(float position,
+        Quantize quantize, float inTime, bool fadeIn, float outTime,
+        bool fadeOut)
+    {
+        const auto clock = nextClock(quantize);
+        transitionTo(position, inTime, fadeIn, outTime, fadeOut, clock);
+        return clock;
+    }
+
+    unsigned long long MultiTrackAudio::nextClock(Quantize quantize) const
+    {
+        if (!isLoaded())
+            throw std::runtime_error("MultiTrackAudio::nextClock: no track "
+                "is loaded");
+
+        const auto now = dspClock();
+        if (quantize == Quantize::None)
+            return now + m->bufferLength;
+
+        // Until a scheduled transition starts, the outgoing set carries the
+        // playhead, looping its own region
+        const auto set = m->playheadSet(now);
+        const double rate = m->info.samplerate;
+        const double clocksPerSample = m->outputRate / rate;
+        const auto loop = m->loopOf(set);
+        const bool looping = loop.end > loop.start;
+
+        // Find the next boundary at or after `pcm`, in PCM samples. Returns
+        // infinity if there is none before the loop end.
+        auto findBoundary = [this, quantize, rate, loop, looping](double pcm)
         {
-            chan.ch_position(position);
-            chan.pause(false, inTime, fadeIn, clock);
+            double boundary = INFINITY;
+            if (quantize == Quantize::Marker)
+            {
+                const auto i = m->points.lowerBound(
+                    (unsigned)std::ceil(pcm));
+                if (i < m->points.size())
+                    boundary = m->points.getOffsetPCM(i);
+            }
+            else
+            {
+                boundary = m->tempo.nextBoundary(pcm / rate, quantize) * rate;
+            }
+
+            return (looping && boundary > loop.end) ? INFINITY : boundary;
+        };
+
+        // Earliest position that can be scheduled: one mix block ahead
+        const double pcm = m->playhead(set);
+        double distance = m->bufferLength / clocksPerSample;
+        double earliest = pcm + distance;
+        if (looping && earliest >= loop.end)
+        {
+            earliest = loop.start +
+                std::fmod(earliest - loop.end, loop.end - loop.start);
+        }
+
+        auto boundary = findBoundary(earliest);
+        if (std::isinf(boundary))
+        {
+            if (!looping)
+                throw std::runtime_error("MultiTrackAudio::nextClock: no "
+                    "boundary ahead of the playhead");
 
+            // Playhead wraps to loop start before reaching a boundary
+            distance += loop.end - earliest;
+
+            boundary = findBoundary(loop.start);
+            if (!std::isinf(boundary))
+                distance += boundary - loop.start;
+        }
+        else
+        {
+            distance += boundary - earliest;
         }
+
+        return now + (unsigned long long)std::llround(distance *
+            clocksPerSample);
+    }
+
+    bool MultiTrackAudio::transitionPending() const
+    {
+        return isLoaded() && dspClock() < m->startClock;
+    }
+
+    TempoMap &MultiTrackAudio::tempoMap()
+    {
+        return m->tempo;
+    }
+
+    const TempoMap &MultiTrackAudio::tempoMap() const
+    {
+        return m->tempo;
     }
 
     float MultiTrackAudio::samplerate() const
     {
-        float freq;
-        checkResult(m->sounds.at(0)->getDefaults(&freq, nullptr));
-        return freq;
+        return m->info.stems.at(0).samplerate;
+    }
+
+    const TrackInfo &MultiTrackAudio::info() const
+    {
+        return m->info;
     }
 
     unsigned long long MultiTrackAudio::dspClock() const
@@ -1,6 +1,11 @@
 #pragma once
 #include "insound/Channel.h"
+#include "insound/DriftMonitor.h"
 #include "insound/LoopInfo.h"
+#include "insound/MemoryBudget.h"
+#include "insound/Quantize.h"
+#include "insound/TrackEvent.h"
+#include "insound/TrackInfo.h"
 #include <functional>
 #include <string>
 #include <string_view>
@@ -12,14 +17,19 @@ namespace FMOD {
 }
 
 namespace Insound {
+    class HorizontalSequencer;
     class ParamDescMgr;
     class Preset;
+    class StingerPool;
+    class SyncPointMgr;
+    class TempoMap;
+    struct TrackProfile;
 
     /**
      * Container of loaded audio tracks to be played in sync.
      *
      */
-    class MultiTrackAudio {
+    class MultiTrackAudio : public EngineObject {
     public:
         MultiTrackAudio(FMOD::System *sys);
         ~MultiTrackAudio();
@@ -37,6 +47,34 @@ namespace Insound {
          */
         void loadFsb(const char *data, size_t bytelength);
 
+        /**
+         * Begin loading an fsb file from memory without blocking. The bank
+         * is decoded on FMOD's loader thread and committed on a later
+         * `update`, replacing any loaded audio, after which the ready
+         * callback fires. Starting another load cancels the one in
+         * progress.
+         *
+         * @param  data       memory pointer to the fsb, must stay valid until
+         *                    the track is cleared
+         * @param  bytelength byte size of the memory block
+         *
+         * @throw FMODError if the load could not be started
+         */
+        void loadFsbAsync(const char *data, size_t bytelength);
+
+        /**
+         * Check if an asynchronous load is in progress
+         */
+        [[nodiscard]]
+        bool loading() const;
+
+        /**
+         * Get the error of the last asynchronous load or `rebind`, empty if
+         * it succeeded
+         */
+        [[nodiscard]]
+        const std::string &loadError() const;
+
         /**
          * Add sounds separately. This is useful for testing audio without
          * needing a compiled FSBank.
@@ -46,11 +84,52 @@ namespace Insound {
          */
         uintptr_t loadSound(const char *data, size_t bytelength);
 
+        /**
+         * Add a stem from already decoded, interleaved float samples, e.g.
+         * from `getSampleData` of another track. The memory is played from
+         * directly, so it must outlive the track or its next `clear`.
+         *
+         * Raw samples carry no sync points, the stem loops in full until
+         * loop points are set.
+         *
+         * @param samples    - interleaved sample data
+         * @param frames     - number of samples per channel
+         * @param channels   - number of interleaved channels
+         * @param samplerate - sample rate of the data
+         */
+        uintptr_t loadPCM(const float *samples, unsigned frames, int channels,
+            int samplerate);
+
         /**
          * Unload fsb file from memory and reset internals
          */
         void clear();
 
+        /**
+         * Check whether `rebind` can move the track right now: it is not
+         * loading, no transition or seek is in flight, and every stem has
+         * a decoded copy to recreate it from, which stems from `loadPCM`
+         * lack.
+         */
+        [[nodiscard]]
+        bool canRebind() const;
+
+        /**
+         * Recreate the track's mixer objects on another FMOD system, e.g.
+         * after the engine re-initialized its output. Loaded stems are
+         * recreated from their decoded copies and resume at the same
+         * position, paused or playing, with their mix, loop, sync points,
+         * tempo map and sequencer. Stingers are decoded again, but voices
+         * playing are cut. If a stem cannot be recreated, e.g. over the
+         * memory budget, the track is left empty, and if a stinger cannot,
+         * stingers are dropped; `loadError` then says why.
+         *
+         * @param sys - system to move to, the old one must still be alive
+         *
+         * @throw runtime_error if `canRebind` is false
+         */
+        void rebind(FMOD::System *sys);
+
         /**
          * Check if bank is currently loaded
          */
@@ -58,7 +137,10 @@ namespace Insound {
         bool isLoaded() const;
 
         /**
-         * Seek current track to a position in the track (in seconds)
+         * Seek current track to a position in the track (in seconds).
+         * While playing, all stems jump together at the next mix block with
+         * a short crossfade. Seeks made while a previous crossfade is still
+         * sounding are applied on a following `update`.
          *
          * @param seconds - position in the number of seconds to seek to.
          */
@@ -81,8 +163,10 @@ namespace Insound {
          *
          * @param pause   - whether to pause `true` or unpause `false` track
          * @param seconds - number of seconds to fade in/out pause
+         * @param clock   - DSP clock to schedule the pause at, 0 uses the
+         *                  current clock
          */
-        void pause(bool pause, float seconds);
+        void pause(bool pause, float seconds, unsigned long long clock = 0);
 
         /**
          * Perform a faded transition to another portion of the track.
@@ -93,6 +177,146 @@ namespace Insound {
          */
         void transitionTo(float position, float inTime, bool fadeIn, float outTime, bool fadeOut, unsigned long long clock = 0);
 
+        /**
+         * Perform a faded transition to another portion of the track at the
+         * next musical boundary, calculated from the tempo map or markers.
+         * The boundary is at least one mix block away, and accounts for
+         * wrapping around the loop end.
+         *
+         * @param position - position to jump to in seconds
+         * @param quantize - boundary to transition at
+         * @param inTime   - fade-in or delay time at new position (seconds)
+         * @param fadeIn   - whether to fade in (true) or delay entrance
+         * @param outTime  - fade-out or delay time at old position (seconds)
+         * @param fadeOut  - whether to fade out (true) or delay stop
+         *
+         * @return DSP clock the transition was scheduled at
+         */
+        unsigned long long transitionTo(float position, Quantize quantize,
+            float inTime, bool fadeIn, float outTime, bool fadeOut);
+
+        /**
+         * Get the DSP clock of the next musical boundary from the current
+         * playhead, at least one mix block from now.
+         *
+         * @param quantize - type of boundary to find
+         */
+        [[nodiscard]]
+        unsigned long long nextClock(Quantize quantize) const;
+
+        /**
+         * Check whether a scheduled transition has not started yet. Seeking
+         * in the meantime cancels it.
+         */
+        [[nodiscard]]
+        bool transitionPending() const;
+
+        /**
+         * Perform a faded transition to a region of the track, which loops
+         * once reached. Only the incoming channel set gets the new loop
+         * points, so the current region keeps looping until `clock`.
+         *
+         * @param start   - region loop start in seconds
+         * @param end     - region loop end in seconds
+         * @param clock   - DSP clock to transition at, 0 for now
+         *
+         * See `transitionTo` for the other parameters.
+         */
+        void transitionToRegion(double start, double end, float inTime,
+            bool fadeIn, float outTime, bool fadeOut,
+            unsigned long long clock = 0);
+
+        /**
+         * Advance engine-side scheduling (e.g. horizontal sequencing), and
+         * check the stems for drift. Called by the AudioEngine on each of its
+         * updates.
+         */
+        void update();
+
+        /**
+         * Horizontal re-sequencer driving this track's sections
+         */
+        [[nodiscard]]
+        HorizontalSequencer &sequencer();
+        [[nodiscard]]
+        const HorizontalSequencer &sequencer() const;
+
+        /**
+         * Get skew statistics of the stems, measured on each `update`
+         */
+        [[nodiscard]]
+        const SyncStats &syncStats() const;
+        void resetSyncStats();
+
+        /**
+         * Skew between stems in PCM samples, above which they are realigned
+         * with a short crossfade at the next mix block
+         */
+        void syncThreshold(unsigned samples);
+        [[nodiscard]]
+        unsigned syncThreshold() const;
+
+        /**
+         * Mix the stems from their decoded copies in one StemMixer DSP on
+         * the main bus, instead of one FMOD channel per stem. The stems
+         * keep their position, pause state, loop, volume and pan, and
+         * share one playhead, so they can't drift apart. Turning it off
+         * hands playback back to the channels where the mixer left off.
+         *
+         * While in use, pauses apply at the next mix block without a fade,
+         * stem reverb sends and priorities have no effect, and transitions
+         * throw. Unloading the track turns it off.
+         *
+         * @param use - whether to mix through the StemMixer
+         *
+         * @throw runtime_error if turned on while no track is loaded, a
+         *        transition, seek or sequencer section is in flight, a stem
+         *        lacks a decoded copy (e.g. from `loadPCM`), or the copy is
+         *        over the memory budget
+         */
+        void useStemMixer(bool use);
+        [[nodiscard]]
+        bool usingStemMixer() const;
+
+        /**
+         * Pool of one-shot samples layered over the stems, routed through
+         * the track's main bus. Scheduling clocks are those of `dspClock`.
+         */
+        [[nodiscard]]
+        StingerPool &stingers();
+        [[nodiscard]]
+        const StingerPool &stingers() const;
+
+        /**
+         * Play a loaded stinger over the track. Throws if no stinger has the
+         * name.
+         *
+         * @param name     - name of the stinger to play
+         * @param quantize - boundary to start at, `None` for now
+         * @param priority - higher priority stingers steal voices from lower
+         *                   ones, the oldest first among equals
+         * @param volume   - stinger volume
+         *
+         * @return voice slot index, or -1 if all voices were busy with higher
+         *         priority stingers
+         */
+        int playStinger(std::string_view name, Quantize quantize,
+            int priority = 0, float volume = 1.f);
+
+        /**
+         * Get the mixer sample rate, the rate that DSP clocks advance at
+         */
+        [[nodiscard]]
+        int outputRate() const;
+
+        /**
+         * Tempo/meter map used for quantized transitions
+         */
+        [[nodiscard]]
+        TempoMap &tempoMap();
+        [[nodiscard]]
+        const TempoMap &tempoMap() const;
+
         /**
          * Get the paused status of the track
          *
@@ -167,6 +391,29 @@ namespace Insound {
         float mainReverbLevel() const;
         void mainReverbLevel(float level);
 
+        /**
+         * Set the voice priority of the whole track. When the engine's real
+         * voice budget is exceeded, FMOD virtualizes the least important
+         * and least audible stems first.
+         *
+         * @param priority - 0: most important, 256: least important,
+         *                   128 by default
+         */
+        void priority(int priority);
+        [[nodiscard]]
+        int priority() const;
+
+        /**
+         * Set a stem's priority relative to the track priority. The stem's
+         * effective priority is their sum, clamped to 0-256.
+         *
+         * @param ch     - index of the stem
+         * @param offset - negative is more important, 0 by default
+         */
+        void channelPriority(int ch, int offset);
+        [[nodiscard]]
+        int channelPriority(int ch) const;
+
         [[nodiscard]]
         float channelPanLeft(int ch) const;
         void channelPanLeft(int ch, float level);
@@ -191,27 +438,64 @@ namespace Insound {
         [[nodiscard]]
         int channelCount() const;
 
-        void setSyncPointCallback(
-            std::function<void(const std::string &, double, int)> callback);
+        /**
+         * Move playback events queued since the last poll into a container:
+         * sync points, loop wraps and the track end, each scheduled a marker
+         * lookahead before it occurs.
+         *
+         * @param events - container to append events to, in order of clock
+         *
+         * @return number of events appended
+         */
+        size_t pollEvents(std::vector<TrackEvent> &events);
+
+        /**
+         * Queue an event for the next poll, e.g. an underrun detected by the
+         * engine. Must be called from the thread that updates the track.
+         *
+         * @return whether it was queued, false if the queue is full
+         */
+        bool pushEvent(const TrackEvent &event);
+
+        /**
+         * Number of events dropped because they weren't polled in time
+         */
         [[nodiscard]]
-        const std::function<void(const std::string &, double, int)> &
-        getSyncPointCallback() const;
+        size_t droppedEvents() const;
 
         /**
-         * This callback fires when the current track has reached its end point
+         * Count audible voices and DSP units of the track, for profiling.
+         * The handle of the result is left 0.
+         */
+        [[nodiscard]]
+        TrackProfile profile() const;
+
+        /**
+         * Set how far ahead of the playhead sync points are dispatched. It
+         * should exceed the interval between updates, or events arrive late.
          *
-         * @param callback - callback to set
+         * @param seconds - lookahead in seconds, .1 by default
          */
-        void setEndCallback(std::function<void()> callback);
+        void markerLookahead(double seconds);
+        [[nodiscard]]
+        double markerLookahead() const;
 
+        /**
+         * This callback fires from `update` when an asynchronous load
+         * finished, successfully or not, see `loadError`
+         *
+         * @param callback - callback to set
+         */
         void setReadyCallback(std::function<void()> &&callback);
 
         /**
-         * Get the callback that fires when current track has ended.
-         * May or may not contain a target.
+         * Replace all sync points of the current track in one pass
+         *
+         * @param labels  - label of each point
+         * @param seconds - offset of each point in seconds
          */
-        [[nodiscard]]
-        const std::function<void()> &getEndCallback() const;
+        void setSyncPoints(const std::vector<std::string> &labels,
+            const std::vector<double> &seconds);
 
         bool addSyncPoint(const std::string &name,
             double offsetSeconds);
@@ -238,6 +522,13 @@ namespace Insound {
         [[nodiscard]]
         double getSyncPointOffsetMS(size_t i) const;
 
+        /**
+         * Sync points of the current track, sorted by offset, for range and
+         * label queries
+         */
+        [[nodiscard]]
+        const SyncPointMgr &syncPoints() const;
+
         void loopMilliseconds(double loopstart, double loopend);
         void loopSeconds(double loopstart, double loopend);
         void loopSamples(unsigned loopstart, unsigned loopend);
@@ -257,12 +548,55 @@ namespace Insound {
         [[nodiscard]]
         const std::vector<float> &getSampleData(size_t index) const;
 
+        /**
+         * Get the sample rate of the loaded track. Throws if no track is
+         * loaded.
+         */
         [[nodiscard]]
         float samplerate() const;
 
+        /**
+         * Get the static data of the loaded track, cached on load. Its
+         * contents are empty if no track is loaded.
+         */
+        [[nodiscard]]
+        const TrackInfo &info() const;
+
         unsigned long long dspClock() const;
 
     private:
+        /**
+         * Measure stem skew of each playing channel set, realigning the
+         * current set if it drifted past the threshold
+         */
+        void checkSync();
+
+        /**
+         * Dispatch sync points within the lookahead of the playhead
+         */
+        void scheduleMarkers();
+
+        /**
+         * Start opening an fsb bank, returning the sound still loading
+         */
+        [[nodiscard]]
+        FMOD::Sound *openFsb(const char *data, size_t bytelength);
+
+        /**
+         * Validate an opened fsb bank and replace the track's audio with it.
+         * The caller keeps ownership of the bank if this throws.
+         */
+        void commitFsb(FMOD::Sound *snd);
+
+        /**
+         * Commit the asynchronous load once FMOD finished opening it
+         */
+        void pollLoad();
+
+        /**
+         * Add a newly created sound as a stem, taking ownership of it
+         */
+        uintptr_t addSound(FMOD::Sound *sound);
 
         // Pimple idiom
         struct Impl;
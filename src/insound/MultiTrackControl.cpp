@@ -1,13 +1,26 @@
 #include "MultiTrackControl.h"
+#include <insound/HorizontalSequencer.h>
 #include <insound/MultiTrackAudio.h>
+#include <insound/StingerPool.h>
+#include <insound/SyncPointMgr.h>
+#include <insound/TempoMap.h>
+#include <insound/profiling/Profiler.h>
 #include <insound/scripting/LuaDriver.h>
 
+#include <stdexcept>
+
 namespace Insound
 {
-    MultiTrackControl::MultiTrackControl(uintptr_t track,
-        emscripten::val callbacks) : lua(), track((MultiTrackAudio *)track),
-        callbacks(callbacks), totalTime()
+    MultiTrackControl::MultiTrackControl(AudioEngine &engine,
+        AudioEngine::TrackHandle track, emscripten::val callbacks) : lua(),
+        engine(&engine), handle(track), profiler(&engine.profiler()),
+        callbacks(callbacks), totalTime(), eventCallback(), events(),
+        eventData()
     {
+        if (!engine.getTrack(track))
+            throw std::invalid_argument("MultiTrackControl: track handle is "
+                "stale or invalid");
+
         initScriptingEngine();
     }
 
@@ -16,20 +29,76 @@ namespace Insound
         delete lua;
     }
 
-    void MultiTrackControl::transitionTo(float position, float inTime, bool fadeIn, float outTime, bool fadeOut, unsigned long clock)
+    MultiTrackAudio &MultiTrackControl::track() const
+    {
+        auto result = engine->getTrack(handle);
+        if (!result)
+            throw std::logic_error("MultiTrackControl: track was deleted");
+
+        return *result;
+    }
+
+    void MultiTrackControl::transitionTo(float position, float inTime, bool fadeIn, float outTime, bool fadeOut, double clock)
+    {
+        track().transitionTo(position, inTime, fadeIn, outTime, fadeOut,
+            (unsigned long long)clock);
+    }
+
+    double MultiTrackControl::transitionToQuantized(float position,
+        int quantize, float inTime, bool fadeIn, float outTime, bool fadeOut)
+    {
+        return (double)track().transitionTo(position, static_cast<Quantize>(quantize),
+            inTime, fadeIn, outTime, fadeOut);
+    }
+
+    void MultiTrackControl::addTempoPoint(double seconds, double bpm,
+        int numerator, int denominator)
+    {
+        track().tempoMap().add(seconds, bpm, numerator, denominator);
+    }
+
+    void MultiTrackControl::clearTempoMap()
+    {
+        track().tempoMap().clear();
+    }
+
+    void MultiTrackControl::loadStinger(const std::string &name, size_t data,
+        size_t bytelength)
+    {
+        track().stingers().load(name, (const char *)data, bytelength);
+    }
+
+    int MultiTrackControl::playStinger(const std::string &name, int quantize,
+        int priority, float volume)
+    {
+        return track().playStinger(name, static_cast<Quantize>(quantize),
+            priority, volume);
+    }
+
+    void MultiTrackControl::stopStingers()
+    {
+        track().stingers().stopAll();
+    }
+
+    void MultiTrackControl::setMaxStingerVoices(int max)
+    {
+        track().stingers().maxVoices(max);
+    }
+
+    void MultiTrackControl::clearStingers()
     {
-        track->transitionTo(position, inTime, fadeIn, outTime, fadeOut, clock);
+        track().stingers().clear();
     }
 
     void MultiTrackControl::loadSound(size_t data, size_t bytelength)
     {
-        track->loadSound((const char *)data, bytelength);
+        track().loadSound((const char *)data, bytelength);
         totalTime = 0;
     }
 
     void MultiTrackControl::loadBank(size_t data, size_t bytelength)
     {
-        track->loadFsb((const char *)data, bytelength);
+        track().loadFsb((const char *)data, bytelength);
         totalTime = 0;
     }
 
@@ -40,131 +109,174 @@ namespace Insound
 
     void MultiTrackControl::unload()
     {
-        track->clear();
+        track().clear();
     }
 
     void MultiTrackControl::update(float deltaTime)
     {
+        ProfileScope scope(profiler, ProfileSection::TrackUpdate);
+        dispatchEvents();
+
         lua->doUpdate(deltaTime, totalTime);
         totalTime += deltaTime;
 
-        if (!getPause() && track->fadeLevel() == 0)
+        if (!getPause() && track().fadeLevel() == 0)
         {
-            track->fadeTo(1, 0);
+            track().fadeTo(1, 0);
         }
     }
 
     bool MultiTrackControl::isLoaded() const
     {
-        return track->isLoaded();
+        return track().isLoaded();
     }
 
     void MultiTrackControl::setPause(bool pause, float seconds)
     {
-        track->pause(pause, seconds);
+        track().pause(pause, seconds);
     }
 
     bool MultiTrackControl::getPause() const
     {
-        return track->paused();
+        return track().paused();
     }
 
     void MultiTrackControl::setVolume(int ch, float volume)
     {
         if (ch == 0)
-            track->mainVolume(volume);
+            track().mainVolume(volume);
         else
-            track->channelVolume(ch-1, volume);
+            track().channelVolume(ch-1, volume);
     }
 
     float MultiTrackControl::getVolume(int ch) const
     {
         return (ch == 0) ?
-            track->mainVolume() :
-            track->channelVolume(ch-1);
+            track().mainVolume() :
+            track().channelVolume(ch-1);
     }
 
     void MultiTrackControl::setReverbLevel(int ch, float level)
     {
         if (ch == 0)
-            track->mainReverbLevel(level);
+            track().mainReverbLevel(level);
         else
-            track->channelReverbLevel(ch-1, level);
+            track().channelReverbLevel(ch-1, level);
     }
 
     float MultiTrackControl::getReverbLevel(int ch) const
     {
         return (ch == 0) ?
-            track->mainReverbLevel() :
-            track->channelReverbLevel(ch-1);
+            track().mainReverbLevel() :
+            track().channelReverbLevel(ch-1);
+    }
+
+    void MultiTrackControl::setPriority(int ch, int priority)
+    {
+        if (ch == 0)
+            track().priority(priority);
+        else
+            track().channelPriority(ch-1, priority);
+    }
+
+    int MultiTrackControl::getPriority(int ch) const
+    {
+        return (ch == 0) ?
+            track().priority() :
+            track().channelPriority(ch-1);
     }
 
     void MultiTrackControl::setPanLeft(int ch, float level)
     {
         if (ch == 0)
-            track->mainPanLeft(level);
+            track().mainPanLeft(level);
         else
-            track->channelPanLeft(ch-1, level);
+            track().channelPanLeft(ch-1, level);
     }
 
     float MultiTrackControl::getPanLeft(int ch) const
     {
         return (ch == 0) ?
-            track->mainPanLeft() :
-            track->channelPanLeft(ch-1);
+            track().mainPanLeft() :
+            track().channelPanLeft(ch-1);
     }
 
     void MultiTrackControl::setPanRight(int ch, float level)
     {
         if (ch == 0)
-            track->mainPanRight(level);
+            track().mainPanRight(level);
         else
-            track->channelPanRight(ch-1, level);
+            track().channelPanRight(ch-1, level);
     }
 
     float MultiTrackControl::getPanRight(int ch) const
     {
         return (ch == 0) ?
-            track->mainPanRight() :
-            track->channelPanRight(ch-1);
+            track().mainPanRight() :
+            track().channelPanRight(ch-1);
     }
 
     void MultiTrackControl::setPosition(float seconds)
     {
-        track->position(seconds);
+        track().position(seconds);
     }
 
     float MultiTrackControl::getPosition() const
     {
-        return track->position();
+        return track().position();
     }
 
     float MultiTrackControl::getLength() const
     {
-        return track->length();
+        return track().length();
     }
 
     int MultiTrackControl::getChannelCount() const
     {
-        return track->channelCount();
+        return track().channelCount();
     }
 
     float MultiTrackControl::getAudibility(int ch) const
     {
         return (ch == 0) ?
-            track->main().audibility() :
-            track->channel(ch-1).audibility();
+            track().main().audibility() :
+            track().channel(ch-1).audibility();
     }
 
     void MultiTrackControl::setLoopPoint(double loopstart, double loopend)
     {
-        track->loopSeconds(loopstart, loopend);
+        track().loopSeconds(loopstart, loopend);
+    }
+
+    SyncStats MultiTrackControl::getSyncStats() const
+    {
+        return track().syncStats();
+    }
+
+    void MultiTrackControl::resetSyncStats()
+    {
+        track().resetSyncStats();
+    }
+
+    void MultiTrackControl::setSyncThreshold(unsigned samples)
+    {
+        track().syncThreshold(samples);
+    }
+
+    void MultiTrackControl::setUseStemMixer(bool use)
+    {
+        track().useStemMixer(use);
+    }
+
+    bool MultiTrackControl::getUseStemMixer() const
+    {
+        return track().usingStemMixer();
     }
 
     LoopInfo<double> MultiTrackControl::getLoopPoint() const
     {
-        auto loopInfo = track->loopSamples();
-        double samplerate = track->samplerate();
+        auto loopInfo = track().loopSamples();
+        double samplerate = track().samplerate();
 
         return {
             .start = loopInfo.start / samplerate,
@@ -174,50 +286,106 @@ namespace Insound
 
     bool MultiTrackControl::addSyncPoint(const std::string &label, double seconds)
     {
-        return track->addSyncPoint(label, seconds);
+        return track().addSyncPoint(label, seconds);
     }
 
     bool MultiTrackControl::deleteSyncPoint(int i)
     {
-        return track->deleteSyncPoint(i);
+        return track().deleteSyncPoint(i);
     }
 
     bool MultiTrackControl::editSyncPoint(int i, const std::string &label, double seconds)
     {
-        return track->editSyncPoint(i, label, seconds);
+        return track().editSyncPoint(i, label, seconds);
     }
 
     size_t MultiTrackControl::getSyncPointCount() const
     {
-        return track->getSyncPointCount();
+        return track().getSyncPointCount();
     }
 
     SyncPointInfo MultiTrackControl::getSyncPoint(int index) const
     {
         return {
-            .name=track->getSyncPointLabel(index).data(),
-            .position=track->getSyncPointOffsetSeconds(index)
+            .name=track().getSyncPointLabel(index).data(),
+            .position=track().getSyncPointOffsetSeconds(index)
         };
     }
 
+    void MultiTrackControl::setSyncPoints(emscripten::val offsets,
+        emscripten::val labels)
+    {
+        track().setSyncPoints(
+            emscripten::vecFromJSArray<std::string>(labels),
+            emscripten::convertJSArrayToNumberVector<double>(offsets));
+    }
+
+    emscripten::val MultiTrackControl::getSyncPoints() const
+    {
+        const auto &points = track().syncPoints();
+        const auto count = points.size();
+
+        std::vector<double> offsets;
+        offsets.reserve(count);
+        auto labels = emscripten::val::array();
+        for (size_t i = 0; i < count; ++i)
+        {
+            offsets.emplace_back(points.getOffsetSeconds(i));
+            labels.set(i, points.getLabel(i));
+        }
+
+        auto result = emscripten::val::object();
+        // copy out of engine memory, the vector is freed on return
+        result.set("offsets", emscripten::val(emscripten::typed_memory_view(
+            offsets.size(), offsets.data())).call<emscripten::val>("slice"));
+        result.set("labels", labels);
+        return result;
+    }
+
     SampleDataInfo MultiTrackControl::getSampleData(int index) const
     {
-        auto &data = track->getSampleData(index);
+        auto &data = track().getSampleData(index);
         return {
             .ptr=(uintptr_t)data.data(),
             .byteLength=data.size()
         };
     }
 
-    void MultiTrackControl::onSyncPoint(emscripten::val callback)
+    void MultiTrackControl::onEvents(emscripten::val callback)
     {
-        track->setSyncPointCallback(
-            [callback, this]
-            (const std::string &name, double offset, int index)
-            {
-                callback(name, offset, index);
-                this->lua->doSyncPoint(name, offset);
+        eventCallback = callback;
+    }
+
+    void MultiTrackControl::dispatchEvents()
+    {
+        events.clear();
+        if (track().pollEvents(events) == 0)
+            return;
+
+        lua->doEvents(events, track());
+
+        if (eventCallback.isUndefined() || eventCallback.isNull())
+            return;
+
+        const double rate = track().samplerate();
+        eventData.clear();
+        for (const auto &event : events)
+        {
+            eventData.insert(eventData.end(), {
+                (double)event.type,
+                (double)event.index,
+                event.offset / rate,
+                (double)event.clock,
             });
+        }
+
+        eventCallback(emscripten::val(emscripten::typed_memory_view(
+            eventData.size(), eventData.data())));
+    }
+
+    void MultiTrackControl::setMarkerLookahead(double seconds)
+    {
+        track().markerLookahead(seconds);
     }
 
     void MultiTrackControl::doMarker(const std::string &name, double seconds)
@@ -227,12 +395,12 @@ namespace Insound
 
     float MultiTrackControl::samplerate() const
     {
-        return track->samplerate();
+        return track().samplerate();
     }
 
-    unsigned long MultiTrackControl::dspClock() const
+    double MultiTrackControl::dspClock() const
     {
-        return track->dspClock();
+        return (double)track().dspClock();
     }
 
     void MultiTrackControl::setParameter(const std::string &name,
@@ -242,7 +410,66 @@ namespace Insound
         if (value.isString())
             v = value.as<std::string>();
         else
+        {
             v = value.as<float>();
+            track().sequencer().setParameter(name, std::get<float>(v));
+        }
         this->lua->doParam(name, v);
     }
+
+    void MultiTrackControl::addSection(const std::string &name, double start,
+        double end)
+    {
+        track().sequencer().addSection(name, start, end);
+    }
+
+    void MultiTrackControl::addSectionExit(const std::string &section,
+        emscripten::val conditions, const std::string &target, int quantize,
+        float inTime, bool fadeIn, float outTime, bool fadeOut)
+    {
+        ExitRule rule{
+            .conditions={},
+            .target=target,
+            .quantize=static_cast<Quantize>(quantize),
+            .inTime=inTime,
+            .fadeIn=fadeIn,
+            .outTime=outTime,
+            .fadeOut=fadeOut,
+        };
+
+        const auto length = conditions["length"].as<unsigned>();
+        rule.conditions.reserve(length);
+        for (unsigned i = 0; i < length; ++i)
+        {
+            emscripten::val condition = conditions[i];
+            rule.conditions.emplace_back(ExitCondition{
+                .param=condition["param"].as<std::string>(),
+                .op=static_cast<CompareOp>(condition["op"].as<int>()),
+                .value=condition["value"].as<float>(),
+            });
+        }
+
+        track().sequencer().addExit(section, rule);
+    }
+
+    void MultiTrackControl::clearSections()
+    {
+        track().sequencer().clear();
+    }
+
+    void MultiTrackControl::startSection(const std::string &name)
+    {
+        track().sequencer().start(name);
+    }
+
+    std::string MultiTrackControl::getCurrentSection() const
+    {
+        auto section = track().sequencer().current();
+        return section ? section->name : std::string();
+    }
+
+    void MultiTrackControl::setSequencerLookahead(float seconds)
+    {
+        track().sequencer().lookahead(seconds);
+    }
 }
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <insound/AudioEngine.h>
+#include <insound/DriftMonitor.h>
 #include <insound/SampleDataInfo.h>
 #include <insound/SyncPointInfo.h>
 #include <insound/LoopInfo.h>
+#include <insound/MemoryBudget.h>
+#include <insound/TrackEvent.h>
 
 #include <emscripten/val.h>
 
 #include <cstddef>
 #include <string>
 #include <variant>
+#include <vector>
 
 namespace Insound
 {
@@ -20,14 +25,20 @@ namespace Insound
      * frontend code. A simple wrapper around MultiTrackAudio for controlling
      * the track play state and mix.
      */
-    class MultiTrackControl
+    class MultiTrackControl : public EngineObject
     {
     public:
         /**
+         * @param engine - engine that owns the track
+         * @param track  - handle retrieved from `AudioEngine::createTrack`
+         *
          * Callbacks:
          *     - syncpoint callback (fires syncpoint as it happens to JS)
+         *
+         * @throws invalid argument if the handle is stale or invalid
          */
-        MultiTrackControl(uintptr_t track, emscripten::val callbacks);
+        MultiTrackControl(AudioEngine &engine, AudioEngine::TrackHandle track,
+            emscripten::val callbacks);
 
         ~MultiTrackControl();
 
@@ -92,6 +103,18 @@ namespace Insound
         [[nodiscard]]
         float getReverbLevel(int ch) const;
 
+        /**
+         * Set the voice priority of the track or one of its channels
+         *
+         * @param ch       - 0 sets the track priority from 0 (most important)
+         *                   to 256, 1-chSize set a channel's offset to it
+         * @param priority - priority or offset to set
+         */
+        void setPriority(int ch, int priority);
+
+        [[nodiscard]]
+        int getPriority(int ch) const;
+
         void setPanLeft(int ch, float level);
 
         [[nodiscard]]
@@ -142,9 +165,88 @@ namespace Insound
          *                   or delay stop if `fadeOut` is false
          * @param fadeOut  - fade out current track portion (true),
          *                   or delay stop (false)
+         * @param clock    - DSP clock to transition at, 0 for now. Clocks
+         *                   are doubles, exact up to 2^53, since `unsigned
+         *                   long` is 32 bits on wasm and wraps within a day.
          */
         void transitionTo(float position, float inTime, bool fadeIn,
-            float outTime, bool fadeOut, unsigned long clock = 0);
+            float outTime, bool fadeOut, double clock = 0);
+
+        /**
+         * Transition to another position in the track at the next musical
+         * boundary, scheduled sample-accurately by the engine.
+         *
+         * @param position - position within the track in seconds
+         * @param quantize - `Quantize` value: 1 beat, 2 bar, 3 marker
+         * @param inTime   - see `transitionTo`
+         * @param fadeIn   - see `transitionTo`
+         * @param outTime  - see `transitionTo`
+         * @param fadeOut  - see `transitionTo`
+         *
+         * @return DSP clock that the transition was scheduled at
+         */
+        double transitionToQuantized(float position, int quantize,
+            float inTime, bool fadeIn, float outTime, bool fadeOut);
+
+        /**
+         * Add a tempo/meter change to the track's tempo map, used by
+         * quantized transitions. Each point starts a new measure.
+         *
+         * @param seconds     - position in the track in seconds
+         * @param bpm         - quarter notes per minute
+         * @param numerator   - beats per measure
+         * @param denominator - note value of one beat
+         */
+        void addTempoPoint(double seconds, double bpm, int numerator,
+            int denominator);
+
+        /**
+         * Remove all points from the track's tempo map
+         */
+        void clearTempoMap();
+
+        // ----- Stingers -----------------------------------------------------
+
+        /**
+         * Decode a one-shot sample into the track's stinger pool, replacing
+         * any with the same name. Safe to call while the track is playing.
+         *
+         * @param name       - name to trigger the stinger by
+         * @param data       - pointer to the encoded audio file
+         * @param bytelength - byte size of the data
+         */
+        void loadStinger(const std::string &name, size_t data,
+            size_t bytelength);
+
+        /**
+         * Play a loaded stinger over the track
+         *
+         * @param name     - name of the stinger to play
+         * @param quantize - `Quantize` boundary to start at, `None` for now
+         * @param priority - higher priority stingers steal voices from lower
+         *                   ones, the oldest first among equals
+         * @param volume   - stinger volume
+         *
+         * @return voice slot index, or -1 if all voices were busy with higher
+         *         priority stingers
+         */
+        int playStinger(const std::string &name, int quantize, int priority,
+            float volume);
+
+        /**
+         * Stop all playing stingers
+         */
+        void stopStingers();
+
+        /**
+         * Set the maximum number of stingers that may play at once
+         */
+        void setMaxStingerVoices(int max);
+
+        /**
+         * Release all loaded stingers
+         */
+        void clearStingers();
 
         /**
          * Set loop points (in seconds)
@@ -160,6 +262,27 @@ namespace Insound
         [[nodiscard]]
         LoopInfo<double> getLoopPoint() const;
 
+        /**
+         * Get skew statistics between the track's stems, in PCM samples
+         */
+        [[nodiscard]]
+        SyncStats getSyncStats() const;
+        void resetSyncStats();
+
+        /**
+         * Set the skew between stems, in PCM samples, above which they get
+         * realigned
+         */
+        void setSyncThreshold(unsigned samples);
+
+        /**
+         * Mix the stems in one DSP from their decoded copies instead of one
+         * FMOD channel each. See `MultiTrackAudio::useStemMixer`.
+         */
+        void setUseStemMixer(bool use);
+        [[nodiscard]]
+        bool getUseStemMixer() const;
+
         bool addSyncPoint(const std::string &label, double seconds);
         bool deleteSyncPoint(int i);
         bool editSyncPoint(int i, const std::string &label, double seconds);
@@ -170,6 +293,23 @@ namespace Insound
         [[nodiscard]]
         SyncPointInfo getSyncPoint(int index) const;
 
+        /**
+         * Replace all sync points in one call
+         *
+         * @param offsets - Float64Array of offsets in seconds
+         * @param labels  - array with the label of each point
+         */
+        void setSyncPoints(emscripten::val offsets, emscripten::val labels);
+
+        /**
+         * Get all sync points in one call, in order of offset
+         *
+         * @return `{offsets: Float64Array, labels: string[]}` where offsets
+         *         are in seconds
+         */
+        [[nodiscard]]
+        emscripten::val getSyncPoints() const;
+
         /**
          * Get pointer information about channel sample data
          *
@@ -178,22 +318,115 @@ namespace Insound
         [[nodiscard]]
         SampleDataInfo getSampleData(int index) const;
 
-        void onSyncPoint(emscripten::val callback);
+        /**
+         * Set the callback receiving the playback events polled by each
+         * `update`, in one Float64Array of `[type, index, position, clock]`
+         * per event, where `position` is in seconds and `clock` is the DSP
+         * clock the event occurs at. The array views engine memory, so it
+         * is only valid during the callback. Lua receives the same events.
+         */
+        void onEvents(emscripten::val callback);
+
+        /**
+         * Set how far ahead of the playhead sync points are dispatched, in
+         * seconds
+         */
+        void setMarkerLookahead(double seconds);
 
         void doMarker(const std::string &name, double seconds);
 
         [[nodiscard]]
         float samplerate() const;
         [[nodiscard]]
-        unsigned long dspClock() const;
+        double dspClock() const;
 
         void setParameter(const std::string &name, emscripten::val value);
 
+        // ----- Horizontal sequencing ----------------------------------------
+
+        /**
+         * Add a section to the horizontal sequencer, replacing any with the
+         * same name.
+         *
+         * @param name  - section name
+         * @param start - loop start in seconds
+         * @param end   - loop end in seconds
+         */
+        void addSection(const std::string &name, double start, double end);
+
+        /**
+         * Add an exit rule to a section. The rule passes once all of its
+         * conditions are met, then transitions to `target` at the next
+         * `quantize` boundary.
+         *
+         * @param section    - name of the section to add the rule to
+         * @param conditions - array of `{param: string, op: CompareOp,
+         *                     value: number}` objects
+         * @param target     - name of the section to transition to
+         * @param quantize   - `Quantize` value of the boundary to transition at
+         *
+         * See `transitionTo` for the fade parameters.
+         */
+        void addSectionExit(const std::string &section,
+            emscripten::val conditions, const std::string &target,
+            int quantize, float inTime, bool fadeIn, float outTime,
+            bool fadeOut);
+
+        /**
+         * Remove all sections and stop sequencing
+         */
+        void clearSections();
+
+        /**
+         * Immediately enter a section and start sequencing
+         */
+        void startSection(const std::string &name);
+
+        /**
+         * Get the name of the current section, or an empty string if the
+         * sequencer is not running
+         */
+        [[nodiscard]]
+        std::string getCurrentSection() const;
+
+        /**
+         * Set how many seconds before a boundary the sequencer commits its
+         * transition.
+         */
+        void setSequencerLookahead(float seconds);
+
     private:
         void initScriptingEngine();
-        MultiTrackAudio *track;
+
+        /**
+         * Resolve the track from its engine handle. The engine may move
+         * tracks, e.g. when re-initializing, so the pointer is not cached.
+         *
+         * @throws std::logic_error if the track was deleted
+         */
+        [[nodiscard]]
+        MultiTrackAudio &track() const;
+
+        /**
+         * Send playback events polled from the track to Lua and JS
+         */
+        void dispatchEvents();
+
+        // Backend of the script's track functions
+        struct ScriptEnv;
+
         LuaDriver *lua;
+        AudioEngine *engine;
+        AudioEngine::TrackHandle handle;
+        // owned by the engine
+        Profiler *profiler;
         emscripten::val callbacks;
         float totalTime;
+
+        emscripten::val eventCallback;
+        // Polled playback events, reused between updates
+        std::vector<TrackEvent> events;
+        // Events flattened for the JS callback
+        std::vector<double> eventData;
     };
 }
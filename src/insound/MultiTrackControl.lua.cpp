@@ -1,12 +1,15 @@
 #include "MultiTrackControl.h"
 #include "MultiTrackAudio.h"
 
-#include <insound/scripting/Marker.h>
 #include <insound/scripting/lua.hpp>
 #include <insound/scripting/LuaDriver.h>
-#include <insound/scripting/LuaError.h>
+#include <insound/scripting/TrackEnv.h>
 
+#include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <variant>
 
 namespace Insound
 {
@@ -24,7 +27,7 @@ namespace Insound
             if (!result)
                 return lua->getError();
 
-            result = lua->doLoad(*track);
+            result = lua->doLoad(track());
             if (!result)
                 return lua->getError();
         }
@@ -33,189 +36,194 @@ namespace Insound
     }
 
 
-    void MultiTrackControl::initScriptingEngine()
+    /**
+     * Routes the script's track functions through the frontend, so that the
+     * UI reflects and animates every change
+     */
+    struct MultiTrackControl::ScriptEnv : Scripting::TrackEnv
     {
-        // set up lua environment callback
-        auto populateEnv = [this](sol::table &env)
+        explicit ScriptEnv(MultiTrackControl &control) : control(control)
+        { }
+
+        MultiTrackControl &control;
+
+        emscripten::val callback(const char *name) const
         {
-            // Javascript callbacks to directly go through the UI
-            emscripten::val addMarker = callbacks["addMarker"];
-            emscripten::val editMarker = callbacks["editMarker"];
-            emscripten::val getMarker = callbacks["getMarker"];
-            emscripten::val getMarkerCount = callbacks["getMarkerCount"];
-            emscripten::val setPause = callbacks["setPause"];
-            emscripten::val setPosition = callbacks["setPosition"];
-            emscripten::val setVolume = callbacks["setVolume"];
-            emscripten::val setPanLeft = callbacks["setPanLeft"];
-            emscripten::val setPanRight = callbacks["setPanRight"];
-            emscripten::val setReverbLevel = callbacks["setReverbLevel"];
-            emscripten::val getPresetName = callbacks["getPresetName"];
-            emscripten::val getPresetCount = callbacks["getPresetCount"];
-            emscripten::val applyPreset = callbacks["applyPreset"];
-            emscripten::val print = callbacks["print"];
-            emscripten::val clearConsole = callbacks["clearConsole"];
-            emscripten::val setLoopPoint = callbacks["setLoopPoint"];
-            emscripten::val transitionTo = callbacks["transitionTo"];
-            emscripten::val addParameter = callbacks["addParameter"];
-            emscripten::val setParameter = callbacks["setParameter"];
-            emscripten::val getParameter = callbacks["getParameter"];
-
-            env.set_function("raw_print", [this, print](int level, std::string name, std::string message)
-            {
-                print(level, name, message);
-            });
+            return control.callbacks[name];
+        }
 
-            env.set_function("clear", [clearConsole]()
-            {
-                clearConsole();
-            });
+        void print(int level, const std::string &name,
+            const std::string &message) override
+        {
+            callback("print")(level, name, message);
+        }
 
-            Scripting::Marker::inject("Marker", env);
+        void clearConsole() override { callback("clearConsole")(); }
 
-            auto snd = env["track"].get_or_create<sol::table>();
+        void pause(bool value, float seconds) override
+        {
+            callback("setPause")(value, seconds);
+        }
 
-            snd.set_function("play", [this, setPause](std::optional<float> seconds={}) -> void
-            {
-                setPause(false, seconds.value_or(0));
-            });
+        bool paused() const override { return control.getPause(); }
 
-            snd.set_function("pause", [this, setPause](std::optional<float> seconds={}) -> void
-            {
-                setPause(true, seconds.value_or(0));
-            });
+        void position(double seconds) override
+        {
+            callback("setPosition")(seconds);
+        }
 
-            snd.set_function("paused",
-            [this](std::optional<bool> pause={}, std::optional<float> seconds={}) -> bool
-            {
-                if (!pause)
-                {
-                    return getPause();
-                }
-                else
-                {
-                    this->setPause(pause.value(), seconds.value_or(0));
-                    return pause.value();
-                }
-            });
+        // doesn't need a callback, because the interface polls for value
+        // on update
+        double position() const override { return control.getPosition(); }
+        double length() const override { return control.getLength(); }
 
-            // doesn't need a callback, because the interface polls for value
-            // on update
-            snd.set_function("position",
-            [this, setPosition](std::optional<double> seconds = {})
-            {
-                double pos;
-                if (seconds)
-                {
-                    setPosition(seconds.value());
-                }
+        void transitionTo(float position, float inTime, bool fadeIn,
+            float outTime, bool fadeOut, unsigned long long clock) override
+        {
+            // JavaScript numbers hold clocks exactly up to 2^53
+            callback("transitionTo")(position, inTime, fadeIn, outTime,
+                fadeOut, (double)clock);
+        }
 
-                return getPosition();
-            });
+        int playStinger(const std::string &name, int quantize, int priority,
+            float volume) override
+        {
+            return control.playStinger(name, quantize, priority, volume);
+        }
 
-            snd.set_function("transition_to",
-            [this, transitionTo](float position, float inTime, bool fadeIn, float outTime, bool fadeOut, std::optional<unsigned long> clock={})
-            {
-                transitionTo(position, inTime, fadeIn, outTime, fadeOut, clock.value_or(0));
-            });
+        void volume(int ch, float value, float seconds) override
+        {
+            callback("setVolume")(ch, value, seconds);
+        }
 
-            snd.set_function("volume",
-            [this, setVolume](std::optional<int> ch={}, std::optional<float> volume={}, std::optional<float> seconds={})
-            {
-                if (volume)
-                {
-                    setVolume(ch.value_or(0), volume.value(), seconds.value_or(0));
-                }
+        float volume(int ch) const override { return control.getVolume(ch); }
 
-                return this->getVolume(ch.value_or(0));
-            });
+        void panLeft(int ch, float value, float seconds) override
+        {
+            callback("setPanLeft")(ch, value, seconds);
+        }
 
-            snd.set_function("pan_left",
-            [this, setPanLeft](std::optional<int> ch={}, std::optional<float> value = {}, std::optional<float> seconds={})
-            {
-                if (value)
-                {
-                    setPanLeft(ch.value_or(0), value.value(), seconds.value_or(0));
-                }
+        float panLeft(int ch) const override
+        {
+            return control.getPanLeft(ch);
+        }
 
-                return this->getPanLeft(ch.value_or(0));
-            });
+        void panRight(int ch, float value, float seconds) override
+        {
+            callback("setPanRight")(ch, value, seconds);
+        }
 
-            snd.set_function("pan_right",
-            [this, setPanRight](std::optional<int> ch={}, std::optional<float> value = {}, std::optional<float> seconds={})
-            {
-                if (value)
-                {
-                    setPanRight(ch.value_or(0), value.value(), seconds.value_or(0));
-                }
+        float panRight(int ch) const override
+        {
+            return control.getPanRight(ch);
+        }
 
-                return this->getPanRight(ch.value_or(0));
-            });
+        void reverbLevel(int ch, float value, float seconds) override
+        {
+            callback("setReverbLevel")(ch, value, seconds);
+        }
 
-            snd.set_function("reverb_level",
-            [this, setReverbLevel](std::optional<int> ch={}, std::optional<float> value = {}, std::optional<float> seconds={})
-            {
-                if (value)
-                {
-                    setReverbLevel(ch.value_or(0), value.value(), seconds.value_or(0));
-                }
+        float reverbLevel(int ch) const override
+        {
+            return control.getReverbLevel(ch);
+        }
 
-                return this->getReverbLevel(ch.value_or(0));
-            });
+        void priority(int ch, int value) override
+        {
+            control.setPriority(ch, value);
+        }
 
+        int priority(int ch) const override
+        {
+            return control.getPriority(ch);
+        }
 
-            snd.set_function("channel_count",
-            [this]()
-            {
-                return this->getChannelCount();
-            });
+        int channelCount() const override
+        {
+            return control.getChannelCount();
+        }
 
-            snd.set_function("loop_point", // loopstart and loopend in milliseconds
-            [this, setLoopPoint](std::optional<double> loopstart={}, std::optional<double> loopend={})
-            {
-                std::cout << "setting loop start: " << loopstart.value_or(0) << ", " << loopend.value_or(0) << '\n';
-                if (loopstart)
-                {
-                    setLoopPoint(loopstart.value(), loopend.value_or(getLength() * 1000.0));
-                }
+        void loopPoint(double loopstart, double loopend) override
+        {
+            callback("setLoopPoint")(loopstart, loopend);
+        }
 
-                return this->getLoopPoint();
-            });
+        LoopInfo<double> loopPoint() const override
+        {
+            return control.getLoopPoint();
+        }
+
+        int markerCount() const override
+        {
+            return callback("getMarkerCount")().as<int>();
+        }
+
+        std::optional<Scripting::Marker> marker(
+            const std::variant<int, std::string> &indexOrName) const override
+        {
+            auto marker = (indexOrName.index() == 0) ?
+                callback("getMarker")(std::get<int>(indexOrName)) :
+                callback("getMarker")(std::get<std::string>(indexOrName));
+
+            if (marker.isUndefined() || marker.isNull())
+                return {};
+
+            return Scripting::Marker{
+                .name=marker["name"].as<std::string>(),
+                .position=marker["position"].as<double>(),
+            };
+        }
+
+        void addParameter(const std::string &config) override
+        {
+            callback("addParameter")(config);
+        }
+
+        void parameter(const std::variant<int, std::string> &indexOrName,
+            float value) override
+        {
+            if (indexOrName.index() == 0)
+                callback("setParameter")(std::get<int>(indexOrName), value);
+            else
+                callback("setParameter")(std::get<std::string>(indexOrName),
+                    value);
+        }
+
+        std::optional<float> parameter(
+            const std::variant<int, std::string> &indexOrName) const override
+        {
+            auto value = (indexOrName.index() == 0) ?
+                callback("getParameter")(std::get<int>(indexOrName)) :
+                callback("getParameter")(std::get<std::string>(indexOrName));
+
+            if (value.isUndefined())
+                return {};
+            return value.as<float>();
+        }
+    };
 
-            // marker namespace
+
+    void MultiTrackControl::initScriptingEngine()
+    {
+        // Owned by the driver's environment callback, outliving its state
+        auto backend = std::make_shared<ScriptEnv>(*this);
+
+        // set up lua environment callback
+        auto populateEnv = [this, backend](sol::table &env)
+        {
+            Scripting::TrackEnv::inject(*backend, lua, env);
+
+            // Javascript callbacks to directly go through the UI
+            emscripten::val addMarker = callbacks["addMarker"];
+            emscripten::val editMarker = callbacks["editMarker"];
+            emscripten::val getPresetName = callbacks["getPresetName"];
+            emscripten::val getPresetCount = callbacks["getPresetCount"];
+            emscripten::val applyPreset = callbacks["applyPreset"];
+
+            auto snd = env["track"].get_or_create<sol::table>();
+
+            // marker editing, only the frontend owns markers
             auto marker = snd["marker"].get_or_create<sol::table>();
-            marker.set_function("count",
-                [this, getMarkerCount]()
-                {
-                    return getMarkerCount().as<int>();
-                });
-            marker.set_function("get",
-                [this, getMarker](std::variant<int, std::string> indexOrName)
-                {
-                    emscripten::val marker;
-                    if (indexOrName.index() == 0)
-                    {   // index
-                        auto index = std::get<int>(indexOrName) - 1; // offset index since lua indexes from 1
-                        marker = getMarker(index);
-
-                        if (marker.isUndefined() || marker.isNull())
-                        {
-                            throw LuaError(lua, "marker at index " +
-                                std::to_string(index+1) + " is out of range");
-                        }
-                    }
-                    else // string name
-                    {
-                        auto name = std::get<std::string>(indexOrName);
-                        marker = getMarker(name);
-                    }
-
-
-
-                    return Scripting::Marker{
-                        .name=marker["name"].as<std::string>(),
-                        .position=marker["position"].as<double>(),
-                    };
-                });
             marker.set_function("add",
             [this, addMarker](std::string name, double ms)
             {
@@ -263,42 +271,10 @@ namespace Insound
             {
                 return getPresetCount().as<size_t>();
             });
-
-            auto param = snd["param"].get_or_create<sol::table>();
-            param.set_function("raw_add",
-            [this, addParameter](std::string config)
-            {
-                addParameter(config);
-            });
-            param.set_function("set",
-            [setParameter](std::variant<int, std::string> indexOrName, float value)
-            {
-                if (indexOrName.index() == 0)
-                {
-                    setParameter(std::get<int>(indexOrName), value);
-                }
-                else
-                {
-                    setParameter(std::get<std::string>(indexOrName), value);
-                }
-            });
-            param.set_function("get",
-            [this, getParameter](std::variant<int, std::string> indexOrName)
-            {
-                auto value = (indexOrName.index() == 0) ?
-                    getParameter(std::get<int>(indexOrName)) :
-                    getParameter(std::get<std::string>(indexOrName));
-
-                if (value.isUndefined())
-                {
-                    throw LuaError(lua, "Attempted to index a non-existent parameter");
-                }
-
-                return value.as<float>();
-            });
         };
 
         this->lua = new LuaDriver(populateEnv);
+        this->lua->setProfiler(profiler);
 
         emscripten::val print = callbacks["print"];
         this->lua->setErrorCallback(
@@ -0,0 +1,283 @@
+#include "Playlist.h"
+
+#include <insound/AudioEngine.h>
+#include <insound/MultiTrackAudio.h>
+#include <insound/SyncPointMgr.h>
+
+#include <iostream>
+#include <stdexcept>
+
+// Seconds ahead of the exit point that a switch is scheduled. Far enough
+// to outlast the time between updates, close enough that seeks and
+// transitions of the current bank made before then are accounted for.
+static const double SCHEDULE_AHEAD = .5;
+
+namespace Insound
+{
+    unsigned samplesUntil(unsigned position, unsigned target,
+        const LoopInfo<unsigned> &loop)
+    {
+        if (position >= loop.end)
+            return 0;
+
+        if (target > loop.end || (target <= position && target < loop.start))
+            target = loop.end;
+
+        return (target > position) ? target - position :
+            (loop.end - position) + (target - loop.start);
+    }
+
+
+    Playlist::Playlist(AudioEngine &engine) : m_engine(engine), m_entries(),
+        m_decks(), m_requested(), m_current(0), m_playing(false),
+        m_started(false), m_switchClock(), m_played(), m_onSwitch()
+    { }
+
+
+    Playlist::~Playlist()
+    {
+        clear();
+    }
+
+
+    void Playlist::enqueue(const char *data, size_t bytelength,
+        float crossfade, const std::string &exitMarker)
+    {
+        if (crossfade < 0)
+            throw std::invalid_argument("Playlist::enqueue: crossfade must "
+                "not be negative");
+
+        m_entries.emplace_back(Entry{
+            .data=std::vector<char>(data, data + bytelength),
+            .crossfade=crossfade,
+            .exitMarker=exitMarker,
+        });
+    }
+
+
+    void Playlist::play(float seconds)
+    {
+        m_playing = true;
+
+        if (m_started || m_entries.empty())
+            return;
+
+        auto current = deck(m_current);
+        if (!current->isLoaded())
+            return; // starts once loaded
+
+        current->pause(false, seconds, m_engine.transport().nextClock());
+        m_started = true;
+    }
+
+
+    void Playlist::stop(float seconds)
+    {
+        m_playing = false;
+
+        if (!m_started)
+            return;
+
+        const auto clock = m_engine.transport().nextClock();
+        deck(m_current)->pause(true, seconds, clock);
+
+        if (m_switchClock)
+        {
+            // rewind the incoming bank, so it starts over on the next switch
+            auto next = deck(1 - m_current);
+            next->pause(true, 0, clock);
+            next->position(0);
+            m_switchClock = 0;
+        }
+
+        m_started = false;
+    }
+
+
+    bool Playlist::skip(float crossfade)
+    {
+        if (!m_started || m_switchClock || !preloaded())
+            return false;
+
+        const auto rate = m_engine.samplerate();
+        switchAt(m_engine.transport().nextClock() +
+            (unsigned long long)(crossfade * rate), crossfade);
+        return true;
+    }
+
+
+    void Playlist::clear()
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            if (m_decks[i])
+                m_engine.deleteTrack(m_decks[i]);
+            m_decks[i] = 0;
+            m_requested[i] = false;
+        }
+
+        m_entries.clear();
+        m_current = 0;
+        m_playing = false;
+        m_started = false;
+        m_switchClock = 0;
+        m_played = 0;
+    }
+
+
+    bool Playlist::preloaded() const
+    {
+        if (m_entries.size() < 2 || !m_decks[1 - m_current])
+            return false;
+
+        auto next = m_engine.getTrack(m_decks[1 - m_current]);
+        return next && next->isLoaded();
+    }
+
+
+    Playlist::TrackHandle Playlist::current() const
+    {
+        return m_entries.empty() ? 0 : m_decks[m_current];
+    }
+
+
+    void Playlist::onSwitch(std::function<void(size_t)> callback)
+    {
+        m_onSwitch = std::move(callback);
+    }
+
+
+    void Playlist::update()
+    {
+        if (m_entries.empty())
+            return;
+
+        if (m_switchClock)
+        {
+            if (m_engine.transport().clock() >= m_switchClock)
+                finishSwitch();
+            return;
+        }
+
+        // Load the current bank first, then preload the next one behind it
+        if (!load(m_current, 0))
+            return;
+
+        if (m_playing && !m_started)
+        {
+            deck(m_current)->pause(false, 0,
+                m_engine.transport().nextClock());
+            m_started = true;
+        }
+
+        if (m_entries.size() < 2 || !load(1 - m_current, 1))
+            return;
+
+        if (m_started)
+            schedule();
+    }
+
+
+    MultiTrackAudio *Playlist::deck(int index)
+    {
+        if (!m_decks[index])
+            m_decks[index] = m_engine.createTrack();
+
+        return m_engine.getTrack(m_decks[index]);
+    }
+
+
+    bool Playlist::load(int index, size_t entry)
+    {
+        auto track = deck(index);
+        if (track->isLoaded() && m_requested[index])
+            return true;
+        if (track->loading())
+            return false;
+
+        if (m_requested[index])
+        {
+            // load finished without audio, skip the bank
+            std::cerr << "Playlist: failed to load bank: " <<
+                track->loadError() << '\n';
+            m_entries.erase(m_entries.begin() + entry);
+            m_requested[index] = false;
+            return false;
+        }
+
+        const auto &data = m_entries[entry].data;
+        track->loadFsbAsync(data.data(), data.size());
+        m_requested[index] = true;
+        return false;
+    }
+
+
+    void Playlist::schedule()
+    {
+        const auto &entry = m_entries[0];
+        auto current = deck(m_current);
+
+        const auto rate = (double)current->outputRate();
+        const auto ratio = rate / current->samplerate();
+        const auto loop = current->loopSamples();
+        const auto position = current->channel(0).ch_positionSamples();
+
+        auto target = loop.end;
+        if (!entry.exitMarker.empty())
+        {
+            const auto offset =
+                current->syncPoints().getOffsetPCM(entry.exitMarker);
+            if (offset)
+                target = offset.value();
+        }
+
+        const auto now = m_engine.transport().clock();
+        const auto lead = m_engine.transport().nextClock() - now;
+        const auto fade = (unsigned long long)(entry.crossfade * rate);
+
+        auto clocks = (unsigned long long)(
+            samplesUntil(position, target, loop) * ratio);
+
+        // Too close to fade in time, exit on the next pass of the loop
+        if (clocks < fade + lead)
+            clocks += (unsigned long long)((loop.end - loop.start) * ratio);
+
+        if (clocks < fade + lead ||
+            clocks - fade > (unsigned long long)(SCHEDULE_AHEAD * rate))
+        {
+            return;
+        }
+
+        switchAt(now + clocks, entry.crossfade);
+    }
+
+
+    void Playlist::switchAt(unsigned long long target, float crossfade)
+    {
+        auto current = deck(m_current);
+        auto next = deck(1 - m_current);
+
+        const auto start = target - (unsigned long long)(crossfade *
+            current->outputRate());
+
+        current->pause(true, crossfade, start);
+        next->pause(false, crossfade, start);
+        m_switchClock = target;
+    }
+
+
+    void Playlist::finishSwitch()
+    {
+        const auto previous = m_current;
+        m_current = 1 - m_current;
+        m_switchClock = 0;
+
+        deck(previous)->clear();
+        m_requested[previous] = false;
+        m_entries.pop_front();
+
+        ++m_played;
+        if (m_onSwitch)
+            m_onSwitch(m_played);
+    }
+}
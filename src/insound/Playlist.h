@@ -0,0 +1,202 @@
+#pragma once
+
+#include <insound/LoopInfo.h>
+#include <insound/SlotMap.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Insound
+{
+    class AudioEngine;
+    class MultiTrackAudio;
+
+    /**
+     * Get the number of samples until a looping playhead reaches a target
+     * offset. Targets the playhead can't reach again, outside of the loop
+     * and behind it, fall back to the loop end.
+     *
+     * @param position - playhead offset in samples
+     * @param target   - offset to reach in samples
+     * @param loop     - loop points of the track in samples
+     */
+    [[nodiscard]]
+    unsigned samplesUntil(unsigned position, unsigned target,
+        const LoopInfo<unsigned> &loop);
+
+    /**
+     * Queue of fsb banks played back to back on two engine tracks.
+     *
+     * While one track plays, the next bank decodes into the other one in
+     * the background. The switch is scheduled on the DSP clock, at the end
+     * of the current bank's loop or at one of its markers, with an optional
+     * crossfade, so banks follow each other without gaps.
+     *
+     * The current bank loops until a next one is queued and loaded.
+     */
+    class Playlist
+    {
+    public:
+        using TrackHandle = SlotMap<MultiTrackAudio *>::Handle;
+
+        /**
+         * @param engine - engine to create the playlist's tracks on
+         */
+        explicit Playlist(AudioEngine &engine);
+        ~Playlist();
+
+        Playlist(const Playlist &) = delete;
+        Playlist &operator=(const Playlist &) = delete;
+
+        /**
+         * Add a bank to the end of the queue. The data is copied, so the
+         * caller may free it right away.
+         *
+         * @param data       - pointer to the fsb in memory
+         * @param bytelength - byte size of the fsb
+         * @param crossfade  - seconds to crossfade into the bank queued
+         *                     after this one, 0 for a hard cut
+         * @param exitMarker - label of the marker to leave this bank at for
+         *                     the next one, empty to leave at its loop end
+         */
+        void enqueue(const char *data, size_t bytelength,
+            float crossfade = 0, const std::string &exitMarker = {});
+
+        /**
+         * Start or resume playback, once the current bank is loaded
+         *
+         * @param seconds - fade-in time when resuming
+         */
+        void play(float seconds = 0);
+
+        /**
+         * Stop playback, cancelling a scheduled switch
+         *
+         * @param seconds - fade-out time
+         */
+        void stop(float seconds = 0);
+
+        /**
+         * Switch to the next bank now instead of at the exit point
+         *
+         * @param crossfade - seconds to crossfade
+         *
+         * @return whether the switch was scheduled, false if the next bank
+         *         is not loaded yet or a switch is already scheduled
+         */
+        bool skip(float crossfade = 0);
+
+        /**
+         * Stop playback, empty the queue and release the playlist's tracks
+         */
+        void clear();
+
+        /**
+         * Load queued banks, start playback and schedule switches. Called by
+         * the AudioEngine on each of its updates, after its tracks update.
+         */
+        void update();
+
+        /**
+         * Number of banks queued, including the current one
+         */
+        [[nodiscard]]
+        size_t size() const { return m_entries.size(); }
+
+        /**
+         * Number of switches made since the last `clear`
+         */
+        [[nodiscard]]
+        size_t played() const { return m_played; }
+
+        [[nodiscard]]
+        bool playing() const { return m_playing; }
+
+        /**
+         * Check whether a switch to the next bank is scheduled or crossfading
+         */
+        [[nodiscard]]
+        bool switching() const { return m_switchClock != 0; }
+
+        /**
+         * Check whether the bank after the current one finished loading
+         */
+        [[nodiscard]]
+        bool preloaded() const;
+
+        /**
+         * Get the engine track playing the current bank, or 0 if the
+         * playlist is empty
+         */
+        [[nodiscard]]
+        TrackHandle current() const;
+
+        /**
+         * Set a callback fired from `update` after each switch, with the
+         * number of switches made
+         */
+        void onSwitch(std::function<void(size_t)> callback);
+
+    private:
+        /**
+         * A queued bank
+         */
+        struct Entry
+        {
+            std::vector<char> data;
+            float crossfade;
+            std::string exitMarker;
+        };
+
+        /**
+         * Get the track of a deck, creating it on first use
+         */
+        [[nodiscard]]
+        MultiTrackAudio *deck(int index);
+
+        /**
+         * Start loading `m_entries[entry]` into a deck if it isn't yet,
+         * dropping the entry if its load failed
+         *
+         * @return whether the deck holds the entry's audio
+         */
+        bool load(int index, size_t entry);
+
+        /**
+         * Schedule the switch to the next deck if the current bank's exit
+         * point is close enough
+         */
+        void schedule();
+
+        /**
+         * Crossfade into the next deck, completing at DSP clock `target`
+         */
+        void switchAt(unsigned long long target, float crossfade);
+
+        /**
+         * Release the previous deck once the switch completed
+         */
+        void finishSwitch();
+
+        AudioEngine &m_engine;
+        std::deque<Entry> m_entries;
+
+        // Two tracks alternating between the current and the next bank
+        TrackHandle m_decks[2];
+        // Whether a load of the deck's entry was started
+        bool m_requested[2];
+        int m_current;
+
+        bool m_playing;
+        // Whether the current deck was unpaused
+        bool m_started;
+        // DSP clock at which the scheduled switch completes, 0 if none
+        unsigned long long m_switchClock;
+        size_t m_played;
+        std::function<void(size_t)> m_onSwitch;
+    };
+}
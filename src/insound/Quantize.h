@@ -0,0 +1,19 @@
+#pragma once
+
+namespace Insound
+{
+    /**
+     * Musical grid that a scheduled transition snaps to
+     */
+    enum class Quantize
+    {
+        /** Schedule as soon as possible */
+        None,
+        /** Next beat boundary */
+        Beat,
+        /** Next downbeat of a measure */
+        Bar,
+        /** Next sync point / marker in the track */
+        Marker,
+    };
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * Unordered container handing out generation-checked handles to its
+     * elements. Insertion, lookup and erasure are O(1), and elements are
+     * stored contiguously for iteration.
+     *
+     * A handle packs a slot index with the slot's generation, which is odd
+     * while the slot is live and advances on each insertion and erasure, so
+     * stale handles never resolve to a newer element. A slot whose
+     * generation runs out is retired instead of wrapping around to reuse
+     * old handles. Handle 0 is never valid.
+     *
+     * @tparam T - element type
+     */
+    template <typename T>
+    class SlotMap
+    {
+    public:
+        using Handle = uint32_t;
+
+        /** Bits of a handle holding the slot index */
+        static constexpr unsigned IndexBits = 16;
+        /** Maximum number of elements */
+        static constexpr size_t MaxSize = (size_t)1 << IndexBits;
+
+        SlotMap() : m_data(), m_owners(), m_slots(), m_free(NoSlot) { }
+
+        /**
+         * Add an element
+         *
+         * @return handle to the element, or 0 if the map is full, i.e. all
+         *         slots are live or retired
+         */
+        Handle insert(T value)
+        {
+            uint32_t slot;
+            if (m_free != NoSlot)
+            {
+                slot = m_free;
+                m_free = m_slots[slot].index;
+            }
+            else
+            {
+                if (m_slots.size() == MaxSize)
+                    return 0;
+
+                slot = (uint32_t)m_slots.size();
+                m_slots.emplace_back(Slot{.index=0, .generation=0});
+            }
+
+            ++m_slots[slot].generation;
+            m_slots[slot].index = (uint32_t)m_data.size();
+            m_data.emplace_back(std::move(value));
+            m_owners.emplace_back(slot);
+
+            return makeHandle(slot, m_slots[slot].generation);
+        }
+
+        /**
+         * Remove an element. The last element moves into its place.
+         *
+         * @return whether the handle was valid and the element removed
+         */
+        bool erase(Handle handle)
+        {
+            const auto slot = slotOf(handle);
+            if (slot == NoSlot)
+                return false;
+
+            const auto index = m_slots[slot].index;
+            if (index + 1 != m_data.size())
+            {
+                m_data[index] = std::move(m_data.back());
+                m_owners[index] = m_owners.back();
+                m_slots[m_owners[index]].index = index;
+            }
+            m_data.pop_back();
+            m_owners.pop_back();
+
+            // Retire the slot rather than wrap its generation back to
+            // handles that may still be held
+            if (++m_slots[slot].generation == 0)
+                return true;
+
+            m_slots[slot].index = m_free;
+            m_free = slot;
+            return true;
+        }
+
+        /**
+         * Get the element of a handle
+         *
+         * @return pointer to the element, or nullptr if the handle is stale
+         *         or invalid. Valid until the next insertion or erasure.
+         */
+        [[nodiscard]]
+        T *find(Handle handle)
+        {
+            const auto slot = slotOf(handle);
+            return (slot == NoSlot) ? nullptr :
+                &m_data[m_slots[slot].index];
+        }
+
+        [[nodiscard]]
+        const T *find(Handle handle) const
+        {
+            const auto slot = slotOf(handle);
+            return (slot == NoSlot) ? nullptr :
+                &m_data[m_slots[slot].index];
+        }
+
+        /**
+         * Check whether a handle refers to a live element
+         */
+        [[nodiscard]]
+        bool contains(Handle handle) const { return slotOf(handle) != NoSlot; }
+
+        /**
+         * Remove all elements, invalidating all handles
+         */
+        void clear()
+        {
+            for (auto handle : handles())
+                erase(handle);
+        }
+
+        /**
+         * Handles of all elements, in iteration order
+         */
+        [[nodiscard]]
+        std::vector<Handle> handles() const
+        {
+            std::vector<Handle> result;
+            result.reserve(m_owners.size());
+            for (auto slot : m_owners)
+                result.emplace_back(makeHandle(slot, m_slots[slot].generation));
+            return result;
+        }
+
+        [[nodiscard]]
+        size_t size() const { return m_data.size(); }
+        [[nodiscard]]
+        bool empty() const { return m_data.empty(); }
+
+        [[nodiscard]]
+        auto begin() { return m_data.begin(); }
+        [[nodiscard]]
+        auto end() { return m_data.end(); }
+        [[nodiscard]]
+        auto begin() const { return m_data.begin(); }
+        [[nodiscard]]
+        auto end() const { return m_data.end(); }
+
+    private:
+        static constexpr uint32_t NoSlot = UINT32_MAX;
+        static constexpr uint32_t IndexMask = MaxSize - 1;
+
+        struct Slot
+        {
+            /** Index into the element array while live, otherwise the next
+             *  free slot */
+            uint32_t index;
+            uint16_t generation;
+        };
+
+        [[nodiscard]]
+        static Handle makeHandle(uint32_t slot, uint16_t generation)
+        {
+            return ((Handle)generation << IndexBits) | slot;
+        }
+
+        /**
+         * Slot of a live handle, or `NoSlot`
+         */
+        [[nodiscard]]
+        uint32_t slotOf(Handle handle) const
+        {
+            const auto slot = handle & IndexMask;
+            const auto generation = (uint16_t)(handle >> IndexBits);
+            if (slot >= m_slots.size() || (generation & 1) == 0 ||
+                m_slots[slot].generation != generation)
+            {
+                return NoSlot;
+            }
+
+            return slot;
+        }
+
+        std::vector<T> m_data;
+        // Slot of each element in `m_data`
+        std::vector<uint32_t> m_owners;
+        std::vector<Slot> m_slots;
+        // Head of the free slot list
+        uint32_t m_free;
+    };
+}
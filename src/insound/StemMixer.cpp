@@ -0,0 +1,525 @@
+#include "StemMixer.h"
+#include "common.h"
+
+#include <fmod.hpp>
+#include <fmod_dsp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Insound
+{
+    /**
+     * Add a planar source channel to both accumulators, with linear gain
+     * ramps. Kept free of aliasing and branches so it vectorizes.
+     */
+    static void mixPlane(float *__restrict left, float *__restrict right,
+        const float *__restrict src, unsigned frames, float leftGain,
+        float leftStep, float rightGain, float rightStep)
+    {
+        for (unsigned i = 0; i < frames; ++i)
+        {
+            const auto sample = src[i];
+            left[i] += sample * (leftGain + leftStep * (float)i);
+            right[i] += sample * (rightGain + rightStep * (float)i);
+        }
+    }
+
+    /**
+     * Interpolate one channel of a stem at precomputed source positions
+     */
+    static void gather(float *__restrict out, const float *__restrict src,
+        const unsigned *__restrict index, const unsigned *__restrict next,
+        const float *__restrict frac, unsigned frames)
+    {
+        for (unsigned i = 0; i < frames; ++i)
+        {
+            const auto a = src[index[i]];
+            out[i] = a + (src[next[i]] - a) * frac[i];
+        }
+    }
+
+
+    static FMOD_RESULT F_CALL stemMixerRead(FMOD_DSP_STATE *state,
+        float *inbuffer, float *outbuffer, unsigned int length,
+        int inchannels, int *outchannels)
+    {
+        std::memcpy(outbuffer, inbuffer,
+            (size_t)length * inchannels * sizeof(float));
+        *outchannels = inchannels;
+
+        void *userdata;
+        auto result = state->functions->getuserdata(state, &userdata);
+        if (result != FMOD_OK)
+            return result;
+
+        static_cast<StemMixer *>(userdata)->process(outbuffer, length,
+            inchannels);
+        return FMOD_OK;
+    }
+
+
+    static FMOD_RESULT F_CALL stemMixerShouldIProcess(FMOD_DSP_STATE *state,
+        FMOD_BOOL inputsidle, unsigned int length, FMOD_CHANNELMASK inmask,
+        int inchannels, FMOD_SPEAKERMODE speakermode)
+    {
+        if (!inputsidle)
+            return FMOD_OK;
+
+        void *userdata;
+        auto result = state->functions->getuserdata(state, &userdata);
+        if (result != FMOD_OK)
+            return result;
+
+        // Nothing to add to silence
+        auto mixer = static_cast<StemMixer *>(userdata);
+        return (mixer->paused() || mixer->length() == 0) ?
+            FMOD_ERR_DSP_DONTPROCESS : FMOD_OK;
+    }
+
+
+    StemMixer::StemMixer() : m_stems(), m_length(), m_samplerate(),
+        m_outputRate(), m_maxFrames(), m_acc(), m_index(), m_next(),
+        m_frac(), m_gather(), m_playhead(), m_position(0), m_seek(-1),
+        m_paused(false), m_loopStart(0), m_loopEnd(0), m_sys(), m_group(),
+        m_dsp()
+    { }
+
+
+    StemMixer::~StemMixer()
+    {
+        try {
+            detach();
+        }
+        catch(...)
+        {
+            // The DSP goes with the system either way
+        }
+    }
+
+
+    void StemMixer::prepare(int outputRate, unsigned maxFrames)
+    {
+        if (outputRate <= 0 || maxFrames == 0)
+            throw std::invalid_argument("StemMixer: invalid output format");
+
+        m_outputRate = outputRate;
+        m_maxFrames = maxFrames;
+        for (auto &acc : m_acc)
+            acc.assign(maxFrames, 0);
+        m_index.assign(maxFrames, 0);
+        m_next.assign(maxFrames, 0);
+        m_frac.assign(maxFrames, 0);
+        m_gather.assign(maxFrames, 0);
+    }
+
+
+    void StemMixer::attach(FMOD::ChannelGroup *group)
+    {
+        detach();
+
+        FMOD::System *sys;
+        checkResult( group->getSystemObject(&sys) );
+
+        int rate;
+        unsigned bufferLength;
+        checkResult( sys->getSoftwareFormat(&rate, nullptr, nullptr) );
+        checkResult( sys->getDSPBufferSize(&bufferLength, nullptr) );
+        prepare(rate, bufferLength);
+
+        FMOD_DSP_DESCRIPTION desc;
+        std::memset(&desc, 0, sizeof(FMOD_DSP_DESCRIPTION));
+        desc.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+        std::strncpy(desc.name, "Insound Stem Mixer", sizeof(desc.name) - 1);
+        desc.numinputbuffers = 1;
+        desc.numoutputbuffers = 1;
+        desc.read = stemMixerRead;
+        desc.shouldiprocess = stemMixerShouldIProcess;
+        desc.userdata = this;
+
+        FMOD::DSP *dsp;
+        checkResult( sys->createDSP(&desc, &dsp) );
+
+        // At the tail, so the group's fader and effects apply to the stems
+        auto result = group->addDSP(FMOD_CHANNELCONTROL_DSP_TAIL, dsp);
+        if (result != FMOD_OK)
+        {
+            dsp->release();
+            checkResult(result);
+        }
+
+        m_sys = sys;
+        m_group = group;
+        m_dsp = dsp;
+    }
+
+
+    void StemMixer::detach()
+    {
+        if (!m_dsp)
+            return;
+
+        auto dsp = m_dsp;
+        auto group = m_group;
+        m_sys = nullptr;
+        m_group = nullptr;
+        m_dsp = nullptr;
+
+        auto result = group->removeDSP(dsp);
+        dsp->release();
+        checkResult(result);
+    }
+
+
+    template <typename Fn>
+    void StemMixer::locked(Fn &&fn)
+    {
+        if (!m_sys)
+        {
+            fn();
+            return;
+        }
+
+        checkResult( m_sys->lockDSP() );
+        try {
+            fn();
+        }
+        catch(...)
+        {
+            m_sys->unlockDSP();
+            throw;
+        }
+        checkResult( m_sys->unlockDSP() );
+    }
+
+
+    int StemMixer::addStem(const float *samples, unsigned frames,
+        int channels, float samplerate)
+    {
+        if (!samples || frames == 0 || channels <= 0 || samplerate <= 0)
+            throw std::invalid_argument("StemMixer: invalid stem data");
+        if (!m_stems.empty() &&
+            (frames != m_length || samplerate != m_samplerate))
+        {
+            throw std::invalid_argument("StemMixer: stem length or sample "
+                "rate does not match the other stems");
+        }
+
+        // Deinterleave before locking the mixer out
+        auto stem = std::make_unique<Stem>();
+        const auto planes = std::min(channels, 2);
+        stem->data.resize((size_t)frames * planes);
+        for (int c = 0; c < planes; ++c)
+        {
+            auto plane = stem->data.data() + (size_t)c * frames;
+            for (unsigned i = 0; i < frames; ++i)
+                plane[i] = samples[(size_t)i * channels + c];
+        }
+
+        stem->channels = planes;
+        stem->gain.store(1.f);
+        stem->left.store(1.f);
+        stem->right.store(1.f);
+        stem->seconds.store(0);
+        stem->serial.store(0);
+        stem->seen = 0;
+        stem->level[0][0] = stem->level[1][1] = 1.f;
+        stem->level[0][1] = (planes == 1) ? 1.f : 0; // mono plays on both
+        stem->level[1][0] = 0;
+        std::memcpy(stem->target, stem->level, sizeof(stem->level));
+        std::memset(stem->step, 0, sizeof(stem->step));
+        stem->ramp = 0;
+
+        int index;
+        locked([&]() {
+            m_stems.emplace_back(std::move(stem));
+            if (m_stems.size() == 1)
+            {
+                m_length = frames;
+                m_samplerate = samplerate;
+                m_loopStart.store(0);
+                m_loopEnd.store(frames);
+            }
+            index = (int)m_stems.size() - 1;
+        });
+
+        return index;
+    }
+
+
+    void StemMixer::clear()
+    {
+        locked([this]() {
+            m_stems.clear();
+            m_length = 0;
+            m_samplerate = 0;
+            m_playhead = 0;
+            m_position.store(0);
+            m_seek.store(-1);
+            m_loopStart.store(0);
+            m_loopEnd.store(0);
+        });
+    }
+
+
+    StemMixer::Stem &StemMixer::stem(int index) const
+    {
+        return *m_stems.at(index);
+    }
+
+
+    void StemMixer::gain(int index, float gain, float seconds)
+    {
+        auto &s = stem(index);
+        s.gain.store(gain, std::memory_order_relaxed);
+        s.seconds.store(seconds, std::memory_order_relaxed);
+        s.serial.fetch_add(1, std::memory_order_release);
+    }
+
+
+    float StemMixer::gain(int index) const
+    {
+        return stem(index).gain.load(std::memory_order_relaxed);
+    }
+
+
+    void StemMixer::pan(int index, float left, float right, float seconds)
+    {
+        auto &s = stem(index);
+        s.left.store(left, std::memory_order_relaxed);
+        s.right.store(right, std::memory_order_relaxed);
+        s.seconds.store(seconds, std::memory_order_relaxed);
+        s.serial.fetch_add(1, std::memory_order_release);
+    }
+
+
+    float StemMixer::panLeft(int index) const
+    {
+        return stem(index).left.load(std::memory_order_relaxed);
+    }
+
+
+    float StemMixer::panRight(int index) const
+    {
+        return stem(index).right.load(std::memory_order_relaxed);
+    }
+
+
+    void StemMixer::paused(bool paused)
+    {
+        m_paused.store(paused, std::memory_order_relaxed);
+    }
+
+
+    bool StemMixer::paused() const
+    {
+        return m_paused.load(std::memory_order_relaxed);
+    }
+
+
+    void StemMixer::position(unsigned frame)
+    {
+        m_seek.store(frame, std::memory_order_release);
+    }
+
+
+    double StemMixer::position() const
+    {
+        return m_position.load(std::memory_order_acquire);
+    }
+
+
+    void StemMixer::loop(unsigned start, unsigned end)
+    {
+        if (start >= end || end > m_length)
+            throw std::invalid_argument("StemMixer: invalid loop points");
+
+        m_loopStart.store(start, std::memory_order_relaxed);
+        m_loopEnd.store(end, std::memory_order_relaxed);
+    }
+
+
+    void StemMixer::updateRamp(Stem &stem)
+    {
+        const auto serial = stem.serial.load(std::memory_order_acquire);
+        if (serial == stem.seen)
+            return;
+        stem.seen = serial;
+
+        const auto gain = stem.gain.load(std::memory_order_relaxed);
+        const auto left = stem.left.load(std::memory_order_relaxed);
+        const auto right = stem.right.load(std::memory_order_relaxed);
+        const auto seconds = stem.seconds.load(std::memory_order_relaxed);
+
+        if (stem.channels == 1)
+        {
+            stem.target[0][0] = gain * left;
+            stem.target[0][1] = gain * right;
+        }
+        else
+        {
+            stem.target[0][0] = gain * left;
+            stem.target[0][1] = gain * (1.f - left);
+            stem.target[1][0] = gain * (1.f - right);
+            stem.target[1][1] = gain * right;
+        }
+
+        stem.ramp = std::max(MinRampFrames,
+            (unsigned)std::max(seconds * (float)m_outputRate, 0.f));
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int o = 0; o < 2; ++o)
+            {
+                stem.step[c][o] = (stem.target[c][o] - stem.level[c][o]) /
+                    (float)stem.ramp;
+            }
+        }
+    }
+
+
+    void StemMixer::mixSegment(unsigned offset, unsigned frames,
+        unsigned end, unsigned wrap)
+    {
+        const auto step = (double)m_samplerate / m_outputRate;
+        const auto start = m_playhead;
+        const bool direct = step == 1.0 && start == std::floor(start);
+
+        if (!direct)
+        {
+            // Source positions are shared by every stem
+            for (unsigned i = 0; i < frames; ++i)
+            {
+                const auto pos = start + step * i;
+                const auto index = (unsigned)pos;
+                m_index[i] = index;
+                m_next[i] = (index + 1 < end) ? index + 1 : wrap;
+                m_frac[i] = (float)(pos - index);
+            }
+        }
+
+        auto left = m_acc[0].data() + offset;
+        auto right = m_acc[1].data() + offset;
+
+        for (auto &ptr : m_stems)
+        {
+            auto &stem = *ptr;
+
+            for (unsigned done = 0; done < frames;)
+            {
+                const auto run = stem.ramp ?
+                    std::min(frames - done, stem.ramp) : frames - done;
+
+                for (int c = 0; c < stem.channels; ++c)
+                {
+                    auto plane = stem.data.data() + (size_t)c * m_length;
+                    const float *src;
+                    if (direct)
+                    {
+                        src = plane + (size_t)start + done;
+                    }
+                    else
+                    {
+                        gather(m_gather.data(), plane, m_index.data() + done,
+                            m_next.data() + done, m_frac.data() + done, run);
+                        src = m_gather.data();
+                    }
+
+                    const auto ramping = stem.ramp != 0;
+                    mixPlane(left + done, right + done, src, run,
+                        stem.level[c][0], ramping ? stem.step[c][0] : 0,
+                        stem.level[c][1], ramping ? stem.step[c][1] : 0);
+                }
+
+                if (stem.ramp)
+                {
+                    stem.ramp -= run;
+                    for (int c = 0; c < 2; ++c)
+                    {
+                        for (int o = 0; o < 2; ++o)
+                        {
+                            stem.level[c][o] = stem.ramp ?
+                                stem.level[c][o] + stem.step[c][o] * run :
+                                stem.target[c][o];
+                        }
+                    }
+                }
+
+                done += run;
+            }
+        }
+
+        m_playhead = start + step * frames;
+        if (m_playhead >= end)
+            m_playhead = wrap + (m_playhead - end);
+    }
+
+
+    void StemMixer::process(float *out, unsigned frames, int channels)
+    {
+        const auto seek = m_seek.exchange(-1, std::memory_order_acquire);
+        if (seek >= 0 && m_length)
+            m_playhead = (double)std::min<long long>(seek, m_length - 1);
+
+        if (m_stems.empty() || m_maxFrames == 0 ||
+            m_paused.load(std::memory_order_relaxed))
+        {
+            m_position.store(m_playhead, std::memory_order_release);
+            return;
+        }
+
+        for (auto &stem : m_stems)
+            updateRamp(*stem);
+
+        auto loopStart = m_loopStart.load(std::memory_order_relaxed);
+        auto loopEnd = m_loopEnd.load(std::memory_order_relaxed);
+        if (loopStart >= loopEnd || loopEnd > m_length)
+        {
+            // Torn by a concurrent `loop`, the next block sees both points
+            loopStart = 0;
+            loopEnd = m_length;
+        }
+
+        const auto step = (double)m_samplerate / m_outputRate;
+
+        for (unsigned done = 0; done < frames;)
+        {
+            const auto block = std::min(frames - done, m_maxFrames);
+            std::fill_n(m_acc[0].data(), block, 0.f);
+            std::fill_n(m_acc[1].data(), block, 0.f);
+
+            for (unsigned mixed = 0; mixed < block;)
+            {
+                // A playhead past the loop plays on to the end of the stems
+                const auto end = (m_playhead < loopEnd) ? loopEnd : m_length;
+                const auto untilEnd = (unsigned)std::ceil(
+                    (end - m_playhead) / step);
+                const auto run = std::clamp(untilEnd, 1u, block - mixed);
+
+                mixSegment(mixed, run, end, loopStart);
+                mixed += run;
+            }
+
+            const auto left = m_acc[0].data(), right = m_acc[1].data();
+            auto dst = out + (size_t)done * channels;
+            if (channels == 1)
+            {
+                for (unsigned i = 0; i < block; ++i)
+                    dst[i] += .5f * (left[i] + right[i]);
+            }
+            else
+            {
+                for (unsigned i = 0; i < block; ++i)
+                {
+                    dst[(size_t)i * channels] += left[i];
+                    dst[(size_t)i * channels + 1] += right[i];
+                }
+            }
+
+            done += block;
+        }
+
+        m_position.store(m_playhead, std::memory_order_release);
+    }
+}
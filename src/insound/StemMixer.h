@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Forward declaration
+namespace FMOD
+{
+    class ChannelGroup;
+    class DSP;
+    class System;
+}
+
+namespace Insound
+{
+    /**
+     * Mixes a track's stems from decoded PCM in a single DSP, instead of one
+     * FMOD channel per stem and channel set. Each stem has a gain and a
+     * stereo pan, ramped per sample so changes don't click, and all stems
+     * share one playhead, so they can't drift apart.
+     *
+     * Stems are stored planar, one contiguous buffer per channel, and summed
+     * block by block into planar accumulators, so the inner loops are plain
+     * multiply-adds over contiguous memory that the compiler vectorizes.
+     *
+     * Playback controls may be called from the thread updating the engine
+     * while the mixer thread runs `process`; they take effect at the next
+     * mix block.
+     */
+    class StemMixer
+    {
+    public:
+        StemMixer();
+        ~StemMixer();
+
+        StemMixer(const StemMixer &) = delete;
+        StemMixer &operator=(const StemMixer &) = delete;
+
+        /**
+         * Set the output format of `process`. Called by `attach` with the
+         * system's format; call it directly to mix without FMOD.
+         *
+         * @param outputRate - sample rate of the output
+         * @param maxFrames  - largest block mixed at once, longer blocks are
+         *                     split
+         */
+        void prepare(int outputRate, unsigned maxFrames);
+
+        /**
+         * Mix into a group: the stems are added to whatever passes through
+         * its DSP chain, before its fader.
+         *
+         * @param group - bus to mix into, detaching from any previous one
+         */
+        void attach(FMOD::ChannelGroup *group);
+
+        /**
+         * Remove the mixer's DSP from its group, if attached
+         */
+        void detach();
+
+        /**
+         * Add a stem, copying its samples. All stems must have the same
+         * length and sample rate. Stems with more than two channels only
+         * mix their first two.
+         *
+         * @param samples    - interleaved sample data
+         * @param frames     - number of samples per channel
+         * @param channels   - number of interleaved channels
+         * @param samplerate - sample rate of the data
+         *
+         * @return index of the stem
+         *
+         * @throw std::invalid_argument if the format doesn't match the
+         *        other stems
+         */
+        int addStem(const float *samples, unsigned frames, int channels,
+            float samplerate);
+
+        /**
+         * Remove all stems and rewind
+         */
+        void clear();
+
+        [[nodiscard]]
+        int stemCount() const { return (int)m_stems.size(); }
+
+        /**
+         * Set the gain of a stem
+         *
+         * @param stem    - index of the stem
+         * @param gain    - linear gain, 1 by default
+         * @param seconds - time to ramp to it, at least `MinRampFrames`
+         */
+        void gain(int stem, float gain, float seconds = 0);
+        [[nodiscard]]
+        float gain(int stem) const;
+
+        /**
+         * Set the pan of a stem, in the same terms as `Channel::pan`: the
+         * level of each input side kept on its own side, the rest going to
+         * the other one. Mono stems play on both sides, scaled by `left`
+         * and `right`.
+         *
+         * @param stem    - index of the stem
+         * @param left    - 1 by default
+         * @param right   - 1 by default
+         * @param seconds - time to ramp to it, at least `MinRampFrames`
+         */
+        void pan(int stem, float left, float right, float seconds = 0);
+        [[nodiscard]]
+        float panLeft(int stem) const;
+        [[nodiscard]]
+        float panRight(int stem) const;
+
+        /**
+         * Set the paused status, stems resume where they left off
+         */
+        void paused(bool paused);
+        [[nodiscard]]
+        bool paused() const;
+
+        /**
+         * Seek all stems, at the next mix block
+         *
+         * @param frame - position in samples of the stems
+         */
+        void position(unsigned frame);
+
+        /**
+         * Get the playhead as of the last mix block, in samples of the stems
+         */
+        [[nodiscard]]
+        double position() const;
+
+        /**
+         * Set the loop region, where the playhead wraps from `end` to
+         * `start`. The whole length by default.
+         *
+         * @param start - first sample of the loop
+         * @param end   - sample after the last one of the loop
+         */
+        void loop(unsigned start, unsigned end);
+
+        /**
+         * Length of the stems in samples, 0 without stems
+         */
+        [[nodiscard]]
+        unsigned length() const { return m_length; }
+
+        /**
+         * Add one block of the mix to interleaved output. Runs on the mixer
+         * thread when attached.
+         *
+         * @param out      - interleaved buffer to add to
+         * @param frames   - samples per channel to mix
+         * @param channels - channels of `out`; stems mix into the first two,
+         *                   or are folded down for mono
+         */
+        void process(float *out, unsigned frames, int channels);
+
+        /**
+         * Shortest ramp of gain and pan changes, in output samples
+         */
+        static constexpr unsigned MinRampFrames = 256;
+
+    private:
+        struct Stem
+        {
+            // Planar samples, channel `c` starts at `c * length`
+            std::vector<float> data;
+            int channels;
+
+            // Requested by the control thread, applied once `serial` changes
+            std::atomic<float> gain;
+            std::atomic<float> left;
+            std::atomic<float> right;
+            std::atomic<float> seconds;
+            std::atomic<unsigned> serial;
+
+            // Mixer thread state: current level of each input side (0: left,
+            // 1: right) on each output side, its step per sample, and the
+            // samples left to ramp
+            unsigned seen;
+            float level[2][2];
+            float target[2][2];
+            float step[2][2];
+            unsigned ramp;
+        };
+
+        /**
+         * Apply a stem's latest parameters to its ramp
+         */
+        void updateRamp(Stem &stem);
+
+        /**
+         * Mix a run of output samples into the accumulators, from the
+         * playhead up to at most the loop end
+         *
+         * @param offset - first output sample in the accumulators
+         * @param frames - number of output samples
+         * @param end    - sample the playhead wraps at
+         * @param wrap   - sample the playhead wraps to
+         */
+        void mixSegment(unsigned offset, unsigned frames, unsigned end,
+            unsigned wrap);
+
+        /**
+         * Run `fn` with the mixer thread locked out, if attached
+         */
+        template <typename Fn>
+        void locked(Fn &&fn);
+
+        Stem &stem(int index) const;
+
+        std::vector<std::unique_ptr<Stem>> m_stems;
+        unsigned m_length;
+        float m_samplerate;
+
+        int m_outputRate;
+        unsigned m_maxFrames;
+        // Planar output accumulators
+        std::vector<float> m_acc[2];
+        // When resampling: the two source samples and the fraction between
+        // them of each output sample, shared by all stems, and one channel
+        // of a stem interpolated with them
+        std::vector<unsigned> m_index;
+        std::vector<unsigned> m_next;
+        std::vector<float> m_frac;
+        std::vector<float> m_gather;
+
+        // Playhead, owned by the mixer thread and published after each block
+        double m_playhead;
+        std::atomic<double> m_position;
+        // Seek requested by the control thread, -1 if none
+        std::atomic<long long> m_seek;
+        std::atomic<bool> m_paused;
+        std::atomic<unsigned> m_loopStart;
+        std::atomic<unsigned> m_loopEnd;
+
+        FMOD::System *m_sys;
+        FMOD::ChannelGroup *m_group;
+        FMOD::DSP *m_dsp;
+    };
+}
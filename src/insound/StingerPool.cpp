@@ -0,0 +1,274 @@
+#include "StingerPool.h"
+#include "common.h"
+
+#include <insound/MemoryBudget.h>
+#include <insound/errors/MemoryBudgetExceeded.h>
+
+#include <fmod.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Insound
+{
+    // Length of the fade applied when a voice is cut off, in seconds
+    static const float ReleaseSeconds = .005f;
+
+    StingerPool::StingerPool(FMOD::System *sys, FMOD::ChannelGroup *group,
+        int maxVoices) :
+            m_sys(sys), m_group(group), m_samples(), m_voices(),
+            m_releaseLength()
+    {
+        int rate;
+        checkResult( sys->getSoftwareFormat(&rate, nullptr, nullptr) );
+        m_releaseLength = (unsigned)(ReleaseSeconds * rate);
+
+        this->maxVoices(maxVoices);
+    }
+
+
+    StingerPool::~StingerPool()
+    {
+        clear();
+    }
+
+
+    int StingerPool::load(const std::string &name, const char *data,
+        size_t bytelength)
+    {
+        if (!MemoryBudget::reserve(MemoryCategory::PCM, bytelength))
+        {
+            const auto stats = MemoryBudget::stats();
+            throw MemoryBudgetExceeded(stats.budget, stats.live,
+                MemoryBudget::takeFailure(MemoryCategory::PCM));
+        }
+
+        std::vector<char> source;
+        FMOD::Sound *sound;
+        try {
+            source.assign(data, data + bytelength);
+            sound = decode(source.data(), source.size());
+        }
+        catch(...)
+        {
+            MemoryBudget::release(MemoryCategory::PCM, bytelength);
+            throw;
+        }
+
+        auto index = find(name);
+        if (index != -1)
+        {
+            auto &sample = m_samples[index];
+
+            // releasing the sound also stops any of its voices
+            sample.sound->release();
+            MemoryBudget::release(MemoryCategory::PCM, sample.source.size());
+
+            sample.sound = sound;
+            sample.source = std::move(source);
+            return index;
+        }
+
+        m_samples.emplace_back(Sample{
+            .name=name,
+            .sound=sound,
+            .source=std::move(source),
+        });
+        return (int)m_samples.size() - 1;
+    }
+
+
+    void StingerPool::loadFrom(const StingerPool &other)
+    {
+        for (const auto &sample : other.m_samples)
+            load(sample.name, sample.source.data(), sample.source.size());
+    }
+
+
+    FMOD::Sound *StingerPool::decode(const char *data, size_t bytelength)
+    {
+        auto exinfo{FMOD_CREATESOUNDEXINFO()};
+        std::memset(&exinfo, 0, sizeof(FMOD_CREATESOUNDEXINFO));
+        exinfo.cbsize = sizeof(FMOD_CREATESOUNDEXINFO);
+        exinfo.length = bytelength;
+
+        // Decode fully up front, so nothing is decoded on the trigger path
+        FMOD::Sound *sound;
+        checkResult( m_sys->createSound(data,
+            FMOD_OPENMEMORY | FMOD_CREATESAMPLE | FMOD_LOOP_OFF |
+            FMOD_ACCURATETIME,
+            &exinfo, &sound) );
+
+        return sound;
+    }
+
+
+    void StingerPool::clear()
+    {
+        for (auto &voice : m_voices)
+        {
+            if (isActive(voice))
+                voice.channel->stop();
+            voice.channel = nullptr;
+        }
+
+        for (auto &sample : m_samples)
+        {
+            sample.sound->release();
+            MemoryBudget::release(MemoryCategory::PCM, sample.source.size());
+        }
+        m_samples.clear();
+    }
+
+
+    int StingerPool::find(std::string_view name) const
+    {
+        for (int i = 0, size = (int)m_samples.size(); i < size; ++i)
+        {
+            if (m_samples[i].name == name)
+                return i;
+        }
+
+        return -1;
+    }
+
+
+    int StingerPool::play(int sample, unsigned long long clock, int priority,
+        float volume)
+    {
+        if (sample < 0 || sample >= (int)m_samples.size())
+            throw std::out_of_range("StingerPool: sample index out of range");
+
+        const auto index = acquire(priority);
+        if (index == -1)
+            return -1;
+
+        FMOD::Channel *channel;
+        checkResult( m_sys->playSound(m_samples[sample].sound, m_group, true,
+            &channel) );
+
+        unsigned long long now;
+        checkResult( m_group->getDSPClock(&now, nullptr) );
+        if (clock > now)
+            checkResult( channel->setDelay(clock, 0, false) );
+        else
+            clock = now;
+
+        checkResult( channel->setVolume(volume) );
+        checkResult( channel->setReverbProperties(0, 0) );
+        checkResult( channel->setPaused(false) );
+
+        m_voices[index] = Voice{
+            .channel=channel,
+            .priority=priority,
+            .clock=clock,
+        };
+
+        return index;
+    }
+
+
+    void StingerPool::stop(int voice)
+    {
+        if (voice < 0 || voice >= (int)m_voices.size())
+            return;
+
+        release(m_voices[voice]);
+    }
+
+
+    void StingerPool::stopAll()
+    {
+        for (auto &voice : m_voices)
+            release(voice);
+    }
+
+
+    void StingerPool::maxVoices(int max)
+    {
+        if (max < 1)
+            throw std::invalid_argument("StingerPool: max voices must be at "
+                "least 1");
+
+        for (int i = max, size = (int)m_voices.size(); i < size; ++i)
+            release(m_voices[i]);
+
+        m_voices.resize(max, Voice{.channel=nullptr, .priority=0, .clock=0});
+    }
+
+
+    int StingerPool::activeVoices() const
+    {
+        int count = 0;
+        for (const auto &voice : m_voices)
+        {
+            if (isActive(voice))
+                ++count;
+        }
+
+        return count;
+    }
+
+
+    bool StingerPool::isActive(const Voice &voice)
+    {
+        if (!voice.channel) return false;
+
+        // Finished voices have their handle invalidated by FMOD
+        bool playing;
+        return voice.channel->isPlaying(&playing) == FMOD_OK && playing;
+    }
+
+
+    int StingerPool::acquire(int priority)
+    {
+        int victim = -1;
+        for (int i = 0, size = (int)m_voices.size(); i < size; ++i)
+        {
+            const auto &voice = m_voices[i];
+            if (!isActive(voice))
+                return i;
+
+            if (victim == -1 ||
+                voice.priority < m_voices[victim].priority ||
+                (voice.priority == m_voices[victim].priority &&
+                    voice.clock < m_voices[victim].clock))
+            {
+                victim = i;
+            }
+        }
+
+        if (victim == -1 || m_voices[victim].priority > priority)
+            return -1;
+
+        release(m_voices[victim]);
+        return victim;
+    }
+
+
+    void StingerPool::release(Voice &voice)
+    {
+        if (isActive(voice))
+        {
+            unsigned long long now;
+            checkResult( m_group->getDSPClock(&now, nullptr) );
+
+            if (voice.clock >= now)
+            {
+                // hasn't started yet, nothing to declick
+                checkResult( voice.channel->stop() );
+            }
+            else
+            {
+                // fade out, then let FMOD stop it at the end of the ramp
+                const auto end = now + m_releaseLength;
+                checkResult( voice.channel->addFadePoint(now, 1.f) );
+                checkResult( voice.channel->addFadePoint(end, 0) );
+                checkResult( voice.channel->setDelay(0, end, true) );
+            }
+        }
+
+        voice.channel = nullptr;
+    }
+}
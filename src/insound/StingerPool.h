@@ -0,0 +1,160 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Forward declaration
+namespace FMOD
+{
+    class Channel;
+    class ChannelGroup;
+    class Sound;
+    class System;
+}
+
+namespace Insound
+{
+    /**
+     * Pool of preloaded one-shot samples played on top of a track's stems,
+     * limited to a fixed number of voices.
+     *
+     * Samples are fully decoded on load, and voice slots are allocated up
+     * front, so triggering a stinger creates no sounds and allocates no
+     * memory. The encoded source of each sample is kept, counted as
+     * `MemoryCategory::PCM`, so it can be decoded again on another system. When all voices are busy, the lowest priority voice is stolen,
+     * the oldest one first among equals.
+     */
+    class StingerPool
+    {
+    public:
+        /**
+         * @param sys       - system to create sounds and play them with
+         * @param group     - bus that voices output to, its DSP clock is the
+         *                    one that `play` schedules against
+         * @param maxVoices - maximum number of voices playing at once
+         */
+        StingerPool(FMOD::System *sys, FMOD::ChannelGroup *group,
+            int maxVoices = 8);
+        ~StingerPool();
+
+        StingerPool(const StingerPool &) = delete;
+        StingerPool &operator=(const StingerPool &) = delete;
+
+        /**
+         * Decode a sample from memory into the pool, replacing any sample
+         * with the same name.
+         *
+         * @param name       - unique name to trigger the sample by
+         * @param data       - pointer to the encoded audio file
+         * @param bytelength - byte size of the data
+         *
+         * @return index of the sample
+         */
+        int load(const std::string &name, const char *data,
+            size_t bytelength);
+
+        /**
+         * Load every sample of another pool, e.g. of the same track on the
+         * system it is moving from. Its voices are not carried over.
+         */
+        void loadFrom(const StingerPool &other);
+
+        /**
+         * Stop all voices and release all samples
+         */
+        void clear();
+
+        /**
+         * Get the index of a sample by name, or -1 if it does not exist
+         */
+        [[nodiscard]]
+        int find(std::string_view name) const;
+
+        [[nodiscard]]
+        int sampleCount() const { return (int)m_samples.size(); }
+
+        /**
+         * Play a sample
+         *
+         * @param sample   - index of the sample to play
+         * @param clock    - DSP clock of the output bus to start at, 0 to start
+         *                   right away
+         * @param priority - higher priority voices steal from lower ones
+         * @param volume   - voice volume
+         *
+         * @return index of the voice slot playing the sample, or -1 if every
+         *         voice was busy with a higher priority sample
+         */
+        int play(int sample, unsigned long long clock = 0, int priority = 0,
+            float volume = 1.f);
+
+        /**
+         * Stop a voice with a short fade out, does nothing if it is not
+         * playing
+         */
+        void stop(int voice);
+
+        /**
+         * Stop all voices with a short fade out
+         */
+        void stopAll();
+
+        /**
+         * Set the maximum number of voices. Voices past the new limit are
+         * stopped.
+         */
+        void maxVoices(int max);
+        [[nodiscard]]
+        int maxVoices() const { return (int)m_voices.size(); }
+
+        /**
+         * Get the number of voices currently playing or scheduled to play
+         */
+        [[nodiscard]]
+        int activeVoices() const;
+
+    private:
+        struct Sample
+        {
+            std::string name;
+            FMOD::Sound *sound;
+            // Encoded audio file the sound was decoded from
+            std::vector<char> source;
+        };
+
+        /**
+         * Decode an encoded audio file into a sound
+         */
+        [[nodiscard]]
+        FMOD::Sound *decode(const char *data, size_t bytelength);
+
+        struct Voice
+        {
+            FMOD::Channel *channel;
+            int priority;
+            /** DSP clock the voice started, or is scheduled to start at */
+            unsigned long long clock;
+        };
+
+        /**
+         * Check if a voice is still playing or scheduled
+         */
+        static bool isActive(const Voice &voice);
+
+        /**
+         * Choose the slot for a new voice, or -1 if none may be used
+         */
+        int acquire(int priority);
+
+        void release(Voice &voice);
+
+        FMOD::System *m_sys;
+        FMOD::ChannelGroup *m_group;
+        std::vector<Sample> m_samples;
+        std::vector<Voice> m_voices;
+
+        // Length of the declicking fade when a voice is cut off, in DSP clocks
+        unsigned m_releaseLength;
+    };
+}
@@ -3,18 +3,50 @@
 #include "fmod_common.h"
 #include <fmod.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+
 namespace Insound
 {
-    SyncPointMgr::SyncPointMgr() : m_sound(), m_points() { }
+    /**
+     * Key of a label in the label index
+     */
+    static std::string lowercase(std::string_view label)
+    {
+        std::string result(label);
+        for (auto &c : result)
+            c = (char)std::tolower((unsigned char)c);
+        return result;
+    }
+
+    /**
+     * Compare labels the way the label index does, ignoring case
+     */
+    static bool sameLabel(std::string_view a, std::string_view b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+            [](char x, char y) {
+                return std::tolower((unsigned char)x) ==
+                    std::tolower((unsigned char)y);
+            });
+    }
+
+    SyncPointMgr::SyncPointMgr() : m_points(), m_offsets(), m_labels(),
+        m_samplerate(), m_sound() { }
 
     SyncPointMgr::SyncPointMgr(FMOD::Sound *sound)
-        : m_sound(), m_points()
+        : m_points(), m_offsets(), m_labels(), m_samplerate(), m_sound()
     {
         load(sound);
     }
 
     void SyncPointMgr::load(FMOD::Sound *sound)
     {
+        float samplerate;
+        checkResult( sound->getDefaults(&samplerate, nullptr) );
+
         int numSyncPoints;
         checkResult( sound->getNumSyncPoints(&numSyncPoints) );
 
@@ -26,19 +58,31 @@ namespace Insound
             FMOD_SYNCPOINT *fPoint;
             checkResult( sound->getSyncPoint(i, &fPoint) );
             char buffer[256];
+            unsigned int offset;
             checkResult( sound->getSyncPointInfo(fPoint, buffer, 255,
-                nullptr, 0));
-            points.emplace_back(buffer, fPoint);
+                &offset, FMOD_TIMEUNIT_PCM));
+            points.emplace_back(buffer, fPoint, offset);
         }
 
+        // Sort once here, so bulk loads don't pay for sorted inserts
+        std::stable_sort(points.begin(), points.end(),
+            [](const SyncPoint &a, const SyncPoint &b) {
+                return a.offset() < b.offset();
+            });
+
         m_points.swap(points);
         m_sound = sound;
+        m_samplerate = samplerate;
+        reindex();
     }
 
     void SyncPointMgr::clear()
     {
         m_sound = nullptr;
         m_points.clear();
+        m_offsets.clear();
+        m_labels.clear();
+        m_samplerate = 0;
     }
 
     const std::string &SyncPointMgr::getLabel(size_t i) const
@@ -48,25 +92,17 @@ namespace Insound
 
     unsigned int SyncPointMgr::getOffsetPCM(size_t i) const
     {
-        unsigned int offset;
-        checkResult( m_sound->getSyncPointInfo(m_points.at(i).point(),
-            nullptr, 0, &offset, FMOD_TIMEUNIT_PCM));
-        return offset;
+        return m_points.at(i).offset();
     }
 
     std::optional<unsigned int>
     SyncPointMgr::getOffsetPCM(std::string_view label) const
     {
-        size_t index = 0;
-        for (auto &point : m_points)
-        {
-            if (compareCaseInsensitive(point.label(), label))
-                return getOffsetPCM(index);
-
-            ++index;
-        }
+        const auto index = findIndex(label);
+        if (index == -1)
+            return {};
 
-        return {};
+        return getOffsetPCM(index);
     }
 
     double SyncPointMgr::getOffsetMS(size_t i) const
@@ -77,18 +113,11 @@ namespace Insound
     std::optional<double>
     SyncPointMgr::getOffsetMS(std::string_view label) const
     {
-        // find index of point with label
-        size_t index = 0;
-        for (auto &point : m_points)
-        {
-            if (point.label() == label)
-                return getOffsetMS(index);
+        const auto index = findIndex(label);
+        if (index == -1)
+            return {};
 
-            ++index;
-        }
-
-        // label could not be found
-        return {};
+        return getOffsetMS(index);
     }
 
     double SyncPointMgr::getOffsetSeconds(size_t i) const
@@ -99,16 +128,11 @@ namespace Insound
     std::optional<double>
     SyncPointMgr::getOffsetSeconds(std::string_view label) const
     {
-        size_t index = 0;
-        for (auto &point : m_points)
-        {
-            if (point.label() == label)
-                return getOffsetSeconds(index);
-
-            ++index;
-        }
+        const auto index = findIndex(label);
+        if (index == -1)
+            return {};
 
-        return {};
+        return getOffsetSeconds(index);
     }
 
     size_t SyncPointMgr::size() const
@@ -121,80 +145,200 @@ namespace Insound
         return m_points.empty();
     }
 
-    int SyncPointMgr::findIndex(std::string_view label)
+    int SyncPointMgr::findIndex(std::string_view label) const
     {
-        int i = 0;
-        for (auto &point : m_points)
-        {
-            if (point.label() == label)
-            {
-                return i;
-            }
+        auto it = m_labels.find(lowercase(label));
+        return it == m_labels.end() ? -1 : (int)it->second;
+    }
 
-            ++i;
-        }
+    size_t SyncPointMgr::lowerBound(unsigned int pcm) const
+    {
+        return std::lower_bound(m_offsets.begin(), m_offsets.end(), pcm) -
+            m_offsets.begin();
+    }
 
-        return -1;
+    int SyncPointMgr::nextAfter(unsigned int pcm) const
+    {
+        auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), pcm);
+        return it == m_offsets.end() ? -1 : (int)(it - m_offsets.begin());
     }
 
-    void SyncPointMgr::replace(size_t i, std::string_view label, unsigned offset, int fmodTimeUnit)
+    std::pair<size_t, size_t> SyncPointMgr::inRange(unsigned int start,
+        unsigned int end) const
     {
-        checkResult(m_sound->deleteSyncPoint(m_points[i].point()));
-        m_points.erase(m_points.begin() + i);
+        const auto first = lowerBound(start);
+        return {first, std::max(first, lowerBound(end))};
+    }
 
+    void SyncPointMgr::replace(size_t i, std::string_view label, unsigned offset, int fmodTimeUnit)
+    {
+        deleteSyncPoint(i);
         emplace(label, offset, fmodTimeUnit);
     }
 
     void SyncPointMgr::deleteSyncPoint(size_t i)
     {
         checkResult(m_sound->deleteSyncPoint(m_points.at(i).point()));
+
+        const auto removed = std::move(m_points[i]);
         m_points.erase(m_points.begin() + i);
+        indexErase(i, removed.label());
     }
 
     SyncPoint &SyncPointMgr::emplace(std::string_view label,
         unsigned int offset, int unit)
     {
-        FMOD_SYNCPOINT *point = nullptr;
-        for (size_t i = 0, size=m_points.size(); i < size; ++i)
+        const auto pcm = toPCM(offset, unit);
+
+        // Don't add duplicates, just return the point found
+        // This functionality covers case where user adds multiple sounds
+        // with the same syncpoint marker info
+        const auto [first, last] = inRange(pcm, pcm + 1);
+        for (auto i = first; i < last; ++i)
         {
-            unsigned int checkOffset;
-            checkResult(m_sound->getSyncPointInfo(m_points[i].point(), nullptr,
-                0, &checkOffset, unit));
-
-            // Don't add duplicates, just return the point found
-            // This functionality covers case where user adds multiple sounds
-            // with the same syncpoint marker info
-            if (checkOffset == offset && m_points[i].label() == label)
+            if (sameLabel(m_points[i].label(), label))
                 return m_points[i];
+        }
 
-            if (checkOffset > offset)
+        FMOD_SYNCPOINT *point = nullptr;
+        checkResult(m_sound->addSyncPoint(pcm, FMOD_TIMEUNIT_PCM,
+            std::string(label).c_str(), &point));
+
+        // insert after points at the same offset
+        auto it = m_points.insert(m_points.begin() + last,
+            SyncPoint{label, point, pcm});
+        indexInsert(last);
+        return *it;
+    }
+
+    void SyncPointMgr::assign(const std::vector<std::string> &labels,
+        const std::vector<unsigned int> &offsets)
+    {
+        if (labels.size() != offsets.size())
+            throw std::invalid_argument("SyncPointMgr::assign: labels and "
+                "offsets differ in length");
+
+        for (auto &point : m_points)
+            checkResult(m_sound->deleteSyncPoint(point.point()));
+        m_points.clear();
+
+        std::vector<SyncPoint> points;
+        points.reserve(labels.size());
+        try {
+            for (size_t i = 0, size = labels.size(); i < size; ++i)
             {
-                checkResult(m_sound->addSyncPoint(offset, unit, label.data(),
-                    &point));
-                return *m_points.insert(m_points.begin() + i,
-                    SyncPoint{label, point});
+                FMOD_SYNCPOINT *point = nullptr;
+                checkResult(m_sound->addSyncPoint(offsets[i],
+                    FMOD_TIMEUNIT_PCM, labels[i].c_str(), &point));
+                points.emplace_back(labels[i], point, offsets[i]);
             }
         }
+        catch(...)
+        {
+            // keep in sync with whatever made it into the sound
+            load(m_sound);
+            throw;
+        }
 
-        checkResult(m_sound->addSyncPoint(offset, unit, label.data(), &point));
-        return m_points.emplace_back(label, point);
+        std::stable_sort(points.begin(), points.end(),
+            [](const SyncPoint &a, const SyncPoint &b) {
+                return a.offset() < b.offset();
+            });
+
+        m_points.swap(points);
+        reindex();
     }
 
     void SyncPointMgr::swap(SyncPointMgr &other)
     {
         m_points.swap(other.m_points);
+        m_offsets.swap(other.m_offsets);
+        m_labels.swap(other.m_labels);
 
         // swap sound objects
         auto tempSound = other.m_sound;
         other.m_sound = m_sound;
         m_sound = tempSound;
+
+        std::swap(m_samplerate, other.m_samplerate);
     }
 
     float SyncPointMgr::getSampleRate() const
     {
-        float samplerate;
-        checkResult(m_sound->getDefaults(&samplerate, nullptr));
+        return m_samplerate;
+    }
+
+    unsigned int SyncPointMgr::toPCM(unsigned int offset, int unit) const
+    {
+        switch(unit)
+        {
+        case FMOD_TIMEUNIT_PCM:
+            return offset;
+        case FMOD_TIMEUNIT_MS:
+            return (unsigned int)(offset * .001 * m_samplerate);
+        default:
+            throw std::runtime_error("SyncPointMgr: unsupported time unit, "
+                "please use FMOD_TIMEUNIT_PCM or FMOD_TIMEUNIT_MS");
+        }
+    }
+
+    void SyncPointMgr::reindex()
+    {
+        m_offsets.clear();
+        m_labels.clear();
+        m_offsets.reserve(m_points.size());
+        m_labels.reserve(m_points.size());
+
+        // emplace keeps the first, earliest, index of repeated labels
+        for (size_t i = 0, size = m_points.size(); i < size; ++i)
+        {
+            m_offsets.emplace_back(m_points[i].offset());
+            m_labels.emplace(lowercase(m_points[i].label()), i);
+        }
+    }
+
+    void SyncPointMgr::indexInsert(size_t i)
+    {
+        const auto &point = m_points[i];
+        m_offsets.insert(m_offsets.begin() + i, point.offset());
+
+        for (auto &[label, index] : m_labels)
+        {
+            if (index >= i)
+                ++index;
+        }
+
+        auto [it, inserted] = m_labels.emplace(lowercase(point.label()), i);
+        if (!inserted && it->second > i)
+            it->second = i;
+    }
+
+    void SyncPointMgr::indexErase(size_t i, std::string_view removed)
+    {
+        m_offsets.erase(m_offsets.begin() + i);
+
+        for (auto &[label, index] : m_labels)
+        {
+            if (index > i)
+                --index;
+        }
+
+        auto it = m_labels.find(lowercase(removed));
+        if (it == m_labels.end() || it->second != i)
+            return;
+
+        // the earliest point of the label was removed, fall back to the
+        // next point with the same label, if any
+        auto next = i;
+        while (next < m_points.size() &&
+            !sameLabel(m_points[next].label(), removed))
+        {
+            ++next;
+        }
 
-        return samplerate;
+        if (next < m_points.size())
+            it->second = next;
+        else
+            m_labels.erase(it);
     }
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <optional>
-#include <map>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 struct FMOD_SYNCPOINT;
@@ -20,16 +22,25 @@ namespace Insound
     struct SyncPoint
     {
     public:
-        SyncPoint(std::string_view label, FMOD_SYNCPOINT *point) :
-            m_label(label), m_point(point) { }
+        SyncPoint(std::string_view label, FMOD_SYNCPOINT *point,
+            unsigned int offset) :
+            m_label(label), m_point(point), m_offset(offset) { }
 
         const std::string &label() const { return m_label; }
         FMOD_SYNCPOINT *point() const { return m_point; }
+
+        /** Cached offset in PCM samples */
+        unsigned int offset() const { return m_offset; }
     private:
         std::string m_label;
         FMOD_SYNCPOINT *m_point;
+        unsigned int m_offset;
     };
 
+    /**
+     * Sync points of a sound, kept sorted by offset. Offsets are cached, and
+     * labels are indexed case-insensitively, so lookups don't query FMOD.
+     */
     class SyncPointMgr
     {
     public:
@@ -73,11 +84,46 @@ namespace Insound
         void deleteSyncPoint(size_t i);
 
         /**
-         * Find index of a sync point with the provided label
+         * Find index of a sync point with the provided label, ignoring case.
+         * If several points share the label, the earliest one is found.
          * @param  label - label of syncpoint to find the index of
          * @return       index of label or -1 if not found
          */
-        int findIndex(std::string_view label);
+        [[nodiscard]]
+        int findIndex(std::string_view label) const;
+
+        /**
+         * Index of the first sync point at or after an offset
+         * @param  pcm - offset in PCM samples
+         * @return       index of the point, or `size()` if there is none
+         */
+        [[nodiscard]]
+        size_t lowerBound(unsigned int pcm) const;
+
+        /**
+         * Index of the first sync point strictly after an offset
+         * @param  pcm - offset in PCM samples
+         * @return       index of the point, or -1 if there is none
+         */
+        [[nodiscard]]
+        int nextAfter(unsigned int pcm) const;
+
+        /**
+         * Get the range of sync points with offsets in [start, end)
+         * @param  start - first offset in PCM samples, inclusive
+         * @param  end   - last offset in PCM samples, exclusive
+         * @return       pair of first index and one past the last index,
+         *               equal if no points are in range
+         */
+        [[nodiscard]]
+        std::pair<size_t, size_t> inRange(unsigned int start,
+            unsigned int end) const;
+
+        /**
+         * Offsets of all sync points in PCM samples, in sorted order
+         */
+        [[nodiscard]]
+        const std::vector<unsigned int> &offsets() const { return m_offsets; }
 
         /**
          * Emplace a new sync point to the manager
@@ -89,14 +135,57 @@ namespace Insound
         SyncPoint &emplace(std::string_view label, unsigned int offset,
             int fmodTimeUnit);
 
+        /**
+         * Replace all sync points at once, sorting and indexing them in a
+         * single pass. Unlike `emplace`, duplicates are kept, so indices
+         * correspond to the sorted input.
+         * @param labels  label of each point
+         * @param offsets offset of each point in PCM samples, same length as
+         *                `labels`
+         */
+        void assign(const std::vector<std::string> &labels,
+            const std::vector<unsigned int> &offsets);
+
         void swap(SyncPointMgr &other);
     private:
         [[nodiscard]]
         float getSampleRate() const;
 
-        // Sync point data
+        /**
+         * Convert an offset in an FMOD_TIMEUNIT to PCM samples
+         */
+        [[nodiscard]]
+        unsigned int toPCM(unsigned int offset, int fmodTimeUnit) const;
+
+        /**
+         * Rebuild the offset and label indices after all points changed
+         */
+        void reindex();
+
+        /**
+         * Update the indices after a point was inserted at index `i`
+         */
+        void indexInsert(size_t i);
+
+        /**
+         * Update the indices after the point at index `i` was removed
+         *
+         * @param removed - label of the removed point
+         */
+        void indexErase(size_t i, std::string_view removed);
+
+        // Sync point data, sorted by offset
         std::vector<SyncPoint> m_points;
 
+        // Offset of each point, for searches without touching labels
+        std::vector<unsigned int> m_offsets;
+
+        // Lowercase label -> index of its earliest point
+        std::unordered_map<std::string, size_t> m_labels;
+
+        // Sample rate of the sound, cached on load
+        float m_samplerate;
+
         // Sound to check points off of, not owned by this SyncPointManager.
         FMOD::Sound *m_sound;
     };
@@ -0,0 +1,100 @@
+#include "TempoMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Insound
+{
+    static const TempoPoint DefaultTempo{
+        .position=0,
+        .bpm=100.0,
+        .numerator=4,
+        .denominator=4,
+    };
+
+    // Tolerance for positions that land on a boundary via rounding errors
+    static const double Epsilon = 1e-9;
+
+    void TempoMap::add(double position, double bpm, int numerator,
+        int denominator)
+    {
+        if (bpm <= 0)
+            throw std::invalid_argument("TempoMap: bpm must be greater than 0");
+        if (numerator <= 0 || denominator <= 0)
+            throw std::invalid_argument("TempoMap: time signature values "
+                "must be greater than 0");
+        if (position < 0)
+            position = 0;
+
+        const TempoPoint point{
+            .position=position,
+            .bpm=bpm,
+            .numerator=numerator,
+            .denominator=denominator,
+        };
+
+        auto it = std::lower_bound(m_points.begin(), m_points.end(), position,
+            [](const TempoPoint &p, double pos) { return p.position < pos; });
+
+        if (it != m_points.end() && it->position == position)
+            *it = point;
+        else
+            m_points.insert(it, point);
+    }
+
+    int TempoMap::indexAt(double position) const
+    {
+        auto it = std::upper_bound(m_points.begin(), m_points.end(), position,
+            [](double pos, const TempoPoint &p) { return pos < p.position; });
+
+        return (int)(it - m_points.begin()) - 1;
+    }
+
+    TempoPoint TempoMap::at(double position) const
+    {
+        const auto index = indexAt(position);
+        if (index < 0)
+        {
+            // Before the first point, the default tempo extends backward
+            // from the start of the track
+            return DefaultTempo;
+        }
+
+        return m_points[index];
+    }
+
+    double TempoMap::beatLength(double position) const
+    {
+        const auto point = at(position);
+        return 60.0 / point.bpm * 4.0 / point.denominator;
+    }
+
+    double TempoMap::nextBoundary(double position, Quantize quantize) const
+    {
+        if (quantize != Quantize::Beat && quantize != Quantize::Bar)
+            return position;
+
+        const auto index = indexAt(position);
+        const auto &point = (index < 0) ? DefaultTempo : m_points[index];
+
+        auto unit = 60.0 / point.bpm * 4.0 / point.denominator;
+        if (quantize == Quantize::Bar)
+            unit *= point.numerator;
+
+        const auto beats = std::ceil((position - point.position) / unit -
+            Epsilon);
+        auto boundary = point.position + beats * unit;
+
+        // A tempo change always starts a new measure, so it is the boundary
+        // if it arrives first
+        const auto nextIndex = index + 1;
+        if (nextIndex < (int)m_points.size() &&
+            m_points[nextIndex].position < boundary)
+        {
+            boundary = m_points[nextIndex].position;
+        }
+
+        return std::max(boundary, position);
+    }
+}
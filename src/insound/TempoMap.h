@@ -0,0 +1,91 @@
+#pragma once
+
+#include <insound/Quantize.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * A tempo and meter change within a track
+     */
+    struct TempoPoint
+    {
+        /** Track position in seconds, always heard as a downbeat */
+        double position;
+        /** Tempo in quarter notes per minute */
+        double bpm;
+        /** Time signature top number: beats per measure */
+        int numerator;
+        /** Time signature bottom number: note value of one beat */
+        int denominator;
+    };
+
+    /**
+     * Tempo/meter map of a track, used to find musical boundaries to
+     * schedule transitions at. Each tempo point starts a new measure.
+     * An empty map behaves as 100 bpm in 4/4 from the start of the track.
+     */
+    class TempoMap
+    {
+    public:
+        TempoMap() : m_points() { }
+
+        /**
+         * Add a tempo point, keeping points sorted by position. A point at
+         * the same position as an existing one replaces it.
+         *
+         * @param position    - track position in seconds
+         * @param bpm         - quarter notes per minute, must be > 0
+         * @param numerator   - beats per measure, must be > 0
+         * @param denominator - note value of each beat, must be > 0
+         */
+        void add(double position, double bpm, int numerator = 4,
+            int denominator = 4);
+
+        /**
+         * Get the position of the next boundary at or after a position.
+         *
+         * @param  position - track position in seconds
+         * @param  quantize - `Quantize::Beat` or `Quantize::Bar`, any other
+         *                    value returns `position` unchanged.
+         * @return position of the boundary in seconds
+         */
+        [[nodiscard]]
+        double nextBoundary(double position, Quantize quantize) const;
+
+        /**
+         * Get the tempo point in effect at a position
+         */
+        [[nodiscard]]
+        TempoPoint at(double position) const;
+
+        /**
+         * Get the length of one beat in seconds at a position
+         */
+        [[nodiscard]]
+        double beatLength(double position) const;
+
+        [[nodiscard]]
+        const std::vector<TempoPoint> &points() const { return m_points; }
+
+        [[nodiscard]]
+        size_t size() const { return m_points.size(); }
+
+        [[nodiscard]]
+        bool empty() const { return m_points.empty(); }
+
+        void clear() { m_points.clear(); }
+
+    private:
+        /**
+         * Index of the point in effect at position, or -1 if before the first
+         * point or map is empty
+         */
+        [[nodiscard]]
+        int indexAt(double position) const;
+
+        std::vector<TempoPoint> m_points;
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Insound
+{
+    /**
+     * Plain event of a track's playback, passed from callback sites to the
+     * update loop through an `EventRing`
+     */
+    struct TrackEvent
+    {
+        enum class Type : uint32_t
+        {
+            /** Playhead is about to cross sync point `index` */
+            SyncPoint,
+            /** Playhead is about to reach the end of a track that doesn't
+             *  loop */
+            End,
+            /** Playhead is about to wrap from the loop end to its start */
+            LoopWrap,
+            /** Mixer could not keep up with the output, audio glitched */
+            Underrun,
+        };
+
+        Type type;
+        /** Sync point index for `SyncPoint` events, 0 otherwise */
+        uint32_t index;
+        /** Track position of the event in PCM samples */
+        uint32_t offset;
+        /** DSP clock at which the event occurs */
+        uint64_t clock;
+    };
+}
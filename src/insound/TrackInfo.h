@@ -0,0 +1,51 @@
+#pragma once
+
+#include <insound/LoopInfo.h>
+
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * Static format data of a single stem, read once when it gets loaded.
+     */
+    struct StemInfo
+    {
+        /** Length of the stem in PCM samples */
+        unsigned int length;
+        /** Default playback frequency */
+        float samplerate;
+        /** FMOD_SOUND_FORMAT of the stem's sample data */
+        int format;
+        /** Number of audio channels (e.g. 1 = mono, 2 = stereo) */
+        int channels;
+        /** Bits per sample */
+        int bits;
+    };
+
+    /**
+     * Snapshot of a loaded track's static data. Built once while loading
+     * the track in `MultiTrackAudio::loadFsb` or `MultiTrackAudio::loadSound`
+     * so that getters polled every frame are served from memory instead of
+     * querying FMOD.
+     */
+    struct TrackInfo
+    {
+        TrackInfo() : stems(), length(), samplerate(), loop{0, 0} { }
+
+        /** Per-stem format data, in order of channel index */
+        std::vector<StemInfo> stems;
+
+        /** Length of the longest stem in PCM samples */
+        unsigned int length;
+
+        /** Sample rate of the first stem, which all positions refer to */
+        float samplerate;
+
+        /** Current loop points in PCM samples */
+        LoopInfo<unsigned> loop;
+
+        [[nodiscard]]
+        bool empty() const { return stems.empty(); }
+    };
+}
@@ -0,0 +1,185 @@
+#include "Transport.h"
+#include "common.h"
+
+#include <insound/MultiTrackAudio.h>
+
+#include <fmod.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Insound
+{
+    Transport::Transport(FMOD::System *sys) : m_sys(sys), m_master(),
+        m_tracks(), m_rate(), m_lead(), m_bpm(120.0), m_beatsPerBar(4),
+        m_origin(), m_playing(false)
+    {
+        rebind(sys);
+    }
+
+    void Transport::rebind(FMOD::System *sys)
+    {
+        m_sys = sys;
+        checkResult( sys->getMasterChannelGroup(&m_master) );
+        checkResult( sys->getSoftwareFormat(&m_rate, nullptr, nullptr) );
+
+        // Schedule one mix block ahead, so that all commands issued for the
+        // attached tracks arrive at the mixer before the target clock.
+        unsigned int bufferLength;
+        checkResult( sys->getDSPBufferSize(&bufferLength, nullptr) );
+        m_lead = bufferLength;
+
+        // The new clock starts over, keep the grid where the tracks are
+        for (auto track : m_tracks)
+        {
+            if (!track->isLoaded()) continue;
+
+            align(track->position(), clock());
+            break;
+        }
+    }
+
+    void Transport::attach(MultiTrackAudio *track)
+    {
+        if (!track || isAttached(track)) return;
+        m_tracks.emplace_back(track);
+    }
+
+    bool Transport::detach(MultiTrackAudio *track)
+    {
+        auto it = std::find(m_tracks.begin(), m_tracks.end(), track);
+        if (it == m_tracks.end())
+            return false;
+
+        m_tracks.erase(it);
+        return true;
+    }
+
+    bool Transport::isAttached(const MultiTrackAudio *track) const
+    {
+        return std::find(m_tracks.begin(), m_tracks.end(), track) !=
+            m_tracks.end();
+    }
+
+    void Transport::clear()
+    {
+        m_tracks.clear();
+        m_playing = false;
+    }
+
+    void Transport::start(float delay)
+    {
+        const auto clock = nextClock(Quantize::None, delay);
+
+        bool didAlign = false;
+        for (auto track : m_tracks)
+        {
+            if (!track->isLoaded()) continue;
+
+            if (!didAlign)
+            {
+                align(track->position(), clock);
+                didAlign = true;
+            }
+
+            track->pause(false, 0, clock);
+        }
+
+        m_playing = true;
+    }
+
+    void Transport::stop(float seconds)
+    {
+        const auto clock = nextClock();
+        for (auto track : m_tracks)
+        {
+            if (!track->isLoaded()) continue;
+            track->pause(true, seconds, clock);
+        }
+
+        m_playing = false;
+    }
+
+    void Transport::seek(double seconds)
+    {
+        if (!m_playing)
+        {
+            for (auto track : m_tracks)
+            {
+                if (!track->isLoaded()) continue;
+                track->position(seconds);
+            }
+
+            align(seconds, clock());
+            return;
+        }
+
+        const auto clock = nextClock();
+        for (auto track : m_tracks)
+        {
+            if (!track->isLoaded()) continue;
+            track->transitionTo(seconds, 0, true, 0, true, clock);
+        }
+
+        align(seconds, clock);
+    }
+
+    void Transport::transitionTo(float position, float inTime, bool fadeIn,
+        float outTime, bool fadeOut, Quantize quantize)
+    {
+        const auto clock = nextClock(quantize);
+        for (auto track : m_tracks)
+        {
+            if (!track->isLoaded()) continue;
+            track->transitionTo(position, inTime, fadeIn, outTime, fadeOut,
+                clock);
+        }
+
+        align(position, clock);
+        m_playing = true;
+    }
+
+    void Transport::tempo(double bpm, int beatsPerBar)
+    {
+        if (bpm <= 0)
+            throw std::invalid_argument("Transport tempo must be greater "
+                "than 0");
+        if (beatsPerBar <= 0)
+            throw std::invalid_argument("Transport beats per bar must be "
+                "greater than 0");
+
+        m_bpm = bpm;
+        m_beatsPerBar = beatsPerBar;
+    }
+
+    unsigned long long Transport::clock() const
+    {
+        unsigned long long clock;
+        checkResult( m_master->getDSPClock(&clock, nullptr) );
+        return clock;
+    }
+
+    unsigned long long Transport::nextClock(Quantize quantize,
+        float delay) const
+    {
+        auto target = (double)clock() + m_lead + (double)delay * m_rate;
+
+        if (quantize != Quantize::None)
+        {
+            auto unit = 60.0 / m_bpm * m_rate;
+            if (quantize == Quantize::Bar)
+                unit *= m_beatsPerBar;
+
+            target = m_origin +
+                std::ceil((target - (double)m_origin) / unit) * unit;
+        }
+
+        return (unsigned long long)std::llround(target);
+    }
+
+    void Transport::align(double seconds, unsigned long long clock)
+    {
+        m_origin = (long long)clock - std::llround(seconds * m_rate);
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <insound/Quantize.h>
+
+#include <cstddef>
+#include <vector>
+
+// Forward declaration
+namespace FMOD
+{
+    class ChannelGroup;
+    class System;
+}
+
+namespace Insound
+{
+    class MultiTrackAudio;
+
+    /**
+     * Engine-wide transport that plays, stops, seeks and transitions all of
+     * its attached tracks at one common DSP clock of the master bus, so that
+     * layered tracks start and loop sample-aligned with each other.
+     *
+     * Tracks are not owned by the Transport.
+     */
+    class Transport
+    {
+    public:
+        explicit Transport(FMOD::System *sys);
+
+        /**
+         * Move onto another system, e.g. after the engine re-initialized its
+         * output with the attached tracks. Tracks stay attached, and the
+         * beat grid is realigned to where they resume.
+         */
+        void rebind(FMOD::System *sys);
+
+        /**
+         * Attach a track to the transport. Attaching an already attached
+         * track does nothing.
+         */
+        void attach(MultiTrackAudio *track);
+
+        /**
+         * Detach a track from the transport
+         * @return whether track was attached and removed
+         */
+        bool detach(MultiTrackAudio *track);
+
+        /**
+         * Check whether a track is attached to this transport
+         */
+        [[nodiscard]]
+        bool isAttached(const MultiTrackAudio *track) const;
+
+        /**
+         * Get the number of tracks attached
+         */
+        [[nodiscard]]
+        size_t size() const { return m_tracks.size(); }
+
+        /**
+         * Detach all tracks
+         */
+        void clear();
+
+        /**
+         * Start all attached tracks at the same DSP clock
+         *
+         * @param delay - number of seconds to wait before starting
+         */
+        void start(float delay = 0);
+
+        /**
+         * Stop all attached tracks at the same DSP clock
+         *
+         * @param seconds - number of seconds to fade out
+         */
+        void stop(float seconds = 0);
+
+        /**
+         * Move all attached tracks to a position. If playing, the jump is
+         * scheduled for all tracks at a common DSP clock.
+         *
+         * @param seconds - track position to seek to in seconds
+         */
+        void seek(double seconds);
+
+        /**
+         * Perform a faded transition in all attached tracks at a common
+         * DSP clock. See `MultiTrackAudio::transitionTo` for details.
+         *
+         * @param quantize - grid that the transition clock snaps to, based on
+         *                   the transport tempo
+         */
+        void transitionTo(float position, float inTime, bool fadeIn,
+            float outTime, bool fadeOut, Quantize quantize = Quantize::None);
+
+        /**
+         * Set the tempo used for quantized transitions
+         *
+         * @param bpm         - beats per minute, must be greater than 0
+         * @param beatsPerBar - number of beats in a measure
+         */
+        void tempo(double bpm, int beatsPerBar = 4);
+
+        [[nodiscard]]
+        double tempo() const { return m_bpm; }
+
+        [[nodiscard]]
+        int beatsPerBar() const { return m_beatsPerBar; }
+
+        /**
+         * Whether the transport is currently playing
+         */
+        [[nodiscard]]
+        bool playing() const { return m_playing; }
+
+        /**
+         * Get the current DSP clock of the master bus, which is the common
+         * time base of all attached tracks.
+         */
+        [[nodiscard]]
+        unsigned long long clock() const;
+
+        /**
+         * Get the earliest DSP clock that can be safely scheduled for all
+         * tracks, quantized to the transport grid.
+         *
+         * @param quantize - grid to snap to
+         * @param delay    - minimum number of seconds from now
+         */
+        [[nodiscard]]
+        unsigned long long nextClock(Quantize quantize = Quantize::None,
+            float delay = 0) const;
+
+    private:
+        /**
+         * Align the beat grid so that track position `seconds` is heard at
+         * DSP clock `clock`
+         */
+        void align(double seconds, unsigned long long clock);
+
+        FMOD::System *m_sys;
+        FMOD::ChannelGroup *m_master;
+        std::vector<MultiTrackAudio *> m_tracks;
+
+        // Output rate in DSP clocks per second
+        int m_rate;
+        // Number of clocks to schedule ahead, so all commands apply in time
+        unsigned int m_lead;
+
+        double m_bpm;
+        int m_beatsPerBar;
+
+        // DSP clock at which the tracks were (or would have been) at 0
+        long long m_origin;
+        bool m_playing;
+    };
+}
@@ -1,6 +1,8 @@
 #include "common.h"
 
 #include <insound/FMODError.h>
+#include <insound/MemoryBudget.h>
+#include <insound/errors/MemoryBudgetExceeded.h>
 
 #include <stdexcept>
 #include <string>
@@ -8,8 +10,22 @@
 namespace Insound {
     void checkResult(FMOD_RESULT result)
     {
-        if (result != FMOD_OK)
-            throw FMODError(result);
+        if (result == FMOD_OK)
+            return;
+
+        if (result == FMOD_ERR_MEMORY)
+        {
+            const auto requested = MemoryBudget::takeFailure(
+                MemoryCategory::FMOD);
+            if (requested)
+            {
+                const auto stats = MemoryBudget::stats();
+                throw MemoryBudgetExceeded(stats.budget, stats.live,
+                    requested);
+            }
+        }
+
+        throw FMODError(result);
     }
 
     bool compareCaseInsensitive(std::string_view a, std::string_view b)
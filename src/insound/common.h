@@ -4,7 +4,8 @@
 
 namespace Insound {
     /**
-     * Check FMOD result - throw if an error occurred.
+     * Check FMOD result - throw if an error occurred. Out of memory errors
+     * caused by the memory budget throw `MemoryBudgetExceeded`.
      */
     void checkResult(FMOD_RESULT result);
 
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace Insound
+{
+    /**
+     * Thrown when loading audio would exceed the engine's memory budget
+     */
+    class MemoryBudgetExceeded : public std::runtime_error
+    {
+    public:
+        /**
+         * @param budget    - budget in bytes
+         * @param live      - bytes in use when the allocation was refused
+         * @param requested - bytes of the refused allocation
+         */
+        MemoryBudgetExceeded(size_t budget, size_t live, size_t requested) :
+            std::runtime_error("Memory budget of " + megabytes(budget) +
+                " exceeded: " + megabytes(live) + " in use, " +
+                megabytes(requested) + " requested."),
+            budget(budget), live(live), requested(requested)
+        {
+
+        }
+
+        size_t budget;
+        size_t live;
+        size_t requested;
+
+    private:
+        static std::string megabytes(size_t bytes)
+        {
+            const auto tenths = (bytes * 10 + 524288) / 1048576;
+            return std::to_string(tenths / 10) + '.' +
+                std::to_string(tenths % 10) + " MB";
+        }
+    };
+}
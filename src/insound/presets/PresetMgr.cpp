@@ -1,5 +1,7 @@
 #include "PresetMgr.h"
 
+#include <stdexcept>
+
 namespace Insound
 {
     const Preset &PresetMgr::operator[](size_t index) const
@@ -0,0 +1,115 @@
+#include "Profiler.h"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace Insound
+{
+    const char *sectionName(ProfileSection section)
+    {
+        static const char *Names[] = {
+            "engine.update",
+            "track.update",
+            "lua.init",
+            "lua.update",
+            "lua.syncpoint",
+            "lua.load",
+            "lua.unload",
+            "lua.trackend",
+            "lua.param",
+            "lua.events",
+        };
+        static_assert(std::size(Names) == (size_t)ProfileSection::Count,
+            "missing ProfileSection name");
+
+        const auto index = (size_t)section;
+        return (index < std::size(Names)) ? Names[index] : "unknown";
+    }
+
+
+    Profiler::Profiler() : m_enabled(true), m_window(1), m_current(),
+        m_last(), m_start(Clock::now()), m_lastWindow()
+    {
+    }
+
+
+    void Profiler::window(double seconds)
+    {
+        if (seconds <= 0)
+            throw std::invalid_argument("Profiler::window: must be greater "
+                "than 0");
+        m_window = seconds;
+    }
+
+
+    void Profiler::record(ProfileSection section, double seconds)
+    {
+        if (m_enabled)
+            m_current.at((size_t)section).record(seconds);
+    }
+
+
+    void Profiler::tick()
+    {
+        const auto now = Clock::now();
+        const auto elapsed = std::chrono::duration<double>(
+            now - m_start).count();
+        if (elapsed < m_window)
+            return;
+
+        m_last = m_current;
+        for (auto &histogram : m_current)
+            histogram.clear();
+
+        m_lastWindow = elapsed;
+        m_start = now;
+    }
+
+
+    void Profiler::reset()
+    {
+        for (auto &histogram : m_current)
+            histogram.clear();
+        for (auto &histogram : m_last)
+            histogram.clear();
+
+        m_lastWindow = 0;
+        m_start = Clock::now();
+    }
+
+
+    const TimingHistogram &Profiler::timing(ProfileSection section) const
+    {
+        return (m_lastWindow > 0 ? m_last : m_current).at((size_t)section);
+    }
+
+
+    double Profiler::reportedWindow() const
+    {
+        return (m_lastWindow > 0) ? m_lastWindow :
+            std::chrono::duration<double>(Clock::now() - m_start).count();
+    }
+
+
+    std::vector<TimingStats> Profiler::stats() const
+    {
+        std::vector<TimingStats> result;
+        result.reserve((size_t)ProfileSection::Count);
+
+        for (size_t i = 0; i < (size_t)ProfileSection::Count; ++i)
+        {
+            const auto section = static_cast<ProfileSection>(i);
+            const auto &histogram = timing(section);
+            result.emplace_back(TimingStats{
+                .name=sectionName(section),
+                .count=(unsigned)histogram.count(),
+                .min=histogram.min() * 1000.0,
+                .avg=histogram.mean() * 1000.0,
+                .p99=histogram.percentile(.99) * 1000.0,
+                .max=histogram.max() * 1000.0,
+            });
+        }
+
+        return result;
+    }
+}
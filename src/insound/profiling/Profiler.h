@@ -0,0 +1,196 @@
+#pragma once
+
+#include <insound/profiling/TimingHistogram.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * Timed sections of the engine and scripting frame
+     */
+    enum class ProfileSection
+    {
+        /** `AudioEngine::update` */
+        EngineUpdate,
+        /** `MultiTrackControl::update`, including its Lua events */
+        TrackUpdate,
+        // Calls of Lua script handlers, one per event type
+        LuaInit,
+        LuaUpdate,
+        LuaSyncPoint,
+        LuaLoad,
+        LuaUnload,
+        LuaTrackEnd,
+        LuaParam,
+        LuaEvents,
+        Count, // leave this last
+    };
+
+    /**
+     * Get the display name of a section, e.g. "engine.update"
+     */
+    [[nodiscard]]
+    const char *sectionName(ProfileSection section);
+
+    /**
+     * Durations of one section in a profiling window, in milliseconds
+     */
+    struct TimingStats
+    {
+        std::string name;
+        unsigned count;
+        double min;
+        double avg;
+        double p99;
+        double max;
+    };
+
+    /**
+     * Voice and DSP usage of one track
+     */
+    struct TrackProfile
+    {
+        /** Engine handle of the track */
+        uint32_t handle;
+        /** Stems and stingers that are playing and audible */
+        int voices;
+        /** DSP units on the track's channels and buses */
+        int dsps;
+    };
+
+    /**
+     * Structured engine profile of one sampling window
+     */
+    struct ProfileSnapshot
+    {
+        /** Seconds covered by the timings */
+        double window;
+
+        // FMOD_CPU_USAGE breakdown, in percent
+        float cpuDsp;
+        float cpuStream;
+        float cpuGeometry;
+        float cpuUpdate;
+        float cpuConvolution1;
+        float cpuConvolution2;
+
+        /** One entry per `ProfileSection`, in order */
+        std::vector<TimingStats> timings;
+        std::vector<TrackProfile> tracks;
+
+        /** Bytes currently allocated by FMOD */
+        int currentAlloc;
+        /** Peak bytes allocated by FMOD since init */
+        int maxAlloc;
+    };
+
+    /**
+     * Collects section timings into histograms over fixed sampling windows.
+     * The last completed window is reported, so numbers stay stable between
+     * reads. Recording is O(1) without allocation, so it can stay enabled
+     * in production. Not thread-safe, owned by one engine's update thread.
+     */
+    class Profiler
+    {
+    public:
+        Profiler();
+
+        /**
+         * Set whether timings are recorded, on by default
+         */
+        void enabled(bool enable) { m_enabled = enable; }
+        [[nodiscard]]
+        bool enabled() const { return m_enabled; }
+
+        /**
+         * Set the length of a sampling window in seconds, 1 by default
+         */
+        void window(double seconds);
+        [[nodiscard]]
+        double window() const { return m_window; }
+
+        /**
+         * Add a duration to a section of the current window
+         */
+        void record(ProfileSection section, double seconds);
+
+        /**
+         * Complete the current window if its time is up. Call once per frame.
+         */
+        void tick();
+
+        /**
+         * Discard all recorded timings and start a new window
+         */
+        void reset();
+
+        /**
+         * Timings of the last completed window, or of the current one if no
+         * window completed yet
+         */
+        [[nodiscard]]
+        const TimingHistogram &timing(ProfileSection section) const;
+
+        /**
+         * Seconds covered by `timing`
+         */
+        [[nodiscard]]
+        double reportedWindow() const;
+
+        /**
+         * Summarize the reported timings of every section
+         */
+        [[nodiscard]]
+        std::vector<TimingStats> stats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        using Histograms = std::array<TimingHistogram,
+            (size_t)ProfileSection::Count>;
+
+        bool m_enabled;
+        double m_window;
+        Histograms m_current, m_last;
+        Clock::time_point m_start;
+        // Length of the last completed window, 0 if none
+        double m_lastWindow;
+    };
+
+    /**
+     * Records the time from construction to destruction into a profiler.
+     * Does nothing if the profiler is null or disabled.
+     */
+    class ProfileScope
+    {
+    public:
+        ProfileScope(Profiler *profiler, ProfileSection section) :
+            m_profiler(profiler && profiler->enabled() ? profiler : nullptr),
+            m_section(section),
+            m_start(m_profiler ? std::chrono::steady_clock::now() :
+                std::chrono::steady_clock::time_point())
+        { }
+
+        ~ProfileScope()
+        {
+            if (m_profiler)
+            {
+                m_profiler->record(m_section, std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - m_start).count());
+            }
+        }
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+    private:
+        Profiler *m_profiler;
+        ProfileSection m_section;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
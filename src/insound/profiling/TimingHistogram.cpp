@@ -0,0 +1,84 @@
+#include "TimingHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Insound
+{
+    TimingHistogram::TimingHistogram() : m_buckets(), m_count(), m_min(),
+        m_max(), m_sum()
+    {
+    }
+
+
+    void TimingHistogram::record(double seconds)
+    {
+        size_t index = 0;
+        if (seconds > Resolution)
+        {
+            index = std::min((size_t)std::ceil(4.0 *
+                std::log2(seconds / Resolution)), BucketCount - 1);
+        }
+
+        ++m_buckets[index];
+        m_min = m_count ? std::min(m_min, seconds) : seconds;
+        m_max = std::max(m_max, seconds);
+        m_sum += seconds;
+        ++m_count;
+    }
+
+
+    void TimingHistogram::merge(const TimingHistogram &other)
+    {
+        if (!other.m_count)
+            return;
+
+        for (size_t i = 0; i < BucketCount; ++i)
+            m_buckets[i] += other.m_buckets[i];
+
+        m_min = m_count ? std::min(m_min, other.m_min) : other.m_min;
+        m_max = std::max(m_max, other.m_max);
+        m_sum += other.m_sum;
+        m_count += other.m_count;
+    }
+
+
+    void TimingHistogram::clear()
+    {
+        m_buckets.fill(0);
+        m_count = 0;
+        m_min = 0;
+        m_max = 0;
+        m_sum = 0;
+    }
+
+
+    double TimingHistogram::percentile(double fraction) const
+    {
+        if (!m_count)
+            return 0;
+
+        const auto rank = (size_t)std::ceil(std::clamp(fraction, 0.0, 1.0) *
+            m_count);
+
+        size_t seen = 0;
+        for (size_t i = 0; i < BucketCount; ++i)
+        {
+            seen += m_buckets[i];
+            if (seen >= rank && seen > 0)
+            {
+                // the last bucket has no upper bound
+                return (i == BucketCount - 1) ? m_max :
+                    std::clamp(bucketBound(i), m_min, m_max);
+            }
+        }
+
+        return m_max;
+    }
+
+
+    double TimingHistogram::bucketBound(size_t index)
+    {
+        return Resolution * std::exp2(index / 4.0);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace Insound
+{
+    /**
+     * Fixed-size histogram of durations with quarter-octave buckets from
+     * 1 microsecond up, so recording is O(1) and never allocates.
+     * Percentiles are accurate to within one bucket, about 19%.
+     */
+    class TimingHistogram
+    {
+    public:
+        static constexpr size_t BucketCount = 96;
+        /** Upper bound of the first bucket in seconds */
+        static constexpr double Resolution = 1e-6;
+
+        TimingHistogram();
+
+        /**
+         * Add a duration in seconds
+         */
+        void record(double seconds);
+
+        /**
+         * Add all durations of another histogram
+         */
+        void merge(const TimingHistogram &other);
+
+        void clear();
+
+        /**
+         * Duration below which a fraction of samples fall, in seconds
+         *
+         * @param fraction - e.g. .99 for the 99th percentile
+         */
+        [[nodiscard]]
+        double percentile(double fraction) const;
+
+        [[nodiscard]]
+        size_t count() const { return m_count; }
+        [[nodiscard]]
+        double min() const { return m_count ? m_min : 0; }
+        [[nodiscard]]
+        double max() const { return m_max; }
+        [[nodiscard]]
+        double mean() const { return m_count ? m_sum / m_count : 0; }
+        [[nodiscard]]
+        double sum() const { return m_sum; }
+
+    private:
+        /**
+         * Upper bound of a bucket in seconds
+         */
+        [[nodiscard]]
+        static double bucketBound(size_t index);
+
+        std::array<unsigned, BucketCount> m_buckets;
+        size_t m_count;
+        double m_min, m_max, m_sum;
+    };
+}
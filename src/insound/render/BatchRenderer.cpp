@@ -0,0 +1,198 @@
+#include "BatchRenderer.h"
+#include "WavWriter.h"
+
+#include <insound/MultiTrackAudio.h>
+#include <insound/presets/PresetMgr.h>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace Insound
+{
+    BatchRenderer::BatchRenderer(const BatchSettings &settings) :
+        m_settings(settings), m_stems(), m_loop{0, 0}, m_length()
+    {
+
+    }
+
+
+    void BatchRenderer::loadBank(const char *data, size_t bytelength)
+    {
+        OfflineRenderer decoder(m_settings.samplerate, m_settings.blockLength);
+        decoder.loadBank(data, bytelength);
+
+        clear();
+        decode(decoder.track());
+    }
+
+
+    void BatchRenderer::loadSound(const char *data, size_t bytelength)
+    {
+        OfflineRenderer decoder(m_settings.samplerate, m_settings.blockLength);
+        decoder.loadSound(data, bytelength);
+
+        decode(decoder.track());
+    }
+
+
+    void BatchRenderer::clear()
+    {
+        m_stems.clear();
+        m_loop = {0, 0};
+        m_length = 0;
+    }
+
+
+    void BatchRenderer::decode(MultiTrackAudio &track)
+    {
+        const auto &info = track.info();
+        if (m_stems.empty())
+        {
+            m_loop = info.loop;
+            m_length = track.length();
+        }
+
+        for (size_t i = 0; i < info.stems.size(); ++i)
+        {
+            const auto &stem = info.stems[i];
+            const auto &samples = track.getSampleData(i);
+            if (samples.size() < (size_t)stem.length * stem.channels)
+            {
+                throw std::runtime_error("BatchRenderer: decoded data of "
+                    "stem " + std::to_string(i) + " is incomplete");
+            }
+
+            m_stems.emplace_back(Stem{
+                .samples=samples,
+                .frames=stem.length,
+                .channels=stem.channels,
+                .samplerate=(int)stem.samplerate,
+            });
+        }
+    }
+
+
+    std::vector<BatchResult> BatchRenderer::render(const PresetMgr &presets)
+    {
+        if (m_stems.empty())
+            throw std::runtime_error("BatchRenderer::render: no audio is "
+                "loaded");
+
+        std::vector<BatchResult> results(presets.size());
+        if (presets.empty())
+            return results;
+
+        auto threadCount = m_settings.threads > 0 ? m_settings.threads :
+            (int)std::thread::hardware_concurrency();
+        threadCount = std::clamp(threadCount, 1, (int)presets.size());
+
+        std::atomic<size_t> next = 0;
+        std::vector<std::exception_ptr> errors(threadCount);
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount);
+
+        for (int i = 0; i < threadCount; ++i)
+        {
+            workers.emplace_back([this, i, &presets, &next, &results,
+                &errors]()
+            {
+                try {
+                    renderJob(presets, next, results);
+                }
+                catch(...)
+                {
+                    errors[i] = std::current_exception();
+
+                    // stop others from picking up more work
+                    next = presets.size();
+                }
+            });
+        }
+
+        for (auto &worker : workers)
+            worker.join();
+
+        for (auto &error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        return results;
+    }
+
+
+    void BatchRenderer::renderToWav(const PresetMgr &presets,
+        const std::string &directory)
+    {
+        const auto results = render(presets);
+        const auto rate = m_settings.samplerate;
+
+        for (const auto &result : results)
+        {
+            // keep preset names from escaping the directory
+            auto name = result.preset;
+            std::replace_if(name.begin(), name.end(), [](char c) {
+                return c == '/' || c == '\\' || c == ':';
+            }, '_');
+
+            const auto base = directory + "/" + name;
+            const auto &mix = result.mix;
+            writeWav(base + ".wav", mix.samples.data(),
+                mix.samples.size() / mix.channels, mix.channels, rate);
+
+            for (size_t i = 0; i < result.stems.size(); ++i)
+            {
+                const auto &stem = result.stems[i];
+                writeWav(base + ".stem" + std::to_string(i) + ".wav",
+                    stem.samples.data(), stem.samples.size() / stem.channels,
+                    stem.channels, rate);
+            }
+        }
+    }
+
+
+    void BatchRenderer::renderJob(const PresetMgr &presets,
+        std::atomic<size_t> &next, std::vector<BatchResult> &results)
+    {
+        // Each worker mixes on its own system, sharing the decoded stems
+        OfflineRenderer renderer(m_settings.samplerate,
+            m_settings.blockLength);
+        auto &track = renderer.track();
+
+        for (const auto &stem : m_stems)
+        {
+            track.loadPCM(stem.samples.data(), stem.frames, stem.channels,
+                stem.samplerate);
+        }
+        track.loopSamples(m_loop.start, m_loop.end);
+        renderer.captureStems(m_settings.stems);
+
+        const auto seconds = m_settings.seconds > 0 ? m_settings.seconds :
+            m_length;
+
+        for (auto index = next++; index < presets.size(); index = next++)
+        {
+            const auto &preset = presets[index];
+
+            // start each preset from a clean mix at the top
+            track.pause(true, 0);
+            track.position(0);
+            track.mainVolume(1.f);
+            for (int ch = 0, count = track.channelCount(); ch < count; ++ch)
+                track.channelVolume(ch, 1.f);
+            renderer.applyPreset(preset);
+
+            auto &result = results[index];
+            result.preset = preset.name;
+            result.mix = RenderBuffer{
+                .samples=renderer.render(seconds),
+                .channels=renderer.channels(),
+            };
+            result.stems = renderer.stems();
+        }
+    }
+}
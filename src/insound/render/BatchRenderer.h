@@ -0,0 +1,126 @@
+#pragma once
+
+#include <insound/LoopInfo.h>
+#include <insound/render/OfflineRenderer.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Insound
+{
+    class PresetMgr;
+
+    /**
+     * Options for `BatchRenderer`
+     */
+    struct BatchSettings
+    {
+        BatchSettings() : samplerate(48000), blockLength(512), threads(0),
+            seconds(0), stems(false)
+        { }
+
+        /** Sample rate to render at */
+        int samplerate;
+        /** Samples mixed per engine update */
+        unsigned blockLength;
+        /** Number of worker threads, 0 uses one per hardware thread */
+        int threads;
+        /** Seconds to render per preset, 0 renders the track length */
+        double seconds;
+        /** Whether to also capture each stem's output per preset */
+        bool stems;
+    };
+
+    /**
+     * Rendered output of one preset
+     */
+    struct BatchResult
+    {
+        std::string preset;
+        RenderBuffer mix;
+        /** Each stem's output after its channel fader, if requested. Stem
+         *  channels are the only buses of a track below its main bus. */
+        std::vector<RenderBuffer> stems;
+    };
+
+    /**
+     * Renders the mixdown of many mix presets of one track in parallel.
+     *
+     * Audio is decoded once on load. Each worker thread runs its own
+     * non-realtime FMOD system, playing the shared decoded samples directly
+     * from memory, and renders presets until none are left.
+     */
+    class BatchRenderer
+    {
+    public:
+        explicit BatchRenderer(const BatchSettings &settings = {});
+
+        /**
+         * Decode an fsb bank from memory
+         */
+        void loadBank(const char *data, size_t bytelength);
+
+        /**
+         * Decode and add a single stem from memory
+         */
+        void loadSound(const char *data, size_t bytelength);
+
+        /**
+         * Release decoded audio
+         */
+        void clear();
+
+        /**
+         * Render each preset's mixdown, and stems if enabled in the settings.
+         *
+         * @param presets - presets to render, volume index 0 is the main bus
+         *
+         * @return results in the order of `presets`
+         */
+        [[nodiscard]]
+        std::vector<BatchResult> render(const PresetMgr &presets);
+
+        /**
+         * Render each preset into 32-bit float WAV files, named
+         * `<preset>.wav`, and `<preset>.stem<n>.wav` for stems.
+         *
+         * @param presets   - presets to render
+         * @param directory - existing directory to write the files to
+         */
+        void renderToWav(const PresetMgr &presets,
+            const std::string &directory);
+
+        [[nodiscard]]
+        const BatchSettings &settings() const { return m_settings; }
+
+    private:
+        /**
+         * Decoded audio of one stem
+         */
+        struct Stem
+        {
+            std::vector<float> samples;
+            unsigned frames;
+            int channels;
+            int samplerate;
+        };
+
+        /**
+         * Copy the decoded stems out of a track that finished loading
+         */
+        void decode(MultiTrackAudio &track);
+
+        /**
+         * Worker loop, renders presets until none are left
+         */
+        void renderJob(const PresetMgr &presets, std::atomic<size_t> &next,
+            std::vector<BatchResult> &results);
+
+        BatchSettings m_settings;
+        std::vector<Stem> m_stems;
+        LoopInfo<unsigned> m_loop;
+        double m_length;
+    };
+}
@@ -0,0 +1,454 @@
+#include "OfflineRenderer.h"
+#include "WavWriter.h"
+
+#include <insound/AudioEngine.h>
+#include <insound/HorizontalSequencer.h>
+#include <insound/MultiTrackAudio.h>
+#include <insound/TrackEvent.h>
+#include <insound/common.h>
+#include <insound/scripting/LuaDriver.h>
+
+#include <fmod.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace Insound
+{
+    /**
+     * Audio collected by a capture DSP
+     */
+    struct Capture
+    {
+        RenderBuffer buffer;
+        bool recording;
+    };
+
+    /**
+     * Pass-through DSP read callback that records the final mix
+     */
+    static FMOD_RESULT F_CALL captureRead(FMOD_DSP_STATE *state,
+        float *inbuffer, float *outbuffer, unsigned int length,
+        int inchannels, int *outchannels)
+    {
+        const auto count = length * inchannels;
+        std::memcpy(outbuffer, inbuffer, count * sizeof(float));
+
+        void *userdata;
+        auto result = state->functions->getuserdata(state, &userdata);
+        if (result != FMOD_OK)
+            return result;
+
+        auto capture = static_cast<Capture *>(userdata);
+        if (capture->recording)
+        {
+            auto &samples = capture->buffer.samples;
+            samples.insert(samples.end(), inbuffer, inbuffer + count);
+            capture->buffer.channels = inchannels;
+        }
+
+        return FMOD_OK;
+    }
+
+    /**
+     * Create a pass-through DSP that records into `capture`
+     */
+    static FMOD::DSP *createCaptureDSP(FMOD::System *sys, Capture *capture)
+    {
+        FMOD_DSP_DESCRIPTION desc;
+        std::memset(&desc, 0, sizeof(FMOD_DSP_DESCRIPTION));
+        desc.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+        std::strncpy(desc.name, "Insound Capture", sizeof(desc.name) - 1);
+        desc.numinputbuffers = 1;
+        desc.numoutputbuffers = 1;
+        desc.read = captureRead;
+        desc.userdata = capture;
+
+        FMOD::DSP *dsp;
+        checkResult( sys->createDSP(&desc, &dsp) );
+        return dsp;
+    }
+
+    struct OfflineRenderer::Impl
+    {
+        Impl() : engine(), track(), lua(), dsp(), capture(), captureStems(),
+            stemCaptures(), stemDsps(), stems(), automation(), params(),
+            events(), total(), blockLength()
+        { }
+
+        ~Impl()
+        {
+            delete lua;
+
+            if (dsp)
+            {
+                FMOD::ChannelGroup *master;
+                if (engine.system()->getMasterChannelGroup(&master) ==
+                    FMOD_OK)
+                {
+                    master->removeDSP(dsp);
+                }
+                dsp->release();
+            }
+        }
+
+        AudioEngine engine;
+        // owned by the engine
+        MultiTrackAudio *track;
+        LuaDriver *lua;
+
+        FMOD::DSP *dsp;
+        Capture capture;
+
+        bool captureStems;
+        // Sized once per render, so addresses stay valid for the DSPs
+        std::vector<Capture> stemCaptures;
+        std::vector<FMOD::DSP *> stemDsps;
+        std::vector<RenderBuffer> stems;
+
+        std::vector<AutomationEvent> automation;
+        std::map<std::string, float, std::less<>> params;
+
+        // Playback events polled each block, reused between blocks
+        std::vector<TrackEvent> events;
+
+        // Script time in seconds since the script was loaded
+        double total;
+        unsigned blockLength;
+    };
+
+
+    OfflineRenderer::OfflineRenderer(int samplerate, unsigned blockLength) :
+        m(new Impl)
+    {
+        try {
+            AudioEngineSettings settings;
+            settings.output = OutputMode::NoSoundNRT;
+            settings.samplerate = samplerate;
+            settings.stereo = true;
+            settings.bufferLength = blockLength;
+
+            if (!m->engine.init(settings))
+                throw std::runtime_error("OfflineRenderer: failed to "
+                    "initialize the audio engine");
+
+            m->blockLength = blockLength;
+            m->track = m->engine.getTrack(m->engine.createTrack());
+
+            // Dispatch events the playhead crosses in each mixed block
+            m->track->markerLookahead((double)blockLength /
+                m->engine.samplerate());
+
+            // Record the final mix at the head of the master bus
+            auto sys = m->engine.system();
+            m->dsp = createCaptureDSP(sys, &m->capture);
+
+            FMOD::ChannelGroup *master;
+            checkResult( sys->getMasterChannelGroup(&master) );
+            checkResult( master->addDSP(FMOD_CHANNELCONTROL_DSP_HEAD,
+                m->dsp) );
+
+            m->lua = createScriptingEngine();
+            m->lua->setProfiler(&m->engine.profiler());
+        }
+        catch(...)
+        {
+            delete m;
+            throw;
+        }
+    }
+
+
+    OfflineRenderer::~OfflineRenderer()
+    {
+        delete m;
+    }
+
+
+    void OfflineRenderer::loadBank(const char *data, size_t bytelength)
+    {
+        m->track->loadFsb(data, bytelength);
+    }
+
+
+    void OfflineRenderer::loadSound(const char *data, size_t bytelength)
+    {
+        m->track->loadSound(data, bytelength);
+    }
+
+
+    const std::string &OfflineRenderer::loadScript(std::string_view text)
+    {
+        static const std::string NoErrors{};
+
+        auto result = m->lua->load(text);
+        if (!result)
+            return m->lua->getError();
+
+        if (!text.empty())
+        {
+            result = m->lua->doInit();
+            if (!result)
+                return m->lua->getError();
+
+            result = m->lua->doLoad(*m->track);
+            if (!result)
+                return m->lua->getError();
+        }
+
+        m->total = 0;
+        return NoErrors;
+    }
+
+
+    void OfflineRenderer::applyPreset(const Preset &preset)
+    {
+        const auto count = std::min((int)preset.volumes.size(),
+            m->track->channelCount() + 1);
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (i == 0)
+                m->track->mainVolume(preset.volumes[i]);
+            else
+                m->track->channelVolume(i - 1, preset.volumes[i]);
+        }
+    }
+
+
+    void OfflineRenderer::automate(const AutomationEvent &event)
+    {
+        // keep sorted by time, in order of insertion among equal times
+        auto it = std::upper_bound(m->automation.begin(),
+            m->automation.end(), event.time,
+            [](double time, const AutomationEvent &e) {
+                return time < e.time;
+            });
+
+        m->automation.insert(it, event);
+    }
+
+
+    void OfflineRenderer::clearAutomation()
+    {
+        m->automation.clear();
+    }
+
+
+    std::vector<float> OfflineRenderer::render(double seconds)
+    {
+        if (!m->track->isLoaded())
+            throw std::runtime_error("OfflineRenderer::render: no track is "
+                "loaded");
+
+        const auto samples = (size_t)(seconds * samplerate()) * channels();
+        const auto delta = (double)m->blockLength / samplerate();
+
+        auto &capture = m->capture;
+        auto &captured = capture.buffer.samples;
+        captured.clear();
+        captured.reserve(samples + m->blockLength * channels());
+        capture.recording = true;
+
+        m->stems.clear();
+        if (m->captureStems)
+            attachStemCaptures();
+
+        if (m->track->paused())
+            m->track->pause(false, 0);
+
+        size_t next = 0;
+        double time = 0;
+        int stalls = 0;
+        try {
+            while (captured.size() < samples)
+            {
+                const auto lastSize = captured.size();
+
+                while (next < m->automation.size() &&
+                    m->automation[next].time <= time)
+                {
+                    apply(m->automation[next++]);
+                }
+
+                // mixes one block in non-realtime mode
+                m->engine.update();
+
+                doEvents();
+                m->lua->doUpdate(delta, m->total);
+
+                time += delta;
+                m->total += delta;
+
+                if (captured.size() == lastSize && ++stalls > 16)
+                    throw std::runtime_error("OfflineRenderer::render: mixer "
+                        "is not producing output");
+            }
+        }
+        catch(...)
+        {
+            capture.recording = false;
+            detachStemCaptures();
+            throw;
+        }
+
+        capture.recording = false;
+        detachStemCaptures();
+
+        // trim the last block and hand over stem data
+        const auto frames = samples / channels();
+        for (auto &stem : m->stemCaptures)
+        {
+            stem.buffer.samples.resize(frames * stem.buffer.channels);
+            m->stems.emplace_back(std::move(stem.buffer));
+        }
+        m->stemCaptures.clear();
+
+        std::vector<float> result;
+        result.swap(captured);
+        result.resize(samples);
+        return result;
+    }
+
+
+    void OfflineRenderer::attachStemCaptures()
+    {
+        auto sys = m->engine.system();
+        const auto count = m->track->channelCount();
+
+        m->stemCaptures.assign(count, Capture{
+            .buffer={.samples={}, .channels=channels()},
+            .recording=true,
+        });
+
+        for (int i = 0; i < count; ++i)
+        {
+            auto dsp = createCaptureDSP(sys, &m->stemCaptures[i]);
+            m->stemDsps.emplace_back(dsp);
+            checkResult( m->track->channel(i).raw()->addDSP(
+                FMOD_CHANNELCONTROL_DSP_HEAD, dsp) );
+        }
+    }
+
+
+    void OfflineRenderer::detachStemCaptures()
+    {
+        const auto count = std::min((int)m->stemDsps.size(),
+            m->track->channelCount());
+
+        for (int i = 0; i < (int)m->stemDsps.size(); ++i)
+        {
+            if (i < count)
+                m->track->channel(i).raw()->removeDSP(m->stemDsps[i]);
+            m->stemDsps[i]->release();
+        }
+
+        m->stemDsps.clear();
+    }
+
+
+    void OfflineRenderer::captureStems(bool capture)
+    {
+        m->captureStems = capture;
+    }
+
+
+    const std::vector<RenderBuffer> &OfflineRenderer::stems() const
+    {
+        return m->stems;
+    }
+
+
+    void OfflineRenderer::renderToWav(const std::string &path,
+        double seconds)
+    {
+        const auto samples = render(seconds);
+        writeWav(path, samples.data(), samples.size() / channels(),
+            channels(), samplerate());
+    }
+
+
+    int OfflineRenderer::channels() const
+    {
+        FMOD_SPEAKERMODE mode;
+        checkResult( m->engine.system()->getSoftwareFormat(nullptr, &mode,
+            nullptr) );
+
+        int count;
+        checkResult( m->engine.system()->getSpeakerModeChannels(mode,
+            &count) );
+        return count;
+    }
+
+
+    int OfflineRenderer::samplerate() const
+    {
+        return m->engine.samplerate();
+    }
+
+
+    MultiTrackAudio &OfflineRenderer::track()
+    {
+        return *m->track;
+    }
+
+
+    void OfflineRenderer::doEvents()
+    {
+        m->events.clear();
+        if (m->track->pollEvents(m->events))
+            m->lua->doEvents(m->events, *m->track);
+    }
+
+
+    void OfflineRenderer::apply(const AutomationEvent &event)
+    {
+        switch(event.type)
+        {
+        case AutomationEvent::Type::Volume:
+            if (event.channel == 0)
+                m->track->mainVolume(event.value);
+            else
+                m->track->channelVolume(event.channel - 1, event.value);
+            break;
+
+        case AutomationEvent::Type::Parameter:
+            setParameter(event.param, event.value);
+            break;
+
+        case AutomationEvent::Type::Position:
+            m->track->position(event.value);
+            break;
+
+        case AutomationEvent::Type::Pause:
+            m->track->pause(event.value != 0, event.seconds);
+            break;
+        }
+    }
+
+
+    LuaDriver *OfflineRenderer::scriptingEngine() const
+    {
+        return m->lua;
+    }
+
+
+    std::optional<float> OfflineRenderer::getParameter(
+        const std::string &name) const
+    {
+        auto it = m->params.find(name);
+        if (it == m->params.end())
+            return {};
+        return it->second;
+    }
+
+
+    void OfflineRenderer::setParameter(const std::string &name, float value)
+    {
+        m->params[name] = value;
+        m->track->sequencer().setParameter(name, value);
+        m->lua->doParam(name, value);
+    }
+}
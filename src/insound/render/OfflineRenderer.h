@@ -0,0 +1,185 @@
+#pragma once
+
+#include <insound/presets/Preset.h>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound
+{
+    class LuaDriver;
+    class MultiTrackAudio;
+
+    /**
+     * A change to the mix at a point in render time
+     */
+    struct AutomationEvent
+    {
+        enum class Type
+        {
+            /** Set volume of `channel`, where 0 is the main bus */
+            Volume,
+            /** Set a script parameter `param` */
+            Parameter,
+            /** Seek to `value` seconds */
+            Position,
+            /** Pause if `value` is non-zero, otherwise unpause */
+            Pause,
+        };
+
+        /** Render time in seconds to apply the event at */
+        double time;
+        Type type;
+        int channel;
+        float value;
+        /** Fade time in seconds, where applicable */
+        float seconds;
+        std::string param;
+    };
+
+    /**
+     * Interleaved audio captured from one bus
+     */
+    struct RenderBuffer
+    {
+        std::vector<float> samples;
+        int channels;
+    };
+
+    /**
+     * Renders a track, its script and mix automation into a buffer without
+     * an audio device, as fast as the CPU allows.
+     */
+    class OfflineRenderer
+    {
+    public:
+        /**
+         * @param samplerate - sample rate to render at
+         * @param blockLength - samples mixed per engine update, which is also
+         *                      the resolution of script updates and
+         *                      automation
+         */
+        explicit OfflineRenderer(int samplerate = 48000,
+            unsigned blockLength = 512);
+        ~OfflineRenderer();
+
+        OfflineRenderer(const OfflineRenderer &) = delete;
+        OfflineRenderer &operator=(const OfflineRenderer &) = delete;
+
+        /**
+         * Load an fsb bank from memory. Data must outlive the renderer.
+         */
+        void loadBank(const char *data, size_t bytelength);
+
+        /**
+         * Add a single stem from memory
+         */
+        void loadSound(const char *data, size_t bytelength);
+
+        /**
+         * Load a Lua script into the track's scripting context. Must be
+         * called after loading audio.
+         *
+         * @return error string, or empty string on success
+         */
+        const std::string &loadScript(std::string_view script);
+
+        /**
+         * Apply a mix preset's volumes, where index 0 is the main bus
+         */
+        void applyPreset(const Preset &preset);
+
+        /**
+         * Schedule an automation event for the next render
+         */
+        void automate(const AutomationEvent &event);
+
+        /**
+         * Remove all scheduled automation events
+         */
+        void clearAutomation();
+
+        /**
+         * Play the track from the current position, rendering the mix.
+         *
+         * @param seconds - length of audio to render
+         *
+         * @return interleaved float samples, `channels()` per frame
+         */
+        [[nodiscard]]
+        std::vector<float> render(double seconds);
+
+        /**
+         * Set whether `render` also captures each stem's output after its
+         * channel fader, retrievable from `stems` afterward. Stems are
+         * captured from the channel set playing when the render starts, so
+         * they are only complete for renders without transitions.
+         */
+        void captureStems(bool capture);
+
+        /**
+         * Stem outputs of the last render, in channel order. Empty if stems
+         * were not captured.
+         */
+        [[nodiscard]]
+        const std::vector<RenderBuffer> &stems() const;
+
+        /**
+         * Render and write the mix to a 32-bit float WAV file
+         *
+         * @param path    - path of the file to write
+         * @param seconds - length of audio to render
+         */
+        void renderToWav(const std::string &path, double seconds);
+
+        /**
+         * Number of interleaved channels in rendered output
+         */
+        [[nodiscard]]
+        int channels() const;
+
+        [[nodiscard]]
+        int samplerate() const;
+
+        [[nodiscard]]
+        MultiTrackAudio &track();
+    private:
+        /**
+         * Create the Lua driver, its environment populated with native track
+         * functions
+         */
+        [[nodiscard]]
+        LuaDriver *createScriptingEngine();
+
+        [[nodiscard]]
+        LuaDriver *scriptingEngine() const;
+
+        /**
+         * Send playback events of the track's last update to the script
+         */
+        void doEvents();
+
+        void apply(const AutomationEvent &event);
+
+        /**
+         * Add a capture DSP after each stem's channel fader
+         */
+        void attachStemCaptures();
+        void detachStemCaptures();
+
+        void setParameter(const std::string &name, float value);
+
+        [[nodiscard]]
+        std::optional<float> getParameter(const std::string &name) const;
+
+        // Backend of the script's track functions
+        struct ScriptEnv;
+
+        // Pimpl idiom
+        struct Impl;
+        Impl *m;
+    };
+}
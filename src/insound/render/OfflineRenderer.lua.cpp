@@ -0,0 +1,224 @@
+#include "OfflineRenderer.h"
+
+#include <insound/MultiTrackAudio.h>
+#include <insound/scripting/LuaDriver.h>
+#include <insound/scripting/TrackEnv.h>
+#include <insound/scripting/lua.hpp>
+
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+namespace Insound
+{
+    /**
+     * Same API as MultiTrackControl's environment, backed directly by the
+     * track instead of the frontend. Fade times of mix functions are
+     * ignored, since there is no UI to animate them.
+     */
+    struct OfflineRenderer::ScriptEnv : Scripting::TrackEnv
+    {
+        explicit ScriptEnv(OfflineRenderer &renderer) : renderer(renderer),
+            track(renderer.track())
+        { }
+
+        OfflineRenderer &renderer;
+        MultiTrackAudio &track;
+
+        void print(int level, const std::string &name,
+            const std::string &message) override
+        {
+            (level >= 2 ? std::cerr : std::cout) << '[' << name << "] " <<
+                message << '\n';
+        }
+
+        void clearConsole() override { }
+
+        void pause(bool value, float seconds) override
+        {
+            track.pause(value, seconds);
+        }
+
+        bool paused() const override { return track.paused(); }
+
+        void position(double seconds) override { track.position(seconds); }
+        double position() const override { return track.position(); }
+        double length() const override { return track.length(); }
+
+        void transitionTo(float position, float inTime, bool fadeIn,
+            float outTime, bool fadeOut, unsigned long long clock) override
+        {
+            track.transitionTo(position, inTime, fadeIn, outTime, fadeOut,
+                clock);
+        }
+
+        int playStinger(const std::string &name, int quantize, int priority,
+            float volume) override
+        {
+            return track.playStinger(name, static_cast<Quantize>(quantize),
+                priority, volume);
+        }
+
+        void volume(int ch, float value, float) override
+        {
+            if (ch == 0)
+                track.mainVolume(value);
+            else
+                track.channelVolume(ch - 1, value);
+        }
+
+        float volume(int ch) const override
+        {
+            return (ch == 0) ? track.mainVolume() :
+                track.channelVolume(ch - 1);
+        }
+
+        void panLeft(int ch, float value, float) override
+        {
+            if (ch == 0)
+                track.mainPanLeft(value);
+            else
+                track.channelPanLeft(ch - 1, value);
+        }
+
+        float panLeft(int ch) const override
+        {
+            return (ch == 0) ? track.mainPanLeft() :
+                track.channelPanLeft(ch - 1);
+        }
+
+        void panRight(int ch, float value, float) override
+        {
+            if (ch == 0)
+                track.mainPanRight(value);
+            else
+                track.channelPanRight(ch - 1, value);
+        }
+
+        float panRight(int ch) const override
+        {
+            return (ch == 0) ? track.mainPanRight() :
+                track.channelPanRight(ch - 1);
+        }
+
+        void reverbLevel(int ch, float value, float) override
+        {
+            if (ch == 0)
+                track.mainReverbLevel(value);
+            else
+                track.channelReverbLevel(ch - 1, value);
+        }
+
+        float reverbLevel(int ch) const override
+        {
+            return (ch == 0) ? track.mainReverbLevel() :
+                track.channelReverbLevel(ch - 1);
+        }
+
+        void priority(int ch, int value) override
+        {
+            if (ch == 0)
+                track.priority(value);
+            else
+                track.channelPriority(ch - 1, value);
+        }
+
+        int priority(int ch) const override
+        {
+            return (ch == 0) ? track.priority() :
+                track.channelPriority(ch - 1);
+        }
+
+        int channelCount() const override { return track.channelCount(); }
+
+        void loopPoint(double loopstart, double loopend) override
+        {
+            track.loopMilliseconds(loopstart, loopend);
+        }
+
+        LoopInfo<double> loopPoint() const override
+        {
+            return track.loopMilliseconds();
+        }
+
+        int markerCount() const override
+        {
+            return (int)track.getSyncPointCount();
+        }
+
+        std::optional<Scripting::Marker> marker(
+            const std::variant<int, std::string> &indexOrName) const override
+        {
+            const auto count = (int)track.getSyncPointCount();
+            int index = -1;
+            if (indexOrName.index() == 0)
+            {
+                index = std::get<int>(indexOrName);
+            }
+            else
+            {
+                const auto &name = std::get<std::string>(indexOrName);
+                for (int i = 0; i < count; ++i)
+                {
+                    if (track.getSyncPointLabel(i) == name)
+                    {
+                        index = i;
+                        break;
+                    }
+                }
+            }
+
+            if (index < 0 || index >= count)
+                return {};
+
+            return Scripting::Marker{
+                .name=std::string(track.getSyncPointLabel(index)),
+                .position=track.getSyncPointOffsetSeconds(index),
+            };
+        }
+
+        // Parameters are declared by automation, not by the script, and
+        // only have names
+        void addParameter(const std::string &) override { }
+
+        void parameter(const std::variant<int, std::string> &indexOrName,
+            float value) override
+        {
+            if (indexOrName.index() == 0)
+                throw std::runtime_error("Offline renders set parameters by "
+                    "name");
+
+            renderer.setParameter(std::get<std::string>(indexOrName), value);
+        }
+
+        std::optional<float> parameter(
+            const std::variant<int, std::string> &indexOrName) const override
+        {
+            if (indexOrName.index() == 0)
+                return {};
+            return renderer.getParameter(std::get<std::string>(indexOrName));
+        }
+    };
+
+    LuaDriver *OfflineRenderer::createScriptingEngine()
+    {
+        // Owned by the driver's environment callback, outliving its state
+        auto backend = std::make_shared<ScriptEnv>(*this);
+        auto populateEnv = [this, backend](sol::table &env)
+        {
+            Scripting::TrackEnv::inject(*backend, scriptingEngine(), env);
+        };
+
+        auto lua = new LuaDriver(populateEnv);
+        lua->setErrorCallback(
+            [](const std::string &message, int line)
+        {
+            std::cerr << "[ERROR] line " << line << ": " << message << '\n';
+        });
+
+        return lua;
+    }
+}
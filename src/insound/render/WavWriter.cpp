@@ -0,0 +1,73 @@
+#include "WavWriter.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Insound
+{
+    // WAVE_FORMAT_IEEE_FLOAT
+    static const uint16_t FormatFloat = 3;
+
+    /**
+     * Write an integer in little-endian byte order
+     */
+    template <typename T>
+    static void writeLE(std::ostream &out, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); ++i)
+            out.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+
+    void writeWav(std::ostream &out, const float *samples, size_t frames,
+        int channels, int samplerate)
+    {
+        if (channels <= 0 || samplerate <= 0)
+            throw std::invalid_argument("writeWav: channels and samplerate "
+                "must be greater than 0");
+
+        const uint16_t blockAlign = channels * sizeof(float);
+        const auto dataSize = (uint32_t)(frames * blockAlign);
+
+        out.write("RIFF", 4);
+        writeLE<uint32_t>(out, 36 + dataSize);
+        out.write("WAVE", 4);
+
+        out.write("fmt ", 4);
+        writeLE<uint32_t>(out, 16);
+        writeLE<uint16_t>(out, FormatFloat);
+        writeLE<uint16_t>(out, channels);
+        writeLE<uint32_t>(out, samplerate);
+        writeLE<uint32_t>(out, samplerate * blockAlign);
+        writeLE<uint16_t>(out, blockAlign);
+        writeLE<uint16_t>(out, sizeof(float) * 8);
+
+        out.write("data", 4);
+        writeLE<uint32_t>(out, dataSize);
+
+        const auto count = frames * channels;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t bits;
+            static_assert(sizeof(bits) == sizeof(float));
+            std::memcpy(&bits, &samples[i], sizeof(float));
+            writeLE<uint32_t>(out, bits);
+        }
+    }
+
+    void writeWav(const std::string &path, const float *samples,
+        size_t frames, int channels, int samplerate)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("writeWav: could not open \"" + path +
+                "\" for writing");
+
+        writeWav(file, samples, frames, channels, samplerate);
+
+        if (!file)
+            throw std::runtime_error("writeWav: failed writing \"" + path +
+                "\"");
+    }
+}
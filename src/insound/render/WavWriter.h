@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace Insound
+{
+    /**
+     * Write interleaved float samples as a 32-bit IEEE float WAV file
+     *
+     * @param out        - stream to write to, opened in binary mode
+     * @param samples    - interleaved sample data
+     * @param frames     - number of sample frames (samples per channel)
+     * @param channels   - number of interleaved channels
+     * @param samplerate - sample rate in Hz
+     */
+    void writeWav(std::ostream &out, const float *samples, size_t frames,
+        int channels, int samplerate);
+
+    /**
+     * Write interleaved float samples to a 32-bit IEEE float WAV file.
+     * Throws a runtime_error if the file could not be written.
+     *
+     * @param path - path of the file to create or overwrite
+     *
+     * See the stream overload for other parameters.
+     */
+    void writeWav(const std::string &path, const float *samples,
+        size_t frames, int channels, int samplerate);
+}
@@ -0,0 +1,88 @@
+#include "ChunkCache.h"
+
+#include <insound/MemoryBudget.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace Insound
+{
+    ChunkCache::ChunkCache(size_t maxEntries) : m_entries(),
+        m_maxEntries(std::max<size_t>(maxEntries, 1)), m_mutex()
+    { }
+
+    ChunkCache::~ChunkCache()
+    {
+        clear();
+    }
+
+    std::optional<std::string> ChunkCache::find(std::string_view source)
+    {
+        const auto hash = std::hash<std::string_view>{}(source);
+
+        std::lock_guard lock(m_mutex);
+        auto it = std::find_if(m_entries.begin(), m_entries.end(),
+            [hash, source](const Entry &entry) {
+                return entry.hash == hash && entry.source == source;
+            });
+        if (it == m_entries.end())
+            return {};
+
+        // Move to the back, as most recently used
+        std::rotate(it, it + 1, m_entries.end());
+        return m_entries.back().bytecode;
+    }
+
+    void ChunkCache::insert(std::string_view source, std::string bytecode)
+    {
+        const auto hash = std::hash<std::string_view>{}(source);
+
+        std::lock_guard lock(m_mutex);
+        auto it = std::find_if(m_entries.begin(), m_entries.end(),
+            [hash, source](const Entry &entry) {
+                return entry.hash == hash && entry.source == source;
+            });
+        if (it != m_entries.end())
+            erase(it);
+        else if (m_entries.size() >= m_maxEntries)
+            erase(m_entries.begin());
+
+        if (!MemoryBudget::reserve(MemoryCategory::Lua,
+            source.size() + bytecode.size()))
+        {
+            return;
+        }
+
+        m_entries.emplace_back(Entry {
+            .hash=hash,
+            .source=std::string(source),
+            .bytecode=std::move(bytecode),
+        });
+    }
+
+    void ChunkCache::clear()
+    {
+        std::lock_guard lock(m_mutex);
+        for (const auto &entry : m_entries)
+            MemoryBudget::release(MemoryCategory::Lua, entry.bytes());
+        m_entries.clear();
+    }
+
+    size_t ChunkCache::size() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_entries.size();
+    }
+
+    void ChunkCache::erase(std::vector<Entry>::iterator it)
+    {
+        MemoryBudget::release(MemoryCategory::Lua, it->bytes());
+        m_entries.erase(it);
+    }
+
+    ChunkCache &ChunkCache::shared()
+    {
+        static ChunkCache cache;
+        return cache;
+    }
+}
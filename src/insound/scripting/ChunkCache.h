@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Insound
+{
+    /**
+     * Bytecode of compiled scripts, keyed by a hash of their source, so
+     * that loading a script again, on reloads or on other tracks, skips
+     * parsing. Keeps the most recently used entries. Thread-safe.
+     *
+     * Entries count as `MemoryCategory::Lua` memory. Scripts that don't fit
+     * the memory budget are not cached, and are parsed on each load.
+     */
+    class ChunkCache
+    {
+    public:
+        /**
+         * @param maxEntries - number of scripts kept
+         */
+        explicit ChunkCache(size_t maxEntries = 16);
+        ~ChunkCache();
+
+        ChunkCache(const ChunkCache &) = delete;
+        ChunkCache &operator=(const ChunkCache &) = delete;
+
+        /**
+         * Get the bytecode of a script, marking it recently used
+         *
+         * @param source - source code of the script
+         *
+         * @return the bytecode, or nothing if it is not cached
+         */
+        [[nodiscard]]
+        std::optional<std::string> find(std::string_view source);
+
+        /**
+         * Store the bytecode of a script, evicting the least recently used
+         * entry if full. Does nothing if it exceeds the memory budget.
+         *
+         * @param source   - source code of the script
+         * @param bytecode - its compiled chunk
+         */
+        void insert(std::string_view source, std::string bytecode);
+
+        /**
+         * Remove all entries
+         */
+        void clear();
+
+        [[nodiscard]]
+        size_t size() const;
+
+        /**
+         * Cache shared by all scripting drivers of the process
+         */
+        [[nodiscard]]
+        static ChunkCache &shared();
+
+    private:
+        struct Entry
+        {
+            size_t hash;
+            std::string source;
+            std::string bytecode;
+
+            /**
+             * Bytes accounted to the memory budget
+             */
+            [[nodiscard]]
+            size_t bytes() const { return source.size() + bytecode.size(); }
+        };
+
+        /**
+         * Remove an entry and release its memory. Expects the lock held.
+         */
+        void erase(std::vector<Entry>::iterator it);
+
+        // Most recently used last
+        std::vector<Entry> m_entries;
+        size_t m_maxEntries;
+        mutable std::mutex m_mutex;
+    };
+}
@@ -1,18 +1,42 @@
 #include "LuaDriver.h"
+#include "ChunkCache.h"
 #include "lua.hpp"
 
+#include <insound/MemoryBudget.h>
+#include <insound/MultiTrackAudio.h>
+#include <insound/SyncPointMgr.h>
+#include <insound/TrackEvent.h>
 #include <insound/params/ParamDesc.h>
+#include <insound/profiling/Profiler.h>
 
-static auto DriverScript =
-#include <insound/embed/driver.lua.h>
+// driver.lua, compiled by insound-luac at build time
+static const unsigned char DriverBytecode[] =
+#include <insound/embed/driver.luac.h>
 ;
 
+#include <array>
 #include <charconv>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 
 static auto NoErrors = "no errors.";
 
+/** Names of the script's event handlers, by `LuaDriver::Handler` */
+static constexpr std::string_view HandlerNames[] = {
+    "on_init",
+    "on_ready",
+    "on_unload",
+    "on_update",
+    "on_marker",
+    "on_track_end",
+    "on_loop",
+    "on_underrun",
+    "on_param",
+};
+
 namespace Insound
 {
 
@@ -74,14 +98,107 @@ namespace Insound
     }
 
 
+    static int writeChunk(lua_State *, const void *data, size_t size,
+        void *ud)
+    {
+        static_cast<std::string *>(ud)->append(
+            static_cast<const char *>(data), size);
+        return 0;
+    }
+
+    /**
+     * Compile a user script to bytecode, or get it from the shared cache if
+     * the same source was compiled before
+     *
+     * @param lua    - state to compile in
+     * @param source - source code of the script
+     *
+     * @throw std::runtime_error with Lua's message if the script does not
+     *        compile
+     */
+    static std::string compileScript(sol::state &lua, std::string_view source)
+    {
+        auto &cache = ChunkCache::shared();
+        if (auto bytecode = cache.find(source))
+            return std::move(*bytecode);
+
+        // Named after its source like Lua's `load` does, for the same error
+        // format: [string "<first line>"]:<line>:<message>
+        const auto L = lua.lua_state();
+        const std::string name(source);
+        if (luaL_loadbufferx(L, source.data(), source.size(), name.c_str(),
+            "t") != LUA_OK)
+        {
+            std::string message = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            throw std::runtime_error(message);
+        }
+
+        std::string bytecode;
+        lua_dump(L, writeChunk, &bytecode, 0);
+        lua_pop(L, 1);
+
+        cache.insert(source, bytecode);
+        return bytecode;
+    }
+
+    /**
+     * Handlers defined by a script, kept up to date by the driver's
+     * `set_handler` as the script assigns them
+     */
+    struct LuaDriver::Handlers
+    {
+        static_assert(std::size(HandlerNames) == (size_t)Handler::MaxCount,
+            "every LuaDriver handler needs a name");
+
+        Handlers() : functions(), mask() { }
+
+        /**
+         * Cache the value assigned to a handler name, functions only
+         */
+        void set(std::string_view name, const sol::object &value)
+        {
+            for (size_t i = 0; i < std::size(HandlerNames); ++i)
+            {
+                if (HandlerNames[i] != name)
+                    continue;
+
+                if (value.get_type() == sol::type::function)
+                {
+                    functions[i] = value.as<sol::main_protected_function>();
+                    mask |= 1u << i;
+                }
+                else
+                {
+                    functions[i] = sol::main_protected_function();
+                    mask &= ~(1u << i);
+                }
+                return;
+            }
+        }
+
+        [[nodiscard]]
+        bool has(Handler handler) const
+        {
+            return mask & (1u << (unsigned)handler);
+        }
+
+        std::array<sol::main_protected_function, (size_t)Handler::MaxCount>
+            functions;
+        // Bit per `Handler` the script defines
+        unsigned mask;
+    };
+
     /**
      * Implementation class for LuaDriver
      */
-    struct LuaDriver::Impl
+    struct LuaDriver::Impl : EngineObject
     {
         Impl(const std::function<void(sol::table &)> &populateEnv)
-        : error(NoErrors), script(), lua(), onError(),
-        populateEnv(populateEnv)
+        : error(NoErrors), script(),
+        lua(sol::default_at_panic, MemoryBudget::luaAlloc),
+        handlers(std::make_unique<Handlers>()), populateEnv(populateEnv),
+        onError(), profiler()
         {
         }
 
@@ -91,9 +208,13 @@ namespace Insound
         std::string script;
         // lua context
         sol::state lua;
+        // handlers of the loaded script, referencing `lua`
+        std::unique_ptr<Handlers> handlers;
         // callback populatates the env from owner
         std::function<void(sol::table &)> populateEnv;
         std::function<void(const std::string &, int)> onError;
+        // times each event, optional
+        Profiler *profiler;
     };
 
     LuaDriver::LuaDriver(const std::function<void(sol::table &)> &populateEnv)
@@ -109,8 +230,9 @@ namespace Insound
     {
         try
         {
-            // Create the lua state, providing std lib
-            sol::state lua;
+            // Create the lua state, providing std lib, counted against the
+            // memory budget
+            sol::state lua(sol::default_at_panic, MemoryBudget::luaAlloc);
             lua.open_libraries(
                 sol::lib::base,
                 sol::lib::coroutine,
@@ -120,19 +242,28 @@ namespace Insound
                 sol::lib::utf8
             );
 
-            // Event type enum used by `process_event` reducer
-            lua["Event"] = lua.create_table_with(
-                "Init", Event::Init,
-                "Update", Event::Update,
-                "SyncPoint", Event::SyncPoint,
-                "Load", Event::Load,
-                "Unload", Event::Unload,
-                "TrackEnd", Event::TrackEnd,
-                "ParamSet", Event::ParamSet
-            );
+            // Handlers the script assigns, cached so that events call them
+            // directly, and cost nothing when there is none
+            auto handlers = std::make_unique<Handlers>();
+            lua.set_function("set_handler",
+                [cache = handlers.get()](std::string_view name,
+                    const sol::object &value) {
+                    cache->set(name, value);
+                });
 
             // Load the driver code
-            auto result = lua.script(DriverScript);
+            auto driver = lua.load(std::string_view(
+                reinterpret_cast<const char *>(DriverBytecode),
+                sizeof(DriverBytecode)), "=driver.lua",
+                sol::load_mode::binary);
+            if (!driver.valid())
+            {
+                sol::error err = driver;
+                m->error = err.what();
+                return false;
+            }
+
+            auto result = driver.get<sol::protected_function>()();
             if (!result.valid())
             {
                 sol::error err = result;
@@ -172,19 +303,10 @@ namespace Insound
                     return false;
                 }
 
-                // Just check that this function exists which is used as a reducer
-                // to run events.
-                auto processEvent =
-                    lua.get<sol::unsafe_function>("process_event");
-                if (!processEvent.valid())
-                {
-                    m->error = "failed to get `process_event` function from the "
-                        "Lua sandbox driver code.";
-                    return false;
-                }
-
-                // Finally load the script into the sandbox
-                result = loadScript(userScript);
+                // Finally load the script into the sandbox, parsed once
+                // per source
+                const auto bytecode = compileScript(lua, userScript);
+                result = loadScript(bytecode);
                 if (!result.valid())
                 {
                     sol::error err = result;
@@ -203,6 +325,7 @@ namespace Insound
 
             // Done, commit changes
             m->script = userScript;
+            m->handlers = std::move(handlers);
             std::swap(m->lua, lua);
             m->error = NoErrors;
 
@@ -286,24 +409,18 @@ namespace Insound
         return m->error;
     }
 
-    bool LuaDriver::doInit()
+    template <typename... Args>
+    bool LuaDriver::dispatch(Handler handler, ProfileSection section,
+        Args &&...args)
     {
-        if (!isLoaded())
-        {
-            doError("Internal error: script is not loaded");
-            return false;
-        }
+        if (!m->handlers->has(handler))
+            return true;
 
-        auto process_event = m->lua["process_event"]
-            .get<sol::protected_function>();
-        if (!process_event.valid())
-        {
-            doError("Internal error: could not get `process_event` function "
-                "from lua driver.");
-            return false;
-        }
+        ProfileScope scope(m->profiler, section);
 
-        auto result = process_event(Event::Init);
+        // Copied, since the handler may reassign itself while it runs
+        auto function = m->handlers->functions[(size_t)handler];
+        auto result = function(std::forward<Args>(args)...);
         if (!result.valid())
         {
             doError(result);
@@ -313,27 +430,23 @@ namespace Insound
         return true;
     }
 
-    bool LuaDriver::doUpdate(double delta, double total)
+    bool LuaDriver::doInit()
     {
-        if (!isLoaded()) return false; // no err set since it may be expensive?
-
-        auto process_event = m->lua["process_event"]
-            .get<sol::protected_function>();
-        if (!process_event.valid())
+        if (!isLoaded())
         {
-            doError("Internal error: could not get `process_event` "
-                "function from lua driver");
+            doError("Internal error: script is not loaded");
             return false;
         }
 
-        auto result = process_event(Event::Update, delta, total);
-        if (!result.valid())
-        {
-            doError(result);
-            return false;
-        }
+        return dispatch(Handler::Init, ProfileSection::LuaInit);
+    }
 
-        return true;
+    bool LuaDriver::doUpdate(double delta, double total)
+    {
+        if (!isLoaded()) return false; // no err set since it may be expensive?
+
+        return dispatch(Handler::Update, ProfileSection::LuaUpdate, delta,
+            total);
     }
 
     bool LuaDriver::doSyncPoint(const std::string &label, double seconds)
@@ -344,23 +457,8 @@ namespace Insound
             return false;
         }
 
-        auto process_event = m->lua["process_event"]
-            .get<sol::protected_function>();
-        if (!process_event.valid())
-        {
-            doError("Internal error: could not get `process_event` function "
-                "from lua driver");
-            return false;
-        }
-
-        auto result = process_event(Event::SyncPoint, label, seconds);
-        if (!result.valid())
-        {
-            doError(result);
-            return false;
-        }
-
-        return true;
+        return dispatch(Handler::Marker, ProfileSection::LuaSyncPoint, label,
+            seconds);
     }
 
     bool LuaDriver::doLoad(const MultiTrackAudio &track)
@@ -371,23 +469,7 @@ namespace Insound
             return false;
         }
 
-        auto process_event = m->lua["process_event"]
-            .get<sol::protected_function>();
-        if (!process_event.valid())
-        {
-            doError("Internal error: could not get `process_event` function "
-                "from lua driver.");
-            return false;
-        }
-
-        auto result = process_event(Event::Load);
-        if (!result.valid())
-        {
-            doError(result);
-            return false;
-        }
-
-        return true;
+        return dispatch(Handler::Ready, ProfileSection::LuaLoad);
     }
 
     bool LuaDriver::doUnload()
@@ -398,47 +480,74 @@ namespace Insound
             return false;
         }
 
-        auto process_event = m->lua["process_event"]
-            .get<sol::unsafe_function>();
-        if (!process_event.valid())
-        {
-            doError("Internal error: could not get `process_event` function "
-                "from lua driver.");
-            return false;
-        }
+        return dispatch(Handler::Unload, ProfileSection::LuaUnload);
+    }
 
-        auto result = process_event(Event::Unload);
-        if (!result.valid())
+    bool LuaDriver::doTrackEnd()
+    {
+        if (!isLoaded())
         {
-            doError(result);
+            doError("Internal error: script is not loaded");
             return false;
         }
 
-        return true;
+        return dispatch(Handler::TrackEnd, ProfileSection::LuaTrackEnd);
     }
 
-    bool LuaDriver::doTrackEnd()
+    bool LuaDriver::doEvents(const std::vector<TrackEvent> &events,
+        const MultiTrackAudio &track)
     {
+        if (events.empty()) return true;
+
         if (!isLoaded())
         {
             doError("Internal error: script is not loaded");
             return false;
         }
 
-        auto process_event = m->lua["process_event"]
-            .get<sol::unsafe_function>();
-        if (!process_event.valid())
-        {
-            doError("Could not get `process_event` function from lua "
-                "driver.");
-            return false;
-        }
+        const auto &handlers = *m->handlers;
+        if (!handlers.has(Handler::Marker) &&
+            !handlers.has(Handler::TrackEnd) &&
+            !handlers.has(Handler::Loop) &&
+            !handlers.has(Handler::Underrun))
+            return true;
 
-        auto result = process_event(Event::TrackEnd);
-        if (!result.valid())
+        const auto &points = track.syncPoints();
+        const double rate = track.samplerate();
+
+        for (const auto &event : events)
         {
-            doError(result);
-            return false;
+            const auto seconds = event.offset / rate;
+
+            bool ok = true;
+            switch (event.type)
+            {
+            case TrackEvent::Type::SyncPoint:
+                // label is false if the point is gone
+                if (event.index < points.size())
+                    ok = dispatch(Handler::Marker, ProfileSection::LuaEvents,
+                        points.getLabel(event.index), seconds);
+                else
+                    ok = dispatch(Handler::Marker, ProfileSection::LuaEvents,
+                        false, seconds);
+                break;
+            case TrackEvent::Type::End:
+                ok = dispatch(Handler::TrackEnd, ProfileSection::LuaEvents);
+                break;
+            case TrackEvent::Type::LoopWrap:
+                ok = dispatch(Handler::Loop, ProfileSection::LuaEvents,
+                    seconds);
+                break;
+            case TrackEvent::Type::Underrun:
+                ok = dispatch(Handler::Underrun, ProfileSection::LuaEvents,
+                    seconds);
+                break;
+            default:
+                break;
+            }
+
+            if (!ok)
+                return false;
         }
 
         return true;
@@ -471,32 +580,16 @@ namespace Insound
             return false;
         }
 
-        auto process_event = m->lua["process_event"]
-            .get<sol::unsafe_function>();
-        if (!process_event.valid())
-        {
-            doError("Could not get `process_event` function from lua "
-                "driver.");
-            return false;
-        }
-
-        sol::unsafe_function_result result;
         if (value.index() == 0)
         {
-            result = process_event(Event::ParamSet, paramName, std::get<float>(value));
+            return dispatch(Handler::Param, ProfileSection::LuaParam,
+                paramName, std::get<float>(value));
         }
         else
         {
-            result = process_event(Event::ParamSet, paramName, std::get<std::string>(value));
+            return dispatch(Handler::Param, ProfileSection::LuaParam,
+                paramName, std::get<std::string>(value));
         }
-
-        if (!result.valid())
-        {
-            doError(result);
-            return false;
-        }
-
-        return true;
     }
 
     const sol::state &LuaDriver::context() const
@@ -514,4 +607,9 @@ namespace Insound
     {
         m->onError = callback;
     }
+
+    void LuaDriver::setProfiler(Profiler *profiler)
+    {
+        m->profiler = profiler;
+    }
 }
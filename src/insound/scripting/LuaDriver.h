@@ -24,11 +24,15 @@ namespace sol {
 #include <string>
 #include <string_view>
 #include <variant>
+#include <vector>
 
 namespace Insound
 {
     class MultiTrackAudio;
     class ParamDesc;
+    class Profiler;
+    struct TrackEvent;
+    enum class ProfileSection;
 
     class LuaDriver
     {
@@ -85,6 +89,17 @@ namespace Insound
         bool doUnload();
         bool doTrackEnd();
 
+        /**
+         * Dispatch a batch of playback events to the script in one call:
+         * sync points to `on_marker`, the track end to `on_track_end`, loop
+         * wraps to `on_loop` and output underruns to `on_underrun`
+         *
+         * @param events - events polled from the track
+         * @param track  - track the events came from, for sync point labels
+         */
+        bool doEvents(const std::vector<TrackEvent> &events,
+            const MultiTrackAudio &track);
+
         // To be called by the AudioEngine from JavaScript to let our Lua
         // API know that a parameter has been set.
         bool doParam(const std::string &paramName, std::variant<float, std::string> value);
@@ -98,6 +113,12 @@ namespace Insound
          */
         void setErrorCallback(const std::function<void(const std::string &, int)> &callback);
 
+        /**
+         * Set the profiler that times each Lua event, or nullptr for none.
+         * It must outlive the driver.
+         */
+        void setProfiler(Profiler *profiler);
+
         [[nodiscard]]
         sol::state &context();
         [[nodiscard]]
@@ -106,17 +127,33 @@ namespace Insound
         void doError(std::string_view message);
         void doError(const sol::error &err);
 
-        enum class Event {
+        /**
+         * Event handlers a script may define, in the order of their names
+         * in `LuaDriver.cpp`
+         */
+        enum class Handler {
             Init,
-            Update,
-            SyncPoint,
-            Load,
+            Ready,
             Unload,
+            Update,
+            Marker,
             TrackEnd,
-            ParamSet,
+            Loop,
+            Underrun,
+            Param,
             MaxCount, // leave this last
         };
-        
+
+        /**
+         * Call a script's handler directly, or nothing if it has none
+         *
+         * @return false if the handler raised an error
+         */
+        template <typename... Args>
+        bool dispatch(Handler handler, ProfileSection section,
+            Args &&...args);
+
+        struct Handlers;
         struct Impl;
         Impl *m;
     };
@@ -0,0 +1,165 @@
+#include "TrackEnv.h"
+#include "LuaError.h"
+#include "lua.hpp"
+
+namespace Insound::Scripting
+{
+    void TrackEnv::inject(TrackEnv &backend, LuaDriver *driver,
+        sol::table &env)
+    {
+        auto api = &backend;
+
+        env.set_function("raw_print", [api](int level, std::string name, std::string message)
+        {
+            api->print(level, name, message);
+        });
+
+        env.set_function("clear", [api]()
+        {
+            api->clearConsole();
+        });
+
+        Marker::inject("Marker", env);
+
+        auto snd = env["track"].get_or_create<sol::table>();
+
+        snd.set_function("play", [api](std::optional<float> seconds={})
+        {
+            api->pause(false, seconds.value_or(0));
+        });
+
+        snd.set_function("pause", [api](std::optional<float> seconds={})
+        {
+            api->pause(true, seconds.value_or(0));
+        });
+
+        snd.set_function("paused",
+        [api](std::optional<bool> pause={}, std::optional<float> seconds={})
+        {
+            if (pause)
+                api->pause(pause.value(), seconds.value_or(0));
+            return api->paused();
+        });
+
+        snd.set_function("position",
+        [api](std::optional<double> seconds={})
+        {
+            if (seconds)
+                api->position(seconds.value());
+            return api->position();
+        });
+
+        snd.set_function("transition_to",
+        [api](float position, float inTime, bool fadeIn, float outTime, bool fadeOut, std::optional<unsigned long long> clock={})
+        {
+            api->transitionTo(position, inTime, fadeIn, outTime, fadeOut,
+                clock.value_or(0));
+        });
+
+        snd.set_function("play_stinger",
+        [api](const std::string &name, std::optional<int> quantize={}, std::optional<int> priority={}, std::optional<float> volume={})
+        {
+            return api->playStinger(name, quantize.value_or(0),
+                priority.value_or(0), volume.value_or(1.f));
+        });
+
+        snd.set_function("volume",
+        [api](std::optional<int> ch={}, std::optional<float> value={}, std::optional<float> seconds={})
+        {
+            if (value)
+                api->volume(ch.value_or(0), value.value(), seconds.value_or(0));
+            return api->volume(ch.value_or(0));
+        });
+
+        snd.set_function("pan_left",
+        [api](std::optional<int> ch={}, std::optional<float> value={}, std::optional<float> seconds={})
+        {
+            if (value)
+                api->panLeft(ch.value_or(0), value.value(), seconds.value_or(0));
+            return api->panLeft(ch.value_or(0));
+        });
+
+        snd.set_function("pan_right",
+        [api](std::optional<int> ch={}, std::optional<float> value={}, std::optional<float> seconds={})
+        {
+            if (value)
+                api->panRight(ch.value_or(0), value.value(), seconds.value_or(0));
+            return api->panRight(ch.value_or(0));
+        });
+
+        snd.set_function("reverb_level",
+        [api](std::optional<int> ch={}, std::optional<float> value={}, std::optional<float> seconds={})
+        {
+            if (value)
+                api->reverbLevel(ch.value_or(0), value.value(), seconds.value_or(0));
+            return api->reverbLevel(ch.value_or(0));
+        });
+
+        snd.set_function("priority",
+        [api](std::optional<int> ch={}, std::optional<int> value={})
+        {
+            if (value)
+                api->priority(ch.value_or(0), value.value());
+            return api->priority(ch.value_or(0));
+        });
+
+        snd.set_function("channel_count", [api]()
+        {
+            return api->channelCount();
+        });
+
+        snd.set_function("loop_point", // loopstart and loopend in milliseconds
+        [api](std::optional<double> loopstart={}, std::optional<double> loopend={})
+        {
+            if (loopstart)
+            {
+                api->loopPoint(loopstart.value(),
+                    loopend.value_or(api->length() * 1000.0));
+            }
+
+            return api->loopPoint();
+        });
+
+        // marker namespace
+        auto marker = snd["marker"].get_or_create<sol::table>();
+        marker.set_function("count", [api]()
+        {
+            return api->markerCount();
+        });
+        marker.set_function("get",
+        [api, driver](std::variant<int, std::string> indexOrName)
+        {
+            if (indexOrName.index() == 0)
+                indexOrName = std::get<int>(indexOrName) - 1; // lua indexes from 1
+
+            auto result = api->marker(indexOrName);
+            if (!result)
+                throw LuaError(driver, "marker does not exist");
+
+            return result.value();
+        });
+
+        auto param = snd["param"].get_or_create<sol::table>();
+        param.set_function("raw_add", [api](std::string config)
+        {
+            api->addParameter(config);
+        });
+        param.set_function("set",
+        [api](std::variant<int, std::string> indexOrName, float value)
+        {
+            api->parameter(indexOrName, value);
+        });
+        param.set_function("get",
+        [api, driver](std::variant<int, std::string> indexOrName)
+        {
+            auto value = api->parameter(indexOrName);
+            if (!value)
+            {
+                throw LuaError(driver,
+                    "Attempted to index a non-existent parameter");
+            }
+
+            return value.value();
+        });
+    }
+}
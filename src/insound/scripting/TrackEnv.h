@@ -0,0 +1,117 @@
+#pragma once
+#include <insound/LoopInfo.h>
+#include <insound/scripting/Marker.h>
+
+#include <sol/forward.hpp>
+
+#include <optional>
+#include <string>
+#include <variant>
+
+namespace Insound
+{
+    class LuaDriver;
+}
+
+namespace Insound::Scripting
+{
+    /**
+     * Backend of the `track` table, shared by the scripting environments of
+     * the frontend and of offline renders. Each environment implements it
+     * over its own source of truth, and `inject` binds it to Lua the same
+     * way for both.
+     *
+     * Channel index 0 is the main bus, stems start at 1. Fade times are in
+     * seconds, and may be ignored where there is nothing to animate.
+     */
+    class TrackEnv
+    {
+    public:
+        virtual ~TrackEnv() = default;
+
+        /**
+         * Bind the environment to a Lua table: `raw_print`, `clear`, the
+         * `Marker` type, and the `track` table with its `marker` and
+         * `param` namespaces
+         *
+         * @param backend - implementation, must outlive the Lua state
+         * @param driver  - driver running the environment, for errors
+         * @param env     - table to populate
+         */
+        static void inject(TrackEnv &backend, LuaDriver *driver,
+            sol::table &env);
+
+        virtual void print(int level, const std::string &name,
+            const std::string &message) = 0;
+        virtual void clearConsole() = 0;
+
+        virtual void pause(bool value, float seconds) = 0;
+        [[nodiscard]]
+        virtual bool paused() const = 0;
+
+        virtual void position(double seconds) = 0;
+        [[nodiscard]]
+        virtual double position() const = 0;
+        [[nodiscard]]
+        virtual double length() const = 0;
+
+        virtual void transitionTo(float position, float inTime, bool fadeIn,
+            float outTime, bool fadeOut, unsigned long long clock) = 0;
+
+        /**
+         * @return voice slot, or -1 if all voices were busy with higher
+         *         priority stingers. Throws if the stinger is not loaded.
+         */
+        virtual int playStinger(const std::string &name, int quantize,
+            int priority, float volume) = 0;
+
+        virtual void volume(int ch, float value, float seconds) = 0;
+        [[nodiscard]]
+        virtual float volume(int ch) const = 0;
+        virtual void panLeft(int ch, float value, float seconds) = 0;
+        [[nodiscard]]
+        virtual float panLeft(int ch) const = 0;
+        virtual void panRight(int ch, float value, float seconds) = 0;
+        [[nodiscard]]
+        virtual float panRight(int ch) const = 0;
+        virtual void reverbLevel(int ch, float value, float seconds) = 0;
+        [[nodiscard]]
+        virtual float reverbLevel(int ch) const = 0;
+        virtual void priority(int ch, int value) = 0;
+        [[nodiscard]]
+        virtual int priority(int ch) const = 0;
+
+        [[nodiscard]]
+        virtual int channelCount() const = 0;
+
+        /** Loop points in milliseconds */
+        virtual void loopPoint(double loopstart, double loopend) = 0;
+        [[nodiscard]]
+        virtual LoopInfo<double> loopPoint() const = 0;
+
+        [[nodiscard]]
+        virtual int markerCount() const = 0;
+        /**
+         * Get a marker by index from 0, or by name, or nothing if it does
+         * not exist
+         */
+        [[nodiscard]]
+        virtual std::optional<Marker> marker(
+            const std::variant<int, std::string> &indexOrName) const = 0;
+
+        virtual void addParameter(const std::string &config) = 0;
+        /**
+         * Parameters are addressed by index, as passed from the script, or
+         * by name
+         */
+        virtual void parameter(
+            const std::variant<int, std::string> &indexOrName,
+            float value) = 0;
+        /**
+         * @return the parameter's value, or nothing if it does not exist
+         */
+        [[nodiscard]]
+        virtual std::optional<float> parameter(
+            const std::variant<int, std::string> &indexOrName) const = 0;
+    };
+}
@@ -57,6 +57,60 @@ function track.channel_volume(channel, volume) end
 ---@return number - number of channels on the current track.
 function track.channel_count() end
 
+---
+---Set the voice priority of the track or one of its channels. When the
+---engine's real voice budget is exceeded, the least important and least
+---audible channels are virtualized first. If no value is passed to
+---`priority`, it will instead return the current priority.
+---
+---@param channel? number - 0 for the whole track (default), or a channel
+---                         ranging from 1 to max channels
+---@param priority? number - track priority from 0 (most important) to 256,
+---                          128 by default, or a channel's offset to it,
+---                          negative being more important
+---@return number - current priority of `channel`
+function track.priority(channel, priority) end
+
+---
+---Play a stinger loaded on the track over its channels
+---
+---@param name string - name of the stinger
+---@param quantize? number - boundary to start at: 0 now (default), 1 next
+---                          beat, 2 next bar, 3 next marker
+---@param priority? number - higher priority stingers steal voices from lower
+---                          ones, the oldest first among equals, 0 by default
+---@param volume? number - volume level (0=off, 1=100%, default)
+---@return number - voice slot playing the stinger, or -1 if every voice was
+---                 busy with a higher priority stinger
+function track.play_stinger(name, quantize, priority, volume) end
+
+
+---------- event handlers -----------------------------------------------------
+
+---
+---Called when the playhead crosses a marker, just ahead of reaching it
+---
+---@param name string|false - label of the marker, false if it was removed
+---@param seconds number - position of the marker in seconds
+function on_marker(name, seconds) end
+
+---
+---Called when the playhead reaches the end of a track that doesn't loop
+function on_track_end() end
+
+---
+---Called when the playhead wraps from the loop end to its start
+---
+---@param seconds number - loop start in seconds
+function on_loop(seconds) end
+
+---
+---Called when the audio output underran and glitched, e.g. because the
+---device was too busy to keep up
+---
+---@param seconds number - playhead position in seconds
+function on_underrun(seconds) end
+
 
 ---------- marker namespace ---------------------------------------------------
 
@@ -4,6 +4,21 @@
 ---Environment for the sandbox
 env = {}
 
+---Event handlers a user script may define, called directly by the engine.
+---They are kept out of `env` itself, so that every assignment to one goes
+---through `__newindex` and reaches `set_handler`, provided by the engine.
+local HANDLER_NAMES <const> = {
+    on_init = true,
+    on_ready = true,
+    on_unload = true,
+    on_update = true,
+    on_marker = true,
+    on_track_end = true,
+    on_loop = true,
+    on_underrun = true,
+    on_param = true,
+}
+
 function table_length(t)
     local count = 0
     for _ in pairs(t) do count = count + 1 end
@@ -134,13 +149,26 @@ function reset_env()
         },
     }
 
+    local handlers = {}
+    setmetatable(env, {
+        __index = handlers,
+        __newindex = function(t, key, value)
+            if HANDLER_NAMES[key] then
+                handlers[key] = value
+                set_handler(key, value)
+            else
+                rawset(t, key, value)
+            end
+        end,
+        __metatable = false,
+    })
 end
 
 ---Load a script and its sandbox environment
----@param untrusted_code string
-function load_script(untrusted_code)
+---@param chunk string bytecode of the user's script, compiled by the engine
+function load_script(chunk)
     local untrusted_func <const>, message <const> =
-        load(untrusted_code, nil, 't', env)
+        load(chunk, nil, 'b', env)
 
     if not untrusted_func then
         error(message)
@@ -174,79 +202,3 @@ function execute_string(untrusted_code)
 
     return tostring(res)
 end
-
---Callback that fires immediately after script load
-local function on_init()
-    if env.on_init ~= nil then
-        env.on_init()
-    end
-end
-
----Callback that fires when the sound bank has been loaded
-local function on_load()
-    if env.on_ready ~= nil then
-        env.on_ready()
-    end
-end
-
----Callback that fires when the sound bank has been unloaded
-local function on_unload()
-    if env.on_unload ~= nil then
-        env.on_unload()
-    end
-end
-
----Callback that fires on each update tick. Occurs ~60+ Hz
----`seconds` is the current time position of the track.
----@param delta number milliseconds between this call to update and the last
----@param totalTime number milliseconds from script load until this update
-local function on_update(delta, totalTime)
-    if env.on_update ~= nil then
-        env.on_update(delta, totalTime)
-    end
-end
-
----Callback that fires when a sync point has been reached
----Calls function `on_syncpoint` only if user provided it in their script
----
----@param label string
----@param seconds number
-local function on_syncpoint(label, seconds)
-    if env.on_marker ~= nil then
-        env.on_marker(label, seconds)
-    end
-end
-
----Callback that fires when a track has reached its maximum time
----Calls function `on_track_end` only if user provided it in their script
-local function on_trackend()
-    if env.on_track_end ~= nil then
-        env.on_track_end()
-    end
-end
-
-local function on_param(name, value)
-    if env.on_param ~= nil then
-        env.on_param(name, value)
-    end
-end
-
-local EV_TABLE <const> = {
-    [Event.Init] = on_init,
-    [Event.Update] = on_update,
-    [Event.SyncPoint] = on_syncpoint,
-    [Event.Load] = on_load,
-    [Event.Unload] = on_unload,
-    [Event.TrackEnd] = on_trackend,
-    [Event.ParamSet] = on_param,
-}
-
-function process_event(ev_type, ...)
-    local callback <const> = EV_TABLE[ev_type]
-    if callback ~= nil then
-        callback(...)
-    else
-        error("Internal error: event type " .. ev_type ..
-            " is not recognized")
-    end
-end
@@ -0,0 +1,45 @@
+#include "test.h"
+#include <insound/AdaptiveLatency.h>
+
+TEST_CASE("AdaptiveLatency backs off after glitches")
+{
+    AdaptiveLatency latency;
+    REQUIRE(latency.profile() == LatencyProfile::Low);
+
+    SECTION("Occasional underruns are tolerated")
+    {
+        REQUIRE_FALSE(latency.observe(1, 10.f, 6.0));
+        REQUIRE_FALSE(latency.observe(1, 10.f, 6.0)); // new window
+        REQUIRE_FALSE(latency.observe(1, 10.f, 1.0));
+        REQUIRE(latency.profile() == LatencyProfile::Low);
+    }
+
+    SECTION("Repeated underruns back off one profile at a time")
+    {
+        REQUIRE_FALSE(latency.observe(2, 10.f, 1.0));
+        REQUIRE(latency.observe(1, 10.f, 1.0));
+        REQUIRE(latency.profile() == LatencyProfile::Balanced);
+
+        REQUIRE(latency.observe(3, 10.f, 1.0));
+        REQUIRE(latency.profile() == LatencyProfile::PowerSaver);
+
+        // nowhere left to go
+        REQUIRE_FALSE(latency.observe(3, 10.f, 1.0));
+        REQUIRE(latency.profile() == LatencyProfile::PowerSaver);
+    }
+
+    SECTION("Sustained high CPU usage backs off")
+    {
+        REQUIRE_FALSE(latency.observe(0, 90.f, 1.0));
+        REQUIRE_FALSE(latency.observe(0, 50.f, 1.0));
+        REQUIRE_FALSE(latency.observe(0, 90.f, 1.5));
+        REQUIRE(latency.observe(0, 90.f, 1.0));
+        REQUIRE(latency.profile() == LatencyProfile::Balanced);
+    }
+
+    SECTION("Adaptive starts at the low profile")
+    {
+        latency.reset(LatencyProfile::Adaptive);
+        REQUIRE(latency.profile() == LatencyProfile::Low);
+    }
+}
@@ -0,0 +1,79 @@
+#include "test.h"
+#include <insound/MemoryBudget.h>
+#include <insound/scripting/ChunkCache.h>
+
+TEST_CASE("ChunkCache keeps the bytecode of recent scripts")
+{
+    ChunkCache cache(2);
+
+    SECTION("Scripts are found by their exact source")
+    {
+        cache.insert("a = 1", "bytecode a");
+
+        REQUIRE(cache.find("a = 1") == "bytecode a");
+        REQUIRE_FALSE(cache.find("a = 2"));
+        REQUIRE_FALSE(cache.find("a = 1 "));
+    }
+
+    SECTION("Inserting a cached script replaces its bytecode")
+    {
+        cache.insert("a = 1", "old");
+        cache.insert("a = 1", "new");
+
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.find("a = 1") == "new");
+    }
+
+    SECTION("The least recently used script is evicted")
+    {
+        cache.insert("a", "A");
+        cache.insert("b", "B");
+        REQUIRE(cache.find("a"));
+
+        cache.insert("c", "C");
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.find("a") == "A");
+        REQUIRE_FALSE(cache.find("b"));
+        REQUIRE(cache.find("c") == "C");
+    }
+
+    SECTION("Clear removes every script")
+    {
+        cache.insert("a", "A");
+        cache.clear();
+
+        REQUIRE(cache.size() == 0);
+        REQUIRE_FALSE(cache.find("a"));
+    }
+}
+
+TEST_CASE("ChunkCache counts its entries as Lua memory")
+{
+    const auto before = MemoryBudget::stats();
+
+    {
+        ChunkCache cache(1);
+        cache.insert("a = 1", "bytecode");
+        REQUIRE(MemoryBudget::stats().luaLive == before.luaLive + 13);
+
+        // evicted entries are released
+        cache.insert("b = 22", "bytecode!");
+        REQUIRE(MemoryBudget::stats().luaLive == before.luaLive + 15);
+
+        SECTION("Scripts over the budget are not cached")
+        {
+            // larger than the entry it evicts
+            const auto stats = MemoryBudget::stats();
+            MemoryBudget::budget(stats.live - stats.engineLive);
+            cache.insert("c = 333", "more bytecode");
+            MemoryBudget::budget(0);
+            (void)MemoryBudget::takeFailure(MemoryCategory::Lua);
+
+            REQUIRE(cache.size() == 0);
+            REQUIRE_FALSE(cache.find("c = 333"));
+            REQUIRE(MemoryBudget::stats().luaLive == before.luaLive);
+        }
+    }
+
+    REQUIRE(MemoryBudget::stats().luaLive == before.luaLive);
+}
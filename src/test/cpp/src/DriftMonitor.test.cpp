@@ -0,0 +1,55 @@
+#include "test.h"
+#include <insound/DriftMonitor.h>
+
+TEST_CASE("DriftMonitor measures skew between stems")
+{
+    const LoopInfo<unsigned> noLoop{0, 0};
+    const LoopInfo<unsigned> loop{1000, 5000};
+
+    SECTION("Aligned stems have no skew")
+    {
+        REQUIRE(DriftMonitor::skew({2048, 2048, 2048}, noLoop) == 0);
+    }
+
+    SECTION("Skew is the span of all positions")
+    {
+        REQUIRE(DriftMonitor::skew({100, 140, 120}, noLoop) == 40);
+    }
+
+    SECTION("Positions around the loop end are measured across the wrap")
+    {
+        REQUIRE(DriftMonitor::skew({4990, 1010}, loop) == 20);
+        REQUIRE(DriftMonitor::skew({4990, 4995, 1005}, loop) == 15);
+    }
+
+    SECTION("Positions outside the loop do not wrap")
+    {
+        REQUIRE(DriftMonitor::skew({4990, 500}, loop) == 4490);
+    }
+
+    SECTION("Measure checks threshold and records stats")
+    {
+        DriftMonitor monitor(16);
+
+        REQUIRE_FALSE(monitor.measure({100, 110}, noLoop));
+        REQUIRE(monitor.measure({100, 200, 150}, noLoop));
+        REQUIRE(monitor.reference() == 150);
+
+        const auto &stats = monitor.stats();
+        REQUIRE(stats.checks == 2);
+        REQUIRE(stats.lastSkew == 100);
+        REQUIRE(stats.maxSkew == 100);
+        REQUIRE(stats.totalSkew == 110);
+
+        monitor.resetStats();
+        REQUIRE(monitor.stats().checks == 0);
+    }
+
+    SECTION("Reference follows the wrap")
+    {
+        DriftMonitor monitor(0);
+        monitor.measure({1002, 4998, 1006}, loop);
+
+        REQUIRE(monitor.reference() == 1002);
+    }
+}
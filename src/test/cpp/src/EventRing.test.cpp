@@ -0,0 +1,81 @@
+#include "test.h"
+#include <insound/EventRing.h>
+
+#include <thread>
+#include <vector>
+
+TEST_CASE("EventRing queues elements in order")
+{
+    EventRing<int, 4> ring;
+
+    SECTION("Empty ring has nothing to pop")
+    {
+        int value;
+        REQUIRE(ring.empty());
+        REQUIRE_FALSE(ring.pop(value));
+    }
+
+    SECTION("Elements pop in push order")
+    {
+        REQUIRE(ring.push(1));
+        REQUIRE(ring.push(2));
+        REQUIRE(ring.size() == 2);
+
+        int value;
+        REQUIRE(ring.pop(value));
+        REQUIRE(value == 1);
+        REQUIRE(ring.pop(value));
+        REQUIRE(value == 2);
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("Pushing to a full ring drops the element")
+    {
+        for (int i = 0; i < 4; ++i)
+            REQUIRE(ring.push(i));
+
+        REQUIRE_FALSE(ring.push(4));
+        REQUIRE(ring.dropped() == 1);
+    }
+
+    SECTION("Drain empties the ring across the wraparound")
+    {
+        for (int round = 0; round < 3; ++round)
+        {
+            ring.push(round * 3);
+            ring.push(round * 3 + 1);
+            ring.push(round * 3 + 2);
+
+            std::vector<int> values;
+            REQUIRE(ring.drain(values) == 3);
+            REQUIRE(values == std::vector<int>{round * 3, round * 3 + 1,
+                round * 3 + 2});
+        }
+
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("Consumer on another thread receives every element")
+    {
+        EventRing<int, 64> shared;
+        constexpr int Count = 10000;
+
+        std::thread producer([&shared]() {
+            for (int i = 0; i < Count; )
+            {
+                if (shared.push(i))
+                    ++i;
+            }
+        });
+
+        std::vector<int> values;
+        while ((int)values.size() < Count)
+            shared.drain(values);
+        producer.join();
+
+        bool ordered = true;
+        for (int i = 0; i < Count; ++i)
+            ordered = ordered && values[i] == i;
+        REQUIRE(ordered);
+    }
+}
@@ -0,0 +1,88 @@
+#include "test.h"
+#include <insound/GlitchMonitor.h>
+
+#include <catch2/catch_approx.hpp>
+
+#include <vector>
+
+using Catch::Approx;
+
+TEST_CASE("GlitchMonitor detects mixer starvation and late updates")
+{
+    // 48 kHz, 480-sample blocks: 10 ms per block, 40 ms buffered
+    GlitchMonitor monitor;
+    monitor.configure(48000, 480, 4);
+
+    std::vector<Glitch> glitches;
+    monitor.onGlitch([&glitches](const Glitch &glitch) {
+        glitches.emplace_back(glitch);
+    });
+
+    SECTION("A steady mixer and update loop is quiet")
+    {
+        unsigned long long clock = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            monitor.mixBegin(i * .01);
+            monitor.mixEnd(i * .01 + .002);
+            clock += 480;
+            REQUIRE(monitor.update(clock, .01, i * .01) == 0);
+        }
+
+        REQUIRE(glitches.empty());
+        REQUIRE(monitor.stats().maxMix == Approx(.002).margin(1e-9));
+    }
+
+    SECTION("Mixer clock falling behind is an underrun")
+    {
+        monitor.restart(0);
+        REQUIRE(monitor.update(480, .01, 0) == 0);
+        // 100 ms pass, but the mixer only advanced 10 ms
+        REQUIRE(monitor.update(960, .1, .1) == 1);
+
+        REQUIRE(glitches.size() == 1);
+        REQUIRE(glitches[0].type == Glitch::Type::Underrun);
+        REQUIRE(glitches[0].clock == 960);
+        REQUIRE(monitor.stats().underruns == 1);
+    }
+
+    SECTION("A stopped mixer clock is treated as suspended")
+    {
+        monitor.restart(0);
+        for (int i = 0; i < 100; ++i)
+            monitor.update(0, .01, i * .01);
+        REQUIRE(monitor.update(480, .01, 1) == 0);
+        REQUIRE(glitches.empty());
+    }
+
+    SECTION("Slow mixes and gaps between mixes are reported on update")
+    {
+        monitor.mixBegin(0);
+        monitor.mixEnd(.015); // overload, longer than a block
+        monitor.mixBegin(.1); // 100 ms gap, more than the buffer
+        monitor.mixEnd(.101);
+
+        REQUIRE(glitches.empty());
+        REQUIRE(monitor.update(0, .01, .1) == 2);
+        REQUIRE(glitches.size() == 2);
+        REQUIRE(glitches[0].type == Glitch::Type::Overload);
+        REQUIRE(glitches[1].type == Glitch::Type::LateMix);
+        REQUIRE(glitches[1].duration == Approx(.1));
+    }
+
+    SECTION("Late updates are counted but not as mixer glitches")
+    {
+        REQUIRE(monitor.update(0, .2, 0) == 0);
+        REQUIRE(glitches.size() == 1);
+        REQUIRE(glitches[0].type == Glitch::Type::LateUpdate);
+        REQUIRE(monitor.stats().lateUpdates == 1);
+
+        // throttled page, ignored
+        REQUIRE(monitor.update(0, 5, 0) == 0);
+        REQUIRE(glitches.size() == 1);
+
+        monitor.resetStats();
+        REQUIRE(monitor.stats().lateUpdates == 0);
+        REQUIRE(monitor.stats().lastGlitch == -1);
+    }
+}
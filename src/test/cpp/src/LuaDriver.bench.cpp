@@ -0,0 +1,125 @@
+#include "test.h"
+#include <insound/scripting/ChunkCache.h>
+#include <insound/scripting/lua.hpp>
+#include <insound/scripting/LuaDriver.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// driver.lua as written to the test build directory
+static const std::string_view DriverSource =
+#include <driver.lua.h>
+;
+
+// and as compiled by insound-luac for the engine
+static const unsigned char DriverBytecode[] =
+#include <insound/embed/driver.luac.h>
+;
+
+// Run with: insound-audio-test "[.benchmark]"
+// Each benchmark is one 60 Hz frame: an update event to every track's
+// script. Divide by the track count for the dispatch cost per event.
+TEST_CASE("LuaDriver update dispatch for N tracks", "[.benchmark]")
+{
+    static const double Delta = 1000.0 / 60.0;
+
+    const auto populateEnv = [](sol::table &) { };
+
+    for (int tracks : {1, 16, 64})
+    {
+        const auto suffix = std::to_string(tracks) + " tracks";
+
+        std::vector<std::unique_ptr<LuaDriver>> idle, listening;
+        for (int i = 0; i < tracks; ++i)
+        {
+            idle.emplace_back(std::make_unique<LuaDriver>(populateEnv));
+            REQUIRE(idle.back()->load("function on_ready() end"));
+
+            listening.emplace_back(std::make_unique<LuaDriver>(populateEnv));
+            REQUIRE(listening.back()->load(
+                "frames = 0\n"
+                "function on_update(delta, total) frames = frames + 1 end"));
+        }
+
+        double total = 0;
+        BENCHMARK("No on_update, " + suffix)
+        {
+            total += Delta;
+            bool ok = true;
+            for (auto &driver : idle)
+                ok = driver->doUpdate(Delta, total) && ok;
+            return ok;
+        };
+
+        BENCHMARK("on_update, " + suffix)
+        {
+            total += Delta;
+            bool ok = true;
+            for (auto &driver : listening)
+                ok = driver->doUpdate(Delta, total) && ok;
+            return ok;
+        };
+    }
+}
+
+// Each benchmark loads a script the size of a typical one into a driver,
+// parsing it, or from the bytecode cached by an earlier load
+TEST_CASE("LuaDriver script load", "[.benchmark]")
+{
+    std::string script = "local state = {}\n";
+    for (int i = 0; i < 100; ++i)
+    {
+        const auto n = std::to_string(i);
+        script += "local function helper" + n + "(a, b)\n"
+            "    if a > b then return a - b end\n"
+            "    state[" + n + "] = (state[" + n + "] or 0) + a * b\n"
+            "    return state[" + n + "]\n"
+            "end\n";
+    }
+    script += "function on_update(delta, total) helper0(delta, total) end\n";
+
+    LuaDriver driver([](sol::table &) { });
+
+    BENCHMARK("Load, parsing the script")
+    {
+        ChunkCache::shared().clear();
+        return driver.load(script);
+    };
+
+    REQUIRE(driver.load(script));
+    BENCHMARK("Load, cached bytecode")
+    {
+        return driver.load(script);
+    };
+}
+
+// Each benchmark loads driver.lua into a Lua state, as every LuaDriver does
+// when it starts or resets: parsing its source, as the engine did before it
+// embedded bytecode, or undumping the embedded bytecode
+TEST_CASE("driver.lua load, source against bytecode", "[.benchmark]")
+{
+    lua_State *L = luaL_newstate();
+
+    BENCHMARK("driver.lua, parsing the source")
+    {
+        const auto result = luaL_loadbufferx(L, DriverSource.data(),
+            DriverSource.size(), "=driver.lua", "t");
+        lua_pop(L, 1);
+        return result;
+    };
+
+    BENCHMARK("driver.lua, embedded bytecode")
+    {
+        const auto result = luaL_loadbufferx(L,
+            reinterpret_cast<const char *>(DriverBytecode),
+            sizeof(DriverBytecode), "=driver.lua", "b");
+        lua_pop(L, 1);
+        return result;
+    };
+
+    lua_close(L);
+}
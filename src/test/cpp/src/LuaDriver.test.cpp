@@ -0,0 +1,97 @@
+#include "test.h"
+#include <insound/scripting/lua.hpp>
+#include <insound/scripting/LuaDriver.h>
+
+#include <string>
+
+TEST_CASE("LuaDriver calls the handlers a script defines")
+{
+    int calls = 0;
+    LuaDriver driver([&calls](sol::table &env) {
+        env.set_function("count", [&calls]() { ++calls; });
+    });
+
+    SECTION("Defined handlers are called")
+    {
+        REQUIRE(driver.load("function on_update(delta, total) count() end"));
+        REQUIRE(driver.doUpdate(16, 16));
+        REQUIRE(driver.doUpdate(16, 32));
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("Events without a handler succeed without calling anything")
+    {
+        REQUIRE(driver.load("function on_ready() count() end"));
+        REQUIRE(driver.doInit());
+        REQUIRE(driver.doUpdate(16, 16));
+        REQUIRE(driver.doParam("volume", 1.f));
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("Handlers assigned while running are picked up")
+    {
+        REQUIRE(driver.load(
+            "function on_init() on_update = function() count() end end"));
+        REQUIRE(driver.doUpdate(16, 16));
+        REQUIRE(calls == 0);
+
+        REQUIRE(driver.doInit());
+        REQUIRE(driver.doUpdate(16, 32));
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("A handler can remove itself")
+    {
+        REQUIRE(driver.load(
+            "function on_update() count() on_update = nil end"));
+        REQUIRE(driver.doUpdate(16, 16));
+        REQUIRE(driver.doUpdate(16, 32));
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Handlers receive their arguments")
+    {
+        REQUIRE(driver.load(
+            "function on_param(name, value)\n"
+            "    if name == 'volume' and value == 'loud' then count() end\n"
+            "end"));
+        REQUIRE(driver.doParam("volume", std::string("loud")));
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Handler errors are reported")
+    {
+        REQUIRE(driver.load("function on_update() error('boom') end"));
+        REQUIRE_FALSE(driver.doUpdate(16, 16));
+        REQUIRE(driver.getError().find("boom") != std::string::npos);
+    }
+
+    SECTION("Reloading keeps the handlers of the new script only")
+    {
+        REQUIRE(driver.load("function on_update() count() end"));
+        REQUIRE(driver.load("function on_init() count() end"));
+        REQUIRE(driver.doUpdate(16, 16));
+        REQUIRE(calls == 0);
+        REQUIRE(driver.doInit());
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Reloading runs the cached bytecode the same")
+    {
+        REQUIRE(driver.load("function on_update() count() end"));
+        REQUIRE(driver.reload());
+        REQUIRE(driver.doUpdate(16, 16));
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Syntax errors report their line")
+    {
+        int line = -1;
+        driver.setErrorCallback([&line](const std::string &, int number) {
+            line = number;
+        });
+
+        REQUIRE_FALSE(driver.load("x = 1\nfunction ("));
+        REQUIRE(line == 2);
+    }
+}
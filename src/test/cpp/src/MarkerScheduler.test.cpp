@@ -0,0 +1,88 @@
+#include "test.h"
+#include <insound/MarkerScheduler.h>
+
+TEST_CASE("MarkerScheduler emits sync points ahead of the playhead")
+{
+    const std::vector<unsigned> offsets{100, 500, 900};
+    const LoopInfo<unsigned> noLoop{0, 0};
+
+    MarkerScheduler scheduler(200);
+    std::vector<TrackEvent> events;
+
+    SECTION("Points within the lookahead are emitted with their clock")
+    {
+        scheduler.update(offsets, 0, 1000, 2.0, noLoop, 10000, events);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].index == 0);
+        REQUIRE(events[0].offset == 100);
+        REQUIRE(events[0].clock == 1200);
+    }
+
+    SECTION("Each point is emitted only once")
+    {
+        scheduler.update(offsets, 0, 0, 1.0, noLoop, 10000, events);
+        scheduler.update(offsets, 50, 50, 1.0, noLoop, 10000, events);
+        scheduler.update(offsets, 350, 350, 1.0, noLoop, 10000, events);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[0].index == 0);
+        REQUIRE(events[1].index == 1);
+        REQUIRE(events[1].clock == 500);
+    }
+
+    SECTION("Points skipped by a stall are emitted late")
+    {
+        scheduler.update(offsets, 0, 0, 1.0, noLoop, 10000, events);
+        scheduler.update(offsets, 600, 600, 1.0, noLoop, 10000, events);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[1].index == 1);
+        REQUIRE(events[1].clock == 600);
+    }
+
+    SECTION("Reset scans from the playhead inclusively")
+    {
+        scheduler.update(offsets, 0, 0, 1.0, noLoop, 10000, events);
+        scheduler.reset();
+        scheduler.update(offsets, 500, 0, 1.0, noLoop, 10000, events);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[1].index == 1);
+        REQUIRE(events[1].clock == 0);
+    }
+
+    SECTION("Lookahead wraps around the loop end")
+    {
+        const LoopInfo<unsigned> loop{100, 1000};
+        scheduler.update(offsets, 850, 0, 1.0, loop, 10000, events);
+        REQUIRE(events.size() == 3);
+        REQUIRE(events[0].index == 2);
+        REQUIRE(events[0].clock == 50);
+        REQUIRE(events[1].type == TrackEvent::Type::LoopWrap);
+        REQUIRE(events[1].offset == 100);
+        REQUIRE(events[1].clock == 150);
+        REQUIRE(events[2].type == TrackEvent::Type::SyncPoint);
+        REQUIRE(events[2].index == 0);
+        REQUIRE(events[2].clock == 150);
+
+        // playhead wrapped, nothing new is in range
+        scheduler.update(offsets, 950, 100, 1.0, loop, 10000, events);
+        scheduler.update(offsets, 120, 170, 1.0, loop, 10000, events);
+        REQUIRE(events.size() == 3);
+
+        // next pass reaches the second point
+        scheduler.update(offsets, 350, 400, 1.0, loop, 10000, events);
+        REQUIRE(events.size() == 4);
+        REQUIRE(events[3].index == 1);
+        REQUIRE(events[3].clock == 550);
+    }
+
+    SECTION("End of a track without a loop is emitted once")
+    {
+        scheduler.update(offsets, 850, 0, 1.0, noLoop, 1000, events);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[1].type == TrackEvent::Type::End);
+        REQUIRE(events[1].offset == 1000);
+        REQUIRE(events[1].clock == 150);
+
+        scheduler.update(offsets, 950, 100, 1.0, noLoop, 1000, events);
+        REQUIRE(events.size() == 2);
+    }
+}
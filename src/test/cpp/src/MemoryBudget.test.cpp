@@ -0,0 +1,80 @@
+#include "test.h"
+#include <insound/MemoryBudget.h>
+
+#include <cstdint>
+
+TEST_CASE("MemoryBudget accounts allocations per category")
+{
+    const auto before = MemoryBudget::stats();
+
+    SECTION("Allocations count towards their category until freed")
+    {
+        auto ptr = MemoryBudget::allocate(1000, MemoryCategory::PCM);
+        REQUIRE(ptr != nullptr);
+        REQUIRE(MemoryBudget::stats().pcmLive == before.pcmLive + 1000);
+        REQUIRE(MemoryBudget::stats().live == before.live + 1000);
+
+        ptr = MemoryBudget::reallocate(ptr, 3000, MemoryCategory::PCM);
+        REQUIRE(ptr != nullptr);
+        REQUIRE(MemoryBudget::stats().pcmLive == before.pcmLive + 3000);
+
+        ptr = MemoryBudget::reallocate(ptr, 500, MemoryCategory::PCM);
+        REQUIRE(MemoryBudget::stats().pcmLive == before.pcmLive + 500);
+        REQUIRE(MemoryBudget::stats().pcmPeak >= before.pcmLive + 3000);
+
+        MemoryBudget::deallocate(ptr, MemoryCategory::PCM);
+        REQUIRE(MemoryBudget::stats().pcmLive == before.pcmLive);
+        REQUIRE(MemoryBudget::stats().live == before.live);
+    }
+
+    SECTION("Allocations over budget are refused")
+    {
+        // engine objects are counted in `live`, but not limited
+        MemoryBudget::budget(before.live - before.engineLive + 4096);
+        (void)MemoryBudget::takeFailure(MemoryCategory::FMOD);
+        (void)MemoryBudget::takeFailure(MemoryCategory::Lua);
+
+        auto fits = MemoryBudget::allocate(4000, MemoryCategory::Lua);
+        REQUIRE(fits != nullptr);
+        REQUIRE(MemoryBudget::takeFailure(MemoryCategory::Lua) == 0);
+
+        REQUIRE(MemoryBudget::allocate(200, MemoryCategory::FMOD) == nullptr);
+        REQUIRE(MemoryBudget::reallocate(fits, 5000,
+            MemoryCategory::Lua) == nullptr);
+        REQUIRE(MemoryBudget::stats().failures >= 2);
+        REQUIRE(MemoryBudget::stats().lastFailure == 1000);
+
+        // each category keeps its own failure
+        REQUIRE(MemoryBudget::takeFailure(MemoryCategory::FMOD) == 200);
+        REQUIRE(MemoryBudget::takeFailure(MemoryCategory::FMOD) == 0);
+        REQUIRE(MemoryBudget::takeFailure(MemoryCategory::Lua) == 1000);
+        REQUIRE(MemoryBudget::takeFailure(MemoryCategory::Lua) == 0);
+
+        // engine objects are only counted, and take nothing from the budget
+        REQUIRE(MemoryBudget::reserve(MemoryCategory::Engine, 200));
+        REQUIRE(MemoryBudget::reserve(MemoryCategory::FMOD, 90));
+        MemoryBudget::release(MemoryCategory::FMOD, 90);
+        MemoryBudget::release(MemoryCategory::Engine, 200);
+
+        MemoryBudget::deallocate(fits, MemoryCategory::Lua);
+        MemoryBudget::budget(0);
+        REQUIRE(MemoryBudget::stats().live == before.live);
+    }
+}
+
+TEST_CASE("EngineObject keeps the alignment of over-aligned types")
+{
+    struct alignas(64) Aligned : EngineObject
+    {
+        char data[100];
+    };
+
+    const auto before = MemoryBudget::stats().engineLive;
+
+    auto object = new Aligned();
+    REQUIRE(reinterpret_cast<uintptr_t>(object) % 64 == 0);
+    REQUIRE(MemoryBudget::stats().engineLive == before + sizeof(Aligned));
+
+    delete object;
+    REQUIRE(MemoryBudget::stats().engineLive == before);
+}
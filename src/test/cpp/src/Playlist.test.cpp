@@ -0,0 +1,31 @@
+#include "test.h"
+#include <insound/Playlist.h>
+
+TEST_CASE("samplesUntil follows the playhead around the loop")
+{
+    const LoopInfo<unsigned> loop{.start=1000, .end=5000};
+
+    SECTION("Targets ahead of the playhead")
+    {
+        REQUIRE(samplesUntil(2000, 3000, loop) == 1000);
+        REQUIRE(samplesUntil(2000, 5000, loop) == 3000);
+        REQUIRE(samplesUntil(0, 500, loop) == 500);
+    }
+
+    SECTION("Targets behind the playhead wrap around the loop")
+    {
+        REQUIRE(samplesUntil(4000, 2000, loop) == 2000);
+        REQUIRE(samplesUntil(3000, 3000, loop) == 4000);
+    }
+
+    SECTION("Unreachable targets fall back to the loop end")
+    {
+        REQUIRE(samplesUntil(2000, 6000, loop) == 3000);
+        REQUIRE(samplesUntil(2000, 500, loop) == 3000);
+    }
+
+    SECTION("Playhead past the loop end")
+    {
+        REQUIRE(samplesUntil(5000, 3000, loop) == 0);
+    }
+}
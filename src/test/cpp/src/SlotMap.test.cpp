@@ -0,0 +1,93 @@
+#include "test.h"
+#include <insound/SlotMap.h>
+
+#include <algorithm>
+#include <string>
+
+TEST_CASE("SlotMap hands out generation-checked handles")
+{
+    SlotMap<std::string> map;
+
+    auto a = map.insert("a");
+    auto b = map.insert("b");
+    auto c = map.insert("c");
+
+    REQUIRE(map.size() == 3);
+    REQUIRE(a != 0);
+    REQUIRE(*map.find(a) == "a");
+    REQUIRE(*map.find(b) == "b");
+    REQUIRE(*map.find(c) == "c");
+    REQUIRE(map.find(0) == nullptr);
+
+    SECTION("Erasing keeps other handles valid and storage contiguous")
+    {
+        REQUIRE(map.erase(a));
+        REQUIRE(map.size() == 2);
+        REQUIRE_FALSE(map.contains(a));
+        REQUIRE(*map.find(b) == "b");
+        REQUIRE(*map.find(c) == "c");
+
+        std::string joined;
+        for (auto &value : map)
+            joined += value;
+        std::sort(joined.begin(), joined.end());
+        REQUIRE(joined == "bc");
+    }
+
+    SECTION("Stale handles don't resolve to a reused slot")
+    {
+        REQUIRE(map.erase(b));
+        REQUIRE_FALSE(map.erase(b));
+
+        auto d = map.insert("d");
+        REQUIRE(d != b);
+        REQUIRE(map.find(b) == nullptr);
+        REQUIRE(*map.find(d) == "d");
+    }
+
+    SECTION("Handles of free slots are never valid")
+    {
+        REQUIRE(map.erase(c));
+        // a forged handle of the freed slot's current generation
+        const auto forged = (c & 0xFFFFu) | ((c >> 16) + 1) << 16;
+        REQUIRE_FALSE(map.contains(forged));
+    }
+
+    SECTION("Clear invalidates everything")
+    {
+        map.clear();
+        REQUIRE(map.empty());
+        REQUIRE_FALSE(map.contains(a));
+        REQUIRE_FALSE(map.contains(b));
+        REQUIRE_FALSE(map.contains(c));
+
+        auto e = map.insert("e");
+        REQUIRE(*map.find(e) == "e");
+        REQUIRE(map.handles() == std::vector<SlotMap<std::string>::Handle>{e});
+    }
+}
+
+TEST_CASE("SlotMap retires slots instead of wrapping their generation")
+{
+    SlotMap<int> map;
+
+    const auto first = map.insert(0);
+    REQUIRE(map.erase(first));
+
+    // Each insertion and erasure advances the generation by one
+    SlotMap<int>::Handle last = 0;
+    for (int i = 1; i < 32768; ++i)
+    {
+        last = map.insert(i);
+        map.erase(last);
+    }
+    REQUIRE((last & 0xFFFFu) == (first & 0xFFFFu));
+    REQUIRE(last >> 16 == 0xFFFFu);
+
+    // The exhausted slot is not reused, so old handles stay stale
+    const auto next = map.insert(-1);
+    REQUIRE((next & 0xFFFFu) != (first & 0xFFFFu));
+    REQUIRE_FALSE(map.contains(first));
+    REQUIRE_FALSE(map.contains(last));
+    REQUIRE(*map.find(next) == -1);
+}
@@ -0,0 +1,162 @@
+#include "test.h"
+#include <insound/MultiTrackAudio.h>
+#include <insound/StemMixer.h>
+#include <insound/render/WavWriter.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <fmod.hpp>
+
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Run with: insound-audio-test "[.benchmark]"
+// Each benchmark mixes one block; divide by the stem count for CPU per stem.
+TEST_CASE("StemMixer against one FMOD channel per stem", "[.benchmark]")
+{
+    static const int Rate = 48000;
+    static const unsigned BlockLength = 512;
+    static const unsigned Frames = Rate; // one second, looping
+
+    FMOD::System *sys;
+    REQUIRE(FMOD::System_Create(&sys) == FMOD_OK);
+    // Non-realtime output: each update mixes one block, right away
+    REQUIRE(sys->setOutput(FMOD_OUTPUTTYPE_NOSOUND_NRT) == FMOD_OK);
+    REQUIRE(sys->setDSPBufferSize(BlockLength, 4) == FMOD_OK);
+    REQUIRE(sys->setSoftwareFormat(Rate, FMOD_SPEAKERMODE_STEREO, 0) ==
+        FMOD_OK);
+    REQUIRE(sys->setSoftwareChannels(256) == FMOD_OK);
+    REQUIRE(sys->init(256, FMOD_INIT_NORMAL, nullptr) == FMOD_OK);
+
+    FMOD::ChannelGroup *master;
+    REQUIRE(sys->getMasterChannelGroup(&master) == FMOD_OK);
+
+    std::vector<float> pcm((size_t)Frames * 2);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> noise(-.1f, .1f);
+    for (auto &sample : pcm)
+        sample = noise(rng);
+
+    for (int stems : {8, 32, 128})
+    {
+        const auto suffix = std::to_string(stems) + " stems";
+
+        {
+            std::vector<FMOD::Sound *> sounds;
+            for (int i = 0; i < stems; ++i)
+            {
+                FMOD_CREATESOUNDEXINFO exinfo;
+                std::memset(&exinfo, 0, sizeof(FMOD_CREATESOUNDEXINFO));
+                exinfo.cbsize = sizeof(FMOD_CREATESOUNDEXINFO);
+                exinfo.length = (unsigned)(pcm.size() * sizeof(float));
+                exinfo.numchannels = 2;
+                exinfo.defaultfrequency = Rate;
+                exinfo.format = FMOD_SOUND_FORMAT_PCMFLOAT;
+
+                // Same flags as MultiTrackAudio::loadPCM
+                FMOD::Sound *sound;
+                REQUIRE(sys->createSound((const char *)pcm.data(),
+                    FMOD_OPENMEMORY_POINT | FMOD_OPENRAW | FMOD_LOOP_NORMAL |
+                    FMOD_ACCURATETIME | FMOD_CREATESAMPLE, &exinfo, &sound)
+                    == FMOD_OK);
+                sounds.emplace_back(sound);
+
+                FMOD::Channel *chan;
+                REQUIRE(sys->playSound(sound, master, false, &chan) ==
+                    FMOD_OK);
+                float matrix[4] = {1.f, 0, 0, 1.f};
+                REQUIRE(chan->setMixMatrix(matrix, 2, 2, 2) == FMOD_OK);
+            }
+
+            BENCHMARK("FMOD channels, " + suffix)
+            {
+                return sys->update();
+            };
+
+            for (auto sound : sounds)
+                sound->release();
+        }
+
+        {
+            StemMixer mixer;
+            for (int i = 0; i < stems; ++i)
+                mixer.addStem(pcm.data(), Frames, 2, Rate);
+            mixer.attach(master);
+
+            BENCHMARK("StemMixer, " + suffix)
+            {
+                return sys->update();
+            };
+
+            int i = 0;
+            BENCHMARK("StemMixer with ramps, " + suffix)
+            {
+                // keep every stem ramping
+                for (int stem = 0; stem < stems; ++stem)
+                    mixer.gain(stem, (i & 1) ? .5f : 1.f);
+                ++i;
+                return sys->update();
+            };
+
+            mixer.detach();
+        }
+    }
+
+    sys->release();
+}
+
+
+// The same comparison through a track, with everything else an engine
+// update does, opting in with `MultiTrackAudio::useStemMixer`
+TEST_CASE("MultiTrackAudio stems through channels or the StemMixer",
+    "[.benchmark]")
+{
+    static const int Rate = 48000;
+    static const unsigned Frames = Rate; // one second, looping
+
+    AudioEngineSettings settings;
+    settings.output = OutputMode::NoSoundNRT;
+    settings.samplerate = Rate;
+    settings.bufferLength = 512;
+    settings.realChannels = 256; // mix every stem channel for real
+    AudioEngine engine;
+    REQUIRE(engine.init(settings));
+
+    std::vector<float> pcm((size_t)Frames * 2);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> noise(-.1f, .1f);
+    for (auto &sample : pcm)
+        sample = noise(rng);
+
+    std::ostringstream out(std::ios::binary);
+    writeWav(out, pcm.data(), Frames, 2, Rate);
+    const auto wav = out.str();
+
+    for (int stems : {8, 32, 128})
+    {
+        const auto suffix = std::to_string(stems) + " stems";
+        const auto handle = engine.createTrack();
+        auto &track = *engine.getTrack(handle);
+        for (int i = 0; i < stems; ++i)
+            track.loadSound(wav.data(), wav.size());
+        track.pause(false, 0);
+
+        BENCHMARK("Track channels, " + suffix)
+        {
+            engine.update();
+            return track.position();
+        };
+
+        track.useStemMixer(true);
+
+        BENCHMARK("Track StemMixer, " + suffix)
+        {
+            engine.update();
+            return track.position();
+        };
+
+        engine.deleteTrack(handle);
+    }
+}
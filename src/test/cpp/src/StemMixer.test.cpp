@@ -0,0 +1,110 @@
+#include "test.h"
+#include <insound/StemMixer.h>
+
+#include <catch2/catch_approx.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+using Catch::Approx;
+
+TEST_CASE("StemMixer sums stems from PCM")
+{
+    StemMixer mixer;
+    mixer.prepare(48000, 64);
+
+    SECTION("Stems at unity add to the output")
+    {
+        const std::vector<float> a(200, .25f), b(200, .5f);
+        mixer.addStem(a.data(), 100, 2, 48000);
+        mixer.addStem(b.data(), 100, 2, 48000);
+
+        std::vector<float> out(20, 1.f);
+        mixer.process(out.data(), 10, 2);
+
+        for (auto sample : out)
+            REQUIRE(sample == Approx(1.75f));
+        REQUIRE(mixer.position() == Approx(10));
+    }
+
+    SECTION("Mismatched stems are rejected")
+    {
+        const std::vector<float> a(100);
+        mixer.addStem(a.data(), 100, 1, 48000);
+
+        REQUIRE_THROWS_AS(mixer.addStem(a.data(), 50, 1, 48000),
+            std::invalid_argument);
+        REQUIRE_THROWS_AS(mixer.addStem(a.data(), 100, 1, 44100),
+            std::invalid_argument);
+    }
+
+    SECTION("Gain changes ramp linearly")
+    {
+        const std::vector<float> a(4096, 1.f);
+        mixer.addStem(a.data(), 4096, 1, 48000);
+        mixer.gain(0, 0);
+
+        std::vector<float> out(StemMixer::MinRampFrames * 2);
+        mixer.process(out.data(), (unsigned)out.size(), 1);
+
+        REQUIRE(out[0] == Approx(1));
+        REQUIRE(out[StemMixer::MinRampFrames / 2] == Approx(.5));
+        REQUIRE(out[StemMixer::MinRampFrames] == Approx(0));
+        REQUIRE(out.back() == Approx(0));
+    }
+
+    SECTION("Pan routes each side like a channel's mix matrix")
+    {
+        const std::vector<float> a{1.f, 0.f};
+        mixer.addStem(a.data(), 1, 2, 48000);
+        mixer.pan(0, .25f, 1.f);
+
+        std::vector<float> out((StemMixer::MinRampFrames + 1) * 2);
+        mixer.process(out.data(), StemMixer::MinRampFrames + 1, 2);
+
+        REQUIRE(out[out.size() - 2] == Approx(.25));
+        REQUIRE(out.back() == Approx(.75));
+    }
+
+    SECTION("Playhead wraps at the loop end")
+    {
+        const std::vector<float> a{0, 1, 2, 3, 4, 5, 6, 7};
+        mixer.addStem(a.data(), 8, 1, 48000);
+        mixer.loop(2, 6);
+
+        std::vector<float> out(10);
+        mixer.process(out.data(), 10, 1);
+
+        // mono output folds both sides back together
+        const std::vector<float> expected{0, 1, 2, 3, 4, 5, 2, 3, 4, 5};
+        for (size_t i = 0; i < out.size(); ++i)
+            REQUIRE(out[i] == Approx(expected[i]));
+        REQUIRE(mixer.position() == Approx(2));
+    }
+
+    SECTION("Stems at another rate are interpolated")
+    {
+        const std::vector<float> a{0, 1, 2, 3};
+        mixer.addStem(a.data(), 4, 1, 24000);
+
+        std::vector<float> out(6);
+        mixer.process(out.data(), 6, 1);
+
+        const std::vector<float> expected{0, .5f, 1, 1.5f, 2, 2.5f};
+        for (size_t i = 0; i < out.size(); ++i)
+            REQUIRE(out[i] == Approx(expected[i]));
+    }
+
+    SECTION("Paused mixers add nothing and hold position")
+    {
+        const std::vector<float> a(100, 1.f);
+        mixer.addStem(a.data(), 100, 1, 48000);
+        mixer.paused(true);
+
+        std::vector<float> out(10);
+        mixer.process(out.data(), 10, 1);
+
+        REQUIRE(out[0] == 0);
+        REQUIRE(mixer.position() == 0);
+    }
+}
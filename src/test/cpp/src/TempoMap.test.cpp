@@ -0,0 +1,78 @@
+#include "test.h"
+#include <insound/TempoMap.h>
+
+#include <catch2/catch_approx.hpp>
+
+using Catch::Approx;
+
+TEST_CASE("TempoMap finds musical boundaries")
+{
+    SECTION("Empty map defaults to 100 bpm in 4/4")
+    {
+        TempoMap map;
+
+        REQUIRE(map.beatLength(0) == Approx(.6));
+        REQUIRE(map.nextBoundary(.1, Quantize::Beat) == Approx(.6));
+        REQUIRE(map.nextBoundary(.1, Quantize::Bar) == Approx(2.4));
+    }
+
+    SECTION("Position on a boundary returns itself")
+    {
+        TempoMap map;
+        map.add(0, 120);
+
+        REQUIRE(map.nextBoundary(1.0, Quantize::Beat) == Approx(1.0));
+        REQUIRE(map.nextBoundary(2.0, Quantize::Bar) == Approx(2.0));
+    }
+
+    SECTION("Unquantized returns position unchanged")
+    {
+        TempoMap map;
+        map.add(0, 120);
+
+        REQUIRE(map.nextBoundary(1.23, Quantize::None) == Approx(1.23));
+    }
+
+    SECTION("Time signature denominator changes beat length")
+    {
+        TempoMap map;
+        map.add(0, 120, 6, 8);
+
+        REQUIRE(map.beatLength(0) == Approx(.25));
+        REQUIRE(map.nextBoundary(.1, Quantize::Beat) == Approx(.25));
+        REQUIRE(map.nextBoundary(.1, Quantize::Bar) == Approx(1.5));
+    }
+
+    SECTION("Tempo change starts a new measure")
+    {
+        TempoMap map;
+        map.add(0, 120);
+        map.add(3, 60, 3, 4);
+
+        // next bar at 120 bpm would be at 4 seconds, tempo change comes first
+        REQUIRE(map.nextBoundary(2.5, Quantize::Bar) == Approx(3));
+
+        // grid continues from the tempo point at the new tempo
+        REQUIRE(map.nextBoundary(3.5, Quantize::Beat) == Approx(4));
+        REQUIRE(map.nextBoundary(3.5, Quantize::Bar) == Approx(6));
+    }
+
+    SECTION("Points are kept sorted and replaced at equal positions")
+    {
+        TempoMap map;
+        map.add(4, 90);
+        map.add(0, 120);
+        map.add(4, 80);
+
+        REQUIRE(map.size() == 2);
+        REQUIRE(map.points()[0].position == 0);
+        REQUIRE(map.points()[1].bpm == 80);
+    }
+
+    SECTION("Invalid tempo throws")
+    {
+        TempoMap map;
+        REQUIRE_THROWS(map.add(0, 0));
+        REQUIRE_THROWS(map.add(0, 120, 0, 4));
+    }
+}
@@ -0,0 +1,56 @@
+#include "test.h"
+#include <insound/profiling/TimingHistogram.h>
+
+#include <catch2/catch_approx.hpp>
+
+using Catch::Approx;
+
+TEST_CASE("TimingHistogram summarizes durations")
+{
+    TimingHistogram histogram;
+    REQUIRE(histogram.count() == 0);
+    REQUIRE(histogram.percentile(.99) == 0);
+
+    // 99 fast samples of 1 ms, one slow sample of 20 ms
+    for (int i = 0; i < 99; ++i)
+        histogram.record(.001);
+    histogram.record(.02);
+
+    REQUIRE(histogram.count() == 100);
+    REQUIRE(histogram.min() == Approx(.001));
+    REQUIRE(histogram.max() == Approx(.02));
+    REQUIRE(histogram.mean() == Approx((99 * .001 + .02) / 100));
+
+    SECTION("Percentiles are bucket-accurate and clamped to the range")
+    {
+        const auto p50 = histogram.percentile(.5);
+        REQUIRE(p50 >= .001);
+        REQUIRE(p50 < .001 * 1.2);
+
+        REQUIRE(histogram.percentile(.99) < .0012);
+        REQUIRE(histogram.percentile(1) == Approx(.02));
+        REQUIRE(histogram.percentile(0) >= .001);
+    }
+
+    SECTION("Merging combines samples")
+    {
+        TimingHistogram other;
+        other.record(.0001);
+        other.record(.05);
+        histogram.merge(other);
+
+        REQUIRE(histogram.count() == 102);
+        REQUIRE(histogram.min() == Approx(.0001));
+        REQUIRE(histogram.max() == Approx(.05));
+    }
+
+    SECTION("Extremes land in the outer buckets")
+    {
+        histogram.clear();
+        histogram.record(0);
+        histogram.record(1e6);
+        REQUIRE(histogram.count() == 2);
+        REQUIRE(histogram.percentile(.5) <= TimingHistogram::Resolution);
+        REQUIRE(histogram.percentile(1) == Approx(1e6));
+    }
+}
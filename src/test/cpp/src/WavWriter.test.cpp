@@ -0,0 +1,43 @@
+#include "test.h"
+#include <insound/render/WavWriter.h>
+
+#include <cstring>
+#include <sstream>
+
+TEST_CASE("writeWav writes a float WAV file")
+{
+    const float samples[] = {0.f, .5f, -.5f, 1.f};
+    std::ostringstream out(std::ios::binary);
+
+    writeWav(out, samples, 2, 2, 48000);
+    const auto data = out.str();
+
+    SECTION("Size is header plus sample data")
+    {
+        REQUIRE(data.size() == 44 + sizeof(samples));
+    }
+
+    SECTION("Header describes the format")
+    {
+        REQUIRE(data.substr(0, 4) == "RIFF");
+        REQUIRE(data.substr(8, 4) == "WAVE");
+        REQUIRE(data.substr(12, 4) == "fmt ");
+        REQUIRE(data[20] == 3); // IEEE float
+        REQUIRE(data[22] == 2); // channels
+        REQUIRE(data.substr(36, 4) == "data");
+
+        uint32_t rate;
+        std::memcpy(&rate, data.data() + 24, sizeof(rate));
+        REQUIRE(rate == 48000);
+    }
+
+    SECTION("Samples follow the header unchanged")
+    {
+        REQUIRE(std::memcmp(data.data() + 44, samples, sizeof(samples)) == 0);
+    }
+
+    SECTION("Invalid format throws")
+    {
+        REQUIRE_THROWS(writeWav(out, samples, 2, 0, 48000));
+    }
+}
@@ -0,0 +1,293 @@
+#include "mock.h"
+#include <insound/MemoryBudget.h>
+#include <insound/StingerPool.h>
+
+#include <catch2/catch_approx.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using Catch::Approx;
+
+/**
+ * Settings of a realtime engine with the buffers of a latency profile
+ */
+static AudioEngineSettings realtimeSettings(LatencyProfile profile)
+{
+    const auto config = bufferConfig(profile);
+
+    AudioEngineSettings settings;
+    settings.samplerate = 48000;
+    settings.bufferLength = config.bufferLength;
+    settings.bufferCount = config.bufferCount;
+    return settings;
+}
+
+TEST_CASE("AudioEngine takes the latency profile of its settings")
+{
+    AudioEngine engine;
+
+    SECTION("Profiles match by latency")
+    {
+        REQUIRE(engine.init(realtimeSettings(LatencyProfile::PowerSaver)));
+        REQUIRE(engine.getLatencyProfile() ==
+            (int)LatencyProfile::PowerSaver);
+        REQUIRE(engine.getLatencyStats().active ==
+            (int)LatencyProfile::PowerSaver);
+    }
+
+    SECTION("Custom buffers count as the closest profile")
+    {
+        auto settings = realtimeSettings(LatencyProfile::Low);
+        settings.bufferCount = 8;
+        REQUIRE(engine.init(settings));
+        REQUIRE(engine.getLatencyProfile() == (int)LatencyProfile::Balanced);
+    }
+
+    SECTION("Adaptive mode is kept")
+    {
+        engine.setLatencyProfile((int)LatencyProfile::Adaptive);
+        REQUIRE(engine.init(realtimeSettings(LatencyProfile::Balanced)));
+        REQUIRE(engine.getLatencyProfile() == (int)LatencyProfile::Adaptive);
+        REQUIRE(engine.getLatencyStats().active ==
+            (int)LatencyProfile::Balanced);
+    }
+}
+
+TEST_CASE("AudioEngine moves loaded tracks when re-initializing")
+{
+    // One block of the balanced profile the engine starts with
+    const double Block = 512 / 48000.0;
+
+    AudioEngine engine;
+    REQUIRE(engine.init(realtimeSettings(LatencyProfile::Balanced)));
+
+    const auto bank = mockBank(2, 192000, {{"Cue", 24000}});
+    const auto handle = engine.createTrack();
+    auto &track = *engine.getTrack(handle);
+    track.loadFsb(bank.data(), bank.size());
+
+    const std::vector<float> samples(1024, .5f);
+    const auto hit = FMOD::Mock::wav(samples.data(), 1024, 1, 48000);
+    track.stingers().load("hit", hit.data(), hit.size());
+
+    SECTION("Playing tracks resume where they were")
+    {
+        track.loopSeconds(0, 3);
+        track.channelVolume(1, .5f);
+        track.addSyncPoint("Added", 1.5);
+        const auto points = track.getSyncPointCount();
+
+        engine.attachTrack(handle);
+        engine.transportStart(0);
+        for (int i = 0; i < 8; ++i)
+            engine.update();
+        const auto position = track.position();
+
+        engine.setLatencyProfile((int)LatencyProfile::Low);
+        REQUIRE(engine.getLatencyStats().pending);
+        engine.update();
+
+        const auto stats = engine.getLatencyStats();
+        REQUIRE_FALSE(stats.pending);
+        REQUIRE(stats.reinits == 1);
+        REQUIRE(stats.bufferLength == 256);
+        REQUIRE(stats.active == (int)LatencyProfile::Low);
+
+        REQUIRE(track.isLoaded());
+        REQUIRE_FALSE(track.paused());
+        REQUIRE(track.position() == Approx(position + Block).margin(1e-6));
+        REQUIRE(track.loopSamples().end == 144000);
+        REQUIRE(track.channelVolume(1) == Approx(.5f));
+        REQUIRE(track.getSyncPointCount() == points);
+        REQUIRE(track.getSyncPointLabel(points - 1) == "Added");
+        REQUIRE(track.getSampleData(1).size() == 192000);
+        REQUIRE(track.stingers().find("hit") == 0);
+        REQUIRE(engine.getTransportPlaying());
+
+        // and keeps playing on the new output
+        engine.update();
+        engine.update();
+        REQUIRE(track.position() ==
+            Approx(position + Block + 2 * 256 / 48000.0).margin(1e-6));
+    }
+
+    SECTION("Paused tracks stay paused")
+    {
+        track.position(2);
+        engine.setLatencyProfile((int)LatencyProfile::PowerSaver);
+        engine.update();
+
+        REQUIRE(engine.getLatencyStats().reinits == 1);
+        REQUIRE(track.paused());
+        REQUIRE(track.position() == Approx(2));
+    }
+
+    SECTION("Failed re-inits are retried, then dropped")
+    {
+        track.pause(false, 0);
+        engine.update();
+
+        // no memory for a new system
+        MemoryBudget::budget(1);
+        engine.setLatencyProfile((int)LatencyProfile::Low);
+        engine.setVoiceBudget(16);
+        engine.update();
+        engine.update();
+        REQUIRE(engine.getVoiceStats().pending);
+        auto stats = engine.getLatencyStats();
+        REQUIRE(stats.failedReinits == 2);
+        REQUIRE(stats.pending);
+        REQUIRE(stats.active == (int)LatencyProfile::Balanced);
+
+        engine.update();
+        stats = engine.getLatencyStats();
+        MemoryBudget::budget(0);
+        REQUIRE(stats.failedReinits == 3);
+        REQUIRE_FALSE(stats.pending);
+        REQUIRE(stats.reinits == 0);
+        REQUIRE(stats.bufferLength == 512);
+        REQUIRE(stats.active == (int)LatencyProfile::Balanced);
+        REQUIRE_FALSE(engine.getVoiceStats().pending);
+        REQUIRE(engine.getVoiceStats().budget == 64);
+
+        // the old output keeps playing, and a new request is retried
+        engine.update();
+        REQUIRE(engine.getLatencyStats().reinits == 0);
+        REQUIRE_FALSE(track.paused());
+
+        engine.setLatencyProfile((int)LatencyProfile::Low);
+        engine.update();
+        REQUIRE(engine.getLatencyStats().reinits == 1);
+        REQUIRE(engine.getLatencyStats().bufferLength == 256);
+    }
+
+    SECTION("Re-initializing waits for a transition to finish")
+    {
+        track.pause(false, 0);
+        engine.update();
+
+        const auto clock = track.dspClock() + 48000;
+        track.transitionTo(3, 0, true, .1f, true, clock);
+
+        engine.setLatencyProfile((int)LatencyProfile::Low);
+        engine.update();
+        REQUIRE(engine.getLatencyStats().pending);
+
+        // still fading out the outgoing stems
+        mixUntil(engine, track, clock + 4096);
+        REQUIRE(engine.getLatencyStats().pending);
+
+        while (engine.getLatencyStats().pending)
+            engine.update();
+        REQUIRE(engine.getLatencyStats().reinits == 1);
+        REQUIRE(track.position() == Approx(3.1).margin(3 * Block));
+    }
+}
+
+TEST_CASE("AudioEngine queues underruns to loaded tracks")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(realtimeSettings(LatencyProfile::Balanced)));
+
+    const auto bank = mockBank(1, 48000);
+    auto &loaded = *engine.getTrack(engine.createTrack());
+    loaded.loadFsb(bank.data(), bank.size());
+    auto &empty = *engine.getTrack(engine.createTrack());
+
+    engine.update();
+
+    // The mock mixes one block per update, so a stalled update leaves the
+    // output clock far behind, and the mix late
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    engine.update();
+
+    const auto stats = engine.getGlitchStats();
+    REQUIRE(stats.underruns == 1);
+    REQUIRE(stats.lateMixes == 1);
+
+    std::vector<TrackEvent> events;
+    loaded.pollEvents(events);
+    REQUIRE(std::count_if(events.begin(), events.end(),
+        [](const TrackEvent &event) {
+            return event.type == TrackEvent::Type::Underrun;
+        }) == 1);
+
+    events.clear();
+    REQUIRE(empty.pollEvents(events) == 0);
+}
+
+TEST_CASE("AudioEngine virtualizes the least important voices over budget")
+{
+    auto settings = mockSettings();
+    settings.realChannels = 2;
+
+    AudioEngine engine;
+    REQUIRE(engine.init(settings));
+
+    const auto bank = mockBank(4, 48000);
+    auto &track = *engine.getTrack(engine.createTrack());
+    track.loadFsb(bank.data(), bank.size());
+    track.priority(64);
+    track.channelPriority(1, 100);
+    track.channelPriority(3, 50);
+
+    // unpausing starts on the next mix block, virtual voices are chosen
+    // before each mix
+    track.pause(false, 0);
+    engine.update();
+    engine.update();
+
+    const auto stats = engine.getVoiceStats();
+    REQUIRE(stats.budget == 2);
+    // each stem keeps a second, silent set of channels for transitions
+    REQUIRE(stats.playing == 8);
+    REQUIRE(stats.real == 2);
+
+    REQUIRE_FALSE(track.channel(0).ch_isVirtual());
+    REQUIRE(track.channel(1).ch_isVirtual());
+    REQUIRE_FALSE(track.channel(2).ch_isVirtual());
+    REQUIRE(track.channel(3).ch_isVirtual());
+
+    SECTION("A more important track takes the voices")
+    {
+        auto &lead = *engine.getTrack(engine.createTrack());
+        lead.loadFsb(bank.data(), bank.size());
+        lead.priority(0);
+        lead.channelPriority(2, 10);
+        lead.channelPriority(3, 10);
+        lead.pause(false, 0);
+        engine.update();
+        engine.update();
+
+        REQUIRE(engine.getVoiceStats().real == 2);
+        REQUIRE_FALSE(lead.channel(0).ch_isVirtual());
+        REQUIRE_FALSE(lead.channel(1).ch_isVirtual());
+        for (int i = 0; i < 4; ++i)
+            REQUIRE(track.channel(i).ch_isVirtual());
+    }
+
+    SECTION("Non-realtime outputs keep their budget")
+    {
+        engine.setVoiceBudget(4);
+        engine.update();
+
+        const auto stats = engine.getVoiceStats();
+        REQUIRE(stats.budget == 2);
+        REQUIRE_FALSE(stats.pending);
+    }
+
+    SECTION("Silent voices free their budget")
+    {
+        track.channelVolume(0, 0);
+        engine.update();
+        engine.update();
+
+        REQUIRE(track.channel(0).ch_isVirtual());
+        REQUIRE_FALSE(track.channel(2).ch_isVirtual());
+        REQUIRE_FALSE(track.channel(3).ch_isVirtual());
+        REQUIRE(track.channel(1).ch_isVirtual());
+    }
+}
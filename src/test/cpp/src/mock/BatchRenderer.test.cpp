@@ -0,0 +1,87 @@
+#include "mock.h"
+#include <insound/presets/PresetMgr.h>
+#include <insound/render/BatchRenderer.h>
+
+#include <catch2/catch_approx.hpp>
+
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+using Catch::Approx;
+
+/**
+ * Average absolute sample value of a buffer
+ */
+static double level(const RenderBuffer &buffer)
+{
+    if (buffer.samples.empty())
+        return 0;
+
+    return std::accumulate(buffer.samples.begin(), buffer.samples.end(), 0.0,
+        [](double sum, float sample) { return sum + std::abs(sample); }) /
+        buffer.samples.size();
+}
+
+TEST_CASE("BatchRenderer renders a mixdown per preset")
+{
+    // Half a second of two constant stems
+    const std::vector<float> loud(24000, .5f), quiet(24000, .25f);
+    const auto bank = FMOD::Mock::bank({
+        FMOD::Mock::wav(loud.data(), 24000, 1, 48000),
+        FMOD::Mock::wav(quiet.data(), 24000, 1, 48000),
+    });
+
+    BatchSettings settings;
+    settings.threads = 2;
+    settings.seconds = .25;
+    settings.stems = true;
+
+    BatchRenderer renderer(settings);
+    renderer.loadBank(bank.data(), bank.size());
+
+    // Volume 0 is the main bus, then each stem
+    PresetMgr presets;
+    presets.emplace_back("full", {1, 1, 1});
+    presets.emplace_back("loud only", {1, 1, 0});
+    presets.emplace_back("silent", {0, 1, 1});
+
+    const auto results = renderer.render(presets);
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[0].preset == "full");
+    REQUIRE(results[1].preset == "loud only");
+    REQUIRE(results[2].preset == "silent");
+
+    SECTION("Each result is as long as requested")
+    {
+        for (const auto &result : results)
+        {
+            REQUIRE(result.mix.channels > 0);
+            REQUIRE(result.mix.samples.size() ==
+                (size_t)(12000 * result.mix.channels));
+        }
+    }
+
+    SECTION("Presets set the mix")
+    {
+        const auto full = level(results[0].mix);
+        const auto loudOnly = level(results[1].mix);
+
+        REQUIRE(full > 0);
+        REQUIRE(loudOnly == Approx(full * 2 / 3).epsilon(.01));
+        REQUIRE(level(results[2].mix) == Approx(0).margin(1e-6));
+    }
+
+    SECTION("Stems are captured after their channel fader")
+    {
+        for (const auto &result : results)
+            REQUIRE(result.stems.size() == 2);
+
+        const auto &full = results[0].stems;
+        REQUIRE(level(full[1]) == Approx(level(full[0]) / 2).epsilon(.01));
+
+        const auto &loudOnly = results[1].stems;
+        REQUIRE(level(loudOnly[0]) == Approx(level(full[0])).epsilon(.01));
+        REQUIRE(level(loudOnly[1]) == Approx(0).margin(1e-6));
+    }
+}
@@ -0,0 +1,132 @@
+#include "../test.h"
+#include <insound/Channel.h>
+
+#include <catch2/catch_approx.hpp>
+#include <fmod.hpp>
+#include <fmod_mock.h>
+
+#include <vector>
+
+using Catch::Approx;
+
+TEST_CASE("Channel schedules fades and pauses on the DSP clock")
+{
+    // each update mixes one 256-sample block at 48 kHz
+    FMOD::System *sys;
+    REQUIRE(FMOD::System_Create(&sys) == FMOD_OK);
+    REQUIRE(sys->setSoftwareFormat(48000, FMOD_SPEAKERMODE_DEFAULT, 0) ==
+        FMOD_OK);
+    REQUIRE(sys->setDSPBufferSize(256, 4) == FMOD_OK);
+    REQUIRE(sys->init(32, FMOD_INIT_NORMAL, nullptr) == FMOD_OK);
+
+    const std::vector<float> samples(96000, .5f);
+    const auto wav = FMOD::Mock::wav(samples.data(), 96000, 1, 48000);
+
+    FMOD_CREATESOUNDEXINFO exinfo{};
+    exinfo.cbsize = sizeof(exinfo);
+    exinfo.length = (unsigned int)wav.size();
+
+    FMOD::Sound *sound;
+    REQUIRE(sys->createSound(wav.data(), FMOD_OPENMEMORY, &exinfo, &sound)
+        == FMOD_OK);
+
+    FMOD::ChannelGroup *master;
+    REQUIRE(sys->getMasterChannelGroup(&master) == FMOD_OK);
+
+    unsigned long long clock;
+    auto mixUntil = [&](unsigned long long target) {
+        do {
+            sys->update();
+            master->getDSPClock(nullptr, &clock);
+        } while (clock < target);
+    };
+
+    {
+        Channel chan(sound, master, sys);
+        REQUIRE(chan.paused());
+        REQUIRE(master->getDSPClock(nullptr, &clock) == FMOD_OK);
+        const auto start = clock;
+
+        SECTION("Fades ramp between their points")
+        {
+            chan.pause(false);
+            chan.fade(0, 1, 1, start + 4800);
+            REQUIRE(chan.fadeLevel(false) == 1);
+
+            REQUIRE(chan.fadeLevel(true, start + 4800) == Approx(0));
+            REQUIRE(chan.fadeLevel(true, start + 28800) == Approx(.5));
+            REQUIRE(chan.fadeLevel(true, start + 60000) == Approx(1));
+
+            mixUntil(start + 28800);
+            REQUIRE(chan.fadeLevel() ==
+                Approx((clock - start - 4800) / 48000.0).margin(.01));
+            REQUIRE(chan.audibility() == Approx(chan.fadeLevel()).margin(.01));
+        }
+
+        SECTION("Fading to a level starts from the current one")
+        {
+            chan.pause(false);
+            chan.fade(1, 0, 1, start);
+            mixUntil(start + 24000);
+
+            const auto level = chan.fadeLevel();
+            REQUIRE(level == Approx(.5).margin(.01));
+
+            chan.fadeTo(1, .5f, clock);
+            REQUIRE(chan.fadeLevel(true, clock) == Approx(level));
+            REQUIRE(chan.fadeLevel(true, clock + 12000) ==
+                Approx((level + 1) / 2).margin(.01));
+            REQUIRE(chan.fadeLevel(true, clock + 48000) == Approx(1));
+        }
+
+        SECTION("Unpausing waits for its DSP clock")
+        {
+            chan.pause(false, 0, true, start + 12000);
+            REQUIRE_FALSE(chan.paused());
+
+            mixUntil(start + 11000);
+            REQUIRE(chan.ch_positionSamples() == 0);
+            REQUIRE(chan.audibility() == 0);
+
+            mixUntil(start + 24000);
+            REQUIRE(chan.ch_positionSamples() ==
+                Approx(clock - start - 12000).margin(256));
+            REQUIRE(chan.audibility() == Approx(1));
+        }
+
+        SECTION("Delayed unpausing without a fade")
+        {
+            chan.pause(false, .25f, false, start);
+
+            mixUntil(start + 11000);
+            REQUIRE(chan.ch_positionSamples() == 0);
+
+            mixUntil(start + 24000);
+            REQUIRE(chan.ch_positionSamples() > 0);
+            REQUIRE(chan.audibility() == Approx(1));
+        }
+
+        SECTION("Pausing fades out, then stops the playhead")
+        {
+            chan.pause(false);
+            mixUntil(start + 4800);
+
+            const auto pausedAt = clock;
+            chan.pause(true, .25f, true, pausedAt);
+            REQUIRE(chan.paused());
+            REQUIRE(chan.fadeLevel(false) == 0);
+
+            mixUntil(pausedAt + 6000);
+            REQUIRE(chan.audibility() == Approx(.5).margin(.05));
+
+            mixUntil(pausedAt + 12000);
+            const auto position = chan.ch_positionSamples();
+            mixUntil(pausedAt + 24000);
+            REQUIRE(chan.ch_positionSamples() == position);
+            REQUIRE(chan.audibility() == 0);
+        }
+    }
+
+    sound->release();
+    sys->release();
+}
@@ -0,0 +1,120 @@
+#include "mock.h"
+#include <insound/HorizontalSequencer.h>
+
+TEST_CASE("HorizontalSequencer moves between sections")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+
+    // Four seconds, with a marker half way into the intro
+    const auto bank = mockBank(2, 192000, {{"Cue", 24000}});
+    auto &track = *engine.getTrack(engine.createTrack());
+    track.loadFsb(bank.data(), bank.size());
+
+    auto &sequencer = track.sequencer();
+    sequencer.addSection("intro", 0, 1);
+    sequencer.addSection("verse", 2, 3);
+
+    const ExitRule toVerse{
+        .conditions={{.param="energy", .op=CompareOp::GreaterThan,
+            .value=.5f}},
+        .target="verse",
+        .quantize=Quantize::None,
+        .inTime=0, .fadeIn=true, .outTime=0, .fadeOut=true,
+    };
+
+    sequencer.start("intro");
+    track.pause(false, 0);
+    engine.update();
+    engine.update();
+    REQUIRE(sequencer.current()->name == "intro");
+    REQUIRE(track.loopSamples().start == 0);
+    REQUIRE(track.loopSamples().end == 48000);
+
+    SECTION("Exit rules wait for their conditions")
+    {
+        sequencer.addExit("intro", toVerse);
+
+        sequencer.setParameter("energy", .25f);
+        engine.update();
+        REQUIRE(sequencer.pending() == nullptr);
+
+        sequencer.setParameter("energy", 1.f);
+        REQUIRE(sequencer.pending()->name == "verse");
+
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(sequencer.current()->name == "verse");
+        REQUIRE(sequencer.pending() == nullptr);
+        REQUIRE(track.position() >= 2.0);
+        REQUIRE(track.loopSamples().start == 96000);
+        REQUIRE(track.loopSamples().end == 144000);
+    }
+
+    SECTION("The first passing rule is used")
+    {
+        sequencer.addSection("outro", 3, 4);
+
+        auto toOutro = toVerse;
+        toOutro.target = "outro";
+        toOutro.conditions[0].value = .9f;
+        sequencer.addExit("intro", toOutro);
+        sequencer.addExit("intro", toVerse);
+
+        sequencer.setParameter("energy", .75f);
+        REQUIRE(sequencer.pending()->name == "verse");
+    }
+
+    SECTION("The loop region changes when the transition is reached")
+    {
+        auto rule = toVerse;
+        rule.quantize = Quantize::Marker;
+        sequencer.lookahead(1);
+        sequencer.addExit("intro", rule);
+        sequencer.setParameter("energy", 1.f);
+
+        REQUIRE(sequencer.pending()->name == "verse");
+        const auto switchClock = track.nextClock(Quantize::Marker);
+
+        // The intro keeps looping until the marker
+        engine.update();
+        REQUIRE(track.dspClock() < switchClock);
+        REQUIRE(track.loopSamples().end == 48000);
+        REQUIRE(track.nextClock(Quantize::Marker) == switchClock);
+
+        mixUntil(engine, track, switchClock);
+        engine.update();
+        REQUIRE(sequencer.current()->name == "verse");
+        REQUIRE(track.loopSamples().start == 96000);
+        REQUIRE(track.loopSamples().end == 144000);
+    }
+
+    SECTION("Transitions wait for their boundary to enter the lookahead")
+    {
+        auto rule = toVerse;
+        rule.quantize = Quantize::Marker;
+        sequencer.lookahead(.25f);
+        sequencer.addExit("intro", rule);
+
+        sequencer.setParameter("energy", 1.f);
+        REQUIRE(sequencer.pending() == nullptr);
+
+        // Marker at .5 seconds enters the window at .25 seconds
+        while (track.position() < .24)
+        {
+            engine.update();
+            REQUIRE(sequencer.pending() == nullptr);
+        }
+
+        while (track.position() < .26)
+            engine.update();
+        REQUIRE(sequencer.pending()->name == "verse");
+    }
+
+    SECTION("Stopping leaves the track playing")
+    {
+        sequencer.stop();
+        REQUIRE(sequencer.current() == nullptr);
+        REQUIRE_FALSE(track.paused());
+    }
+}
@@ -0,0 +1,356 @@
+#include "mock.h"
+#include <insound/HorizontalSequencer.h>
+#include <insound/MemoryBudget.h>
+#include <insound/TempoMap.h>
+
+#include <catch2/catch_approx.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Catch::Approx;
+
+// Seconds of one mix block of the mock settings
+static const double Block = 256 / 48000.0;
+
+TEST_CASE("MultiTrackAudio seeks while playing")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+
+    // Four seconds, with a marker half way into the first
+    const auto bank = mockBank(2, 192000, {{"Cue", 24000}});
+    auto &track = *engine.getTrack(engine.createTrack());
+    track.loadFsb(bank.data(), bank.size());
+    track.pause(false, 0);
+    engine.update();
+
+    SECTION("Seeks land after one mix block")
+    {
+        track.position(2);
+        REQUIRE(track.position() == Approx(2));
+
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() == Approx(2 + 3 * Block).margin(Block));
+    }
+
+    SECTION("Seeking cancels a transition that has not started")
+    {
+        const auto clock = track.transitionTo(3, Quantize::Marker, 0, true,
+            0, true);
+
+        track.position(1);
+
+        // Plays from the seek right away, not from the transition's clock
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.dspClock() < clock);
+        REQUIRE(track.position() == Approx(1 + 3 * Block).margin(Block));
+
+        // and the transition to 3 seconds never happens
+        mixUntil(engine, track, clock + 256);
+        REQUIRE(track.position() == Approx(1.5).margin(2 * Block));
+    }
+
+    SECTION("The position follows the outgoing set until a transition")
+    {
+        const auto clock = track.transitionTo(3, Quantize::Marker, 0, true,
+            0, true);
+        const auto position = track.position();
+        REQUIRE(position < .5);
+
+        engine.update();
+        REQUIRE(track.position() == Approx(position + Block).margin(1e-6));
+
+        mixUntil(engine, track, clock + 256);
+        REQUIRE(track.position() == Approx(3 + Block).margin(Block));
+    }
+
+    SECTION("Seeking cancels a pending section of the sequencer")
+    {
+        auto &sequencer = track.sequencer();
+        sequencer.addSection("intro", 0, 1);
+        sequencer.addSection("verse", 2, 3);
+        sequencer.addExit("intro", ExitRule{
+            .conditions={},
+            .target="verse",
+            .quantize=Quantize::Marker,
+            .inTime=0, .fadeIn=true, .outTime=0, .fadeOut=true,
+        });
+        sequencer.lookahead(1);
+
+        sequencer.start("intro");
+        engine.update();
+        engine.update();
+        REQUIRE(sequencer.pending()->name == "verse");
+
+        track.position(.75);
+        REQUIRE(sequencer.pending() == nullptr);
+        REQUIRE(sequencer.current()->name == "intro");
+        REQUIRE(track.loopSamples().end == 48000);
+
+        // The rule still passes, rescheduling once the seek started
+        engine.update();
+        REQUIRE(sequencer.pending() == nullptr);
+        engine.update();
+        REQUIRE(sequencer.pending()->name == "verse");
+    }
+
+    SECTION("Seeking before the sequencer enters its first section stops it")
+    {
+        auto &sequencer = track.sequencer();
+        sequencer.addSection("intro", 0, 1);
+
+        sequencer.start("intro");
+        track.position(2);
+        REQUIRE(sequencer.current() == nullptr);
+        REQUIRE(track.loopSamples().end == 192000);
+    }
+
+    SECTION("Seeks while paused apply right away")
+    {
+        track.pause(true, 0);
+        engine.update();
+
+        track.position(1.5);
+        REQUIRE(track.position() == Approx(1.5));
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() == Approx(1.5));
+
+        track.pause(false, 0);
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() == Approx(1.5 + 3 * Block).margin(Block));
+    }
+
+    SECTION("Seeks across the loop boundary")
+    {
+        track.loopSeconds(0, .5);
+
+        // Play up to the last block before the loop end
+        while (track.position() < .5 - Block)
+            engine.update();
+
+        track.position(.25);
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() == Approx(.25 + 3 * Block).margin(Block));
+
+        // A seek to just before the loop end wraps to its start
+        track.position(.5 - Block);
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() == Approx(2 * Block).margin(Block));
+    }
+}
+
+TEST_CASE("MultiTrackAudio dispatches markers up to a scheduled transition")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+
+    // Four seconds, with markers before the bar and after the target
+    const auto bank = mockBank(2, 192000, {{"Cue", 24000}, {"Out", 156000}});
+    auto &track = *engine.getTrack(engine.createTrack());
+    track.loadFsb(bank.data(), bank.size());
+    track.pause(false, 0);
+    engine.update();
+
+    // 120 bpm in 4/4: the next bar is two seconds in, far past the lookahead
+    track.tempoMap().add(0, 120);
+    const auto origin = track.dspClock() -
+        (unsigned long long)(track.position() * 48000);
+    const auto clock = track.transitionTo(3, Quantize::Bar, 0, true, 0, true);
+    REQUIRE(clock == origin + 96000);
+
+    mixUntil(engine, track, clock + 24000);
+    std::vector<TrackEvent> events;
+    track.pollEvents(events);
+
+    std::vector<TrackEvent> points;
+    for (const auto &event : events)
+    {
+        if (event.type == TrackEvent::Type::SyncPoint)
+            points.emplace_back(event);
+    }
+
+    // the outgoing set plays "Cue" before the switch, the incoming one "Out"
+    REQUIRE(points.size() == 2);
+    REQUIRE(points[0].index == 0);
+    REQUIRE(points[0].clock == origin + 24000);
+    REQUIRE(points[1].index == 1);
+    REQUIRE(points[1].clock == clock + 12000);
+}
+
+TEST_CASE("MultiTrackAudio loads and unloads banks")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+
+    const auto bank = mockBank(3, 96000, {{"Intro", 0}, {"Verse", 48000}});
+    auto &track = *engine.getTrack(engine.createTrack());
+    const auto before = MemoryBudget::stats();
+
+    SECTION("Loading sets up a paused stem per subsound")
+    {
+        track.loadFsb(bank.data(), bank.size());
+        REQUIRE(track.isLoaded());
+        REQUIRE(track.channelCount() == 3);
+        REQUIRE(track.paused());
+        REQUIRE(track.position() == 0);
+        REQUIRE(track.length() == Approx(2));
+        REQUIRE(track.samplerate() == 48000);
+        REQUIRE(track.getSyncPointCount() == 2);
+        REQUIRE(track.getSyncPointLabel(1) == "Verse");
+        REQUIRE(track.loopSamples().end == 96000);
+
+        // each stem keeps a decoded copy
+        REQUIRE(track.getSampleData(2).size() == 96000);
+        REQUIRE(MemoryBudget::stats().pcmLive >=
+            before.pcmLive + 3 * 96000 * sizeof(float));
+
+        SECTION("Clearing releases the stems and their copies")
+        {
+            track.clear();
+            REQUIRE_FALSE(track.isLoaded());
+            REQUIRE(track.channelCount() == 0);
+            REQUIRE(MemoryBudget::stats().pcmLive == before.pcmLive);
+        }
+
+        SECTION("Loading again replaces the stems")
+        {
+            const auto other = mockBank(1, 48000);
+            track.loadFsb(other.data(), other.size());
+            REQUIRE(track.channelCount() == 1);
+            REQUIRE(track.length() == Approx(1));
+            REQUIRE(track.getSyncPointCount() == 0);
+        }
+    }
+
+    SECTION("Asynchronous loads commit on update")
+    {
+        bool ready = false;
+        track.setReadyCallback([&ready]() { ready = true; });
+
+        track.loadFsbAsync(bank.data(), bank.size());
+        REQUIRE(track.loading());
+        REQUIRE_FALSE(track.isLoaded());
+
+        engine.update();
+        REQUIRE(ready);
+        REQUIRE_FALSE(track.loading());
+        REQUIRE(track.isLoaded());
+        REQUIRE(track.channelCount() == 3);
+        REQUIRE(track.loadError().empty());
+    }
+
+    SECTION("Invalid banks fail to load")
+    {
+        const std::string garbage(64, 'x');
+        REQUIRE_THROWS_AS(track.loadFsb(garbage.data(), garbage.size()),
+            std::runtime_error);
+        REQUIRE_FALSE(track.isLoaded());
+
+        track.loadFsbAsync(garbage.data(), garbage.size());
+        engine.update();
+        REQUIRE_FALSE(track.loading());
+        REQUIRE_FALSE(track.isLoaded());
+        REQUIRE_FALSE(track.loadError().empty());
+    }
+}
+
+TEST_CASE("MultiTrackAudio mixes through the stem mixer on request")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+
+    // Four seconds, with a marker half way into the first
+    const auto bank = mockBank(2, 192000, {{"Cue", 24000}});
+    auto &track = *engine.getTrack(engine.createTrack());
+    track.loadFsb(bank.data(), bank.size());
+    track.pause(false, 0);
+    engine.update();
+
+    const auto before = MemoryBudget::stats();
+    track.useStemMixer(true);
+    REQUIRE(track.usingStemMixer());
+    REQUIRE_FALSE(track.paused());
+
+    // the stem channels are silenced, and the mixer's copy is budgeted
+    engine.update();
+    REQUIRE(track.profile().voices == 0);
+    REQUIRE(MemoryBudget::stats().pcmLive ==
+        before.pcmLive + 2 * 192000 * sizeof(float));
+
+    SECTION("The mixer carries the playhead")
+    {
+        const auto start = track.position();
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() == Approx(start + 4 * Block).margin(Block));
+    }
+
+    SECTION("Pauses and seeks apply at the next mix block")
+    {
+        track.pause(true, 0);
+        REQUIRE(track.paused());
+        engine.update();
+        const auto paused = track.position();
+        engine.update();
+        REQUIRE(track.position() == paused);
+
+        track.position(2);
+        engine.update();
+        REQUIRE(track.position() == Approx(2));
+    }
+
+    SECTION("Markers are dispatched from the mixer's playhead")
+    {
+        mixUntil(engine, track, track.dspClock() + 48000);
+        std::vector<TrackEvent> events;
+        track.pollEvents(events);
+
+        REQUIRE(std::any_of(events.begin(), events.end(),
+            [](const TrackEvent &event) {
+                return event.type == TrackEvent::Type::SyncPoint &&
+                    event.index == 0;
+            }));
+    }
+
+    SECTION("Transitions are not supported")
+    {
+        REQUIRE_THROWS_AS(track.transitionTo(3, Quantize::None, 0, true, 0,
+            true), std::runtime_error);
+        REQUIRE_THROWS_AS(track.transitionToRegion(1, 2, 0, true, 0, true),
+            std::runtime_error);
+    }
+
+    SECTION("Turning it off hands the playhead back to the channels")
+    {
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        const auto handover = track.position();
+
+        track.useStemMixer(false);
+        REQUIRE_FALSE(track.usingStemMixer());
+        REQUIRE(track.position() == Approx(handover));
+        REQUIRE(MemoryBudget::stats().pcmLive == before.pcmLive);
+
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(track.position() ==
+            Approx(handover + 4 * Block).margin(Block));
+        REQUIRE(track.profile().voices == 2);
+    }
+
+    SECTION("Unloading turns it off")
+    {
+        track.clear();
+        REQUIRE_FALSE(track.usingStemMixer());
+        REQUIRE_THROWS_AS(track.useStemMixer(true), std::runtime_error);
+    }
+}
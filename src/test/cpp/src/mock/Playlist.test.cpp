@@ -0,0 +1,220 @@
+#include "mock.h"
+#include <insound/Playlist.h>
+
+#include <catch2/catch_approx.hpp>
+
+#include <algorithm>
+#include <string>
+
+using Catch::Approx;
+
+// One mix block of the mock engine in seconds
+static const double Block = 256 / 48000.0;
+
+/**
+ * Update the engine until the playlist made a number of switches
+ *
+ * @return highest position reached by the outgoing bank's track
+ */
+static double playUntilSwitch(AudioEngine &engine, size_t played)
+{
+    auto &playlist = engine.playlist();
+
+    double reached = 0;
+    for (int i = 0; i < 2000 && playlist.played() < played; ++i)
+    {
+        if (auto track = engine.getTrack(playlist.current()))
+            reached = std::max(reached, track->position());
+        engine.update();
+    }
+
+    REQUIRE(playlist.played() == played);
+    return reached;
+}
+
+TEST_CASE("Playlist plays banks back to back")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+    auto &playlist = engine.playlist();
+
+    // One second each, the first with a marker half way
+    const auto first = mockBank(2, 48000, {{"Exit", 24000}});
+    const auto second = mockBank(1, 96000);
+
+    SECTION("Banks load in the background and start once loaded")
+    {
+        playlist.enqueue(first.data(), first.size());
+        playlist.play();
+        REQUIRE(playlist.playing());
+
+        // the load is started by one update and committed by the next
+        engine.update();
+        auto track = engine.getTrack(playlist.current());
+        REQUIRE(track);
+        REQUIRE_FALSE(track->isLoaded());
+
+        engine.update();
+        REQUIRE(track->isLoaded());
+        REQUIRE(track->channelCount() == 2);
+        REQUIRE_FALSE(track->paused());
+
+        // the next bank is preloaded behind it
+        playlist.enqueue(second.data(), second.size());
+        REQUIRE(playlist.size() == 2);
+        REQUIRE_FALSE(playlist.preloaded());
+        engine.update();
+        engine.update();
+        REQUIRE(playlist.preloaded());
+        REQUIRE(engine.getTrack(playlist.current()) == track);
+    }
+
+    SECTION("The current bank loops until a next one is queued")
+    {
+        playlist.enqueue(first.data(), first.size());
+        playlist.play();
+
+        for (int i = 0; i < 250; ++i)
+            engine.update();
+        REQUIRE(playlist.played() == 0);
+        REQUIRE(engine.getTrack(playlist.current())->position() < .5);
+    }
+
+    SECTION("Banks switch at the loop end")
+    {
+        playlist.enqueue(first.data(), first.size());
+        playlist.enqueue(second.data(), second.size());
+        playlist.play();
+
+        size_t switches = 0;
+        playlist.onSwitch([&switches](size_t played) { switches = played; });
+
+        const auto outgoing = playlist.current();
+        REQUIRE(playUntilSwitch(engine, 1) == Approx(1).margin(3 * Block));
+        REQUIRE(switches == 1);
+        REQUIRE(playlist.size() == 1);
+        REQUIRE_FALSE(playlist.switching());
+
+        // the outgoing deck is emptied for the bank after next
+        REQUIRE_FALSE(engine.getTrack(outgoing)->isLoaded());
+
+        auto track = engine.getTrack(playlist.current());
+        REQUIRE(track->channelCount() == 1);
+        REQUIRE_FALSE(track->paused());
+        REQUIRE(track->position() < 3 * Block);
+    }
+
+    SECTION("Banks switch at their exit marker")
+    {
+        playlist.enqueue(first.data(), first.size(), 0, "exit");
+        playlist.enqueue(second.data(), second.size());
+        playlist.play();
+
+        REQUIRE(playUntilSwitch(engine, 1) == Approx(.5).margin(3 * Block));
+        REQUIRE(engine.getTrack(playlist.current())->position() <
+            3 * Block);
+    }
+
+    SECTION("Banks crossfade into the next")
+    {
+        playlist.enqueue(first.data(), first.size(), .25f);
+        playlist.enqueue(second.data(), second.size());
+        playlist.play();
+
+        const auto outgoing = engine.getTrack(playlist.current());
+        while (!playlist.switching())
+            engine.update();
+
+        // both banks play while the switch is in progress
+        mixUntil(engine, *outgoing, outgoing->dspClock() + 24000);
+        REQUIRE(playlist.switching());
+        REQUIRE(playlist.played() == 0);
+        const auto position = outgoing->position();
+        engine.update();
+        REQUIRE(outgoing->position() > position);
+
+        REQUIRE(playUntilSwitch(engine, 1) == Approx(1).margin(3 * Block));
+
+        // the incoming bank started a crossfade ahead of the exit point
+        REQUIRE(engine.getTrack(playlist.current())->position() ==
+            Approx(.25).margin(3 * Block));
+    }
+
+    SECTION("Skipping waits for the next bank to load")
+    {
+        playlist.enqueue(first.data(), first.size());
+        playlist.play();
+        engine.update();
+        engine.update();
+
+        playlist.enqueue(second.data(), second.size());
+        REQUIRE_FALSE(playlist.skip());
+
+        engine.update();
+        engine.update();
+        REQUIRE(playlist.preloaded());
+        REQUIRE(playlist.skip());
+        REQUIRE(playlist.switching());
+        REQUIRE_FALSE(playlist.skip());
+
+        REQUIRE(playUntilSwitch(engine, 1) < .1);
+    }
+
+    SECTION("Banks that fail to load are dropped")
+    {
+        const std::string garbage(64, 'x');
+        playlist.enqueue(garbage.data(), garbage.size());
+        playlist.enqueue(second.data(), second.size());
+        playlist.play();
+
+        for (int i = 0; i < 4; ++i)
+            engine.update();
+        REQUIRE(playlist.size() == 1);
+
+        auto track = engine.getTrack(playlist.current());
+        REQUIRE(track->isLoaded());
+        REQUIRE(track->channelCount() == 1);
+        REQUIRE_FALSE(track->paused());
+    }
+
+    SECTION("Stopping cancels a scheduled switch")
+    {
+        playlist.enqueue(first.data(), first.size(), .25f);
+        playlist.enqueue(second.data(), second.size());
+        playlist.play();
+
+        const auto outgoing = engine.getTrack(playlist.current());
+        while (!playlist.switching())
+            engine.update();
+        mixUntil(engine, *outgoing, outgoing->dspClock() + 24000);
+
+        playlist.stop();
+        REQUIRE_FALSE(playlist.playing());
+        REQUIRE_FALSE(playlist.switching());
+        engine.update();
+        engine.update();
+        REQUIRE(outgoing->paused());
+
+        // the next bank starts over when resumed, and is switched to again
+        playlist.play();
+        REQUIRE(playUntilSwitch(engine, 1) == Approx(1).margin(3 * Block));
+        REQUIRE(engine.getTrack(playlist.current())->position() ==
+            Approx(.25).margin(3 * Block));
+    }
+
+    SECTION("Clearing releases the decks")
+    {
+        playlist.enqueue(first.data(), first.size());
+        playlist.enqueue(second.data(), second.size());
+        playlist.play();
+        playUntilSwitch(engine, 1);
+
+        const auto deck = playlist.current();
+        playlist.clear();
+        REQUIRE(playlist.size() == 0);
+        REQUIRE(playlist.played() == 0);
+        REQUIRE(playlist.current() == 0);
+        REQUIRE_FALSE(playlist.playing());
+        REQUIRE(engine.getTrack(deck) == nullptr);
+    }
+}
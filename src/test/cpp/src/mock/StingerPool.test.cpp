@@ -0,0 +1,105 @@
+#include "mock.h"
+#include <insound/StingerPool.h>
+
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("StingerPool plays one-shots within its voice limit")
+{
+    AudioEngine engine;
+    REQUIRE(engine.init(mockSettings()));
+
+    const auto bank = mockBank(1, 48000);
+    auto &track = *engine.getTrack(engine.createTrack());
+    track.loadFsb(bank.data(), bank.size());
+    track.pause(false, 0);
+
+    // 1024 frames, four mix blocks
+    const std::vector<float> samples(1024, .5f);
+    const auto hit = FMOD::Mock::wav(samples.data(), 1024, 1, 48000);
+
+    auto &stingers = track.stingers();
+    stingers.maxVoices(2);
+    REQUIRE(stingers.load("hit", hit.data(), hit.size()) == 0);
+    REQUIRE(stingers.load("crash", hit.data(), hit.size()) == 1);
+    REQUIRE(stingers.load("hit", hit.data(), hit.size()) == 0);
+    REQUIRE(stingers.sampleCount() == 2);
+
+    SECTION("Voices free up when their sample ends")
+    {
+        REQUIRE(stingers.play(0) == 0);
+        REQUIRE(stingers.play(1) == 1);
+        REQUIRE(stingers.activeVoices() == 2);
+
+        for (int i = 0; i < 6; ++i)
+            engine.update();
+        REQUIRE(stingers.activeVoices() == 0);
+    }
+
+    SECTION("The lowest priority voice is stolen")
+    {
+        REQUIRE(stingers.play(0, 0, 5) == 0);
+        REQUIRE(stingers.play(0, 0, 1) == 1);
+
+        REQUIRE(stingers.play(1, 0, 3) == 1);
+        REQUIRE(stingers.activeVoices() == 2);
+    }
+
+    SECTION("The oldest voice is stolen among equals")
+    {
+        REQUIRE(stingers.play(0) == 0);
+        engine.update();
+        REQUIRE(stingers.play(0) == 1);
+
+        REQUIRE(stingers.play(1) == 0);
+    }
+
+    SECTION("Higher priority voices are not stolen")
+    {
+        REQUIRE(stingers.play(0, 0, 5) == 0);
+        REQUIRE(stingers.play(0, 0, 5) == 1);
+
+        REQUIRE(stingers.play(1, 0, 4) == -1);
+        REQUIRE(stingers.activeVoices() == 2);
+    }
+
+    SECTION("Scheduled voices count as active before they start")
+    {
+        const auto clock = track.dspClock() + 48000;
+        REQUIRE(stingers.play(0, clock) == 0);
+
+        for (int i = 0; i < 8; ++i)
+            engine.update();
+        REQUIRE(stingers.activeVoices() == 1);
+
+        // Stopping a voice that has not started cuts it right away
+        stingers.stop(0);
+        REQUIRE(stingers.activeVoices() == 0);
+    }
+
+    SECTION("Lowering the limit stops voices past it")
+    {
+        REQUIRE(stingers.play(0) == 0);
+        REQUIRE(stingers.play(1) == 1);
+
+        stingers.maxVoices(1);
+        REQUIRE(stingers.maxVoices() == 1);
+        REQUIRE(stingers.activeVoices() == 1);
+
+        REQUIRE_THROWS_AS(stingers.maxVoices(0), std::invalid_argument);
+    }
+
+    SECTION("Samples out of range throw")
+    {
+        REQUIRE_THROWS_AS(stingers.play(2), std::out_of_range);
+    }
+
+    SECTION("Tracks play stingers by name")
+    {
+        REQUIRE(track.playStinger("crash", Quantize::None) == 0);
+        REQUIRE(stingers.activeVoices() == 1);
+
+        REQUIRE_THROWS_AS(track.playStinger("missing", Quantize::None),
+            std::runtime_error);
+    }
+}
@@ -0,0 +1,120 @@
+#include "../test.h"
+#include <insound/SyncPointMgr.h>
+
+#include <catch2/catch_approx.hpp>
+#include <fmod.hpp>
+#include <fmod_mock.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Catch::Approx;
+
+TEST_CASE("SyncPointMgr loads the cue points of a sound")
+{
+    FMOD::System *sys;
+    REQUIRE(FMOD::System_Create(&sys) == FMOD_OK);
+    REQUIRE(sys->init(32, FMOD_INIT_NORMAL, nullptr) == FMOD_OK);
+
+    const std::vector<float> samples(48000, 0.f);
+    const auto wav = FMOD::Mock::wav(samples.data(), 48000, 1, 48000, {
+        {"Outro", 36000}, {"Intro", 0}, {"Verse", 12000},
+    });
+
+    FMOD_CREATESOUNDEXINFO exinfo{};
+    exinfo.cbsize = sizeof(exinfo);
+    exinfo.length = (unsigned int)wav.size();
+
+    FMOD::Sound *sound;
+    REQUIRE(sys->createSound(wav.data(), FMOD_OPENMEMORY, &exinfo, &sound)
+        == FMOD_OK);
+
+    SyncPointMgr points(sound);
+
+    SECTION("Points are sorted by offset")
+    {
+        REQUIRE(points.size() == 3);
+        REQUIRE(points.getLabel(0) == "Intro");
+        REQUIRE(points.getLabel(1) == "Verse");
+        REQUIRE(points.getLabel(2) == "Outro");
+    }
+
+    SECTION("Offsets convert with the sound's sample rate")
+    {
+        REQUIRE(points.getOffsetPCM(1) == 12000);
+        REQUIRE(points.getOffsetSeconds(1) == Approx(.25));
+        REQUIRE(points.getOffsetMS("outro").value() == Approx(750));
+    }
+
+    SECTION("Added points are written to the sound")
+    {
+        points.emplace("Bridge", 500, FMOD_TIMEUNIT_MS);
+
+        int count;
+        REQUIRE(sound->getNumSyncPoints(&count) == FMOD_OK);
+        REQUIRE(count == 4);
+        REQUIRE(points.findIndex("bridge") == 2);
+        REQUIRE(points.getOffsetPCM(2) == 24000);
+    }
+
+    SECTION("Adding a point differing only in case returns the existing one")
+    {
+        auto &point = points.emplace("VERSE", 12000, FMOD_TIMEUNIT_PCM);
+        REQUIRE(point.label() == "Verse");
+        REQUIRE(points.size() == 3);
+    }
+
+    SECTION("Labels stay indexed as points are added and removed")
+    {
+        points.emplace("verse", 6000, FMOD_TIMEUNIT_PCM);
+        points.emplace("Coda", 40000, FMOD_TIMEUNIT_PCM);
+        REQUIRE(points.findIndex("Verse") == 1);
+        REQUIRE(points.findIndex("Outro") == 3);
+        REQUIRE(points.findIndex("coda") == 4);
+        REQUIRE(points.getOffsetPCM("Coda").value() == 40000);
+
+        // Removing the earliest of a label falls back to the next one
+        points.deleteSyncPoint(1);
+        REQUIRE(points.findIndex("verse") == 1);
+        REQUIRE(points.getOffsetPCM("verse").value() == 12000);
+        REQUIRE(points.findIndex("coda") == 3);
+
+        points.deleteSyncPoint(1);
+        REQUIRE(points.findIndex("verse") == -1);
+        REQUIRE(points.findIndex("intro") == 0);
+        REQUIRE(points.findIndex("outro") == 1);
+        REQUIRE(points.offsets() == std::vector<unsigned>{0, 36000, 40000});
+
+        // Replacing moves a point, keeping the others indexed
+        points.replace(0, "Intro", 38000, FMOD_TIMEUNIT_PCM);
+        REQUIRE(points.findIndex("outro") == 0);
+        REQUIRE(points.findIndex("intro") == 1);
+        REQUIRE(points.findIndex("coda") == 2);
+    }
+
+    SECTION("Assigned labels are kept verbatim")
+    {
+        const std::vector<std::string> labels{
+            "Chorus\nrepeat", "", "Chorus\nrepeat", "Coda",
+        };
+        points.assign(labels, {30000, 6000, 18000, 42000});
+
+        REQUIRE(points.size() == 4);
+        REQUIRE(points.getLabel(0).empty());
+        REQUIRE(points.getLabel(1) == "Chorus\nrepeat");
+        REQUIRE(points.getLabel(2) == "Chorus\nrepeat");
+        REQUIRE(points.getLabel(3) == "Coda");
+        REQUIRE(points.findIndex("chorus\nrepeat") == 1);
+
+        int count;
+        REQUIRE(sound->getNumSyncPoints(&count) == FMOD_OK);
+        REQUIRE(count == 4);
+
+        REQUIRE_THROWS_AS(points.assign(labels, {0}), std::invalid_argument);
+        REQUIRE(points.size() == 4);
+    }
+
+    sound->release();
+    sys->release();
+}
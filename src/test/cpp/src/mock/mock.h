@@ -0,0 +1,53 @@
+#pragma once
+#include "../test.h"
+#include <insound/MultiTrackAudio.h>
+
+#include <fmod_mock.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Settings of a deterministic engine: each update mixes one 256-sample
+ * block at 48 kHz
+ */
+inline AudioEngineSettings mockSettings()
+{
+    AudioEngineSettings settings;
+    settings.output = OutputMode::NoSoundNRT;
+    settings.samplerate = 48000;
+    settings.bufferLength = 256;
+    return settings;
+}
+
+/**
+ * Encode a mock bank of silent mono stems at 48 kHz
+ *
+ * @param stems   - number of subsounds
+ * @param frames  - length of each in sample frames
+ * @param markers - cue points of the first stem
+ */
+inline std::string mockBank(int stems, unsigned frames,
+    const std::vector<FMOD::Mock::Marker> &markers = {})
+{
+    const std::vector<float> samples(frames, 0.f);
+
+    std::vector<std::string> wavs;
+    for (int i = 0; i < stems; ++i)
+    {
+        wavs.emplace_back(FMOD::Mock::wav(samples.data(), frames, 1, 48000,
+            i == 0 ? markers : std::vector<FMOD::Mock::Marker>{}));
+    }
+
+    return FMOD::Mock::bank(wavs);
+}
+
+/**
+ * Update the engine until its DSP clock reaches a sample
+ */
+inline void mixUntil(AudioEngine &engine, MultiTrackAudio &track,
+    unsigned long long clock)
+{
+    while (track.dspClock() < clock)
+        engine.update();
+}
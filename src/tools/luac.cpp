@@ -0,0 +1,78 @@
+/**
+ * @file luac.cpp
+ *
+ * Build tool compiling a Lua source file to bytecode, written as a braced
+ * list of bytes to embed with `#include`:
+ *
+ *     insound-luac <input.lua> <output.h> <chunkname>
+ *
+ * It is built with the engine's toolchain, so the bytecode matches the
+ * engine's Lua build. Cross builds run it through the toolchain's emulator.
+ */
+#define MAKE_LIB
+
+extern "C" {
+#include <onelua.c>
+}
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+static int writeChunk(lua_State *, const void *data, size_t size, void *ud)
+{
+    static_cast<std::string *>(ud)->append(static_cast<const char *>(data),
+        size);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "usage: insound-luac <input.lua> <output.h> "
+            "<chunkname>\n";
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input)
+    {
+        std::cerr << "insound-luac: cannot open " << argv[1] << '\n';
+        return 1;
+    }
+    const std::string source{std::istreambuf_iterator<char>(input),
+        std::istreambuf_iterator<char>()};
+
+    auto L = luaL_newstate();
+    if (luaL_loadbufferx(L, source.data(), source.size(), argv[3], "t") !=
+        LUA_OK)
+    {
+        std::cerr << "insound-luac: " << lua_tostring(L, -1) << '\n';
+        lua_close(L);
+        return 1;
+    }
+
+    // Keep debug info, for line numbers in errors
+    std::string bytecode;
+    lua_dump(L, writeChunk, &bytecode, 0);
+    lua_close(L);
+
+    std::ofstream output(argv[2], std::ios::binary);
+    output << "// Generated by insound-luac from " << argv[1] << "\n{";
+    for (size_t i = 0; i < bytecode.size(); ++i)
+    {
+        output << (i % 16 ? " " : "\n    ") <<
+            (int)(unsigned char)bytecode[i] << ',';
+    }
+    output << "\n}\n";
+
+    if (!output)
+    {
+        std::cerr << "insound-luac: cannot write " << argv[2] << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -2,6 +2,10 @@ import { audioModuleWasInit, initAudioModule } from "./emaudio/AudioModule";
 import { getAudioModule } from "./emaudio/AudioModule";
 import { SpectrumAnalyzer } from "./SpectrumAnalyzer";
 import { MultiTrackControl } from "./MultiTrackControl";
+import { LatencyProfile } from "./LatencyProfile";
+import { GlitchType } from "./GlitchType";
+import { Callback } from "./Callback";
+import { EmBuffer } from "./emaudio/EmBuffer";
 
 /** Max time in seconds before AudioEngine should suspend itself. */
 const MAX_DOWNTIME = 5;
@@ -15,6 +19,16 @@ const registry = new FinalizationRegistry((heldValue: any) => {
     }
 });
 
+/** Copy an Embind vector into an array */
+function toArray<T>(vector: Vector<T>): T[]
+{
+    const result: T[] = [];
+    const size = vector.size();
+    for (let i = 0; i < size; ++i)
+        result.push(vector.get(i));
+    return result;
+}
+
 // Get this info from a database to populate a new track with
 export interface LoadOptions
 {
@@ -41,7 +55,22 @@ export class AudioEngine
     private m_lastFrameTime: number;
     private m_downTime: number;
 
-    constructor()
+    /**
+     * Fired for each output glitch with its type, time and measured
+     * duration in seconds, and the mixer DSP clock
+     */
+    readonly onglitch: Callback<[GlitchType, number, number, number]>;
+
+    /**
+     * Fired when the playlist switched to its next bank, with the number of
+     * switches made
+     */
+    readonly onplaylistswitch: Callback<[number]>;
+
+    /**
+     * @param latency - output latency profile, re-applied on `reset`
+     */
+    constructor(latency: LatencyProfile = LatencyProfile.Balanced)
     {
         // Ensure WebAssembly module was initialized
         if (!audioModuleWasInit())
@@ -55,7 +84,10 @@ export class AudioEngine
 
         this.m_engine = new (this.m_module.AudioEngine)();
         this.m_tracks = [];
+        this.onglitch = new Callback;
+        this.onplaylistswitch = new Callback;
 
+        this.m_engine.setLatencyProfile(latency);
         if (!this.m_engine.init())
         {
             this.m_engine.delete();
@@ -63,10 +95,23 @@ export class AudioEngine
         }
 
         registry.register(this, this.engine, this);
+        this.m_engine.setGlitchCallback(this.handleGlitch);
+        this.m_engine.setPlaylistCallback(this.handlePlaylistSwitch);
 
         this.m_lastFrameTime = performance.now();
     }
 
+    private handleGlitch = (type: number, time: number, duration: number,
+        clock: number) =>
+    {
+        this.onglitch.invoke(type, time, duration, clock);
+    }
+
+    private handlePlaylistSwitch = (played: number) =>
+    {
+        this.onplaylistswitch.invoke(played);
+    }
+
     /**
      * Restart the underlying Emscripten audio module and replace the
      * underlying AudioEngine with a new one. To be used when encountering
@@ -78,8 +123,11 @@ export class AudioEngine
 
         this.m_isResetting = true;
 
+        let latency = LatencyProfile.Balanced;
+
         // Delete old engine object
         try {
+            latency = this.engine.getLatencyProfile();
             this.engine.delete();
         }
         catch(err)
@@ -104,12 +152,15 @@ export class AudioEngine
         // Reset AudioEngine
         try {
             this.m_engine = new (this.m_module.AudioEngine)();
+            this.m_engine.setLatencyProfile(latency);
 
             // Re-register new engine as `heldValue` to finalize
             registry.unregister(this);
             registry.register(this, this.m_engine, this);
 
             this.engine.init();
+            this.engine.setGlitchCallback(this.handleGlitch);
+            this.engine.setPlaylistCallback(this.handlePlaylistSwitch);
         }
         catch(err)
         {
@@ -127,15 +178,15 @@ export class AudioEngine
 
     createTrack(): MultiTrackControl
     {
-        const trackPtr = this.engine.createTrack();
+        const handle = this.engine.createTrack();
         try {
-            const track = new MultiTrackControl(this, trackPtr);
+            const track = new MultiTrackControl(this, handle);
             this.m_tracks.push(track);
             return track;
         }
         catch(err)
         {
-            this.engine.deleteTrack(trackPtr);
+            this.engine.deleteTrack(handle);
             throw err;
         }
     }
@@ -154,6 +205,7 @@ export class AudioEngine
             if (this.m_tracks[i] === track)
             {
                 track.delete();
+                this.engine.deleteTrack(track.handle);
 
                 this.m_tracks.splice(i, 1);
                 return true;
@@ -163,6 +215,150 @@ export class AudioEngine
         return false;
     }
 
+    /**
+     * Attach a track to the engine transport, so that it plays, stops and
+     * seeks sample-aligned with the other attached tracks.
+     */
+    attachTrack(track: MultiTrackControl)
+    {
+        this.engine.attachTrack(track.handle);
+    }
+
+    /** Detach a track from the engine transport */
+    detachTrack(track: MultiTrackControl)
+    {
+        this.engine.detachTrack(track.handle);
+    }
+
+    /**
+     * Output latency profile. Changing it after construction takes effect
+     * once no track is loading or transitioning. Loaded tracks resume where
+     * they were after a short gap.
+     */
+    get latencyProfile(): LatencyProfile
+    {
+        return this.m_engine.getLatencyProfile();
+    }
+
+    set latencyProfile(profile: LatencyProfile)
+    {
+        this.m_engine.setLatencyProfile(profile);
+    }
+
+    /** Current output buffer configuration and glitch counts */
+    get latencyStats() { return this.m_engine.getLatencyStats(); }
+
+    /**
+     * Number of channels actually mixed. Less audible, lower priority
+     * channels beyond it play virtually until a real voice frees up.
+     */
+    set voiceBudget(voices: number) { this.m_engine.setVoiceBudget(voices); }
+
+    /** Voice budget and current voice usage */
+    get voiceStats() { return this.m_engine.getVoiceStats(); }
+
+    /**
+     * Get an engine profile of the last sampling window, with timing and
+     * track lists copied into plain arrays
+     */
+    profile()
+    {
+        const snapshot = this.m_engine.getProfile();
+        try {
+            return {
+                ...snapshot,
+                timings: toArray(snapshot.timings),
+                tracks: toArray(snapshot.tracks),
+            };
+        }
+        finally
+        {
+            snapshot.timings.delete();
+            snapshot.tracks.delete();
+        }
+    }
+
+    /** Glitch counters and worst-case mixer and update timings */
+    get glitchStats() { return this.m_engine.getGlitchStats(); }
+
+    resetGlitchStats()
+    {
+        this.m_engine.resetGlitchStats();
+    }
+
+    /**
+     * Maximum bytes of FMOD, decoded PCM and Lua memory, 0 for unlimited.
+     * Banks that would exceed it fail to load with an error.
+     */
+    set memoryBudget(bytes: number) { this.m_engine.setMemoryBudget(bytes); }
+
+    /** Live and peak bytes per subsystem */
+    get memoryStats() { return this.m_engine.getMemoryStats(); }
+
+    resetMemoryPeaks()
+    {
+        this.m_engine.resetMemoryPeaks();
+    }
+
+    // ----- Playlist ---------------------------------------------------------
+
+    /**
+     * Queue an fsb bank to play gaplessly after the ones already queued. It
+     * decodes in the background while the previous bank plays.
+     *
+     * @param buffer     - fsb file data
+     * @param crossfade  - seconds to crossfade into the bank queued after
+     *                     this one, 0 for a sample-accurate cut
+     * @param exitMarker - marker to leave this bank at for the next one,
+     *                     leaves at the loop end by default
+     */
+    enqueue(buffer: ArrayBuffer, crossfade: number = 0,
+        exitMarker: string = "")
+    {
+        const data = new EmBuffer;
+        data.alloc(buffer, getAudioModule());
+
+        try {
+            this.m_engine.playlistEnqueue(data.ptr, data.size, crossfade,
+                exitMarker);
+        }
+        finally
+        {
+            data.free();
+        }
+    }
+
+    playPlaylist(seconds: number = 0) { this.m_engine.playlistPlay(seconds); }
+
+    stopPlaylist(seconds: number = 0) { this.m_engine.playlistStop(seconds); }
+
+    /**
+     * Switch to the next bank now instead of at the exit point
+     * @returns whether the switch was scheduled, false if the next bank
+     *          hasn't loaded yet
+     */
+    skipPlaylist(crossfade: number = 0): boolean
+    {
+        return this.m_engine.playlistSkip(crossfade);
+    }
+
+    clearPlaylist() { this.m_engine.playlistClear(); }
+
+    /** Number of banks queued, including the one playing */
+    get playlistSize() { return this.m_engine.getPlaylistSize(); }
+
+    /** Discard recorded profile timings and start a new sampling window */
+    resetProfile()
+    {
+        this.m_engine.resetProfile();
+    }
+
+    /** Whether profile timings are recorded */
+    set profiling(enabled: boolean)
+    {
+        this.m_engine.setProfiling(enabled);
+    }
+
     get masterVolume() { return this.m_engine.getMasterVolume(); }
 
     set masterVolume(level: number) { this.m_engine.setMasterVolume(level); }
@@ -29,6 +29,9 @@ export interface AudioMarker
 /**
  * Manager for an audio track's markers. Emits callbacks when markers are
  * triggered from playback.
+ *
+ * Markers are mirrored to the track's sync points, which the engine
+ * dispatches from. Both are kept in order of position, so indices match.
  */
 export class AudioMarkerMgr extends MarkerMgr<AudioMarker>
 {
@@ -46,14 +49,42 @@ export class AudioMarkerMgr extends MarkerMgr<AudioMarker>
      */
     loadFromTrack(): void
     {
-        const track = this.track;
-        this.clear();
+        const points = this.track.track.getSyncPoints();
 
-        const pointCount = track.track.getSyncPointCount();
-        for (let i = 0; i < pointCount; ++i)
+        const markers: AudioMarker[] = [];
+        for (let i = 0; i < points.offsets.length; ++i)
         {
-            this.push(track.track.getSyncPoint(i));
+            markers.push({name: points.labels[i], position: points.offsets[i]});
         }
+
+        // already in the track, so skip mirroring
+        super.assign(markers);
+    }
+
+    /**
+     * Replace all markers and the track's sync points in one pass
+     */
+    override assign(markers: AudioMarker[])
+    {
+        const length = this.track.length;
+        for (const marker of markers)
+        {
+            // clamp marker position within valid range
+            marker.position = Math.max(Math.min(marker.position, length), 0);
+        }
+
+        super.assign(markers);
+
+        // mirror in the same sorted order, so indices match
+        const sorted = this.markers;
+        const offsets = new Float64Array(sorted.length);
+        for (let i = 0; i < sorted.length; ++i)
+        {
+            offsets[i] = sorted[i].position;
+        }
+
+        this.track.track.setSyncPoints(offsets,
+            sorted.map(m => m.name));
     }
 
     protected override cleanMarkers(): boolean
@@ -82,9 +113,37 @@ export class AudioMarkerMgr extends MarkerMgr<AudioMarker>
         // clamp marker position within valid range
         marker.position = Math.max(Math.min(marker.position, this.track.length), 0);
 
+        this.track.track.addSyncPoint(marker.name, marker.position);
         return super.push(marker);
     }
 
+    override eraseByIndex(index: number): boolean
+    {
+        if (!super.eraseByIndex(index))
+            return false;
+
+        this.track.track.deleteSyncPoint(index);
+        return true;
+    }
+
+    override editPositionByIndex(index: number, position: number): boolean
+    {
+        const marker = this.markers[index];
+        if (!marker) return false;
+
+        // the name may have changed even if the position didn't
+        this.track.track.editSyncPoint(index, marker.name, position);
+        return super.editPositionByIndex(index, position);
+    }
+
+    override clear(): void
+    {
+        if (this.track.track.isLoaded())
+            this.track.track.setSyncPoints(new Float64Array, []);
+
+        super.clear();
+    }
+
     /** Find marker by name (only the first occurrence) */
     findByName(name: string): AudioMarker | undefined
     {
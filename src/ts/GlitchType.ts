@@ -0,0 +1,15 @@
+/**
+ * Kind of output glitch detected by the engine.
+ * Mirrors `Insound::Glitch::Type` in the C++ engine.
+ */
+export enum GlitchType
+{
+    /** The device ran dry because the mixer clock fell behind */
+    Underrun,
+    /** Mixing one block took longer than its duration */
+    Overload,
+    /** The mixer was starved of CPU time between two mixes */
+    LateMix,
+    /** The engine update was called too late */
+    LateUpdate,
+}
@@ -1,43 +1,114 @@
-import { ConditionalGroup } from "./Conditional";
-import { MarkerTransition } from "./MarkerMgr";
+import { CompareOp } from "./Conditional";
+import { Quantize } from "./Quantize";
 
-enum NoteType {
-    Beat,
-    Measure,
-    BeatInMeasure,
+/** Compares a float parameter against a constant */
+export interface ExitCondition
+{
+    param: string;
+    op: CompareOp;
+    value: number;
 }
 
-interface ExitCondition
+/** Transition out of a section, taken once all conditions are met */
+export interface ExitRule
 {
-    condition: ConditionalGroup;
-    transition: MarkerTransition;
-    sync?: {
-        noteType: NoteType;
+    /** All must pass for the rule to be taken, passes if empty */
+    conditions: ExitCondition[];
+    /** Name of the section to transition to */
+    target: string;
+    /** Musical boundary to transition at */
+    quantize: Quantize;
 
-    };
+    inTime?: number;
+    fadeIn?: boolean;
+    outTime?: number;
+    fadeOut?: boolean;
 }
 
 export class HorizontalSection
 {
+    name: string;
     start: number;
     end: number;
-    exitConditions: ExitCondition[];
+    exits: ExitRule[];
 
-    constructor()
+    constructor(name: string, start: number, end: number)
     {
-        this.exitConditions = [];
-        this.start = 0;
-        this.end = 0;
+        this.name = name;
+        this.start = start;
+        this.end = end;
+        this.exits = [];
     }
 }
 
-
-
-
+/**
+ * Frontend for the engine's horizontal re-sequencer. Sections and exit rules
+ * are stored here for editing, then uploaded to the track via `commit`.
+ * Exit rules are evaluated against the track's numeric parameters.
+ */
 export class HorizontalSequenceMgr
 {
-    private m_current: HorizontalSection | null = null;
+    private m_track: InsoundMultiTrackControl;
     private m_sections: HorizontalSection[];
 
+    get sections(): readonly HorizontalSection[] { return this.m_sections; }
+
+    /** Name of the section currently playing, or "" if not sequencing */
+    get current(): string { return this.m_track.getCurrentSection(); }
+
+    constructor(track: InsoundMultiTrackControl)
+    {
+        this.m_track = track;
+        this.m_sections = [];
+    }
+
+    add(section: HorizontalSection)
+    {
+        const index = this.m_sections.findIndex(s => s.name === section.name);
+        if (index === -1)
+            this.m_sections.push(section);
+        else
+            this.m_sections[index] = section;
+    }
+
+    clear()
+    {
+        this.m_sections.length = 0;
+        this.m_track.clearSections();
+    }
+
+    /** Upload all sections and their exit rules to the engine */
+    commit()
+    {
+        this.m_track.clearSections();
+
+        for (const section of this.m_sections)
+            this.m_track.addSection(section.name, section.start, section.end);
+
+        for (const section of this.m_sections)
+        {
+            for (const exit of section.exits)
+            {
+                this.m_track.addSectionExit(section.name, exit.conditions,
+                    exit.target, exit.quantize, exit.inTime ?? 0,
+                    exit.fadeIn ?? true, exit.outTime ?? 0,
+                    exit.fadeOut ?? true);
+            }
+        }
+    }
+
+    /** Enter a section immediately and start sequencing */
+    start(name: string)
+    {
+        this.m_track.startSection(name);
+    }
 
+    /**
+     * Seconds before a boundary the engine commits its transition. Should be
+     * longer than the longest expected gap between engine updates.
+     */
+    set lookahead(seconds: number)
+    {
+        this.m_track.setSequencerLookahead(seconds);
+    }
 }
@@ -0,0 +1,15 @@
+/**
+ * Trade-off between output latency and robustness against glitches.
+ * Mirrors `Insound::LatencyProfile` in the C++ engine.
+ */
+export enum LatencyProfile
+{
+    /** ~21 ms at 48 kHz */
+    Low,
+    /** ~43 ms at 48 kHz */
+    Balanced,
+    /** ~85 ms at 48 kHz */
+    PowerSaver,
+    /** Starts low, backing off after underruns or high CPU usage */
+    Adaptive,
+}
@@ -9,7 +9,8 @@ export interface IMarker
 /**
  * Manages a list of markers in order by position.
  * Fires callbacks right before marker with clock time for sample accurate
- * synchronization.
+ * synchronization. Markers are dispatched by the engine via `fire`, which
+ * tracks the playhead against the DSP clock.
  */
 export class MarkerMgr<T extends IMarker>
 {
@@ -31,7 +32,8 @@ export class MarkerMgr<T extends IMarker>
     protected isDirty: boolean;
 
     /**
-     * Callback when marker is just about to pass playhead (~.1 second before)
+     * Callback when marker is just about to pass playhead, by the engine's
+     * marker lookahead (.1 second by default).
      * Sample-accurate timings can be planned using the second parameter, which
      * contains the dsp clock of the target marker.
      * You can use a timeout to approximate exact timing via marker position.
@@ -109,6 +111,18 @@ export class MarkerMgr<T extends IMarker>
         return marker;
     }
 
+    /**
+     * Replace all markers at once, sorting them by position in one pass.
+     *
+     * @param markers - markers to contain, in any order
+     */
+    assign(markers: T[])
+    {
+        // Array.prototype.sort is stable, equal positions keep their order
+        this.markers = [...markers].sort((a, b) => a.position - b.position);
+        this.isDirty = true;
+    }
+
     /**
      * Called when markers are dirty and are requested to be cleaned
      * Should be overriden with desired behavior for each marker subclass
@@ -122,49 +136,42 @@ export class MarkerMgr<T extends IMarker>
      */
     private update(): void
     {
-        const track = this.track;
-        if (track.isPaused) return;
-
-        let position = track.position;
-        const oldCursor = this.cursor;
-
         if (this.isDirty) // if dirty, we need to recalibrate cursor
         {
-            this.calibrateCursor(position);
+            const oldCursor = this.cursor;
+            this.calibrateCursor(this.track.position);
             if (this.cleanMarkers())
             {
                 this.onmarkersupdated.invoke();
             }
 
             this.isDirty = false;
-        }
-
-        for (let marker = this.markers[this.cursor]; this.cursor < this.markers.length; )
-        {
-            position = track.position; // (update in case seek occurs in onmark callback)
-
-            let checkSec = (marker.position < position) ? // loop probably occured, check position by added length
-                marker.position + track.length:
-                marker.position;
 
-            if (checkSec - position < .1)
+            if (oldCursor !== this.cursor)
             {
-                // get target clock for marker
-                const clock = track.track.dspClock() + track.track.samplerate() * (checkSec - position);
+                this.oncursorchanged.invoke(this.cursor, oldCursor);
+            }
+        }
+    }
 
-                // increment cursor/marker for next check (this happens before callback invocation, since transition may update cursor during callback)
-                this.cursor = (this.cursor + 1) % this.markers.length;
+    /**
+     * Notify that the playhead is about to cross a marker. Called with
+     * events scheduled by the engine.
+     *
+     * @param index - index of the marker
+     * @param clock - dsp clock at which the playhead reaches the marker
+     */
+    fire(index: number, clock: number): void
+    {
+        const marker = this.markers[index];
+        if (!marker) return;
 
-                // fire callback
-                this.onmarker.invoke(marker, clock);
+        // move cursor before invocation, since transition may update cursor
+        // during callback
+        const oldCursor = this.cursor;
+        this.cursor = (index + 1) % this.markers.length;
 
-                marker = this.markers[this.cursor];
-            }
-            else
-            {
-                break;
-            }
-        }
+        this.onmarker.invoke(marker, clock);
 
         if (oldCursor !== this.cursor)
         {
@@ -3,12 +3,14 @@ import { AudioConsole } from "./AudioConsole";
 import { Callback } from "./Callback";
 import { MixPreset, MixPresetMgr } from "./MixPresetMgr";
 import { SpectrumAnalyzer } from "./SpectrumAnalyzer";
-import { EmBufferGroup } from "./emaudio/EmBuffer";
+import { EmBuffer, EmBufferGroup } from "./emaudio/EmBuffer";
 import { SoundLoadError } from "./SoundLoadError";
 import { AudioEngine } from "./AudioEngine";
 import { AudioMarker, AudioMarkerMgr } from "./AudioMarkerMgr";
 import { AudioChannel } from "./AudioChannel";
 import { ParamConfig, ParameterMgr } from "./params/ParameterMgr";
+import { Quantize } from "./Quantize";
+import { TrackEventType, TRACK_EVENT_STRIDE } from "./TrackEvent";
 
 // Get this info from a database to populate a new track with
 export interface LoadOptions
@@ -31,7 +33,7 @@ export class MultiTrackControl
 {
     private m_engine: AudioEngine;
     private m_track: InsoundMultiTrackControl;
-    private m_ptr: number;
+    private m_handle: number;
     private m_markers: AudioMarkerMgr;
     private m_spectrum: SpectrumAnalyzer;
     private m_trackData: EmBufferGroup;
@@ -46,6 +48,9 @@ export class MultiTrackControl
 
     get track() { return this.m_track; }
 
+    /** Engine handle of the underlying track */
+    get handle() { return this.m_handle; }
+
     /** Read-only list of mix presets, do not modify directly */
     get mixPresets() { return this.m_mixPresets.presets; }
     set mixPresets(val: MixPreset[]) { this.m_mixPresets.presets = val; }
@@ -65,6 +70,15 @@ export class MultiTrackControl
      */
     readonly onupdate: Callback<[number, number, number]>;
     readonly onmarker: Callback<[AudioMarker]>;
+
+    /**
+     * Fires for playback events other than markers, ahead of time by the
+     * marker lookahead.
+     * Param 1: event type
+     * Param 2: track position of the event in seconds
+     * Param 3: dsp clock at which the event occurs
+     */
+    readonly ontrackevent: Callback<[TrackEventType, number, number]>;
     readonly onload: Callback<[MultiTrackControl]>;
 
     /** Called when position is set from lua */
@@ -77,10 +91,10 @@ export class MultiTrackControl
     readonly doprint: Callback<[number, string, string, any?]>;
     readonly doclear: Callback<[]>;
 
-    constructor(engine: AudioEngine, ptr: number)
+    constructor(engine: AudioEngine, handle: number)
     {
         this.m_engine = engine;
-        this.m_ptr = ptr;
+        this.m_handle = handle;
 
         this.m_spectrum = new SpectrumAnalyzer();
         this.m_trackData = new EmBufferGroup();
@@ -90,6 +104,7 @@ export class MultiTrackControl
         this.onpause = new Callback;
         this.onupdate = new Callback;
         this.onmarker = new Callback;
+        this.ontrackevent = new Callback;
         this.onseek = new Callback;
         this.onload = new Callback;
         this.doprint = new Callback;
@@ -104,7 +119,7 @@ export class MultiTrackControl
         this.m_markers = new AudioMarkerMgr(this);
 
         const MultiTrackControl = getAudioModule().MultiTrackControl;
-        this.m_track = new MultiTrackControl(this.m_ptr, {
+        this.m_track = new MultiTrackControl(engine.engine, this.m_handle, {
             addMarker: (name: string, sec: number) => {
                 this.m_markers.push({
                     name: name, position: sec
@@ -184,8 +199,8 @@ export class MultiTrackControl
             clearConsole: () => {
                 this.doclear.invoke();
             },
-            transitionTo: (position: number, inTime: number, fadeIn: boolean, outTime: number, fadeOut: boolean) => {
-                this.transitionTo(position, inTime, fadeIn, outTime, fadeOut);
+            transitionTo: (position: number, inTime: number, fadeIn: boolean, outTime: number, fadeOut: boolean, clock: number) => {
+                this.transitionTo(position, inTime, fadeIn, outTime, fadeOut, clock);
             },
 
             setParameter: (index: number | string, value: number) => {
@@ -213,10 +228,21 @@ export class MultiTrackControl
             }
         });
 
+        // Playback events are polled from the engine once per update
+        this.m_track.onEvents(events => {
+            for (let i = 0; i < events.length; i += TRACK_EVENT_STRIDE)
+            {
+                const type = events[i] as TrackEventType;
+                if (type === TrackEventType.SyncPoint)
+                    this.m_markers.fire(events[i + 1], events[i + 3]);
+                else
+                    this.ontrackevent.invoke(type, events[i + 2], events[i + 3]);
+            }
+        });
+
         this.m_markers.onmarker.addListener((marker, clock) => {
 
-            // Notify Lua scripting
-            this.m_track.doMarker(marker.name, marker.position);
+            // Lua is notified by the engine directly
 
             // Local callbacks
             this.onmarker.invoke(marker);
@@ -298,6 +324,93 @@ export class MultiTrackControl
         this.m_track.transitionTo(position, inTime, fadeIn, outTime, fadeOut, clock);
     }
 
+    /**
+     * Transition to a new track position at the next beat, bar or marker.
+     * The boundary is calculated and scheduled by the engine from the track's
+     * tempo map, so timing does not depend on the main thread.
+     *
+     * @param position - position to seek to, in seconds
+     * @param quantize - musical boundary to transition at
+     *
+     * See `transitionTo` for the remaining parameters.
+     *
+     * @return DSP clock that the transition was scheduled at
+     */
+    transitionOn(quantize: Quantize, position: number, inTime: number, fadeIn: boolean, outTime: number, fadeOut: boolean): number
+    {
+        this.onseek.invoke(position);
+
+        return this.m_track.transitionToQuantized(position, quantize, inTime,
+            fadeIn, outTime, fadeOut);
+    }
+
+    /**
+     * Set the tempo map used by quantized transitions. Each tempo marker
+     * starts a new measure.
+     */
+    setTempoMap(points: {position: number, bpm: number, numerator?: number, denominator?: number}[])
+    {
+        this.m_track.clearTempoMap();
+        for (const point of points)
+        {
+            this.m_track.addTempoPoint(point.position, point.bpm,
+                point.numerator ?? 4, point.denominator ?? 4);
+        }
+    }
+
+    // ----- Stingers ---------------------------------------------------------
+
+    /**
+     * Decode a one-shot sample into the track's stinger pool, replacing any
+     * with the same name.
+     */
+    loadStinger(name: string, buffer: ArrayBuffer)
+    {
+        const data = new EmBuffer;
+        data.alloc(buffer, getAudioModule());
+
+        try {
+            this.m_track.loadStinger(name, data.ptr, data.size);
+        }
+        finally
+        {
+            data.free();
+        }
+    }
+
+    /**
+     * Play a loaded stinger over the track
+     *
+     * @param name     - name the stinger was loaded with
+     * @param quantize - musical boundary to start at
+     * @param priority - higher priority stingers steal voices from lower ones
+     * @param volume   - stinger volume
+     *
+     * @return voice index, or -1 if no voice was available
+     */
+    playStinger(name: string, quantize: Quantize = Quantize.None,
+        priority: number = 0, volume: number = 1): number
+    {
+        return this.m_track.playStinger(name, quantize, priority, volume);
+    }
+
+    stopStingers() { this.m_track.stopStingers(); }
+
+    set maxStingerVoices(max: number) { this.m_track.setMaxStingerVoices(max); }
+
+    /**
+     * Seconds ahead of the playhead that `onmarker` fires. Must be longer
+     * than the interval between updates, or markers fire late.
+     */
+    set markerLookahead(seconds: number) { this.m_track.setMarkerLookahead(seconds); }
+
+    /**
+     * Mix the stems in one DSP from their decoded copies, instead of one
+     * channel each. Transitions and sections throw while it is on.
+     */
+    get useStemMixer() { return this.m_track.getUseStemMixer(); }
+    set useStemMixer(use: boolean) { this.m_track.setUseStemMixer(use); }
+
     // ----- Loading / Unloading ----------------------------------------------
 
     /** Load audio internals after the main file buffer loading */
@@ -310,10 +423,9 @@ export class MultiTrackControl
         this.m_track.loadScript(opts.script || "");
 
         // Load markers
-        this.m_markers.clear();
         if (opts.markers) // if markers provided use these
         {
-            opts.markers.forEach(marker => this.m_markers.push(marker));
+            this.m_markers.assign(opts.markers);
         }
         else // otherwise get them from the track
         {
@@ -0,0 +1,11 @@
+/**
+ * Musical boundary that an engine-scheduled transition snaps to.
+ * Mirrors `Insound::Quantize` in the C++ engine.
+ */
+export enum Quantize
+{
+    None,
+    Beat,
+    Bar,
+    Marker,
+}
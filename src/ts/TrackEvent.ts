@@ -0,0 +1,14 @@
+/**
+ * Type of a playback event polled from the engine.
+ * Mirrors `Insound::TrackEvent::Type` in the C++ engine.
+ */
+export enum TrackEventType
+{
+    SyncPoint,
+    End,
+    LoopWrap,
+    Underrun,
+}
+
+/** Number of values per event in the array passed to `onEvents` */
+export const TRACK_EVENT_STRIDE = 4;
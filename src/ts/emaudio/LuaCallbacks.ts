@@ -15,7 +15,7 @@ export interface LuaCallbacks
     setPause(pause: boolean, seconds?: number): void;
     setPosition(seconds: number): void;
 
-    transitionTo(position: number, inTime: number, fadeIn: boolean, outTime: number, fadeOut: boolean): void;
+    transitionTo(position: number, inTime: number, fadeIn: boolean, outTime: number, fadeOut: boolean, clock: number): void;
 
     // --- mixer parameters ---------------------------------------------------
 
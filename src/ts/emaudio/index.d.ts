@@ -30,6 +30,42 @@ declare interface Vector<T> {
     delete();
 }
 
+/** Durations of one profiled section, in milliseconds */
+declare interface TimingStats {
+    name: string;
+    count: number;
+    min: number;
+    avg: number;
+    p99: number;
+    max: number;
+}
+
+declare interface TrackProfile {
+    /** handle retrieved from `createTrack` */
+    handle: number;
+    voices: number;
+    dsps: number;
+}
+
+declare interface ProfileSnapshot {
+    /** seconds covered by the timings */
+    window: number;
+    cpuDsp: number;
+    cpuStream: number;
+    cpuGeometry: number;
+    cpuUpdate: number;
+    cpuConvolution1: number;
+    cpuConvolution2: number;
+    /** must be deleted when done with */
+    timings: Vector<TimingStats>;
+    /** must be deleted when done with */
+    tracks: Vector<TrackProfile>;
+    /** bytes currently allocated by FMOD */
+    currentAlloc: number;
+    /** peak bytes allocated by FMOD */
+    maxAlloc: number;
+}
+
 declare interface InsoundAudioEngine {
 
     /**
@@ -66,18 +102,21 @@ declare interface InsoundAudioEngine {
     update(): void;
 
     /**
-     * Create track and get pointer to the new instance. Use the returned
-     * pointer as the argument for a new MultiTrackControl object.
+     * Create track and get a handle to the new instance. Use the returned
+     * handle as the argument for a new MultiTrackControl object.
+     *
+     * @throws if the maximum number of tracks is reached
      */
     createTrack(): number;
 
     /**
-     * Delete track pointer. Make sure to delete the pointer retrieved from
-     * createTrack when done with it to free memory.
+     * Delete a track. Make sure to delete each handle retrieved from
+     * createTrack when done with it to free memory. Stale handles are
+     * ignored.
      *
-     * @param {number} ptr - pointer to the track object
+     * @param {number} handle - handle of the track object
      */
-    deleteTrack(ptr: number): void;
+    deleteTrack(handle: number): void;
 
     /**
      * Get volume level of the master bus.
@@ -113,6 +152,187 @@ declare interface InsoundAudioEngine {
      * @return floating point number in percent from 0 to 100
      */
     getCPUUsageDSP(): number;
+
+    /**
+     * Attach a track to the engine transport, so that it plays, stops and
+     * seeks sample-aligned with all other attached tracks.
+     *
+     * @param handle - handle retrieved from `createTrack`
+     */
+    attachTrack(handle: number): void;
+
+    /**
+     * Detach a track from the engine transport.
+     *
+     * @param handle - handle retrieved from `createTrack`
+     */
+    detachTrack(handle: number): void;
+
+    /**
+     * Start all attached tracks at one common DSP clock.
+     *
+     * @param delay - seconds to wait before starting
+     */
+    transportStart(delay: number): void;
+
+    /**
+     * Stop all attached tracks at one common DSP clock.
+     *
+     * @param seconds - seconds to fade out
+     */
+    transportStop(seconds: number): void;
+
+    /**
+     * Seek all attached tracks to a position in seconds.
+     */
+    transportSeek(seconds: number): void;
+
+    /**
+     * Transition all attached tracks at one common DSP clock.
+     *
+     * @param quantize - 0: none, 1: next beat, 2: next bar, based on the
+     *                   transport tempo
+     */
+    transportTransitionTo(position: number, inTime: number, fadeIn: boolean,
+        outTime: number, fadeOut: boolean, quantize: number): void;
+
+    /**
+     * Set the transport tempo used for quantized transitions.
+     */
+    setTransportTempo(bpm: number, beatsPerBar: number): void;
+
+    /**
+     * Whether the transport is playing.
+     */
+    getTransportPlaying(): boolean;
+
+    /**
+     * Set the latency profile. Before `init` it picks the buffer
+     * configuration to initialize with. Afterward, the output re-initializes
+     * on an update where no track is loading or transitioning, moving loaded
+     * tracks over.
+     *
+     * @param profile - `LatencyProfile` value
+     */
+    setLatencyProfile(profile: number): void;
+
+    /**
+     * Set how many channels are actually mixed, 64 by default. Beyond it the
+     * least important and least audible channels play virtually. Changes
+     * after `init` apply along with latency profile changes.
+     */
+    setVoiceBudget(voices: number): void;
+
+    /**
+     * Get the voice budget and how many voices are playing.
+     */
+    getVoiceStats(): {budget: number, playing: number, real: number,
+        pending: boolean};
+
+    /**
+     * Get the requested `LatencyProfile` value.
+     */
+    getLatencyProfile(): number;
+
+    /**
+     * Get the current buffer configuration and glitch counts.
+     */
+    getLatencyStats(): {profile: number, active: number,
+        bufferLength: number, bufferCount: number, latency: number,
+        underruns: number, reinits: number, failedReinits: number,
+        pending: boolean};
+
+    /**
+     * Get a profile of the last sampling window: CPU usage breakdown,
+     * engine, track and Lua timings, per-track voices and DSPs, and FMOD
+     * allocation counters.
+     */
+    getProfile(): ProfileSnapshot;
+
+    /**
+     * Discard recorded timings and start a new sampling window.
+     */
+    resetProfile(): void;
+
+    /**
+     * Get glitch counters and worst-case timings in seconds, since init or
+     * the last `resetGlitchStats`. `lastGlitch` is -1 if there was none.
+     */
+    getGlitchStats(): {underruns: number, overloads: number,
+        lateMixes: number, lateUpdates: number, lastGlitch: number,
+        maxMix: number, maxMixInterval: number, maxUpdateInterval: number};
+
+    resetGlitchStats(): void;
+
+    /**
+     * Set the maximum bytes of FMOD, decoded PCM and Lua memory, shared by
+     * all engines. Loading a bank that would exceed it throws. 0 (default)
+     * is unlimited.
+     */
+    setMemoryBudget(bytes: number): void;
+
+    /**
+     * Get live and peak bytes per subsystem, and how many allocations the
+     * budget refused.
+     */
+    getMemoryStats(): {budget: number, live: number, peak: number,
+        fmodLive: number, fmodPeak: number, pcmLive: number, pcmPeak: number,
+        luaLive: number, luaPeak: number, engineLive: number,
+        enginePeak: number, failures: number, lastFailure: number};
+
+    /** Reset memory peaks to current usage, and the refusal counter */
+    resetMemoryPeaks(): void;
+
+    /**
+     * Set a callback fired during `update` for each glitch detected.
+     *
+     * @param callback - receives the `GlitchType`, the time in seconds since
+     *                   engine creation, the measured duration in seconds and
+     *                   the mixer DSP clock; null to remove it
+     */
+    setGlitchCallback(callback: ((type: number, time: number,
+        duration: number, clock: number) => void) | null): void;
+
+    /**
+     * Queue an fsb bank to play after the ones already queued. The data is
+     * copied, so it may be freed right after.
+     *
+     * @param crossfade  - seconds to crossfade into the following bank
+     * @param exitMarker - marker to leave this bank at, "" for its loop end
+     */
+    playlistEnqueue(data: number, bytelength: number, crossfade: number,
+        exitMarker: string): void;
+    /** Start the playlist, once its first bank is loaded */
+    playlistPlay(seconds: number): void;
+    playlistStop(seconds: number): void;
+    /**
+     * Switch to the next bank now, if it is loaded.
+     * @returns whether the switch was scheduled
+     */
+    playlistSkip(crossfade: number): boolean;
+    /** Stop the playlist and empty its queue */
+    playlistClear(): void;
+    /** Number of banks queued, including the one playing */
+    getPlaylistSize(): number;
+    /** Number of switches made since the last clear */
+    getPlaylistPlayed(): number;
+    /** Whether the bank after the current one is loaded */
+    getPlaylistPreloaded(): boolean;
+    /**
+     * Set a callback fired during `update` after each switch between banks,
+     * with the number of switches made; null to remove it
+     */
+    setPlaylistCallback(callback: ((played: number) => void) | null): void;
+
+    /**
+     * Set whether timings are recorded, on by default.
+     */
+    setProfiling(enabled: boolean): void;
+
+    /**
+     * Set the length of a profiling sampling window in seconds, 1 by default.
+     */
+    setProfileWindow(seconds: number): void;
 }
 
 declare interface InsoundMultiTrackControl
@@ -135,6 +355,12 @@ declare interface InsoundMultiTrackControl
     getVolume(ch: number): void;
     setReverbLevel(ch: number, level: number): void;
     getReverbLevel(ch: number): number;
+    /**
+     * Set the voice priority of the track (ch 0, 0: most important to 256)
+     * or a channel's offset to it (ch 1-chSize).
+     */
+    setPriority(ch: number, priority: number): void;
+    getPriority(ch: number): number;
     setPanLeft(ch: number, level: number): void;
     getPanLeft(ch: number): number;
     setPanRight(ch: number, level: number): void;
@@ -146,27 +372,80 @@ declare interface InsoundMultiTrackControl
     transitionTo(position: number, inTime: number, fadeIn: boolean,
         outTime: number, fadeOut: boolean, clock: number): void;
 
+    /**
+     * Transition at the next beat, bar or marker, scheduled by the engine.
+     * @return DSP clock the transition was scheduled at
+     */
+    transitionToQuantized(position: number, quantize: number, inTime: number,
+        fadeIn: boolean, outTime: number, fadeOut: boolean): number;
+
+    addTempoPoint(seconds: number, bpm: number, numerator: number,
+        denominator: number): void;
+    clearTempoMap(): void;
+
+    loadStinger(name: string, data: number, bytelength: number): void;
+    /**
+     * @returns voice index, or -1 if all voices were busy with higher
+     *          priority stingers
+     */
+    playStinger(name: string, quantize: number, priority: number,
+        volume: number): number;
+    stopStingers(): void;
+    setMaxStingerVoices(max: number): void;
+    clearStingers(): void;
+
     getLength(): number;
     getChannelCount(): number;
     getAudibility(ch: number): number;
     setLoopPoint(startMs: number, endMs: number): void; // in ms
     getLoopPoint(): {start: number, end: number}; // in ms
 
+    /** Skew between stems in PCM samples, measured each engine update */
+    getSyncStats(): {checks: number, resyncs: number, lastSkew: number,
+        maxSkew: number, totalSkew: number};
+    resetSyncStats(): void;
+    setSyncThreshold(samples: number): void;
+    /**
+     * Mix the stems in one DSP from their decoded copies, instead of one
+     * channel each. Transitions throw while it is in use.
+     */
+    setUseStemMixer(use: boolean): void;
+    getUseStemMixer(): boolean;
+
     addSyncPoint(label: string, ms: number): boolean;
     deleteSyncPoint(index: number): boolean;
     editSyncPoint(index: number, label: string, ms: number): boolean;
     getSyncPointCount(): number;
     getSyncPoint(index: number): {name: string, position: number}; //offset in ms
+    /** Replace all sync points, offsets in seconds, one label per offset */
+    setSyncPoints(offsets: Float64Array, labels: string[]): void;
+    getSyncPoints(): {offsets: Float64Array, labels: string[]};
     getSampleData(index: number): {ptr: number, byteLength: number};
 
-    onSyncPoint(
-        callback: (name: string, offset: number, index: number) => void): void;
+    /**
+     * Receives the playback events polled each update, as
+     * `[type, index, position, clock]` per event. The array views engine
+     * memory and is only valid during the callback.
+     */
+    onEvents(callback: (events: Float64Array) => void): void;
+    /** Seconds ahead of the playhead that sync points are dispatched */
+    setMarkerLookahead(seconds: number): void;
     doMarker(name: string, ms: number): void;
 
     samplerate(): number;
     dspClock(): number;
 
     setParameter(name: string, value: number | string): void;
+
+    addSection(name: string, start: number, end: number): void;
+    addSectionExit(section: string,
+        conditions: {param: string, op: number, value: number}[],
+        target: string, quantize: number, inTime: number, fadeIn: boolean,
+        outTime: number, fadeOut: boolean): void;
+    clearSections(): void;
+    startSection(name: string): void;
+    getCurrentSection(): string;
+    setSequencerLookahead(seconds: number): void;
 }
 
 declare interface InsoundAudioModule extends EmscriptenModule {
@@ -175,7 +454,8 @@ declare interface InsoundAudioModule extends EmscriptenModule {
     }
 
     MultiTrackControl: {
-        new (ptr: number, callbacks: LuaCallbacks): InsoundMultiTrackControl;
+        new (engine: InsoundAudioEngine, handle: number,
+            callbacks: LuaCallbacks): InsoundMultiTrackControl;
     }
 
     ParamType: ParamType;